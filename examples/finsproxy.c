@@ -0,0 +1,160 @@
+/*
+ * Library: libfins
+ * File:    examples/finsproxy.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file examples/finsproxy.c contains a small daemon which runs the
+ * libfins FINS proxy. Local FINS/TCP and FINS/UDP clients connect to the proxy
+ * which forwards their commands over a limited number of connections to one or
+ * more PLCs.
+ *
+ * Usage: finsproxy [-u] [-n node] [-p port] plc[:port][,match_node[,pool]] ...
+ *
+ *   -u		Use FINS/UDP instead of FINS/TCP to communicate with the PLCs
+ *   -n node	FINS node number of the proxy reported to its clients
+ *   -p port	Port on which the proxy accepts clients
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+static void	usage( const char *prog );
+
+/*
+ * int main( int argc, char *argv[] );
+ *
+ * Entry point of the FINS proxy daemon.
+ */
+
+int main( int argc, char *argv[] ) {
+
+	int a;
+	int retval;
+	int error_val;
+	int proxy_node;
+	int proxy_port;
+	int match_node;
+	int pool_size;
+	int plc_port;
+	uint8_t comm_type;
+	char *ptr;
+	char address[128];
+	char errbuf[128];
+	struct fins_proxy_tp *proxy;
+
+#if defined(_WIN32)
+	WSADATA wsa_data;
+
+	WSAStartup( MAKEWORD(2,2), & wsa_data );
+#endif  /* defined(_WIN32) */
+
+	comm_type  = FINS_COMM_TYPE_TCP;
+	proxy_node = 250;
+	proxy_port = FINS_DEFAULT_PORT;
+
+	for (a=1; a<argc  &&  argv[a][0] == '-'; a++) {
+
+		if      ( ! strcmp( argv[a], "-u" )              ) comm_type  = FINS_COMM_TYPE_UDP;
+		else if ( ! strcmp( argv[a], "-n" )  &&  a+1 < argc ) proxy_node = atoi( argv[++a] );
+		else if ( ! strcmp( argv[a], "-p" )  &&  a+1 < argc ) proxy_port = atoi( argv[++a] );
+		else { usage( argv[0] ); return EXIT_FAILURE; }
+	}
+
+	if ( a >= argc ) { usage( argv[0] ); return EXIT_FAILURE; }
+
+	proxy = finslib_proxy_create( (uint16_t) proxy_port, (uint8_t) proxy_node, & error_val );
+
+	if ( proxy == NULL ) {
+
+		fprintf( stderr, "finsproxy: %s\n", finslib_errmsg( error_val, errbuf, sizeof(errbuf) ) );
+		return EXIT_FAILURE;
+	}
+
+	for (; a<argc; a++) {
+
+		match_node = 0;
+		pool_size  = 1;
+		plc_port   = FINS_DEFAULT_PORT;
+
+		snprintf( address, sizeof(address), "%s", argv[a] );
+
+		ptr = strchr( address, ',' );
+
+		if ( ptr != NULL ) {
+
+			*ptr++     = 0;
+			match_node = atoi( ptr );
+			ptr        = strchr( ptr, ',' );
+
+			if ( ptr != NULL ) pool_size = atoi( ptr+1 );
+		}
+
+		ptr = strchr( address, ':' );
+
+		if ( ptr != NULL ) {
+
+			*ptr++   = 0;
+			plc_port = atoi( ptr );
+		}
+
+		retval = finslib_proxy_add_upstream( proxy, (uint8_t) match_node, comm_type, address, (uint16_t) plc_port, 0, (uint8_t) proxy_node, 0, 0, 0, (size_t) pool_size );
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			fprintf( stderr, "finsproxy: %s: %s\n", address, finslib_errmsg( retval, errbuf, sizeof(errbuf) ) );
+			finslib_proxy_destroy( proxy );
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (;;) {
+
+		retval = finslib_proxy_poll( proxy, 100 );
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			fprintf( stderr, "finsproxy: %s\n", finslib_errmsg( retval, errbuf, sizeof(errbuf) ) );
+			finslib_milli_second_sleep( 100 );
+		}
+	}
+
+}  /* main */
+
+/*
+ * static void usage( const char *prog );
+ *
+ * The function usage() shows how the program must be called.
+ */
+
+static void usage( const char *prog ) {
+
+	fprintf( stderr, "Usage: %s [-u] [-n node] [-p port] plc[:port][,match_node[,pool]] ...\n", prog );
+
+}  /* usage */
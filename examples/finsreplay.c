@@ -0,0 +1,581 @@
+/*
+ * Library: libfins
+ * File:    examples/finsreplay.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file examples/finsreplay.c contains a tool which replays a FINS
+ * capture file recorded with finslib_capture_start(). It can act as the PLC
+ * side of the session, answering the recorded requests with the recorded
+ * responses, or as the client side, sending the recorded requests again to a
+ * real or simulated PLC and comparing the response times with the original.
+ *
+ * The original timing is preserved by default. It can be accelerated or
+ * slowed down with a speed factor. A speed factor of 0 replays all frames as
+ * fast as possible.
+ *
+ * Usage: finsreplay [-u] [-n node] [-p port] [-x speed] -s capture
+ *        finsreplay [-u] [-n node] [-p port] [-x speed] -c plc capture
+ *
+ *   -u		Use FINS/UDP instead of FINS/TCP
+ *   -n node	FINS node number of the replay tool
+ *   -p port	Port to listen on with -s, or port of the PLC with -c
+ *   -x speed	Speed factor relative to the original timing
+ *   -s		Act as the PLC and answer with the recorded responses
+ *   -c plc	Act as the client and send the recorded requests to a PLC
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <unistd.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+#define NO_FRAME		((size_t) -1)
+#define MAX_CMDSTATS		64
+
+									/********************************************************/
+struct replay_pair_tp {							/*							*/
+	size_t			request;				/* Index of the request frame				*/
+	size_t			response;				/* Index of the response frame or NO_FRAME		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct replay_cmdstats_tp {						/*							*/
+	uint8_t			mrc;					/* Main Request Code of the command			*/
+	uint8_t			src;					/* Sub Request Code of the command			*/
+	uint64_t		count;					/* Number of commands replayed				*/
+	uint64_t		errors;					/* Number of commands which failed			*/
+	int64_t			recorded_nsec;				/* Sum of the recorded round trip times			*/
+	int64_t			replayed_nsec;				/* Sum of the replayed round trip times			*/
+	int64_t			replayed_max;				/* Longest replayed round trip time			*/
+};									/*							*/
+									/********************************************************/
+
+static struct fins_capframe_tp *	frames;
+static size_t				num_frames;
+static struct replay_pair_tp *		pairs;
+static size_t				num_pairs;
+static size_t				cursor;
+static double				speed;
+
+static void	answer_request( const struct fins_command_tp *request, size_t bodylen, struct fins_command_tp *response, size_t *resplen );
+static size_t	find_pair( const struct fins_command_tp *request, size_t bodylen, bool match_body, size_t start );
+static int	load_capture( const char *filename );
+static int	run_client( const char *plc, uint16_t port, uint8_t comm_type, uint8_t node );
+static int	run_server( uint16_t port, uint8_t comm_type, uint8_t node );
+static bool	recv_exact( SOCKET sockfd, unsigned char *buf, size_t len );
+static void	serve_tcp_client( SOCKET sockfd, uint8_t node );
+static void	usage( const char *prog );
+static void	wait_until( int64_t start, int64_t offset );
+
+/*
+ * int main( int argc, char *argv[] );
+ *
+ * Entry point of the FINS replay tool.
+ */
+
+int main( int argc, char *argv[] ) {
+
+	int a;
+	int retval;
+	int node;
+	int port;
+	bool server;
+	uint8_t comm_type;
+	const char *plc;
+	char errbuf[128];
+
+#if defined(_WIN32)
+	WSADATA wsa_data;
+
+	WSAStartup( MAKEWORD(2,2), & wsa_data );
+#endif  /* defined(_WIN32) */
+
+	comm_type = FINS_COMM_TYPE_TCP;
+	node      = 250;
+	port      = FINS_DEFAULT_PORT;
+	speed     = 1.0;
+	server    = false;
+	plc       = NULL;
+
+	for (a=1; a<argc  &&  argv[a][0] == '-'; a++) {
+
+		if      ( ! strcmp( argv[a], "-u" )                  ) comm_type = FINS_COMM_TYPE_UDP;
+		else if ( ! strcmp( argv[a], "-s" )                  ) server    = true;
+		else if ( ! strcmp( argv[a], "-n" )  &&  a+1 < argc ) node      = atoi( argv[++a] );
+		else if ( ! strcmp( argv[a], "-p" )  &&  a+1 < argc ) port      = atoi( argv[++a] );
+		else if ( ! strcmp( argv[a], "-x" )  &&  a+1 < argc ) speed     = atof( argv[++a] );
+		else if ( ! strcmp( argv[a], "-c" )  &&  a+1 < argc ) plc       = argv[++a];
+		else { usage( argv[0] ); return EXIT_FAILURE; }
+	}
+
+	if ( a+1 != argc  ||  server == ( plc != NULL )  ||  speed < 0.0 ) { usage( argv[0] ); return EXIT_FAILURE; }
+
+	retval = load_capture( argv[a] );
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		fprintf( stderr, "finsreplay: %s: %s\n", argv[a], finslib_errmsg( retval, errbuf, sizeof(errbuf) ) );
+		return EXIT_FAILURE;
+	}
+
+	if ( server ) retval = run_server( (uint16_t) port, comm_type, (uint8_t) node );
+	else          retval = run_client( plc, (uint16_t) port, comm_type, (uint8_t) node );
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		fprintf( stderr, "finsreplay: %s\n", finslib_errmsg( retval, errbuf, sizeof(errbuf) ) );
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+}  /* main */
+
+/*
+ * static int load_capture( const char *filename );
+ *
+ * The function load_capture() reads all frames from a capture file in memory
+ * and pairs every request with the response which has the same Service ID
+ * and command code.
+ */
+
+static int load_capture( const char *filename ) {
+
+	int retval;
+	size_t a;
+	size_t b;
+	size_t allocated;
+	bool *paired;
+	struct fins_capframe_tp *ptr;
+	struct fins_capture_tp *capture;
+
+	capture = finslib_capture_open( filename, & retval );
+	if ( capture == NULL ) return retval;
+
+	allocated = 0;
+
+	do {
+		if ( num_frames >= allocated ) {
+
+			allocated = ( allocated > 0 ) ? 2*allocated : 256;
+			ptr       = realloc( frames, allocated * sizeof(struct fins_capframe_tp) );
+
+			if ( ptr == NULL ) {
+
+				finslib_capture_close( capture );
+				return FINS_RETVAL_OUT_OF_MEMORY;
+			}
+
+			frames = ptr;
+		}
+
+		retval = finslib_capture_next( capture, & frames[num_frames] );
+		if ( retval == FINS_RETVAL_SUCCESS ) num_frames++;
+
+	} while ( retval == FINS_RETVAL_SUCCESS );
+
+	finslib_capture_close( capture );
+
+	if ( retval != FINS_RETVAL_CAPTURE_END ) return retval;
+
+	pairs  = calloc( num_frames + 1, sizeof(struct replay_pair_tp) );
+	paired = calloc( num_frames + 1, sizeof(bool) );
+
+	if ( pairs == NULL  ||  paired == NULL ) {
+
+		free( paired );
+		return FINS_RETVAL_OUT_OF_MEMORY;
+	}
+
+	for (a=0; a<num_frames; a++) {
+
+		if ( frames[a].direction != FINS_CAPTURE_SENT ) continue;
+
+		pairs[num_pairs].request  = a;
+		pairs[num_pairs].response = NO_FRAME;
+
+		for (b=a+1; b<num_frames; b++) {
+
+			if ( frames[b].direction                     != FINS_CAPTURE_RECEIVED                 ) continue;
+			if ( paired[b]                                                                        ) continue;
+			if ( frames[b].frame.header[FINS_SID]        != frames[a].frame.header[FINS_SID]      ) continue;
+			if ( frames[b].frame.header[FINS_MRC]        != frames[a].frame.header[FINS_MRC]      ) continue;
+			if ( frames[b].frame.header[FINS_SRC]        != frames[a].frame.header[FINS_SRC]      ) continue;
+
+			pairs[num_pairs].response = b;
+			paired[b]                 = true;
+
+			break;
+		}
+
+		num_pairs++;
+	}
+
+	free( paired );
+
+	printf( "finsreplay: %zu frames, %zu requests loaded\n", num_frames, num_pairs );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* load_capture */
+
+/*
+ * static int run_server( uint16_t port, uint8_t comm_type, uint8_t node );
+ *
+ * The function run_server() acts as the PLC side of the recorded session.
+ * Clients are served one at a time to keep the replay deterministic.
+ */
+
+static int run_server( uint16_t port, uint8_t comm_type, uint8_t node ) {
+
+	int recvlen;
+	int error_val;
+	size_t resplen;
+	SOCKET listenfd;
+	SOCKET sockfd;
+	socklen_t addrlen;
+	struct sockaddr_in cs_addr;
+	struct fins_command_tp request;
+	struct fins_command_tp response;
+
+	listenfd = XX_finslib_server_socket( comm_type, port, & error_val );
+	if ( listenfd == INVALID_SOCKET ) return error_val;
+
+	printf( "finsreplay: answering on %s port %u\n", ( comm_type == FINS_COMM_TYPE_TCP ) ? "TCP" : "UDP", (unsigned int) port );
+	fflush( stdout );
+
+	for (;;) {
+
+		if ( comm_type == FINS_COMM_TYPE_TCP ) {
+
+			sockfd = XX_finslib_server_accept( listenfd );
+			if ( sockfd == INVALID_SOCKET ) continue;
+
+			serve_tcp_client( sockfd, node );
+			closesocket( sockfd );
+
+			continue;
+		}
+
+		addrlen = sizeof(cs_addr);
+		recvlen = recvfrom( listenfd, (char *) request.header, FINS_HEADER_LEN + FINS_BODY_LEN, 0, (struct sockaddr *) & cs_addr, & addrlen );
+
+		if ( recvlen < FINS_HEADER_LEN ) continue;
+
+		answer_request( & request, (size_t) recvlen - FINS_HEADER_LEN, & response, & resplen );
+
+		sendto( listenfd, (const char *) response.header, (int) ( FINS_HEADER_LEN + resplen ), 0, (const struct sockaddr *) & cs_addr, addrlen );
+	}
+
+}  /* run_server */
+
+/*
+ * static void serve_tcp_client( SOCKET sockfd, uint8_t node );
+ *
+ * The function serve_tcp_client() handles the node address handshake and all
+ * FINS frames of one FINS/TCP client until the client disconnects.
+ */
+
+static void serve_tcp_client( SOCKET sockfd, uint8_t node ) {
+
+	int error_val;
+	size_t msglen;
+	size_t resplen;
+	uint32_t command;
+	unsigned char msg[16 + FINS_HEADER_LEN + FINS_BODY_LEN];
+	unsigned char answer[24];
+	struct fins_command_tp request;
+	struct fins_command_tp response;
+
+	for (;;) {
+
+		if ( ! recv_exact( sockfd, msg, 16 ) ) return;
+
+		msglen = XX_finslib_server_tcp_message_len( msg, 16, & error_val );
+
+		if ( msglen < 16  ||  msglen > sizeof(msg) ) return;
+		if ( ! recv_exact( sockfd, msg+16, msglen-16 ) ) return;
+
+		command = ( (uint32_t) msg[8] << 24 ) | ( (uint32_t) msg[9] << 16 ) | ( (uint32_t) msg[10] << 8 ) | msg[11];
+
+		if ( command == 0x00000000  &&  msglen >= 20 ) {
+
+			XX_finslib_server_tcp_header( answer, 0x00000001, 0x00000000, 8 );
+
+			answer[16] = 0x00;
+			answer[17] = 0x00;
+			answer[18] = 0x00;
+			answer[19] = ( msg[19] != 0 ) ? msg[19] : (uint8_t) ( ( node == 1 ) ? 2 : 1 );
+			answer[20] = 0x00;
+			answer[21] = 0x00;
+			answer[22] = 0x00;
+			answer[23] = node;
+
+			if ( send( sockfd, (const char *) answer, 24, 0 ) != 24 ) return;
+
+			continue;
+		}
+
+		if ( command != 0x00000002  ||  msglen < 16 + FINS_HEADER_LEN ) return;
+
+		memcpy( request.header, msg + 16,                   FINS_HEADER_LEN                );
+		memcpy( request.body,   msg + 16 + FINS_HEADER_LEN, msglen - 16 - FINS_HEADER_LEN );
+
+		answer_request( & request, msglen - 16 - FINS_HEADER_LEN, & response, & resplen );
+
+		if ( XX_finslib_server_send_tcp_frame( sockfd, & response, resplen ) != FINS_RETVAL_SUCCESS ) return;
+	}
+
+}  /* serve_tcp_client */
+
+/*
+ * static void answer_request( const struct fins_command_tp *request, size_t bodylen, struct fins_command_tp *response, size_t *resplen );
+ *
+ * The function answer_request() searches the recorded response for a request
+ * and waits the recorded response time divided by the speed factor before
+ * returning it. Recorded requests are preferably matched in order and with an
+ * identical body. If no recorded request with the same command code exists,
+ * the response contains the end code for an unsupported command.
+ */
+
+static void answer_request( const struct fins_command_tp *request, size_t bodylen, struct fins_command_tp *response, size_t *resplen ) {
+
+	size_t index;
+	int64_t start;
+	const struct fins_capframe_tp *recorded;
+
+	start = finslib_monotonic_nsec_timer();
+
+	index = find_pair( request, bodylen, true, cursor );
+	if ( index == NO_FRAME ) index = find_pair( request, bodylen, true,  0      );
+	if ( index == NO_FRAME ) index = find_pair( request, bodylen, false, cursor );
+	if ( index == NO_FRAME ) index = find_pair( request, bodylen, false, 0      );
+
+	if ( index == NO_FRAME ) {
+
+		response->body[0] = 0x04;
+		response->body[1] = 0x01;
+		*resplen          = 2;
+	}
+
+	else {
+		cursor   = index + 1;
+		recorded = & frames[ pairs[index].response ];
+
+		memcpy( response->body, recorded->frame.body, recorded->bodylen );
+		*resplen = recorded->bodylen;
+
+		if ( speed > 0.0 ) wait_until( start, (int64_t) ( (double) ( recorded->nsec - frames[ pairs[index].request ].nsec ) / speed ) );
+	}
+
+	XX_finslib_response_header( response, request->header );
+
+}  /* answer_request */
+
+/*
+ * static size_t find_pair( const struct fins_command_tp *request, size_t bodylen, bool match_body, size_t start );
+ *
+ * The function find_pair() returns the index of the first recorded request
+ * with a response at or after position start which has the same command code
+ * as a received request, and optionally the same body.
+ */
+
+static size_t find_pair( const struct fins_command_tp *request, size_t bodylen, bool match_body, size_t start ) {
+
+	size_t a;
+	const struct fins_capframe_tp *recorded;
+
+	for (a=start; a<num_pairs; a++) {
+
+		if ( pairs[a].response == NO_FRAME ) continue;
+
+		recorded = & frames[ pairs[a].request ];
+
+		if ( recorded->frame.header[FINS_MRC] != request->header[FINS_MRC] ) continue;
+		if ( recorded->frame.header[FINS_SRC] != request->header[FINS_SRC] ) continue;
+
+		if ( match_body  &&  ( recorded->bodylen != bodylen  ||  memcmp( recorded->frame.body, request->body, bodylen ) != 0 ) ) continue;
+
+		return a;
+	}
+
+	return NO_FRAME;
+
+}  /* find_pair */
+
+/*
+ * static int run_client( const char *plc, uint16_t port, uint8_t comm_type, uint8_t node );
+ *
+ * The function run_client() acts as the client side of the recorded session
+ * and sends all recorded requests to a PLC with the recorded spacing divided
+ * by the speed factor. The recorded and replayed response times are printed
+ * per command code afterwards.
+ */
+
+static int run_client( const char *plc, uint16_t port, uint8_t comm_type, uint8_t node ) {
+
+	int retval;
+	int error_val;
+	size_t a;
+	size_t b;
+	size_t bodylen;
+	size_t num_cmdstats;
+	int64_t start;
+	int64_t sent;
+	int64_t rtt;
+	const struct fins_capframe_tp *recorded;
+	struct fins_sys_tp *sys;
+	struct fins_command_tp command;
+	struct replay_cmdstats_tp cmdstats[MAX_CMDSTATS];
+	struct replay_cmdstats_tp *cs;
+
+	if ( comm_type == FINS_COMM_TYPE_TCP ) sys = finslib_tcp_connect( NULL, plc, port, 0, node, 0, 0, 0, 0, & error_val, 0 );
+	else                                   sys = finslib_udp_connect( NULL, plc, port, 0, node, 0, 0, 0, 0, & error_val, 0 );
+
+	if ( sys == NULL ) return error_val;
+
+	num_cmdstats = 0;
+	start        = finslib_monotonic_nsec_timer();
+
+	for (a=0; a<num_pairs; a++) {
+
+		recorded = & frames[ pairs[a].request ];
+
+		if ( speed > 0.0 ) wait_until( start, (int64_t) ( (double) ( recorded->nsec - frames[ pairs[0].request ].nsec ) / speed ) );
+
+		XX_finslib_init_command( sys, & command, recorded->frame.header[FINS_MRC], recorded->frame.header[FINS_SRC] );
+
+		bodylen = recorded->bodylen;
+		memcpy( command.body, recorded->frame.body, bodylen );
+
+		sent   = finslib_monotonic_nsec_timer();
+		retval = XX_finslib_communicate( sys, & command, & bodylen, pairs[a].response != NO_FRAME );
+		rtt    = finslib_monotonic_nsec_timer() - sent;
+
+		for (b=0; b<num_cmdstats; b++) if ( cmdstats[b].mrc == recorded->frame.header[FINS_MRC]  &&  cmdstats[b].src == recorded->frame.header[FINS_SRC] ) break;
+
+		if ( b >= MAX_CMDSTATS ) continue;
+
+		cs = & cmdstats[b];
+
+		if ( b == num_cmdstats ) {
+
+			memset( cs, 0, sizeof(struct replay_cmdstats_tp) );
+			cs->mrc = recorded->frame.header[FINS_MRC];
+			cs->src = recorded->frame.header[FINS_SRC];
+			num_cmdstats++;
+		}
+
+		cs->count++;
+		if ( retval != FINS_RETVAL_SUCCESS ) cs->errors++;
+
+		if ( pairs[a].response != NO_FRAME ) {
+
+			cs->recorded_nsec += frames[ pairs[a].response ].nsec - recorded->nsec;
+			cs->replayed_nsec += rtt;
+			if ( rtt > cs->replayed_max ) cs->replayed_max = rtt;
+		}
+	}
+
+	printf( "finsreplay: %zu requests replayed in %.3f s\n", num_pairs, (double) ( finslib_monotonic_nsec_timer() - start ) / 1e9 );
+	printf( "command     count  errors  recorded avg  replayed avg  replayed max\n" );
+
+	for (b=0; b<num_cmdstats; b++) {
+
+		cs = & cmdstats[b];
+
+		printf( "%02X %02X  %10llu  %6llu  %9.3f ms  %9.3f ms  %9.3f ms\n", cs->mrc, cs->src, (unsigned long long) cs->count, (unsigned long long) cs->errors,
+				(double) cs->recorded_nsec / 1e6 / (double) cs->count,
+				(double) cs->replayed_nsec / 1e6 / (double) cs->count,
+				(double) cs->replayed_max  / 1e6 );
+	}
+
+	finslib_disconnect( sys );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* run_client */
+
+/*
+ * static void wait_until( int64_t start, int64_t offset );
+ *
+ * The function wait_until() sleeps until offset nanoseconds have passed since
+ * the monotonic time start.
+ */
+
+static void wait_until( int64_t start, int64_t offset ) {
+
+	int64_t remaining;
+
+	remaining = start + offset - finslib_monotonic_nsec_timer();
+
+	if ( remaining >= 1000000 ) finslib_milli_second_sleep( (int) ( remaining / 1000000 ) );
+
+}  /* wait_until */
+
+/*
+ * static bool recv_exact( SOCKET sockfd, unsigned char *buf, size_t len );
+ *
+ * The function recv_exact() receives exactly len bytes from a socket. False
+ * is returned if the connection is closed or an error occurs.
+ */
+
+static bool recv_exact( SOCKET sockfd, unsigned char *buf, size_t len ) {
+
+	int recvlen;
+
+	while ( len > 0 ) {
+
+		recvlen = recv( sockfd, (char *) buf, (int) len, 0 );
+		if ( recvlen <= 0 ) return false;
+
+		buf += recvlen;
+		len -= (size_t) recvlen;
+	}
+
+	return true;
+
+}  /* recv_exact */
+
+/*
+ * static void usage( const char *prog );
+ *
+ * The function usage() shows how the program must be called.
+ */
+
+static void usage( const char *prog ) {
+
+	fprintf( stderr, "Usage: %s [-u] [-n node] [-p port] [-x speed] -s capture\n", prog );
+	fprintf( stderr, "       %s [-u] [-n node] [-p port] [-x speed] -c plc capture\n", prog );
+
+}  /* usage */
@@ -54,6 +54,12 @@
 #define INVALID_SOCKET				(-1)
 typedef int					SOCKET;
 #define closesocket				close
+#endif  /* defined(_WIN32) */
+
+#if defined(_WIN32)
+#define FINS_MEMORY_BARRIER()			MemoryBarrier()
+#else  /* defined(_WIN32) */
+#define FINS_MEMORY_BARRIER()			__sync_synchronize()
 #endif  /* defined(_WIN32) */
 
 									/********************************************************/
@@ -93,6 +99,82 @@ typedef int					SOCKET;
 
 #define FINS_TIMEOUT				60
 
+#define FINS_CACHE_DEFAULT_ENTRIES		32			/* Default number of entries in a read cache		*/
+
+									/********************************************************/
+									/*							*/
+#define FINS_STATS_MAX_COMMANDS			64			/* Max number of command codes with statistics		*/
+#define FINS_STATS_RTT_BUCKETS			200			/* Number of round trip time histogram buckets		*/
+									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+									/*							*/
+#define FINS_TRACE_BUILD			0x01			/* A command is being built				*/
+#define FINS_TRACE_SEND_START			0x02			/* Sending of a command starts				*/
+#define FINS_TRACE_SEND_END			0x03			/* Sending of a command has finished			*/
+#define FINS_TRACE_RECV_FIRST			0x04			/* The first part of a response has been received	*/
+#define FINS_TRACE_RECV_END			0x05			/* The complete response has been received		*/
+#define FINS_TRACE_DECODE_END			0x06			/* The response has been checked and decoded		*/
+									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+									/*							*/
+#define FINS_CAPTURE_SENT			0x01			/* Frame sent to the remote node			*/
+#define FINS_CAPTURE_RECEIVED			0x02			/* Frame received from the remote node			*/
+									/*							*/
+									/********************************************************/
+
+#if defined(FINS_ENABLE_TRACE)
+#define XX_FINS_TRACE(sys,event,header,retval)	do { if ( (sys) != NULL  &&  (sys)->trace != NULL ) XX_finslib_trace( (sys), (event), (header), (retval) ); } while ( false )
+#else  /* defined(FINS_ENABLE_TRACE) */
+#define XX_FINS_TRACE(sys,event,header,retval)	do { } while ( false )
+#endif  /* defined(FINS_ENABLE_TRACE) */
+
+									/********************************************************/
+									/*							*/
+#define FINS_PROXY_MAX_CLIENTS			64			/* Max number of FINS/TCP clients of a proxy		*/
+#define FINS_PROXY_MAX_ROUTES			16			/* Max number of upstream PLCs of a proxy		*/
+#define FINS_PROXY_MAX_POOL			4			/* Max number of connections to one upstream PLC	*/
+#define FINS_PROXY_MAX_IN_FLIGHT		8			/* Max commands waiting for a response per connection	*/
+#define FINS_PROXY_MAX_WAITERS			16			/* Max clients sharing one coalesced read		*/
+#define FINS_PROXY_QUEUE_LEN			64			/* Max commands queued per upstream PLC			*/
+#define FINS_PROXY_TIMEOUT			10			/* Seconds before an upstream command times out		*/
+#define FINS_PROXY_RETRY			5			/* Seconds between upstream connection attempts		*/
+									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+									/*							*/
+#define FINS_DISCOVER_DEFAULT_PARALLEL		64			/* Default number of discovery requests in flight	*/
+#define FINS_DISCOVER_MAX_PARALLEL		128			/* Max number of discovery requests in flight		*/
+#define FINS_DISCOVER_DEFAULT_TIMEOUT		500			/* Default msec to wait for a discovery response	*/
+									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+									/*							*/
+#define FINS_PIPELINE_DEFAULT_DEPTH		4			/* Default number of pipelined commands in flight	*/
+#define FINS_PIPELINE_MAX_DEPTH			8			/* Max number of pipelined commands in flight		*/
+									/*							*/
+#define FINS_MAX_FILE_READ_BYTES		1900			/* Max number of bytes in one file read command		*/
+#define FINS_MAX_FILE_WRITE_BYTES		1900			/* Max number of bytes in one file write command	*/
+#define FINS_MAX_PROGRAM_AREA_BYTES		992			/* Max number of bytes in one program area command	*/
+#define FINS_MAX_LOG_READ_RECORDS		20			/* Max number of records in one log read command	*/
+									/*							*/
+#define FINS_ERRORLOG_RECORD_LEN		10			/* Number of bytes in an error log record		*/
+#define FINS_ACCESSLOG_RECORD_LEN		12			/* Number of bytes in an access log record		*/
+#define FINS_FILEINFO_RECORD_LEN		22			/* Number of bytes in a directory entry			*/
+#define FINS_MAX_PATH_LEN			65			/* Max number of characters in a directory path		*/
+									/*							*/
+#define FINS_SHA256_LEN				32			/* Number of bytes in a SHA-256 hash			*/
+#define FINS_SNAPSHOT_BLOCK_WORDS		256			/* Number of words in one snapshot block		*/
+#define FINS_SNAPSHOT_START_LEN			16			/* Max length of a snapshot start address incl. NUL	*/
+#define FINS_TAG_NAME_LEN			64			/* Max length of a symbolic tag name incl. NUL		*/
+									/*							*/
+									/********************************************************/
+
 
 									/********************************************************/
 									/*							*/
@@ -118,6 +200,9 @@ typedef int					SOCKET;
 #define FI_TRD					0x20
 #define FI_FRC					0x40
 
+#define FINS_MEMADDR_WORD(mode,area,word)	{ (mode), (area), 16, 0,     (word), 0, FI_RD | FI_WR | FI_FILL | FI_MRD | FI_TRS | FI_TRD }
+#define FINS_MEMADDR_BIT(mode,area,word,bit)	{ (mode), (area), 1,  (bit), (word), 0, FI_RD | FI_WR | FI_MRD }
+
 									/********************************************************/
 									/*							*/
 #define FINS_MAX_READ_WORDS_SYSWAY		269			/* Max number of read words reading over SYSWAY		*/
@@ -125,6 +210,7 @@ typedef int					SOCKET;
 #define FINS_MAX_READ_WORDS_CLINK		999			/* Max number of read words reading over C-Link		*/
 #define FINS_MAX_READ_WORDS_SYSMAC_LINK		269			/* Max number of read words reading over Sysmac Link	*/
 #define FINS_MAX_READ_WORDS_DEVICENET		269			/* Max number of read words reading over DeviceNet	*/
+#define FINS_MAX_READ_ITEMS_MULTIPLE		24			/* Max number of items in one multiple area read	*/
 									/*							*/
 #define FINS_MAX_WRITE_WORDS_SYSWAY		267			/* Max number of write words writing over SYSWAY	*/
 #define FINS_MAX_WRITE_WORDS_ETHERNET		996			/* Max number of write words writing over Ethernet	*/
@@ -132,6 +218,9 @@ typedef int					SOCKET;
 #define FINS_MAX_WRITE_WORDS_SYSMAC_LINK	267			/* Max number of write words writing over Sysmac Link	*/
 #define FINS_MAX_WRITE_WORDS_DEVICENET		267			/* Max number of write words writing over DeviceNet	*/
 									/*							*/
+#define FINS_MAX_FILL_WORDS			0xFFFF			/* Max words in the 16 bit count of a fill command	*/
+#define FINS_MAX_TRANSFER_WORDS			0xFFFF			/* Max words in the 16 bit count of a transfer command	*/
+									/*							*/
 									/********************************************************/
 
 									/********************************************************/
@@ -168,6 +257,14 @@ typedef int					SOCKET;
 									/*							*/
 									/********************************************************/
 
+									/********************************************************/
+									/*							*/
+#define FINS_EDGE_BOTH				0			/* Notify rising and falling edges of a bit		*/
+#define FINS_EDGE_RISING			1			/* Notify only when a bit becomes set			*/
+#define FINS_EDGE_FALLING			2			/* Notify only when a bit becomes cleared		*/
+									/*							*/
+									/********************************************************/
+
 #define FINS_MEMORY_CARD_NONE			0
 #define FINS_MEMORY_CARD_FLASH			4
 
@@ -196,6 +293,14 @@ typedef int					SOCKET;
 #define FINS_WRITE_MODE_ADD_DATA		0x0002
 #define FINS_WRITE_MODE_OVERWRITE		0x0003
 
+									/********************************************************/
+									/*							*/
+#define FINS_VERIFY_NONE			0			/* Do not verify transferred data			*/
+#define FINS_VERIFY_SIZE			1			/* Verify the size in the directory entry		*/
+#define FINS_VERIFY_READ_BACK			2			/* Read back the data and compare the CRC-32		*/
+									/*							*/
+									/********************************************************/
+
 									/********************************************************/
 									/*							*/
 #define FINS_PARAM_AREA_ALL			0x8000			/* Pseudo value for all parameter areas			*/
@@ -326,6 +431,20 @@ typedef int					SOCKET;
 #define FINS_RETVAL_INVALID_IP_ADDRESS		0x8005			/* The IP address passed to inet_pton is invalid	*/
 #define FINS_RETVAL_MAX_ERROR_COUNT		0x8006			/* The connection was closed after reaching max errors	*/
 #define FINS_RETVAL_SYNC_ERROR			0x8007			/* Synchronization error. Some packets probably lost	*/
+#define FINS_RETVAL_NOT_SUPPORTED		0x8008			/* The function is not supported in this build		*/
+#define FINS_RETVAL_CAPTURE_END			0x8009			/* No more frames in the capture file			*/
+#define FINS_RETVAL_CAPTURE_INVALID		0x800A			/* The capture file is invalid or truncated		*/
+#define FINS_RETVAL_FILE_SIZE_MISMATCH		0x800B			/* Transferred file size differs from directory entry	*/
+#define FINS_RETVAL_VERIFY_FAILED		0x800C			/* Data read back differs from the data written		*/
+#define FINS_RETVAL_BACKUP_INVALID		0x800D			/* The program backup file is invalid or corrupt	*/
+#define FINS_RETVAL_BACKUP_MODEL_MISMATCH	0x800E			/* The program backup was made from another PLC model	*/
+#define FINS_RETVAL_SNAPSHOT_INVALID		0x800F			/* A snapshot manifest or object is missing or corrupt	*/
+#define FINS_RETVAL_IMAGE_INVALID		0x8010			/* A memory image file is missing or corrupt		*/
+#define FINS_RETVAL_INVALID_PERIOD		0x8011			/* An invalid period, interval or deadband was specified*/
+#define FINS_RETVAL_SHM_INVALID			0x8012			/* A shared memory process image is missing or corrupt	*/
+#define FINS_RETVAL_HISTORY_INVALID		0x8013			/* A history file is missing or corrupt			*/
+#define FINS_RETVAL_INVALID_TAG			0x8014			/* An invalid, duplicate or unknown tag was specified	*/
+#define FINS_RETVAL_STILL_CONNECTED		0x8015			/* The FINS context still has an open connection	*/
 									/*							*/
 #define FINS_RETVAL_NO_READ_ADDRESS		0x8101			/* No read address in the remote PLC was specified	*/
 #define FINS_RETVAL_NO_WRITE_ADDRESS		0x8102			/* No write address in the remote PLC was specified	*/
@@ -345,6 +464,7 @@ typedef int					SOCKET;
 #define FINS_RETVAL_INVALID_DISK		0x8601			/* An invalid disk was specified			*/
 #define FINS_RETVAL_INVALID_PATH		0x8602			/* An invalid path on a disk was specified		*/
 #define FINS_RETVAL_INVALID_FILENAME		0x8603			/* An invalid filename was specified			*/
+#define FINS_RETVAL_INVALID_VERIFY_MODE		0x8604			/* An invalid verification mode was specified		*/
 									/*							*/
 #define FINS_RETVAL_NO_COMMAND			0x8701			/* No command specified when executing a function	*/
 #define FINS_RETVAL_NO_COMMAND_LENGTH           0x8702			/* No command length specified when executing a function*/
@@ -438,6 +558,21 @@ struct fins_mcap_tp {							/*							*/
 };									/*							*/
 									/********************************************************/
 
+struct fins_cache_tp;
+struct fins_capcache_tp;
+struct fins_capture_tp;
+struct fins_dircache_tp;
+struct fins_historian_tp;
+struct fins_history_tp;
+struct fins_image_tp;
+struct fins_proxy_tp;
+struct fins_schedule_tp;
+struct fins_shm_tp;
+struct fins_subscribe_tp;
+struct fins_statsdata_tp;
+struct fins_tagdb_tp;
+struct fins_tracedata_tp;
+
 struct fins_sys_tp {
 	char		address[128];
 	uint16_t	port;
@@ -458,7 +593,116 @@ struct fins_sys_tp {
 	char		model[21];
 	char		version[21];
 	int		plc_mode;
+	struct fins_cache_tp *cache;
+	struct fins_statsdata_tp *stats;
+	struct fins_tracedata_tp *trace;
+	struct fins_capture_tp *capture;
+	struct fins_dircache_tp *dircache;
+	bool		allocated;
+	unsigned char	header[FINS_HEADER_LEN];
 };
+
+									/********************************************************/
+struct fins_cmdstats_tp {						/*							*/
+	uint8_t		mrc;						/* Main Request Code of the command			*/
+	uint8_t		src;						/* Sub Request Code of the command			*/
+	uint64_t	count;						/* Number of times the command was executed		*/
+	uint64_t	errors;						/* Number of times the command failed			*/
+	uint64_t	rtt_count;					/* Number of round trip times measured			*/
+	uint64_t	rtt_sum_usec;					/* Sum of all round trip times in microseconds		*/
+	uint64_t	rtt_max_usec;					/* Longest round trip time in microseconds		*/
+	uint32_t	rtt_bucket[FINS_STATS_RTT_BUCKETS];		/* Round trip time histogram				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_stats_tp {							/*							*/
+	uint64_t	commands;					/* Number of commands executed				*/
+	uint64_t	frames_sent;					/* Number of FINS frames sent				*/
+	uint64_t	frames_received;				/* Number of FINS frames received			*/
+	uint64_t	bytes_sent;					/* Number of FINS header and body bytes sent		*/
+	uint64_t	bytes_received;					/* Number of FINS header and body bytes received	*/
+	uint64_t	send_errors;					/* Number of commands which could not be sent		*/
+	uint64_t	recv_errors;					/* Number of commands without a response		*/
+	uint64_t	sync_errors;					/* Number of responses not matching the command		*/
+	uint64_t	end_code_errors;				/* Number of responses with an error end code		*/
+	uint64_t	cache_hits;					/* Number of reads answered from the read cache		*/
+	uint64_t	reconnects;					/* Number of times the connection was reestablished	*/
+	size_t		num_commands;					/* Number of command codes with statistics		*/
+	struct fins_cmdstats_tp command[FINS_STATS_MAX_COMMANDS];	/* Statistics per command code				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_trace_tp {							/*							*/
+	int64_t		nsec;						/* Monotonic timestamp in nanoseconds			*/
+	uint8_t		event;						/* Event type FINS_TRACE_...				*/
+	uint8_t		sid;						/* Service ID of the command				*/
+	uint8_t		mrc;						/* Main Request Code of the command			*/
+	uint8_t		src;						/* Sub Request Code of the command			*/
+	int		retval;						/* Result of the step which ended with this event	*/
+};									/*							*/
+									/********************************************************/
+
+typedef void (*fins_trace_callback_tp)( struct fins_sys_tp *sys, const struct fins_trace_tp *event, void *context );
+typedef int  (*fins_sink_callback_tp)( const unsigned char *data, size_t num_bytes, void *context );
+typedef int  (*fins_pipeline_build_tp)( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+typedef int  (*fins_pipeline_handle_tp)( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+
+									/********************************************************/
+struct fins_capframe_tp {						/*							*/
+	int64_t		nsec;						/* Nanoseconds since the start of the capture		*/
+	uint8_t		direction;					/* Direction FINS_CAPTURE_...				*/
+	size_t		bodylen;					/* Length of the FINS body				*/
+	struct fins_command_tp frame;					/* FINS header and body of the frame			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_snapinfo_tp {						/*							*/
+	char		start[FINS_SNAPSHOT_START_LEN];			/* Start address of the memory area			*/
+	size_t		num_words;					/* Number of words in the snapshot			*/
+	size_t		num_blocks;					/* Number of blocks in the snapshot			*/
+	time_t		time;						/* Wall clock time at which the snapshot was taken	*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_sample_tp {							/*							*/
+	int64_t		time_msec;					/* Time of the sample in msec				*/
+	double		value;						/* Value of the sample					*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_shmblock_tp {						/*							*/
+	char		start[FINS_SNAPSHOT_START_LEN];			/* Address of the first word of the block		*/
+	size_t		num_words;					/* Number of words in the block				*/
+	uint64_t	generation;					/* Generation in which the words last changed		*/
+	time_t		time;						/* Wall clock time of the last refresh			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_imageinfo_tp {						/*							*/
+	char		model[21];					/* CPU unit model					*/
+	char		version[21];					/* CPU unit version					*/
+	time_t		time;						/* Wall clock time at which the image was made		*/
+	int		plc_mode;					/* CS/CJ or CV mode communication			*/
+	size_t		num_areas;					/* Number of memory areas in the image			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_imagearea_tp {						/*							*/
+	char		name[4];					/* Text string with the area short code			*/
+	uint8_t		area;						/* Area code						*/
+	uint32_t	first_word;					/* Address of the first word in the area		*/
+	size_t		num_words;					/* Number of words in the area				*/
+	const unsigned char *data;					/* Words of the area in the mapped image file		*/
+};									/*							*/
+									/********************************************************/
+
 									/********************************************************/
 struct fins_datetime_tp {						/* 							*/
 	int		year;						/* Year							*/
@@ -541,6 +785,89 @@ struct fins_msgdata_tp {
 	uint8_t		msg;
 };
 
+									/********************************************************/
+struct fins_health_tp {							/*							*/
+	struct fins_cpustatus_tp	status;				/* Status of the CPU unit				*/
+	struct fins_cycletime_tp	cycle_time;			/* Minimum, average and maximum cycle time		*/
+	struct fins_datetime_tp		clock;				/* Clock of the PLC					*/
+	size_t				num_messages;			/* Number of messages returned by the PLC		*/
+	struct fins_msgdata_tp		messages[8];			/* Messages returned by the PLC				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_capability_tp {						/*							*/
+	char		model[21];					/* CPU unit model					*/
+	char		version[21];					/* CPU unit version					*/
+	int		plc_mode;					/* CS/CJ or CV mode communication			*/
+	size_t		program_area_words;				/* Size of the program area in words			*/
+	size_t		em_banks;					/* Number of non-file EM banks				*/
+	time_t		verified;					/* Wall clock time the profile was read from the PLC	*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_discover_tp {						/*							*/
+	const char *	address;					/* IP address of the PLC, gateway or subnet to scan	*/
+	uint16_t	port;						/* UDP port, or 0 for the default FINS port		*/
+	uint8_t		local_net;					/* Network of the client				*/
+	uint8_t		local_node;					/* Node number of the client				*/
+	uint8_t		first_net;					/* First network to scan, 0 for the local network	*/
+	uint8_t		last_net;					/* Last network to scan					*/
+	uint8_t		first_node;					/* First node number to scan				*/
+	uint8_t		last_node;					/* Last node number to scan				*/
+	bool		node_in_address;				/* Node number is the last byte of the IP address	*/
+	size_t		parallel;					/* Max requests in flight, 0 for the default		*/
+	int		timeout_msec;					/* Msec to wait for each response, 0 for the default	*/
+	int		retries;					/* Number of times a request without response is repeated */
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_nodeinfo_tp {						/*							*/
+	char		address[16];					/* IP address from which the node responded		*/
+	uint8_t		net;						/* Network of the node					*/
+	uint8_t		node;						/* Node number						*/
+	uint8_t		unit;						/* Unit address of the responding unit			*/
+	char		model[21];					/* CPU unit model					*/
+	char		version[21];					/* CPU unit version					*/
+	int		plc_mode;					/* CS/CJ or CV mode communication			*/
+	int		rtt_msec;					/* Response time in milliseconds			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_view_tp {							/*							*/
+	const unsigned char *	data;					/* First byte of the data in the response		*/
+	size_t			num_bytes;				/* Number of data bytes in this part of the view	*/
+	struct fins_view_tp *	next;					/* Next part of the view or NULL			*/
+	struct fins_command_tp	frame;					/* Receive buffer which holds the response		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_schedstats_tp {						/*							*/
+	uint64_t	ticks;						/* Number of ticks in which tags were read		*/
+	uint64_t	frames;						/* Number of read commands sent				*/
+	uint64_t	tags_read;					/* Number of tag refreshes				*/
+	uint64_t	tags_early;					/* Number of tags read early in a shared frame		*/
+	uint64_t	errors;						/* Number of tag refreshes which failed			*/
+	uint64_t	overruns;					/* Number of reads which ended after the deadline	*/
+	uint64_t	jitter_sum_msec;				/* Sum of the delays after the due time in msec		*/
+	int64_t		jitter_max_msec;				/* Longest delay after the due time in msec		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_filter_tp {							/*							*/
+	double		deadband_abs;					/* Minimum absolute change of a number to notify	*/
+	double		deadband_pct;					/* Minimum change of a number in percent to notify	*/
+	int		edge;						/* Edges of a bit to notify FINS_EDGE_...		*/
+	int		min_interval_msec;				/* Minimum msec between notifications, 0 for none	*/
+	int		max_interval_msec;				/* Notify at least every msec, 0 for only on change	*/
+};									/*							*/
+									/********************************************************/
+
 struct fins_nodedata_tp {
 	uint8_t		network;
 	uint8_t		node;
@@ -570,6 +897,17 @@ struct fins_accessdata_tp {
 	int		sec;
 };
 
+typedef int (*fins_errorlog_callback_tp)( const struct fins_errordata_tp *errordata, void *context );
+typedef int (*fins_accesslog_callback_tp)( const struct fins_accessdata_tp *accessdata, void *context );
+
+									/********************************************************/
+struct fins_logtail_tp {						/*							*/
+	size_t		seen;						/* Number of log records already delivered		*/
+	bool		valid;						/* The last record below is filled in			*/
+	unsigned char	last[FINS_ACCESSLOG_RECORD_LEN];		/* Raw copy of the last record delivered		*/
+};									/*							*/
+									/********************************************************/
+
 struct fins_diskinfo_tp {
 	char		volume_label[13];
 	uint32_t	total_capacity;
@@ -602,12 +940,26 @@ struct fins_fileinfo_tp {						/*							*/
 };									/*							*/
 									/********************************************************/
 
+typedef int (*fins_walk_callback_tp)( const char *path, const struct fins_fileinfo_tp *fileinfo, void *context );
+
 struct fins_address_tp {
 	char		name[4];
 	uint32_t	main_address;
 	uint32_t	sub_address;
 };
 
+									/********************************************************/
+struct fins_memaddr_tp {						/*							*/
+	int		plc_mode;					/* CS/CJ or CV mode communication			*/
+	uint8_t		area;						/* Area code						*/
+	uint8_t		bits;						/* Number of bits per element, 1 or 16			*/
+	uint8_t		bit;						/* Bit number in the start word				*/
+	uint32_t	start;						/* Start word as encoded in FINS commands		*/
+	uint32_t	num_words;					/* Words to the end of the area, 0=unknown		*/
+	uint32_t	access;						/* Allowed access FI_...				*/
+};									/*							*/
+									/********************************************************/
+
 struct fins_forcebit_tp {
 	char		address[12];
 	uint16_t	force_command;
@@ -634,23 +986,56 @@ struct fins_multidata_tp {
     };
 };
 
+									/********************************************************/
+struct fins_tag_tp {							/*							*/
+	char		name[FINS_TAG_NAME_LEN];			/* Symbolic name of the tag				*/
+	char		address[12];					/* Normalized address string of the tag			*/
+	int		type;						/* Data type FINS_DATA_TYPE_...				*/
+	struct fins_address_tp decoded;					/* Pre-decoded address					*/
+	const struct fins_area_tp *read_area;				/* Area used to read the tag, or NULL			*/
+	const struct fins_area_tp *write_area;				/* Area used to write the tag, or NULL			*/
+};									/*							*/
+									/********************************************************/
+
+typedef void (*fins_notify_callback_tp)( const struct fins_multidata_tp *item, void *context );
 
 
 
 int				finslib_access_log_read( struct fins_sys_tp *sys, struct fins_accessdata_tp *accessdata, uint16_t start_record, size_t *num_records, size_t *stored_records );
+int				finslib_access_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_accesslog_callback_tp callback, void *context, size_t depth, size_t *num_new );
 int				finslib_access_right_acquire( struct fins_sys_tp *sys, struct fins_nodedata_tp *nodedata );
 int				finslib_access_right_forced_acquire( struct fins_sys_tp* sys );
 int				finslib_access_right_release( struct fins_sys_tp *sys );
 int				finslib_area_file_compare( struct fins_sys_tp *sys, const char *start, uint16_t disk, const char *path, const char *file, size_t *num_records );
 int				finslib_area_to_file_transfer( struct fins_sys_tp *sys, const char *start, uint16_t disk, const char *path, const char *file, size_t *num_records );
 int32_t				finslib_bcd_to_int( uint32_t value, int type );
+void				finslib_cache_disable( struct fins_sys_tp *sys );
+int				finslib_cache_enable( struct fins_sys_tp *sys, int ttl_msec, size_t num_entries );
+void				finslib_cache_flush( struct fins_sys_tp *sys );
+int				finslib_capcache_apply( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys );
+void				finslib_capcache_close( struct fins_capcache_tp *capcache );
+bool				finslib_capcache_lookup( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys, struct fins_capability_tp *capability );
+struct fins_capcache_tp *	finslib_capcache_open( const char *filename, int *error_val );
+int				finslib_capcache_save( struct fins_capcache_tp *capcache );
+int				finslib_capcache_verify( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed );
+void				finslib_capture_close( struct fins_capture_tp *capture );
+int				finslib_capture_next( struct fins_capture_tp *capture, struct fins_capframe_tp *capframe );
+struct fins_capture_tp *	finslib_capture_open( const char *filename, int *error_val );
+int				finslib_capture_start( struct fins_sys_tp *sys, const char *filename );
+void				finslib_capture_stop( struct fins_sys_tp *sys );
 int				finslib_clock_read( struct fins_sys_tp* sys, struct fins_datetime_tp *datetime );
 int				finslib_clock_write( struct fins_sys_tp *sys, const struct fins_datetime_tp *datetime, bool do_sec, bool do_day_of_week );
 int				finslib_connection_data_read( struct fins_sys_tp *sys, struct fins_unitdata_tp *unitdata, uint8_t start_unit, size_t *num_units );
+int				finslib_connection_init( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int error_max );
 int				finslib_cpu_unit_data_read( struct fins_sys_tp *sys, struct fins_cpudata_tp *cpudata );
 int				finslib_cpu_unit_status_read( struct fins_sys_tp *sys, struct fins_cpustatus_tp *status );
+uint32_t			finslib_crc32( uint32_t crc, const unsigned char *data, size_t num_bytes );
 int				finslib_cycle_time_init( struct fins_sys_tp *sys );
 int				finslib_cycle_time_read( struct fins_sys_tp *sys, struct fins_cycletime_tp *ctime );
+void				finslib_dircache_disable( struct fins_sys_tp *sys );
+int				finslib_dircache_enable( struct fins_sys_tp *sys, int ttl_msec );
+void				finslib_dircache_flush( struct fins_sys_tp *sys );
+int				finslib_discover( const struct fins_discover_tp *spec, struct fins_nodeinfo_tp *nodes, size_t max_nodes, size_t *num_nodes );
 void				finslib_disconnect( struct fins_sys_tp* sys );
 const char *			finslib_errmsg( int error_code, char *buffer, size_t buffer_len );
 int				finslib_error_clear( struct fins_sys_tp *sys, uint16_t error_code );
@@ -660,17 +1045,66 @@ int				finslib_error_clear_fal( struct fins_sys_tp *sys, uint16_t fal_number );
 int				finslib_error_clear_fals( struct fins_sys_tp *sys, uint16_t fals_number );
 int				finslib_error_log_clear( struct fins_sys_tp *sys );
 int				finslib_error_log_read( struct fins_sys_tp *sys, struct fins_errordata_tp *errordata, uint16_t start_record, size_t *num_records, size_t *stored_records );
+int				finslib_error_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_errorlog_callback_tp callback, void *context, size_t depth, size_t *num_new );
 int				finslib_filename_to_83( const char *infile, char *outfile );
 int				finslib_file_memory_format( struct fins_sys_tp *sys, uint16_t disk );
+int				finslib_file_download( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, fins_sink_callback_tp sink, void *context, size_t depth, size_t *num_bytes );
+int				finslib_file_download_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, int fd, size_t depth, size_t *num_bytes );
+int				finslib_file_info( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, struct fins_fileinfo_tp *fileinfo );
 int				finslib_file_name_read( struct fins_sys_tp *sys, struct fins_diskinfo_tp *diskinfo, struct fins_fileinfo_tp *fileinfo, uint16_t disk, const char *path, uint16_t start_file, size_t *num_files );
 int				finslib_file_read( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, unsigned char *data, size_t file_position, size_t *num_bytes );
 int				finslib_file_to_area_transfer( struct fins_sys_tp *sys, const char *start, uint16_t disk, const char *path, const char *file, size_t *num_records );
+int				finslib_file_upload( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t num_bytes, size_t depth, int verify );
+int				finslib_file_upload_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, int fd, size_t depth, int verify, size_t *num_bytes );
+int				finslib_file_walk( struct fins_sys_tp *sys, uint16_t disk, const char *path, fins_walk_callback_tp callback, void *context, size_t depth, size_t *num_entries );
 int				finslib_file_write( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t file_position, size_t num_bytes, uint16_t open_mode );
 int				finslib_forced_set_reset_cancel( struct fins_sys_tp *sys );
+int				finslib_health_read( struct fins_sys_tp *sys, struct fins_health_tp *health );
+int				finslib_health_read_multi( struct fins_sys_tp **sys, struct fins_health_tp *health, int *retval, size_t num_sys );
+int				finslib_historian_add( struct fins_historian_tp *historian, int64_t time_msec, const struct fins_multidata_tp *items, size_t num_items );
+void				finslib_historian_close( struct fins_historian_tp *historian );
+int				finslib_historian_flush( struct fins_historian_tp *historian );
+struct fins_historian_tp *	finslib_historian_open( const char *filename, int *error_val );
+void				finslib_history_close( struct fins_history_tp *history );
+struct fins_history_tp *	finslib_history_open( const char *filename, int *error_val );
+int				finslib_history_query( const struct fins_history_tp *history, const char *tag, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples );
+int				finslib_image_area( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area );
+void				finslib_image_close( struct fins_image_tp *image );
+int				finslib_image_find( const struct fins_image_tp *image, const char *name, struct fins_imagearea_tp *area );
+int				finslib_image_info( const struct fins_image_tp *image, struct fins_imageinfo_tp *info );
+struct fins_image_tp *		finslib_image_open( const char *filename, int *error_val );
+int				finslib_image_read_word( const struct fins_image_tp *image, const char *address, uint16_t *value );
+int				finslib_image_verify( const struct fins_image_tp *image );
+int				finslib_image_write( struct fins_sys_tp *sys, const char *filename, const char * const *areas, size_t num_areas, size_t depth );
 const char *			finslib_inet_ntop( int af, const void *src, char *dst, socklen_t size );
 int				finslib_inet_pton( int af, const char *src, void *dst );
 uint32_t			finslib_int_to_bcd( int32_t value, int type );
 int				finslib_link_unit_reset( struct fins_sys_tp *sys );
+void				finslib_log_tail_reset( struct fins_logtail_tp *tail );
+int				finslib_memaddr_fill( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint16_t fill_data, size_t num_word );
+int				finslib_memaddr_read_bcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint16_t *data, size_t num_bcd16 );
+int				finslib_memaddr_read_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32 );
+int				finslib_memaddr_read_bit( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, bool *data, size_t num_bits );
+int				finslib_memaddr_read_int16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int16_t *data, size_t num_int16 );
+int				finslib_memaddr_read_int32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int32_t *data, size_t num_int32 );
+int				finslib_memaddr_read_sbcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int16_t *data, size_t num_sbcd16, int type );
+int				finslib_memaddr_read_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int32_t *data, size_t num_sbcd32, int type );
+int				finslib_memaddr_read_uint16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint16_t *data, size_t num_uint16 );
+int				finslib_memaddr_read_uint32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_uint32 );
+int				finslib_memaddr_read_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, unsigned char *data, size_t num_word );
+int				finslib_memaddr_read_word_view( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, size_t num_word, struct fins_view_tp **view );
+int				finslib_memaddr_resolve( int plc_mode, const char *address, int bits, struct fins_memaddr_tp *memaddr );
+int				finslib_memaddr_transfer( struct fins_sys_tp *sys, const struct fins_memaddr_tp *source, const struct fins_memaddr_tp *dest, size_t num_words );
+int				finslib_memaddr_write_bcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16 );
+int				finslib_memaddr_write_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32 );
+int				finslib_memaddr_write_bit( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const bool *data, size_t num_bit );
+int				finslib_memaddr_write_int16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_int16 );
+int				finslib_memaddr_write_int32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int32_t *data, size_t num_int32 );
+int				finslib_memaddr_write_sbcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_sbcd16, int type );
+int				finslib_memaddr_write_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int32_t *data, size_t num_sbcd32, int type );
+int				finslib_memaddr_write_uint16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_uint16 );
+int				finslib_memaddr_write_uint32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_uint32 );
+int				finslib_memaddr_write_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const unsigned char *data, size_t num_word );
 int				finslib_memory_area_fill( struct fins_sys_tp *sys, const char *start, uint16_t fill_data, size_t num_word );
 int				finslib_memory_area_read_bcd16( struct fins_sys_tp *sys, const char *start, uint16_t *data, size_t num_bcd16 );
 int				finslib_memory_area_read_bcd32( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_bcd32 );
@@ -682,6 +1116,7 @@ int				finslib_memory_area_read_sbcd32( struct fins_sys_tp *sys, const char *sta
 int				finslib_memory_area_read_uint16( struct fins_sys_tp *sys, const char *start, uint16_t *data, size_t num_uint16 );
 int				finslib_memory_area_read_uint32( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_uint32 );
 int				finslib_memory_area_read_word( struct fins_sys_tp *sys, const char *start, unsigned char *data, size_t num_word );
+int				finslib_memory_area_read_word_view( struct fins_sys_tp *sys, const char *start, size_t num_word, struct fins_view_tp **view );
 int				finslib_memory_area_transfer( struct fins_sys_tp *sys, const char *source, const char *dest, size_t num_words );
 int				finslib_memory_area_write_bcd16( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_bcd16 );
 int				finslib_memory_area_write_bcd32( struct fins_sys_tp *sys, const char *start, const uint32_t *data, size_t num_bcd32 );
@@ -697,6 +1132,8 @@ int				finslib_message_clear( struct fins_sys_tp *sys, uint8_t msg_mask );
 int				finslib_message_read( struct fins_sys_tp *sys, struct fins_msgdata_tp *msgdata, uint8_t msg_mask );
 int				finslib_message_fal_fals_read( struct fins_sys_tp *sys, char *faldata, uint16_t fal_number );
 void				finslib_milli_second_sleep( int msec );
+int64_t				finslib_monotonic_msec_timer( void );
+int64_t				finslib_monotonic_nsec_timer( void );
 time_t				finslib_monotonic_sec_timer( void );
 int				finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, size_t num_item );
 int				finslib_name_delete( struct fins_sys_tp *sys );
@@ -708,19 +1145,114 @@ int				finslib_parameter_area_write( struct fins_sys_tp *sys, uint16_t area_code
 int				finslib_program_area_clear( struct fins_sys_tp *sys, bool do_interrupt_tasks );
 int				finslib_program_area_read( struct fins_sys_tp *sys, unsigned char *data, uint32_t start_word, size_t *num_bytes );
 int				finslib_program_area_write( struct fins_sys_tp *sys, const unsigned char *data, uint32_t start_word, size_t num_bytes );
+int				finslib_program_backup( struct fins_sys_tp *sys, const char *filename, size_t depth, size_t *num_bytes );
+int				finslib_program_restore( struct fins_sys_tp *sys, const char *filename, size_t depth, int verify );
+int				finslib_proxy_add_upstream( struct fins_proxy_tp *proxy, uint8_t match_node, uint8_t comm_type, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, size_t pool_size );
+struct fins_proxy_tp *		finslib_proxy_create( uint16_t port, uint8_t proxy_node, int *error_val );
+void				finslib_proxy_destroy( struct fins_proxy_tp *proxy );
+int				finslib_proxy_poll( struct fins_proxy_tp *proxy, int timeout_msec );
 int				finslib_raw( struct fins_sys_tp *sys, uint16_t command, unsigned char *buffer, size_t send_len, size_t *recv_len );
+int				finslib_schedule_add( struct fins_schedule_tp *schedule, struct fins_sys_tp *sys, struct fins_multidata_tp *item, int period_msec, int deadline_msec );
+struct fins_schedule_tp *	finslib_schedule_create( int *error_val );
+void				finslib_schedule_destroy( struct fins_schedule_tp *schedule );
+int64_t				finslib_schedule_next( const struct fins_schedule_tp *schedule );
+int				finslib_schedule_stats( const struct fins_schedule_tp *schedule, struct fins_schedstats_tp *stats );
+int				finslib_schedule_tick( struct fins_schedule_tp *schedule, size_t *num_read );
 int				finslib_set_cpu_run( struct fins_sys_tp *sys, bool do_monitor );
 int				finslib_set_cpu_stop( struct fins_sys_tp *sys );
 int				finslib_set_plc_name( struct fins_sys_tp *sys, const char *name );
+void				finslib_sha256( const unsigned char *data, size_t num_bytes, unsigned char *hash );
+void				finslib_shm_close( struct fins_shm_tp *shm );
+struct fins_shm_tp *		finslib_shm_create( const char *name, const struct fins_shmblock_tp *blocks, size_t num_blocks, int *error_val );
+uint64_t			finslib_shm_generation( const struct fins_shm_tp *shm );
+int				finslib_shm_info( const struct fins_shm_tp *shm, size_t index, struct fins_shmblock_tp *info );
+struct fins_shm_tp *		finslib_shm_open( const char *name, int *error_val );
+int				finslib_shm_publish( struct fins_shm_tp *shm, struct fins_sys_tp *sys, size_t depth, size_t *num_changed );
+int				finslib_shm_read( const struct fins_shm_tp *shm, const char *start, uint16_t *data, size_t num_words, uint64_t *generation );
+int				finslib_snapshot_assemble( const char *store, const char *name, unsigned char *data, size_t max_words, size_t *num_words );
+int				finslib_snapshot_info( const char *store, const char *name, struct fins_snapinfo_tp *info );
+int				finslib_snapshot_take( struct fins_sys_tp *sys, const char *store, const char *name, const char *start, size_t num_words, size_t depth, size_t *new_blocks );
+uint64_t			finslib_stats_bucket_usec( size_t bucket );
+void				finslib_stats_disable( struct fins_sys_tp *sys );
+int				finslib_stats_enable( struct fins_sys_tp *sys );
+void				finslib_stats_reset( struct fins_sys_tp *sys );
+uint64_t			finslib_stats_rtt_percentile( const struct fins_cmdstats_tp *cmdstats, double percentile );
+int				finslib_stats_snapshot( struct fins_sys_tp *sys, struct fins_stats_tp *stats );
+int				finslib_subscribe_add( struct fins_subscribe_tp *subscribe, const struct fins_multidata_tp *item, const struct fins_filter_tp *filter, fins_notify_callback_tp callback, void *context );
+struct fins_subscribe_tp *	finslib_subscribe_create( int *error_val );
+void				finslib_subscribe_destroy( struct fins_subscribe_tp *subscribe );
+int				finslib_subscribe_evaluate( struct fins_subscribe_tp *subscribe, size_t *num_notified );
+int				finslib_tag_read( struct fins_sys_tp *sys, const struct fins_tag_tp * const *tags, struct fins_multidata_tp *values, size_t num_tags );
+int				finslib_tag_write( struct fins_sys_tp *sys, const struct fins_tag_tp *tag, const struct fins_multidata_tp *value );
+int				finslib_tagdb_add( struct fins_tagdb_tp *tagdb, const char *name, const char *address, int type );
+struct fins_tagdb_tp *		finslib_tagdb_create( int plc_mode, int *error_val );
+void				finslib_tagdb_destroy( struct fins_tagdb_tp *tagdb );
+const struct fins_tag_tp *	finslib_tagdb_find( const struct fins_tagdb_tp *tagdb, const char *name );
+int				finslib_tagdb_import( struct fins_tagdb_tp *tagdb, const char *filename, size_t *num_tags, size_t *num_skipped );
+void				finslib_trace_disable( struct fins_sys_tp *sys );
+int				finslib_trace_enable( struct fins_sys_tp *sys, fins_trace_callback_tp callback, void *context, size_t ring_size );
+size_t				finslib_trace_read( struct fins_sys_tp *sys, struct fins_trace_tp *events, size_t max_events, uint64_t *dropped );
 struct fins_sys_tp *		finslib_tcp_connect( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int *error_val, int error_max );
 struct fins_sys_tp *		finslib_udp_connect( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int *error_val, int error_max );
 bool				finslib_valid_directory( const char *path );
 bool				finslib_valid_filename( const char *filename );
+void				finslib_view_release( struct fins_view_tp *view );
 int				finslib_write_access_log_clear( struct fins_sys_tp *sys );
+void				XX_finslib_cache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen );
+bool				XX_finslib_cache_lookup( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen );
+void				XX_finslib_cache_store( struct fins_sys_tp *sys, const unsigned char *request_body, const struct fins_command_tp *response, size_t bodylen );
+void				XX_finslib_capture( struct fins_sys_tp *sys, uint8_t direction, const struct fins_command_tp *frame, size_t bodylen );
+bool				XX_finslib_check_memaddr( const struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int bits, uint32_t access );
+bool				XX_finslib_check_memaddr_range( const struct fins_memaddr_tp *memaddr, size_t num_words );
+int				XX_finslib_check_response( struct fins_sys_tp *sys, const unsigned char *sent_header, const struct fins_command_tp *response, size_t bodylen );
 int				XX_finslib_communicate( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, bool wait_response );
+void				XX_finslib_decode_accessdata( const unsigned char *record, struct fins_accessdata_tp *accessdata );
 bool				XX_finslib_decode_address( const char *str, struct fins_address_tp *address );
+void				XX_finslib_decode_cpustatus( const unsigned char *data, struct fins_cpustatus_tp *status );
+void				XX_finslib_decode_cycletime( const unsigned char *data, struct fins_cycletime_tp *cyc_time );
+void				XX_finslib_decode_datetime( const unsigned char *data, struct fins_datetime_tp *datetime );
+void				XX_finslib_decode_diskinfo( const unsigned char *data, struct fins_diskinfo_tp *diskinfo );
+void				XX_finslib_decode_errordata( const unsigned char *record, struct fins_errordata_tp *errordata );
+void				XX_finslib_decode_fileinfo( const unsigned char *data, struct fins_fileinfo_tp *fileinfo );
+size_t				XX_finslib_decode_msgdata( const unsigned char *data, size_t datalen, struct fins_msgdata_tp *msgdata );
+void				XX_finslib_dircache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen );
+bool				XX_finslib_dircache_lookup( struct fins_sys_tp *sys, uint16_t disk, const char *path, struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp **fileinfo, size_t *num_files );
+int				XX_finslib_dircache_store( struct fins_sys_tp *sys, uint16_t disk, const char *path, const struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp *fileinfo, size_t num_files );
+void				XX_finslib_file_name_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, uint16_t start_file, size_t num_files );
+int				XX_finslib_file_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, const char *filename, size_t file_position, size_t num_bytes );
+int				XX_finslib_file_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t file_position, size_t num_bytes, uint16_t write_mode );
+uint32_t			XX_finslib_get_uint32( const unsigned char *buf );
+uint64_t			XX_finslib_get_uint64( const unsigned char *buf );
 void				XX_finslib_init_command( struct fins_sys_tp *sys, struct fins_command_tp *command, uint8_t mrc, uint8_t src );
+void				XX_finslib_init_header( struct fins_sys_tp *sys );
+int				XX_finslib_memory_area_read_word_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const struct fins_memaddr_tp *memaddr, size_t offset, size_t num_words );
+const struct fins_mcap_tp *	XX_finslib_model_capabilities( const char *model );
+int				XX_finslib_model_to_plc_mode( const char *model );
+int				XX_finslib_pipeline( struct fins_sys_tp *sys, size_t num_command, size_t depth, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void *context );
+int				XX_finslib_pipeline_multi( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval );
+int				XX_finslib_program_area_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint32_t start_word, size_t num_bytes );
+int				XX_finslib_program_area_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const unsigned char *data, uint32_t start_word, size_t num_bytes, bool last_data );
+void				XX_finslib_put_uint32( unsigned char *buf, uint32_t value );
+void				XX_finslib_put_uint64( unsigned char *buf, uint64_t value );
+int				XX_finslib_recv_complete( struct fins_sys_tp *sys, const unsigned char *sent_header, const struct fins_command_tp *response, int recvlen, int retval, size_t *bodylen );
+int				XX_finslib_recv_response( struct fins_sys_tp *sys, const unsigned char *sent_header, struct fins_command_tp *response, size_t *bodylen );
+bool				XX_finslib_resolve_memaddr( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t access, struct fins_memaddr_tp *memaddr );
+int				XX_finslib_resolve_start( const struct fins_sys_tp *sys, const char *start, int bits, uint32_t access, struct fins_memaddr_tp *memaddr );
+void				XX_finslib_response_header( struct fins_command_tp *response, const unsigned char *request_header );
 const struct fins_area_tp *	XX_finslib_search_area( struct fins_sys_tp *sys, const struct fins_address_tp *address, int bits, uint32_t access, bool force );
+const struct fins_area_tp *	XX_finslib_search_area_mode( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t access, bool force );
+int				XX_finslib_send_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t bodylen );
+int				XX_finslib_send_complete( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen, int retval );
+SOCKET				XX_finslib_server_accept( SOCKET listenfd );
+int				XX_finslib_server_send_tcp_frame( SOCKET sockfd, const struct fins_command_tp *frame, size_t bodylen );
+SOCKET				XX_finslib_server_socket( uint8_t comm_type, uint16_t port, int *error_val );
+void				XX_finslib_server_tcp_header( unsigned char *buf, uint32_t command, uint32_t errorcode, size_t datalen );
+size_t				XX_finslib_server_tcp_message_len( const unsigned char *buf, size_t len, int *error_val );
+int				XX_finslib_socket_error( void );
+void				XX_finslib_stats_command( struct fins_sys_tp *sys, const unsigned char *header, size_t sent_len, size_t recv_len, int64_t rtt_nsec, int retval, bool from_cache );
+void				XX_finslib_stats_reconnect( struct fins_sys_tp *sys );
+void				XX_finslib_trace( struct fins_sys_tp *sys, uint8_t event, const unsigned char *header, int retval );
+bool				XX_finslib_uring_pipeline( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval );
 int				XX_finslib_wsa_errorcode_to_fins_retval( int errorcode );
 
 
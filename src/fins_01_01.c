@@ -28,9 +28,12 @@
  * Description
  * -----------
  * The source file src/fins_01_01.c contains routines to read data from a
- * remote PLC over the FINS protocol with the function 01 01.
+ * remote PLC over the FINS protocol with the function 01 01. Besides a read
+ * into a caller supplied buffer, a read which returns views on the receive
+ * buffers is available for callers which only pass the data on.
  */
 
+#include <stdlib.h>
 #include "fins.h"
 
 /*
@@ -45,47 +48,50 @@
 
 int finslib_memory_area_read_word( struct fins_sys_tp *sys, const char *start, unsigned char *data, size_t num_words ) {
 
-	size_t chunk_start;
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_words == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_RD, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_read_word( sys, & memaddr, data, num_words );
+
+}  /* finslib_memory_area_read_word */
+
+/*
+ * int finslib_memaddr_read_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, unsigned char *data, size_t num_words );
+ *
+ * The function finslib_memaddr_read_word() reads a number of words from a
+ * remote PLC memory area, starting at the address in an address handle. No
+ * conversion takes place and the information is directly stored in a memory
+ * blob.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_read_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, unsigned char *data, size_t num_words ) {
+
 	size_t chunk_length;
 	size_t offset;
 	size_t a;
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_words   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_READ_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_RD, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( num_words == 0    ) return FINS_RETVAL_SUCCESS;
+	if ( sys       == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( data      == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
 
-	offset       = 0;
-	todo         = num_words;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	offset = 0;
+	todo   = num_words;
 
 	do {
 		chunk_length = FINS_MAX_READ_WORDS_SYSWAY;
 		if ( chunk_length > todo ) chunk_length = todo;
 
-		XX_finslib_init_command( sys, & fins_cmnd, 0x01, 0x01 );
-
-		bodylen = 0;
-
-		fins_cmnd.body[bodylen++] = area_ptr->area;
-		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
-		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
-		fins_cmnd.body[bodylen++] = 0x00;
-		fins_cmnd.body[bodylen++] = (chunk_length >> 8) & 0xff;
-		fins_cmnd.body[bodylen++] = (chunk_length     ) & 0xff;
+		if ( ( retval = XX_finslib_memory_area_read_word_command( sys, & fins_cmnd, & bodylen, memaddr, offset / 2, chunk_length ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
 		if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
@@ -95,12 +101,179 @@ int finslib_memory_area_read_word( struct fins_sys_tp *sys, const char *start, u
 
 		for (a=0; a<2*chunk_length; a++) data[offset+a] = fins_cmnd.body[bodylen++];
 
-		todo        -= chunk_length;
-		offset      += chunk_length * 2;
-		chunk_start += chunk_length;
+		todo   -= chunk_length;
+		offset += chunk_length * 2;
 
 	} while ( todo > 0 );
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_read_word */
+}  /* finslib_memaddr_read_word */
+
+/*
+ * int finslib_memory_area_read_word_view( struct fins_sys_tp *sys, const char *start, size_t num_word, struct fins_view_tp **view );
+ *
+ * The function finslib_memory_area_read_word_view() reads the same data as
+ * finslib_memory_area_read_word() but does not copy it to a caller supplied
+ * buffer. Each response is received in a buffer owned by the library and the
+ * caller gets a chain of read-only views with one part per FINS response. The
+ * data in the chain stays valid until the chain is handed back with
+ * finslib_view_release(). On error no chain is returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memory_area_read_word_view( struct fins_sys_tp *sys, const char *start, size_t num_word, struct fins_view_tp **view ) {
+
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( view     == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	*view = NULL;
+
+	if ( num_word == 0    ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_RD, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_read_word_view( sys, & memaddr, num_word, view );
+
+}  /* finslib_memory_area_read_word_view */
+
+/*
+ * int finslib_memaddr_read_word_view( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, size_t num_word, struct fins_view_tp **view );
+ *
+ * The function finslib_memaddr_read_word_view() reads the same data as
+ * finslib_memaddr_read_word() but returns a chain of read-only views on the
+ * receive buffers like finslib_memory_area_read_word_view() does.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_read_word_view( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, size_t num_word, struct fins_view_tp **view ) {
+
+	size_t chunk_length;
+	size_t offset;
+	size_t todo;
+	size_t bodylen;
+	size_t num_parts;
+	size_t a;
+	struct fins_view_tp *parts;
+	struct fins_view_tp *part;
+	int retval;
+
+	if ( view      == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	*view = NULL;
+
+	if ( num_word  == 0    ) return FINS_RETVAL_SUCCESS;
+	if ( sys       == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	/*
+	 * All parts of the chain are taken from one block. A part holds a full
+	 * receive frame of about 2 kB, but the number of parts is known before
+	 * the first command is sent. One allocation per read is therefore
+	 * enough, and finslib_view_release() only has to free the first part.
+	 */
+
+	num_parts = ( num_word + FINS_MAX_READ_WORDS_SYSWAY - 1 ) / FINS_MAX_READ_WORDS_SYSWAY;
+	parts     = malloc( num_parts * sizeof(struct fins_view_tp) );
+
+	if ( parts == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	offset = 0;
+	todo   = num_word;
+
+	for (a=0; a<num_parts; a++) {
+
+		chunk_length = FINS_MAX_READ_WORDS_SYSWAY;
+		if ( chunk_length > todo ) chunk_length = todo;
+
+		part            = & parts[a];
+		part->data      = NULL;
+		part->num_bytes = 0;
+		part->next      = ( a+1 < num_parts ) ? & parts[a+1] : NULL;
+
+		if ( ( retval = XX_finslib_memory_area_read_word_command( sys, & part->frame, & bodylen, memaddr, offset, chunk_length ) ) == FINS_RETVAL_SUCCESS ) {
+
+			if ( ( retval = XX_finslib_communicate( sys, & part->frame, & bodylen, true ) ) == FINS_RETVAL_SUCCESS ) {
+
+				if ( bodylen != 2+2*chunk_length ) retval = FINS_RETVAL_BODY_TOO_SHORT;
+			}
+		}
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			free( parts );
+
+			return retval;
+		}
+
+		part->data      = & part->frame.body[2];
+		part->num_bytes = 2*chunk_length;
+
+		todo   -= chunk_length;
+		offset += chunk_length;
+	}
+
+	*view = parts;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_memaddr_read_word_view */
+
+/*
+ * void finslib_view_release( struct fins_view_tp *view );
+ *
+ * The function finslib_view_release() hands a chain of views back to the
+ * library. The receive buffers of all parts are released and the data they
+ * point to must not be used anymore. The parts of a chain share one
+ * allocation and view must therefore be the first part of the chain as it
+ * was returned by the library.
+ */
+
+void finslib_view_release( struct fins_view_tp *view ) {
+
+	if ( view != NULL ) free( view );
+
+}  /* finslib_view_release */
+
+/*
+ * int XX_finslib_memory_area_read_word_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const struct fins_memaddr_tp *memaddr, size_t offset, size_t num_words );
+ *
+ * The function XX_finslib_memory_area_read_word_command() builds the FINS
+ * command to read num_words words from a PLC memory area, beginning offset
+ * words after the address in an address handle.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_memory_area_read_word_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const struct fins_memaddr_tp *memaddr, size_t offset, size_t num_words ) {
+
+	size_t chunk_start;
+
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( command     == NULL           ) return FINS_RETVAL_NO_COMMAND;
+	if ( bodylen     == NULL           ) return FINS_RETVAL_NO_COMMAND_LENGTH;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_RD ) ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	chunk_start  = memaddr->start;
+	chunk_start += offset;
+
+	XX_finslib_init_command( sys, command, 0x01, 0x01 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = memaddr->area;
+	command->body[(*bodylen)++] = (chunk_start >> 8) & 0xff;
+	command->body[(*bodylen)++] = (chunk_start     ) & 0xff;
+	command->body[(*bodylen)++] = 0x00;
+	command->body[(*bodylen)++] = (num_words   >> 8) & 0xff;
+	command->body[(*bodylen)++] = (num_words       ) & 0xff;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_memory_area_read_word_command */
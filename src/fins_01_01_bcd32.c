@@ -33,7 +33,7 @@
 
 #include "fins.h"
 
-static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_bcd32, int type );
+static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32, int type );
 
 /*
  * int finslib_memory_area_read_sbcd32( struct fins_sys_tp *sys, const char *start, int32_t *data, size_t num_sbcd32, int type );
@@ -47,7 +47,14 @@ static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *d
 
 int finslib_memory_area_read_sbcd32( struct fins_sys_tp *sys, const char *start, int32_t *data, size_t num_sbcd32, int type ) {
 
-	return process_data( sys, start, (uint32_t *)data, num_sbcd32, type );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_sbcd32 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_RD, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_read_sbcd32( sys, & memaddr, data, num_sbcd32, type );
 
 }  /* finslib_memory_area_read_sbcd32 */
 
@@ -63,12 +70,52 @@ int finslib_memory_area_read_sbcd32( struct fins_sys_tp *sys, const char *start,
 
 int finslib_memory_area_read_bcd32( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_bcd32 ) {
 
-	return process_data( sys, start, data, num_bcd32, FINS_DATA_TYPE_BCD32 );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_bcd32 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_RD, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_read_bcd32( sys, & memaddr, data, num_bcd32 );
 
 }  /* finslib_memory_area_read_bcd32 */
 
 /*
- * static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_bcd32, int type );
+ * int finslib_memaddr_read_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int32_t *data, size_t num_sbcd32, int type );
+ *
+ * The function finslib_memaddr_read_sbcd32() reads signed BCD values of 32
+ * bits from the memory area of a remote PLC at the address in an address
+ * handle. The values are converted from BCD after reading. The parameter type
+ * selects how the sign is encoded.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_read_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int32_t *data, size_t num_sbcd32, int type ) {
+
+	return process_data( sys, memaddr, (uint32_t *)data, num_sbcd32, type );
+
+}  /* finslib_memaddr_read_sbcd32 */
+
+/*
+ * int finslib_memaddr_read_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32 );
+ *
+ * The function finslib_memaddr_read_bcd32() reads BCD values of 32 bits from
+ * the memory area of a remote PLC at the address in an address handle. The
+ * values are converted from BCD after reading.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_read_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32 ) {
+
+	return process_data( sys, memaddr, data, num_bcd32, FINS_DATA_TYPE_BCD32 );
+
+}  /* finslib_memaddr_read_bcd32 */
+
+/*
+ * static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32, int type );
  *
  * The function process_data() is the worker routine which reads a block of
  * data from a remote PLC, interprets it as signed or unsigned BCD32 value s
@@ -76,7 +123,7 @@ int finslib_memory_area_read_bcd32( struct fins_sys_tp *sys, const char *start,
  * signed and unsigned BCD values can be read.
  */
 
-static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *data, size_t num_bcd32, int type ) {
+static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint32_t *data, size_t num_bcd32, int type ) {
 
 	uint32_t bcd_val;
 	size_t chunk_start;
@@ -86,25 +133,19 @@ static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *d
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_bcd32   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_READ_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( num_bcd32   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_RD, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_RD ) ) return FINS_RETVAL_INVALID_READ_AREA;
 
 	offset       = 0;
 	todo         = num_bcd32;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	chunk_start  = memaddr->start;
 
 	do {
 		chunk_length = FINS_MAX_READ_WORDS_SYSWAY;
@@ -116,7 +157,7 @@ static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *d
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] = 0x00;
@@ -152,4 +193,4 @@ static int process_data( struct fins_sys_tp *sys, const char *start, uint32_t *d
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_read_bcd32 */
+}  /* process_data */
@@ -44,6 +44,29 @@
 
 int finslib_memory_area_read_bit( struct fins_sys_tp *sys, const char *start, bool *data, size_t num_bits ) {
 
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_bits == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 1, FI_RD, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_read_bit( sys, & memaddr, data, num_bits );
+
+}  /* finslib_memory_area_read_bit */
+
+/*
+ * int finslib_memaddr_read_bit( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, bool *data, size_t num_bits );
+ *
+ * The function finslib_memaddr_read_bit() reads a block of bits from the
+ * memory area of a remote PLC, starting at the bit in an address handle. The
+ * handle must have been resolved for bit access.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_read_bit( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, bool *data, size_t num_bits ) {
+
 	uint8_t chunk_bit;
 	size_t chunk_start;
 	size_t chunk_length;
@@ -52,26 +75,20 @@ int finslib_memory_area_read_bit( struct fins_sys_tp *sys, const char *start, bo
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_bits    == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_READ_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( num_bits    == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 1, FI_RD, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 1, FI_RD ) ) return FINS_RETVAL_INVALID_READ_AREA;
 
 	offset       = 0;
 	todo         = num_bits;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
-	chunk_bit    = address.sub_address & 0x0f;
+	chunk_start  = memaddr->start;
+	chunk_bit    = memaddr->bit;
 
 	do {
 		chunk_length = FINS_MAX_READ_WORDS_SYSWAY;
@@ -81,7 +98,7 @@ int finslib_memory_area_read_bit( struct fins_sys_tp *sys, const char *start, bo
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] =  chunk_bit;
@@ -108,4 +125,4 @@ int finslib_memory_area_read_bit( struct fins_sys_tp *sys, const char *start, bo
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_read_bit */
+}  /* finslib_memaddr_read_bit */
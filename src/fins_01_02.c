@@ -31,6 +31,8 @@
  * memory areas of a remote PLC.
  */
 
+#include <string.h>
+
 #include "fins.h"
 
 /*
@@ -45,6 +47,29 @@
 
 int finslib_memory_area_write_word( struct fins_sys_tp *sys, const char *start, const unsigned char *data, size_t num_words ) {
 
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_words == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_word( sys, & memaddr, data, num_words );
+
+}  /* finslib_memory_area_write_word */
+
+/*
+ * int finslib_memaddr_write_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const unsigned char *data, size_t num_words );
+ *
+ * The function finslib_memaddr_write_word() writes a block of words to a
+ * memory area of a remote PLC, starting at the address in an address handle.
+ * For very large blocks the transfer is partitioned in multiple chunks.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_word( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const unsigned char *data, size_t num_words ) {
+
 	size_t chunk_start;
 	size_t chunk_length;
 	size_t offset;
@@ -52,25 +77,19 @@ int finslib_memory_area_write_word( struct fins_sys_tp *sys, const char *start,
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_words   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_words   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_WR, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_WR ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
 
 	offset       = 0;
 	todo         = num_words;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	chunk_start  = memaddr->start;
 
 	do {
 		chunk_length = FINS_MAX_WRITE_WORDS_SYSWAY;
@@ -80,7 +99,7 @@ int finslib_memory_area_write_word( struct fins_sys_tp *sys, const char *start,
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] = 0x00;
@@ -101,4 +120,130 @@ int finslib_memory_area_write_word( struct fins_sys_tp *sys, const char *start,
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_write_word */
+}  /* finslib_memaddr_write_word */
+
+/*
+ * int finslib_tag_write( struct fins_sys_tp *sys, const struct fins_tag_tp *tag, const struct fins_multidata_tp *value );
+ *
+ * The function finslib_tag_write() writes one value to a tag from a tag
+ * database in a remote PLC. The value is taken from the member of the union
+ * in value which belongs to the data type of the tag. The type and address
+ * fields of value are not used. Values of 32 and 64 bits are written with the
+ * least significant word first and BCD values are converted to BCD before
+ * they are sent. Tags with a forced data type cannot be written.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_tag_write( struct fins_sys_tp *sys, const struct fins_tag_tp *tag, const struct fins_multidata_tp *value ) {
+
+	size_t chunk_start;
+	size_t num_words;
+	size_t a;
+	size_t bodylen;
+	uint64_t raw;
+	uint32_t float_val;
+	struct fins_command_tp fins_cmnd;
+	const struct fins_area_tp *area_ptr;
+	int retval;
+
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( tag         == NULL           ) return FINS_RETVAL_INVALID_TAG;
+	if ( value       == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	area_ptr = tag->write_area;
+
+	if ( area_ptr           == NULL          ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( area_ptr->plc_mode != sys->plc_mode ) return FINS_RETVAL_INVALID_TAG;
+
+	num_words = 1;
+
+	switch ( tag->type ) {
+
+		case FINS_DATA_TYPE_BIT :
+
+			raw = value->bit;
+			break;
+
+		case FINS_DATA_TYPE_INT16  :
+		case FINS_DATA_TYPE_UINT16 :
+
+			raw = value->uint16;
+			break;
+
+		case FINS_DATA_TYPE_BCD16    :
+		case FINS_DATA_TYPE_SBCD16_0 :
+		case FINS_DATA_TYPE_SBCD16_1 :
+		case FINS_DATA_TYPE_SBCD16_2 :
+		case FINS_DATA_TYPE_SBCD16_3 :
+
+			raw = finslib_int_to_bcd( ( tag->type == FINS_DATA_TYPE_BCD16 ) ? value->uint16 : value->int16, tag->type ) & 0xffff;
+			break;
+
+		case FINS_DATA_TYPE_INT32  :
+		case FINS_DATA_TYPE_UINT32 :
+
+			raw       = value->uint32;
+			num_words = 2;
+			break;
+
+		case FINS_DATA_TYPE_BCD32    :
+		case FINS_DATA_TYPE_SBCD32_0 :
+		case FINS_DATA_TYPE_SBCD32_1 :
+		case FINS_DATA_TYPE_SBCD32_2 :
+		case FINS_DATA_TYPE_SBCD32_3 :
+
+			raw       = finslib_int_to_bcd( value->int32, tag->type );
+			num_words = 2;
+			break;
+
+		case FINS_DATA_TYPE_FLOAT :
+
+			memcpy( & float_val, & value->sfloat, sizeof(float) );
+			raw       = float_val;
+			num_words = 2;
+			break;
+
+		case FINS_DATA_TYPE_DOUBLE :
+
+			memcpy( & raw, & value->dfloat, sizeof(double) );
+			num_words = 4;
+			break;
+
+		default :
+
+			return FINS_RETVAL_INVALID_TAG;
+	}
+
+	chunk_start  = tag->decoded.main_address;
+	chunk_start += area_ptr->low_addr >> 8;
+	chunk_start -= area_ptr->low_id;
+
+	XX_finslib_init_command( sys, & fins_cmnd, 0x01, 0x02 );
+
+	bodylen = 0;
+
+	fins_cmnd.body[bodylen++] = area_ptr->area;
+	fins_cmnd.body[bodylen++] = (chunk_start >> 8) & 0xff;
+	fins_cmnd.body[bodylen++] = (chunk_start     ) & 0xff;
+	fins_cmnd.body[bodylen++] = ( tag->type == FINS_DATA_TYPE_BIT ) ? tag->decoded.sub_address & 0x0f : 0x00;
+	fins_cmnd.body[bodylen++] = (num_words   >> 8) & 0xff;
+	fins_cmnd.body[bodylen++] = (num_words       ) & 0xff;
+
+	if ( tag->type == FINS_DATA_TYPE_BIT ) fins_cmnd.body[bodylen++] = (unsigned char) raw;
+
+	else for (a=0; a<num_words; a++) {
+
+		fins_cmnd.body[bodylen++] = (raw >> 8) & 0xff;
+		fins_cmnd.body[bodylen++] = (raw     ) & 0xff;
+		raw >>= 16;
+	}
+
+	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_tag_write */
@@ -33,7 +33,7 @@
 
 #include "fins.h"
 
-static int process_data( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_bcd16, int type );
+static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16, int type );
 
 /*
  * int finslib_memory_area_write_sbcd16( struct fins_sys_tp *sys, const char *start, const int16_t *data, size_t num_sbcd16, int type );
@@ -48,7 +48,14 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint1
 
 int finslib_memory_area_write_sbcd16( struct fins_sys_tp *sys, const char *start, const int16_t *data, size_t num_sbcd16, int type ) {
 
-	return process_data( sys, start, (const uint16_t *)data, num_sbcd16, type );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_sbcd16 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_sbcd16( sys, & memaddr, data, num_sbcd16, type );
 
 }  /* finslib_memory_area_write_sbcd16 */
 
@@ -66,12 +73,52 @@ int finslib_memory_area_write_sbcd16( struct fins_sys_tp *sys, const char *start
 
 int finslib_memory_area_write_bcd16( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_bcd16 ) {
 
-	return process_data( sys, start, data, num_bcd16, FINS_DATA_TYPE_BCD16 );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_bcd16 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_bcd16( sys, & memaddr, data, num_bcd16 );
 
 }  /* finslib_memory_area_write_bcd16 */
 
 /*
- * static int process_data( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_bcd16, int type );
+ * int finslib_memaddr_write_sbcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_sbcd16, int type );
+ *
+ * The function finslib_memaddr_write_sbcd16() writes signed BCD values of 16
+ * bits to the memory area of a remote PLC at the address in an address handle.
+ * The values are converted to BCD before they are sent. The parameter type
+ * selects how the sign is encoded.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_sbcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_sbcd16, int type ) {
+
+	return process_data( sys, memaddr, (const uint16_t *)data, num_sbcd16, type );
+
+}  /* finslib_memaddr_write_sbcd16 */
+
+/*
+ * int finslib_memaddr_write_bcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16 );
+ *
+ * The function finslib_memaddr_write_bcd16() writes BCD values of 16 bits to
+ * the memory area of a remote PLC at the address in an address handle. The
+ * values are converted to BCD before they are sent.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_bcd16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16 ) {
+
+	return process_data( sys, memaddr, data, num_bcd16, FINS_DATA_TYPE_BCD16 );
+
+}  /* finslib_memaddr_write_bcd16 */
+
+/*
+ * static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16, int type );
  *
  * The function process_data() is the workhorse routine which does the actual
  * writing of BCD data to a remote PLC over the FINS protocol. With proper type
@@ -79,7 +126,7 @@ int finslib_memory_area_write_bcd16( struct fins_sys_tp *sys, const char *start,
  * well as unsigned BCD values.
  */
 
-static int process_data( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_bcd16, int type ) {
+static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_bcd16, int type ) {
 
 	uint16_t bcd_val;
 	size_t chunk_start;
@@ -89,25 +136,19 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint1
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_bcd16   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_bcd16   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_WR, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_WR ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
 
 	offset       = 0;
 	todo         = num_bcd16;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	chunk_start  = memaddr->start;
 
 	do {
 		chunk_length = FINS_MAX_WRITE_WORDS_SYSWAY;
@@ -117,7 +158,7 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint1
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] = 0x00;
@@ -144,4 +185,4 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint1
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_write_bcd16 */
+}  /* process_data */
@@ -33,7 +33,7 @@
 
 #include "fins.h"
 
-static int	process_data( struct fins_sys_tp *sys, const char *start, const uint32_t *data, size_t num_bcd32, int type );
+static int	process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32, int type );
 
 /*
  * int finslib_memory_area_write_sbcd32( struct fins_sys_tp *sys, const char *start, const int32_t *data, size_t num_sbcd32, int type );
@@ -48,7 +48,14 @@ static int	process_data( struct fins_sys_tp *sys, const char *start, const uint3
 
 int finslib_memory_area_write_sbcd32( struct fins_sys_tp *sys, const char *start, const int32_t *data, size_t num_sbcd32, int type ) {
 
-	return process_data( sys, start, (const uint32_t *)data, num_sbcd32, type );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_sbcd32 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_sbcd32( sys, & memaddr, data, num_sbcd32, type );
 
 }  /* finslib_memory_area_write_sbcd32 */
 
@@ -66,19 +73,59 @@ int finslib_memory_area_write_sbcd32( struct fins_sys_tp *sys, const char *start
 
 int finslib_memory_area_write_bcd32( struct fins_sys_tp *sys, const char *start, const uint32_t *data, size_t num_bcd32 ) {
 
-	return process_data( sys, start, data, num_bcd32, FINS_DATA_TYPE_BCD32 );
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_bcd32 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_bcd32( sys, & memaddr, data, num_bcd32 );
 
 }  /* finslib_memory_area_write_bcd32 */
 
 /*
- * static int process_data( struct fins_sys_tp *sys, const char *start, const uint32_t *data, size_t num_bcd32, int type );
+ * int finslib_memaddr_write_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int32_t *data, size_t num_sbcd32, int type );
+ *
+ * The function finslib_memaddr_write_sbcd32() writes signed BCD values of 32
+ * bits to the memory area of a remote PLC at the address in an address handle.
+ * The values are converted to BCD before they are sent. The parameter type
+ * selects how the sign is encoded.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_sbcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int32_t *data, size_t num_sbcd32, int type ) {
+
+	return process_data( sys, memaddr, (const uint32_t *)data, num_sbcd32, type );
+
+}  /* finslib_memaddr_write_sbcd32 */
+
+/*
+ * int finslib_memaddr_write_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32 );
+ *
+ * The function finslib_memaddr_write_bcd32() writes BCD values of 32 bits to
+ * the memory area of a remote PLC at the address in an address handle. The
+ * values are converted to BCD before they are sent.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_bcd32( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32 ) {
+
+	return process_data( sys, memaddr, data, num_bcd32, FINS_DATA_TYPE_BCD32 );
+
+}  /* finslib_memaddr_write_bcd32 */
+
+/*
+ * static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32, int type );
  *
  * The function process_data() is the workhorse to write 32 bit BCD data in a
  * memory area of a remote PLC. The function processes with proper casting  of
  * the parameters both signed and unsigned 32 bit BCD values.
  */
 
-static int process_data( struct fins_sys_tp *sys, const char *start, const uint32_t *data, size_t num_bcd32, int type ) {
+static int process_data( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint32_t *data, size_t num_bcd32, int type ) {
 
 	uint32_t bcd_val;
 	size_t chunk_start;
@@ -88,25 +135,19 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint3
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_bcd32   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_bcd32   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_WR, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_WR ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
 
 	offset       = 0;
 	todo         = num_bcd32;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	chunk_start  = memaddr->start;
 
 	do {
 		chunk_length = FINS_MAX_WRITE_WORDS_SYSWAY;
@@ -118,7 +159,7 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint3
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] = 0x00;
@@ -149,4 +190,4 @@ static int process_data( struct fins_sys_tp *sys, const char *start, const uint3
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_write_bcd32 */
+}  /* process_data */
@@ -59,6 +59,46 @@ int finslib_memory_area_write_int16( struct fins_sys_tp *sys, const char *start,
 
 int finslib_memory_area_write_uint16( struct fins_sys_tp *sys, const char *start, const uint16_t *data, size_t num_uint16 ) {
 
+	struct fins_memaddr_tp memaddr;
+	int retval;
+
+	if ( num_uint16 == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_WR, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_write_uint16( sys, & memaddr, data, num_uint16 );
+
+}  /* finslib_memory_area_write_uint16 */
+
+/*
+ * int finslib_memaddr_write_int16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_int16 );
+ *
+ * The function finslib_memaddr_write_int16() writes a block of 16 bit signed
+ * integers to the memory area of a remote PLC at the address in an address
+ * handle. The bit patterns of signed and unsigned integers are the same, so
+ * the work is done by finslib_memaddr_write_uint16().
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_int16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const int16_t *data, size_t num_int16 ) {
+
+	return finslib_memaddr_write_uint16( sys, memaddr, (const uint16_t *) data, num_int16 );
+
+}  /* finslib_memaddr_write_int16 */
+
+/*
+ * int finslib_memaddr_write_uint16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_uint16 );
+ *
+ * The function finslib_memaddr_write_uint16() writes a block of 16 bit unsigned
+ * integers to the memory area of a remote PLC at the address in an address
+ * handle.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_write_uint16( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, const uint16_t *data, size_t num_uint16 ) {
+
 	size_t chunk_start;
 	size_t chunk_length;
 	size_t offset;
@@ -66,25 +106,19 @@ int finslib_memory_area_write_uint16( struct fins_sys_tp *sys, const char *start
 	size_t todo;
 	size_t bodylen;
 	struct fins_command_tp fins_cmnd;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
 	int retval;
 
-	if ( num_uint16  == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( data        == NULL                           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_uint16  == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_WR, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr( sys, memaddr, 16, FI_WR ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
 
 	offset       = 0;
 	todo         = num_uint16;
-	chunk_start  = address.main_address;
-	chunk_start += area_ptr->low_addr >> 8;
-	chunk_start -= area_ptr->low_id;
+	chunk_start  = memaddr->start;
 
 	do {
 		chunk_length = FINS_MAX_WRITE_WORDS_SYSWAY;
@@ -94,7 +128,7 @@ int finslib_memory_area_write_uint16( struct fins_sys_tp *sys, const char *start
 
 		bodylen = 0;
 
-		fins_cmnd.body[bodylen++] = area_ptr->area;
+		fins_cmnd.body[bodylen++] = memaddr->area;
 		fins_cmnd.body[bodylen++] = (chunk_start  >> 8) & 0xff;
 		fins_cmnd.body[bodylen++] = (chunk_start      ) & 0xff;
 		fins_cmnd.body[bodylen++] = 0x00;
@@ -119,4 +153,4 @@ int finslib_memory_area_write_uint16( struct fins_sys_tp *sys, const char *start
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_write_uint16 */
+}  /* finslib_memaddr_write_uint16 */
@@ -28,11 +28,25 @@
  * Description
  * -----------
  * The source file src/fins_01_03.c contains routines to fill a memory area of
- * a remote PLC with data through the FINS protocol.
+ * a remote PLC with data through the FINS protocol. The word count of the 01
+ * 03 command is a 16 bit field, so a complete area like DM or an EM bank is
+ * filled with one command. Only a fill of all 0x10000 words of an area is
+ * split in two commands, which may be in flight at the same time.
  */
 
 #include "fins.h"
 
+									/********************************************************/
+struct fill_tp {							/*							*/
+	const struct fins_memaddr_tp *	memaddr;			/* Address handle of the first word			*/
+	uint16_t			fill_data;			/* The word to fill the range with			*/
+	size_t				num_words;			/* Number of words in the range				*/
+};									/*							*/
+									/********************************************************/
+
+static int			build_fill( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			handle_fill( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+
 /*
  * int finslib_memory_area_fill( struct fins_sys_tp *sys, const char *start, uint16_t fill_data, size_t num_words );
  *
@@ -44,43 +58,103 @@
 
 int finslib_memory_area_fill( struct fins_sys_tp *sys, const char *start, uint16_t fill_data, size_t num_words ) {
 
-	uint32_t block_start;
-	const struct fins_area_tp *area_ptr;
-	struct fins_address_tp address;
-	struct fins_command_tp fins_cmnd;
-	size_t bodylen;
+	struct fins_memaddr_tp memaddr;
 	int retval;
 
-	if ( num_words   == 0                              ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( start       == NULL                           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( start, & address ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_words == 0 ) return FINS_RETVAL_SUCCESS;
 
-	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_FILL, false );
-	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_FILL_AREA;
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_FILL, & memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
-	block_start  = address.main_address;
-	block_start += area_ptr->low_addr >> 8;
-	block_start -= area_ptr->low_id;
+	return finslib_memaddr_fill( sys, & memaddr, fill_data, num_words );
+
+}  /* finslib_memory_area_fill */
 
-	XX_finslib_init_command( sys, & fins_cmnd, 0x01, 0x03 );
+/*
+ * int finslib_memaddr_fill( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint16_t fill_data, size_t num_words );
+ *
+ * The function finslib_memaddr_fill() fills a range of words in the memory
+ * area of a remote PLC, starting at the address in an address handle, with a
+ * fixed word. The whole range is checked against the limits of the memory
+ * area before the first command is sent, so a range which does not fit is
+ * rejected without changing anything in the PLC.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
 
-	bodylen = 0;
+int finslib_memaddr_fill( struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, uint16_t fill_data, size_t num_words ) {
 
-	fins_cmnd.body[bodylen++] = area_ptr->area;
-	fins_cmnd.body[bodylen++] = (block_start >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (block_start     ) & 0xff;
-	fins_cmnd.body[bodylen++] = 0x00;
-	fins_cmnd.body[bodylen++] = (num_words   >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_words       ) & 0xff;
-	fins_cmnd.body[bodylen++] = (fill_data   >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (fill_data       ) & 0xff;
+	size_t num_command;
+	struct fill_tp fill;
 
-	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	if ( num_words   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( memaddr     == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	if ( XX_finslib_check_memaddr(       sys, memaddr, 16, FI_FILL ) ) return FINS_RETVAL_INVALID_FILL_AREA;
+	if ( XX_finslib_check_memaddr_range( memaddr, num_words        ) ) return FINS_RETVAL_INVALID_FILL_AREA;
+
+	fill.memaddr   = memaddr;
+	fill.fill_data = fill_data;
+	fill.num_words = num_words;
+
+	num_command = ( num_words + FINS_MAX_FILL_WORDS - 1 ) / FINS_MAX_FILL_WORDS;
+
+	return XX_finslib_pipeline( sys, num_command, 0, build_fill, handle_fill, & fill );
+
+}  /* finslib_memaddr_fill */
+
+/*
+ * static int build_fill( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_fill() builds the fill command for the chunk with the
+ * given index of the range.
+ */
+
+static int build_fill( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	uint32_t block_start;
+	size_t block_length;
+	struct fill_tp *fill;
+
+	fill          = context;
+	block_start   = fill->memaddr->start + index * FINS_MAX_FILL_WORDS;
+	block_length  = fill->num_words      - index * FINS_MAX_FILL_WORDS;
+
+	if ( block_length > FINS_MAX_FILL_WORDS ) block_length = FINS_MAX_FILL_WORDS;
+
+	XX_finslib_init_command( sys, command, 0x01, 0x03 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = fill->memaddr->area;
+	command->body[(*bodylen)++] = (block_start     >> 8) & 0xff;
+	command->body[(*bodylen)++] = (block_start         ) & 0xff;
+	command->body[(*bodylen)++] = 0x00;
+	command->body[(*bodylen)++] = (block_length    >> 8) & 0xff;
+	command->body[(*bodylen)++] = (block_length        ) & 0xff;
+	command->body[(*bodylen)++] = (fill->fill_data >> 8) & 0xff;
+	command->body[(*bodylen)++] = (fill->fill_data     ) & 0xff;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_fill */
+
+/*
+ * static int handle_fill( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_fill() checks the response to a fill command.
+ */
+
+static int handle_fill( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	(void) sys;
+	(void) index;
+	(void) response;
+	(void) context;
 
 	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_fill */
+}  /* handle_fill */
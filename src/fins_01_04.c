@@ -31,8 +31,13 @@
  * types in one batch from a remote PLC over the FINS protocol.
  */
 
+#include <string.h>
+
 #include "fins.h"
 
+static int	item_area( struct fins_sys_tp *sys, const struct fins_multidata_tp *item, const struct fins_tag_tp *tag, int bits, bool force, struct fins_address_tp *address, const struct fins_area_tp **area_ptr );
+static int	multiple_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, const struct fins_tag_tp * const *tag, size_t num_item );
+
 /*
  * int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, size_t num_item );
  *
@@ -46,8 +51,90 @@
 
 int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, size_t num_item ) {
 
+	return multiple_read( sys, item, NULL, num_item );
+
+}  /* finslib_multiple_memory_area_read */
+
+/*
+ * int finslib_tag_read( struct fins_sys_tp *sys, const struct fins_tag_tp * const *tags, struct fins_multidata_tp *values, size_t num_tags );
+ *
+ * The function finslib_tag_read() reads the values of a list of tags from a
+ * tag database in a remote PLC. The type and address of each value are set
+ * from the tag before the value is read. The addresses and memory areas of
+ * the tags were resolved when they were added to the database, so no address
+ * strings are parsed while reading.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_tag_read( struct fins_sys_tp *sys, const struct fins_tag_tp * const *tags, struct fins_multidata_tp *values, size_t num_tags ) {
+
+	size_t a;
+
+	if ( num_tags == 0    ) return FINS_RETVAL_SUCCESS;
+	if ( tags     == NULL ) return FINS_RETVAL_INVALID_TAG;
+	if ( values   == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	for (a=0; a<num_tags; a++) {
+
+		if ( tags[a] == NULL ) return FINS_RETVAL_INVALID_TAG;
+
+		memcpy( values[a].address, tags[a]->address, sizeof(values[a].address) );
+		values[a].type = tags[a]->type;
+	}
+
+	return multiple_read( sys, values, tags, num_tags );
+
+}  /* finslib_tag_read */
+
+/*
+ * static int item_area( struct fins_sys_tp *sys, const struct fins_multidata_tp *item, const struct fins_tag_tp *tag, int bits, bool force, struct fins_address_tp *address, const struct fins_area_tp **area_ptr );
+ *
+ * The function item_area() returns the decoded address and the memory area
+ * to read an item. When the item belongs to a tag, the address and area
+ * resolved in the tag are used. Otherwise the address string of the item is
+ * decoded and the area is searched.
+ */
+
+static int item_area( struct fins_sys_tp *sys, const struct fins_multidata_tp *item, const struct fins_tag_tp *tag, int bits, bool force, struct fins_address_tp *address, const struct fins_area_tp **area_ptr ) {
+
+	if ( tag != NULL ) {
+
+		if ( tag->read_area           == NULL          ) return FINS_RETVAL_INVALID_TAG;
+		if ( tag->read_area->plc_mode != sys->plc_mode ) return FINS_RETVAL_INVALID_TAG;
+		if ( tag->read_area->bits     != bits          ) return FINS_RETVAL_INVALID_TAG;
+		if ( tag->read_area->force    != force         ) return FINS_RETVAL_INVALID_TAG;
+
+		*address  = tag->decoded;
+		*area_ptr = tag->read_area;
+
+		return FINS_RETVAL_SUCCESS;
+	}
+
+	if ( XX_finslib_decode_address( item->address, address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	*area_ptr = XX_finslib_search_area( sys, address, bits, FI_MRD, force );
+	if ( *area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* item_area */
+
+/*
+ * static int multiple_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, const struct fins_tag_tp * const *tag, size_t num_item );
+ *
+ * The function multiple_read() reads a list of items from a remote PLC with
+ * the 01 04 multiple memory area read command. If tag is not NULL, it points
+ * to a list with the tag of each item.
+ */
+
+static int multiple_read( struct fins_sys_tp *sys, struct fins_multidata_tp *item, const struct fins_tag_tp * const *tag, size_t num_item ) {
+
 	uint32_t bcd_val;
+	uint32_t float_val;
+	uint64_t double_val;
 	size_t a;
+	size_t b;
 	size_t bodylen;
 	size_t recvlen;
 	size_t chunk_start;
@@ -57,14 +144,6 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 	struct fins_command_tp fins_cmnd;
 	struct fins_address_tp address;
 	const struct fins_area_tp *area_ptr;
-	union {
-		unsigned char val_raw[4];
-		float val_float;
-	} sfloat;
-	union {
-		unsigned char val_raw[8];
-		double val_double;
-	} dfloat;
 	int retval;
 
 	if ( num_item    == 0              ) return FINS_RETVAL_SUCCESS;
@@ -76,7 +155,7 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 	todo   = num_item;
 
 	do {
-		chunk_length = 24;
+		chunk_length = FINS_MAX_READ_ITEMS_MULTIPLE;
 		if ( chunk_length > todo ) chunk_length = todo;
 
 		XX_finslib_init_command( sys, & fins_cmnd, 0x01, 0x04 );
@@ -96,10 +175,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 				case FINS_DATA_TYPE_SBCD16_2 :
 				case FINS_DATA_TYPE_SBCD16_3 :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 16, FI_MRD, false );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 16, false, & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -118,10 +195,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_BIT :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 1, FI_MRD, false );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 1,  false, & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -140,10 +215,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_BIT_FORCED :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 1, FI_MRD, true );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 1,  true,  & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -162,10 +235,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_WORD_FORCED :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 16, FI_MRD, true );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 16, true,  & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -191,10 +262,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 				case FINS_DATA_TYPE_SBCD32_3 :
 				case FINS_DATA_TYPE_FLOAT    :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 16, FI_MRD, false );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 16, false, & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -220,10 +289,8 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_DOUBLE :
 
-					if ( XX_finslib_decode_address( item[offset+a].address, & address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-
-					area_ptr = XX_finslib_search_area( sys, & address, 16, FI_MRD, false );
-					if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+					retval = item_area( sys, & item[offset+a], ( tag != NULL ) ? tag[offset+a] : NULL, 16, false, & address, & area_ptr );
+					if ( retval != FINS_RETVAL_SUCCESS ) return retval;
 
 					chunk_start  = address.main_address;
 					chunk_start += area_ptr->low_addr >> 8;
@@ -332,12 +399,15 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_FLOAT :
 
-					sfloat.val_raw[0] = fins_cmnd.body[0];
-					sfloat.val_raw[1] = fins_cmnd.body[1];
-					sfloat.val_raw[2] = fins_cmnd.body[3];
-					sfloat.val_raw[3] = fins_cmnd.body[4];
+					float_val   = fins_cmnd.body[bodylen+3];
+					float_val <<= 8;
+					float_val  += fins_cmnd.body[bodylen+4];
+					float_val <<= 8;
+					float_val  += fins_cmnd.body[bodylen+0];
+					float_val <<= 8;
+					float_val  += fins_cmnd.body[bodylen+1];
 
-					item[offset+a].sfloat = sfloat.val_float;
+					memcpy( & item[offset+a].sfloat, & float_val, sizeof(float) );
 
 					bodylen += 5;
 
@@ -347,16 +417,17 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 				case FINS_DATA_TYPE_DOUBLE :
 
-					dfloat.val_raw[0] = fins_cmnd.body[0];
-					dfloat.val_raw[1] = fins_cmnd.body[1];
-					dfloat.val_raw[2] = fins_cmnd.body[3];
-					dfloat.val_raw[3] = fins_cmnd.body[4];
-					dfloat.val_raw[4] = fins_cmnd.body[6];
-					dfloat.val_raw[5] = fins_cmnd.body[7];
-					dfloat.val_raw[6] = fins_cmnd.body[9];
-					dfloat.val_raw[7] = fins_cmnd.body[10];
+					double_val = 0;
 
-					item[offset+a].dfloat = dfloat.val_double;
+					for (b=4; b>0; b--) {
+
+						double_val <<= 8;
+						double_val  += fins_cmnd.body[bodylen+3*b-3];
+						double_val <<= 8;
+						double_val  += fins_cmnd.body[bodylen+3*b-2];
+					}
+
+					memcpy( & item[offset+a].dfloat, & double_val, sizeof(double) );
 
 					bodylen += 11;
 
@@ -476,4 +547,4 @@ int finslib_multiple_memory_area_read( struct fins_sys_tp *sys, struct fins_mult
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_multiple_memory_area_read */
+}  /* multiple_read */
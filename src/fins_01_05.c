@@ -28,11 +28,27 @@
  * Description
  * -----------
  * The source file src/fins_01_05.c contains routines to transfer data in a
- * remote PLC from one memory are to another through the FINS protocol.
+ * remote PLC from one memory are to another through the FINS protocol. The
+ * word count of the 01 05 command is a 16 bit field and a memory area has at
+ * most 0x10000 words, so nearly every transfer is one command. Only a
+ * transfer of all 0x10000 words of an area is split in two.
  */
 
 #include "fins.h"
 
+									/********************************************************/
+struct transfer_tp {							/*							*/
+	const struct fins_memaddr_tp *	source;				/* Address handle of the first source word		*/
+	const struct fins_memaddr_tp *	dest;				/* Address handle of the first destination word		*/
+	size_t				num_words;			/* Number of words to transfer				*/
+	size_t				num_command;			/* Number of commands needed for the transfer		*/
+	bool				backward;			/* Transfer the last chunk first			*/
+};									/*							*/
+									/********************************************************/
+
+static int			build_transfer( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			handle_transfer( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+
 /*
  * int finslib_memory_area_transfer( struct fins_sys_tp *sys, const char *source, const char *dest, size_t num_words );
  *
@@ -44,57 +60,125 @@
 
 int finslib_memory_area_transfer( struct fins_sys_tp *sys, const char *source, const char *dest, size_t num_words ) {
 
-	int32_t source_start;
-	int32_t dest_start;
-	const struct fins_area_tp *source_area_ptr;
-	const struct fins_area_tp *dest_area_ptr;
-	struct fins_address_tp source_address;
-	struct fins_address_tp dest_address;
-	struct fins_command_tp fins_cmnd;
-	size_t bodylen;
+	struct fins_memaddr_tp source_memaddr;
+	struct fins_memaddr_tp dest_memaddr;
 	int retval;
 
-	if ( num_words   == 0                                      ) return FINS_RETVAL_SUCCESS;
-	if ( sys         == NULL                                   ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( source      == NULL                                   ) return FINS_RETVAL_NO_READ_ADDRESS;
-	if ( dest        == NULL                                   ) return FINS_RETVAL_NO_WRITE_ADDRESS;
-	if ( sys->sockfd == INVALID_SOCKET                         ) return FINS_RETVAL_NOT_CONNECTED;
-	if ( XX_finslib_decode_address( source, & source_address ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
-	if ( XX_finslib_decode_address( dest,   & dest_address   ) ) return FINS_RETVAL_INVALID_WRITE_ADDRESS;
+	if ( num_words == 0 ) return FINS_RETVAL_SUCCESS;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, source, 16, FI_TRS, & source_memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	if ( ( retval = XX_finslib_resolve_start( sys, dest,   16, FI_TRD, & dest_memaddr   ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return finslib_memaddr_transfer( sys, & source_memaddr, & dest_memaddr, num_words );
+
+}  /* finslib_memory_area_transfer */
+
+/*
+ * int finslib_memaddr_transfer( struct fins_sys_tp *sys, const struct fins_memaddr_tp *source, const struct fins_memaddr_tp *dest, size_t num_words );
+ *
+ * The function finslib_memaddr_transfer() moves data from one area in a
+ * remote PLC to another area. Source and destination are passed as address
+ * handles. Both ranges are checked against the limits of their memory areas
+ * before the first command is sent.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_transfer( struct fins_sys_tp *sys, const struct fins_memaddr_tp *source, const struct fins_memaddr_tp *dest, size_t num_words ) {
+
+	struct transfer_tp transfer;
 
-	source_area_ptr = XX_finslib_search_area( sys, & source_address, 16, FI_TRS, false );
-	if ( source_area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( num_words   == 0              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( source      == NULL           ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( dest        == NULL           ) return FINS_RETVAL_NO_WRITE_ADDRESS;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	dest_area_ptr = XX_finslib_search_area( sys, & dest_address, 16, FI_TRD, false );
-	if ( dest_area_ptr == NULL ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr(       sys, source, 16, FI_TRS ) ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( XX_finslib_check_memaddr(       sys, dest,   16, FI_TRD ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
+	if ( XX_finslib_check_memaddr_range( source, num_words       ) ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( XX_finslib_check_memaddr_range( dest,   num_words       ) ) return FINS_RETVAL_INVALID_WRITE_AREA;
 
-	source_start  = source_address.main_address;
-	source_start += source_area_ptr->low_addr >> 8;
-	source_start -= source_area_ptr->low_id;
+	/*
+	 * When the destination overlaps the end of the source range, a forward
+	 * transfer would overwrite source words before they are moved. The chunks
+	 * are then transferred starting with the last one. Commands in flight at
+	 * the same time may be executed in any order, so such a transfer sends
+	 * the next chunk only after the previous one has been confirmed.
+	 */
 
-	dest_start    = dest_address.main_address;
-	dest_start   += dest_area_ptr->low_addr >> 8;
-	dest_start   -= dest_area_ptr->low_id;
+	transfer.source      = source;
+	transfer.dest        = dest;
+	transfer.num_words   = num_words;
+	transfer.num_command = ( num_words + FINS_MAX_TRANSFER_WORDS - 1 ) / FINS_MAX_TRANSFER_WORDS;
+	transfer.backward    = ( source->area == dest->area  &&  dest->start > source->start  &&  dest->start < source->start + num_words );
 
-	XX_finslib_init_command( sys, & fins_cmnd, 0x01, 0x05 );
+	return XX_finslib_pipeline( sys, transfer.num_command, ( transfer.backward ) ? 1 : 0, build_transfer, handle_transfer, & transfer );
 
-	bodylen = 0;
+}  /* finslib_memaddr_transfer */
+
+/*
+ * static int build_transfer( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_transfer() builds the transfer command for the command
+ * with the given index. For a backward transfer the first command moves the
+ * last chunk of the range.
+ */
 
-	fins_cmnd.body[bodylen++] = source_area_ptr->area;
-	fins_cmnd.body[bodylen++] = (source_start >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (source_start     ) & 0xff;
-	fins_cmnd.body[bodylen++] = 0x00;
-	fins_cmnd.body[bodylen++] = dest_area_ptr->area;
-	fins_cmnd.body[bodylen++] = (dest_start   >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (dest_start       ) & 0xff;
-	fins_cmnd.body[bodylen++] = 0x00;
-	fins_cmnd.body[bodylen++] = (num_words    >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_words        ) & 0xff;
+static int build_transfer( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
 
-	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	size_t chunk;
+	size_t offset;
+	size_t chunk_length;
+	uint32_t source_start;
+	uint32_t dest_start;
+	struct transfer_tp *transfer;
+
+	transfer = context;
+
+	chunk        = ( transfer->backward ) ? transfer->num_command - 1 - index : index;
+	offset       = chunk * FINS_MAX_TRANSFER_WORDS;
+	chunk_length = transfer->num_words - offset;
+
+	if ( chunk_length > FINS_MAX_TRANSFER_WORDS ) chunk_length = FINS_MAX_TRANSFER_WORDS;
+
+	source_start = transfer->source->start + offset;
+	dest_start   = transfer->dest->start   + offset;
+
+	XX_finslib_init_command( sys, command, 0x01, 0x05 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = transfer->source->area;
+	command->body[(*bodylen)++] = (source_start >> 8) & 0xff;
+	command->body[(*bodylen)++] = (source_start     ) & 0xff;
+	command->body[(*bodylen)++] = 0x00;
+	command->body[(*bodylen)++] = transfer->dest->area;
+	command->body[(*bodylen)++] = (dest_start   >> 8) & 0xff;
+	command->body[(*bodylen)++] = (dest_start       ) & 0xff;
+	command->body[(*bodylen)++] = 0x00;
+	command->body[(*bodylen)++] = (chunk_length >> 8) & 0xff;
+	command->body[(*bodylen)++] = (chunk_length     ) & 0xff;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_transfer */
+
+/*
+ * static int handle_transfer( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_transfer() checks the response to a transfer command.
+ */
+
+static int handle_transfer( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	(void) sys;
+	(void) index;
+	(void) response;
+	(void) context;
 
 	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_memory_area_transfer */
+}  /* handle_transfer */
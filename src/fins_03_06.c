@@ -52,23 +52,10 @@ int finslib_program_area_read( struct fins_sys_tp *sys, unsigned char *data, uin
 
 	if ( num_bytes   == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
 	if ( *num_bytes  == 0              ) return FINS_RETVAL_SUCCESS;
-	if ( *num_bytes  >  992            ) return FINS_RETVAL_BODY_TOO_LONG;
 	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
 	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
 
-	XX_finslib_init_command( sys, & fins_cmnd, 0x03, 0x06 );
-
-	bodylen = 0;
-
-	fins_cmnd.body[bodylen++] = 0xff;
-	fins_cmnd.body[bodylen++] = 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >> 24) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >> 16) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word      ) & 0xff;
-	fins_cmnd.body[bodylen++] = (*num_bytes >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (*num_bytes      ) & 0xff;
+	if ( ( retval = XX_finslib_program_area_read_command( sys, & fins_cmnd, & bodylen, start_word, *num_bytes ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
 	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
@@ -87,3 +74,38 @@ int finslib_program_area_read( struct fins_sys_tp *sys, unsigned char *data, uin
 	return (last_data) ? FINS_RETVAL_SUCCESS_LAST_DATA : FINS_RETVAL_SUCCESS;
 
 }  /* finslib_program_area_read */
+
+/*
+ * int XX_finslib_program_area_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint32_t start_word, size_t num_bytes );
+ *
+ * The function XX_finslib_program_area_read_command() checks the parameters of
+ * a program area read and builds the FINS command to read a block of data from
+ * the program area.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_program_area_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint32_t start_word, size_t num_bytes ) {
+
+	if ( sys         == NULL                         ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( command     == NULL                         ) return FINS_RETVAL_NO_COMMAND;
+	if ( bodylen     == NULL                         ) return FINS_RETVAL_NO_COMMAND_LENGTH;
+	if ( num_bytes   >  FINS_MAX_PROGRAM_AREA_BYTES  ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( sys->sockfd == INVALID_SOCKET               ) return FINS_RETVAL_NOT_CONNECTED;
+
+	XX_finslib_init_command( sys, command, 0x03, 0x06 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = 0xff;
+	command->body[(*bodylen)++] = 0xff;
+	command->body[(*bodylen)++] = (start_word >> 24) & 0xff;
+	command->body[(*bodylen)++] = (start_word >> 16) & 0xff;
+	command->body[(*bodylen)++] = (start_word >>  8) & 0xff;
+	command->body[(*bodylen)++] = (start_word      ) & 0xff;
+	command->body[(*bodylen)++] = (num_bytes  >>  8) & 0xff;
+	command->body[(*bodylen)++] = (num_bytes       ) & 0xff;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_program_area_read_command */
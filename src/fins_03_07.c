@@ -45,30 +45,13 @@
 int finslib_program_area_write( struct fins_sys_tp *sys, const unsigned char *data, uint32_t start_word, size_t num_bytes ) {
 
 	struct fins_command_tp fins_cmnd;
-	size_t a;
 	size_t bodylen;
 	int retval;
 
 	if ( num_bytes   == 0              ) return FINS_RETVAL_SUCCESS;
-	if ( num_bytes   >  992            ) return FINS_RETVAL_BODY_TOO_LONG;
 	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( data        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
-
-	XX_finslib_init_command( sys, & fins_cmnd, 0x03, 0x07 );
-
-	bodylen = 0;
 
-	fins_cmnd.body[bodylen++] = 0xff;
-	fins_cmnd.body[bodylen++] = 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >> 24) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >> 16) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_word      ) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_bytes  >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_bytes       ) & 0xff;
-
-	for (a=0; a<num_bytes; a++) fins_cmnd.body[bodylen++] = data[a];
+	if ( ( retval = XX_finslib_program_area_write_command( sys, & fins_cmnd, & bodylen, data, start_word, num_bytes, false ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
 	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
@@ -77,3 +60,47 @@ int finslib_program_area_write( struct fins_sys_tp *sys, const unsigned char *da
 	return FINS_RETVAL_SUCCESS;
 
 }  /* finslib_program_area_write */
+
+/*
+ * int XX_finslib_program_area_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const unsigned char *data, uint32_t start_word, size_t num_bytes, bool last_data );
+ *
+ * The function XX_finslib_program_area_write_command() checks the parameters
+ * of a program area write and builds the FINS command to write a block of
+ * data to the program area. The command is not sent. When last_data is true
+ * the block is marked as the last block of a program transfer.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_program_area_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, const unsigned char *data, uint32_t start_word, size_t num_bytes, bool last_data ) {
+
+	size_t a;
+	size_t length;
+
+	if ( sys         == NULL                         ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( command     == NULL                         ) return FINS_RETVAL_NO_COMMAND;
+	if ( bodylen     == NULL                         ) return FINS_RETVAL_NO_COMMAND_LENGTH;
+	if ( num_bytes   >  FINS_MAX_PROGRAM_AREA_BYTES  ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( num_bytes   >  0  &&  data == NULL          ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET               ) return FINS_RETVAL_NOT_CONNECTED;
+
+	length = ( last_data ) ? ( num_bytes | 0x8000 ) : num_bytes;
+
+	XX_finslib_init_command( sys, command, 0x03, 0x07 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = 0xff;
+	command->body[(*bodylen)++] = 0xff;
+	command->body[(*bodylen)++] = (start_word >> 24) & 0xff;
+	command->body[(*bodylen)++] = (start_word >> 16) & 0xff;
+	command->body[(*bodylen)++] = (start_word >>  8) & 0xff;
+	command->body[(*bodylen)++] = (start_word      ) & 0xff;
+	command->body[(*bodylen)++] = (length     >>  8) & 0xff;
+	command->body[(*bodylen)++] = (length          ) & 0xff;
+
+	for (a=0; a<num_bytes; a++) command->body[(*bodylen)++] = data[a];
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_program_area_write_command */
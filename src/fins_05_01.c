@@ -81,10 +81,7 @@ int finslib_cpu_unit_data_read( struct fins_sys_tp *sys, struct fins_cpudata_tp
 	memcpy( sys->model,   cpudata->model,   21 );
 	memcpy( sys->version, cpudata->version, 21 );
 
-	if      ( cpudata->model[0] == 'C'  &&  cpudata->model[1] == 'S' ) sys->plc_mode = FINS_MODE_CS;
-	else if ( cpudata->model[0] == 'C'  &&  cpudata->model[1] == 'J' ) sys->plc_mode = FINS_MODE_CS;
-	else if ( cpudata->model[0] == 'C'  &&  cpudata->model[1] == 'V' ) sys->plc_mode = FINS_MODE_CV;
-	else                                                               sys->plc_mode = FINS_MODE_UNKNOWN;
+	sys->plc_mode = XX_finslib_model_to_plc_mode( cpudata->model );
 
 	memcpy( cpudata->system_block, & fins_cmnd.body[42], 40 );
 
@@ -133,3 +130,20 @@ int finslib_cpu_unit_data_read( struct fins_sys_tp *sys, struct fins_cpudata_tp
 	return FINS_RETVAL_SUCCESS;
 
 }  /* finslib_cpu_unit_data_read */
+
+/*
+ * int XX_finslib_model_to_plc_mode( const char *model );
+ *
+ * The function XX_finslib_model_to_plc_mode() determines the FINS
+ * communication mode of a PLC from the CPU model name it reports.
+ */
+
+int XX_finslib_model_to_plc_mode( const char *model ) {
+
+	if      ( model[0] == 'C'  &&  model[1] == 'S' ) return FINS_MODE_CS;
+	else if ( model[0] == 'C'  &&  model[1] == 'J' ) return FINS_MODE_CS;
+	else if ( model[0] == 'C'  &&  model[1] == 'V' ) return FINS_MODE_CV;
+
+	return FINS_MODE_UNKNOWN;
+
+}  /* XX_finslib_model_to_plc_mode */
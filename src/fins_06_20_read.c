@@ -46,9 +46,6 @@
 int finslib_cycle_time_read( struct fins_sys_tp *sys, struct fins_cycletime_tp *cyc_time ) {
 
 	struct fins_command_tp fins_cmnd;
-	uint32_t avg;
-	uint32_t min;
-	uint32_t max;
 	size_t bodylen;
 	int retval;
 
@@ -66,34 +63,52 @@ int finslib_cycle_time_read( struct fins_sys_tp *sys, struct fins_cycletime_tp *
 
 	if ( bodylen != 14 ) return FINS_RETVAL_BODY_TOO_SHORT;
 
-	avg   = fins_cmnd.body[2];
+	XX_finslib_decode_cycletime( & fins_cmnd.body[2], cyc_time );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_cycle_time_read */
+
+/*
+ * void XX_finslib_decode_cycletime( const unsigned char *data, struct fins_cycletime_tp *cyc_time );
+ *
+ * The function XX_finslib_decode_cycletime() decodes the 12 bytes of cycle
+ * time information which follow the end code in the response to a 06 20
+ * command.
+ */
+
+void XX_finslib_decode_cycletime( const unsigned char *data, struct fins_cycletime_tp *cyc_time ) {
+
+	uint32_t avg;
+	uint32_t min;
+	uint32_t max;
+
+	avg   = data[0];
 	avg <<= 8;
-	avg  += fins_cmnd.body[3];
+	avg  += data[1];
 	avg <<= 8;
-	avg  += fins_cmnd.body[4];
+	avg  += data[2];
 	avg <<= 8;
-	avg  += fins_cmnd.body[5];
+	avg  += data[3];
 
-	max   = fins_cmnd.body[6];
+	max   = data[4];
 	max <<= 8;
-	max  += fins_cmnd.body[7];
+	max  += data[5];
 	max <<= 8;
-	max  += fins_cmnd.body[8];
+	max  += data[6];
 	max <<= 8;
-	max  += fins_cmnd.body[9];
+	max  += data[7];
 
-	min   = fins_cmnd.body[10];
+	min   = data[8];
 	min <<= 8;
-	min  += fins_cmnd.body[11];
+	min  += data[9];
 	min <<= 8;
-	min  += fins_cmnd.body[12];
+	min  += data[10];
 	min <<= 8;
-	min  += fins_cmnd.body[13];
+	min  += data[11];
 
 	cyc_time->avg = avg;
 	cyc_time->min = min;
 	cyc_time->max = max;
 
-	return FINS_RETVAL_SUCCESS;
-
-}  /* finslib_cycle_time_read */
+}  /* XX_finslib_decode_cycletime */
@@ -61,18 +61,34 @@ int finslib_clock_read( struct fins_sys_tp *sys, struct fins_datetime_tp* dateti
 
 	if ( bodylen != 9 ) return FINS_RETVAL_BODY_TOO_SHORT;
 
-	bodylen = 2;
-
-	datetime->year   = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 ) + 1900;
-	datetime->month  = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-	datetime->day    = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-	datetime->hour   = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-	datetime->min    = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-	datetime->sec    = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-	datetime->dow    = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-
-	if ( datetime->year < 1998 ) datetime->year += 100;
+	XX_finslib_decode_datetime( & fins_cmnd.body[2], datetime );
 
 	return FINS_RETVAL_SUCCESS;
 
 }  /* finslib_clock_read */
+
+/*
+ * void XX_finslib_decode_datetime( const unsigned char *data, struct fins_datetime_tp *datetime );
+ *
+ * The function XX_finslib_decode_datetime() decodes the 7 BCD coded bytes of
+ * clock information which follow the end code in the response to a 07 01
+ * command.
+ */
+
+void XX_finslib_decode_datetime( const unsigned char *data, struct fins_datetime_tp *datetime ) {
+
+	size_t pos;
+
+	pos = 0;
+
+	datetime->year   = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 ) + 1900;
+	datetime->month  = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+	datetime->day    = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+	datetime->hour   = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+	datetime->min    = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+	datetime->sec    = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+	datetime->dow    = finslib_bcd_to_int( data[pos++], FINS_DATA_TYPE_BCD16 );
+
+	if ( datetime->year < 1998 ) datetime->year += 100;
+
+}  /* XX_finslib_decode_datetime */
@@ -48,11 +48,7 @@ static uint8_t mask_array[] = { FINS_MSG_0, FINS_MSG_1, FINS_MSG_2, FINS_MSG_3,
 int finslib_message_read( struct fins_sys_tp *sys, struct fins_msgdata_tp *msgdata, uint8_t msg_mask ) {
 
 	struct fins_command_tp fins_cmnd;
-	size_t a;
-	size_t b;
-	size_t msg_index;
 	size_t bodylen;
-	uint8_t recv_mask;
 	int retval;
 
 	if ( msg_mask    == 0x00           ) return FINS_RETVAL_SUCCESS;
@@ -69,16 +65,43 @@ int finslib_message_read( struct fins_sys_tp *sys, struct fins_msgdata_tp *msgda
 
 	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
+	if ( bodylen < 4 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	XX_finslib_decode_msgdata( & fins_cmnd.body[2], bodylen-2, msgdata );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_message_read */
+
+/*
+ * size_t XX_finslib_decode_msgdata( const unsigned char *data, size_t datalen, struct fins_msgdata_tp *msgdata );
+ *
+ * The function XX_finslib_decode_msgdata() decodes the messages which follow
+ * the end code in the response to a 09 20 command. The messages are stored
+ * in the order of their message number and the number of messages decoded is
+ * returned. Messages which are not completely present in the datalen bytes of
+ * the response are ignored.
+ */
+
+size_t XX_finslib_decode_msgdata( const unsigned char *data, size_t datalen, struct fins_msgdata_tp *msgdata ) {
+
+	size_t a;
+	size_t b;
+	size_t pos;
+	size_t msg_index;
+	uint8_t recv_mask;
+
 	msg_index = 0;
-	bodylen   = 3;
-	recv_mask = fins_cmnd.body[bodylen++];
+	pos       = 1;
+	recv_mask = data[pos++];
 
 	for (a=0; a<8; a++) {
 
 		if ( ! (recv_mask & mask_array[a]) ) continue;
+		if ( pos + 32 > datalen              ) break;
 
 		msgdata[msg_index].msg = mask_array[a];
-		for (b=0; b<32; b++) msgdata[msg_index].text[b] = fins_cmnd.body[bodylen++];
+		for (b=0; b<32; b++) msgdata[msg_index].text[b] = data[pos++];
 
 		while ( b > 0  &&  isspace( msgdata[msg_index].text[b-1] ) ) b--;
 		msgdata[msg_index].text[b] = 0;
@@ -86,6 +109,6 @@ int finslib_message_read( struct fins_sys_tp *sys, struct fins_msgdata_tp *msgda
 		msg_index++;
 	}
 
-	return FINS_RETVAL_SUCCESS;
+	return msg_index;
 
-}  /* finslib_message_read */
+}  /* XX_finslib_decode_msgdata */
@@ -87,24 +87,42 @@ int finslib_error_log_read( struct fins_sys_tp *sys, struct fins_errordata_tp *e
 
 	for (a=0; a<*num_records; a++) {
 
-		errordata[a].error_code[0]   = fins_cmnd.body[bodylen++];
-		errordata[a].error_code[0] <<= 8;
-		errordata[a].error_code[0]  += fins_cmnd.body[bodylen++];
-
-		errordata[a].error_code[1]   = fins_cmnd.body[bodylen++];
-		errordata[a].error_code[1] <<= 8;
-		errordata[a].error_code[1]  += fins_cmnd.body[bodylen++];
-
-		errordata[a].min             = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-		errordata[a].sec             = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-		errordata[a].day             = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-		errordata[a].hour            = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-		errordata[a].year            = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 ) + 1900;
-		errordata[a].month           = finslib_bcd_to_int( fins_cmnd.body[bodylen++], FINS_DATA_TYPE_BCD16 );
-
-		if ( errordata[a].year < 1998 ) errordata[a].year += 100;
+		XX_finslib_decode_errordata( & fins_cmnd.body[bodylen], & errordata[a] );
+		bodylen += FINS_ERRORLOG_RECORD_LEN;
 	}
 
 	return FINS_RETVAL_SUCCESS;
 
 }  /* finslib_error_log_read */
+
+/*
+ * void XX_finslib_decode_errordata( const unsigned char *record, struct fins_errordata_tp *errordata );
+ *
+ * The function XX_finslib_decode_errordata() decodes one record of the
+ * error log as it is returned by the PLC.
+ */
+
+void XX_finslib_decode_errordata( const unsigned char *record, struct fins_errordata_tp *errordata ) {
+
+	size_t pos;
+
+	pos = 0;
+
+	errordata->error_code[0]   = record[pos++];
+	errordata->error_code[0] <<= 8;
+	errordata->error_code[0]  += record[pos++];
+
+	errordata->error_code[1]   = record[pos++];
+	errordata->error_code[1] <<= 8;
+	errordata->error_code[1]  += record[pos++];
+
+	errordata->min             = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 );
+	errordata->sec             = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 );
+	errordata->day             = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 );
+	errordata->hour            = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 );
+	errordata->year            = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 ) + 1900;
+	errordata->month           = finslib_bcd_to_int( record[pos++], FINS_DATA_TYPE_BCD16 );
+
+	if ( errordata->year < 1998 ) errordata->year += 100;
+
+}  /* XX_finslib_decode_errordata */
@@ -74,26 +74,44 @@ int finslib_access_log_read( struct fins_sys_tp *sys, struct fins_accessdata_tp
 
 	for (a=0; a<*num_records; a++) {
 
-		accessdata[a].network        = fins_cmnd.body[bodylen++];
-		accessdata[a].node           = fins_cmnd.body[bodylen++];
-		accessdata[a].unit           = fins_cmnd.body[bodylen++];
+		XX_finslib_decode_accessdata( & fins_cmnd.body[bodylen], & accessdata[a] );
+		bodylen += FINS_ACCESSLOG_RECORD_LEN;
+	}
 
-		bodylen++;
+	return FINS_RETVAL_SUCCESS;
 
-		accessdata[a].command_code   = fins_cmnd.body[bodylen++];
-		accessdata[a].command_code <<= 8;
-		accessdata[a].command_code  += fins_cmnd.body[bodylen++];
+}  /* finslib_access_log_read */
 
-		accessdata[a].min            = fins_cmnd.body[bodylen++];
-		accessdata[a].sec            = fins_cmnd.body[bodylen++];
-		accessdata[a].day            = fins_cmnd.body[bodylen++];
-		accessdata[a].hour           = fins_cmnd.body[bodylen++];
-		accessdata[a].year           = fins_cmnd.body[bodylen++] + 1900;
-		accessdata[a].month          = fins_cmnd.body[bodylen++];
+/*
+ * void XX_finslib_decode_accessdata( const unsigned char *record, struct fins_accessdata_tp *accessdata );
+ *
+ * The function XX_finslib_decode_accessdata() decodes one record of the
+ * access log as it is returned by the PLC.
+ */
 
-		if ( accessdata[a].year < 1998 ) accessdata[a].year += 100;
-	}
+void XX_finslib_decode_accessdata( const unsigned char *record, struct fins_accessdata_tp *accessdata ) {
 
-	return FINS_RETVAL_SUCCESS;
+	size_t pos;
 
-}  /* finslib_access_log_read */
+	pos = 0;
+
+	accessdata->network        = record[pos++];
+	accessdata->node           = record[pos++];
+	accessdata->unit           = record[pos++];
+
+	pos++;
+
+	accessdata->command_code   = record[pos++];
+	accessdata->command_code <<= 8;
+	accessdata->command_code  += record[pos++];
+
+	accessdata->min            = record[pos++];
+	accessdata->sec            = record[pos++];
+	accessdata->day            = record[pos++];
+	accessdata->hour           = record[pos++];
+	accessdata->year           = record[pos++] + 1900;
+	accessdata->month          = record[pos++];
+
+	if ( accessdata->year < 1998 ) accessdata->year += 100;
+
+}  /* XX_finslib_decode_accessdata */
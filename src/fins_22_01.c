@@ -31,9 +31,12 @@
  * directory on a remote PLC over the FINS protocol.
  */
 
+#include <ctype.h>
 #include <string.h>
 #include "fins.h"
 
+#define FILE_INFO_BLOCK		20
+
 /*
  * int finslib_file_name_read( struct fins_sys_tp *sys, struct fins_diskinfo_tp *diskinfo, struct fins_fileinfo_tp *fileinfo, uint16_t disk, const char *path, uint16_t start_file, size_t *num_file );
  *
@@ -49,11 +52,10 @@
 int finslib_file_name_read( struct fins_sys_tp *sys, struct fins_diskinfo_tp *diskinfo, struct fins_fileinfo_tp *fileinfo, uint16_t disk, const char *path, uint16_t start_file, size_t *num_files ) {
 
 	struct fins_command_tp fins_cmnd;
+	const struct fins_fileinfo_tp *cached;
+	size_t num_cached;
 	size_t bodylen;
 	size_t a;
-	size_t b;
-	size_t dirlen;
-	uint32_t datetime;
 	int retval;
 
 	if ( sys         == NULL                    ) return FINS_RETVAL_NOT_INITIALIZED;
@@ -65,71 +67,25 @@ int finslib_file_name_read( struct fins_sys_tp *sys, struct fins_diskinfo_tp *di
 
 	if ( ! finslib_valid_directory( path ) ) return FINS_RETVAL_INVALID_PATH;
 
-	if ( path == NULL ) dirlen = 0;
-	else                dirlen = strlen( path );
+	if ( sys->dircache != NULL  &&  XX_finslib_dircache_lookup( sys, disk, path, diskinfo, & cached, & num_cached ) ) {
 
-	XX_finslib_init_command( sys, & fins_cmnd, 0x22, 0x01 );
+		num_cached = ( start_file < num_cached ) ? num_cached - start_file : 0;
 
-	bodylen = 0;
+		if ( *num_files > num_cached ) *num_files = num_cached;
+		if ( *num_files > 0          ) memcpy( fileinfo, cached + start_file, *num_files * sizeof(struct fins_fileinfo_tp) );
 
-	fins_cmnd.body[bodylen++] = (disk       >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (disk           ) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_file >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (start_file     ) & 0xff;
-	fins_cmnd.body[bodylen++] = (*num_files >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (*num_files     ) & 0xff;
-	fins_cmnd.body[bodylen++] = (dirlen     >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (dirlen         ) & 0xff;
+		return FINS_RETVAL_SUCCESS;
+	}
 
-	for (b=0; b<dirlen; b++) fins_cmnd.body[bodylen++] = path[b];
+	XX_finslib_file_name_read_command( sys, & fins_cmnd, & bodylen, disk, path, start_file, *num_files );
 
 	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
 
 	if ( bodylen < 30 ) return FINS_RETVAL_BODY_TOO_SHORT;
 
-	bodylen = 2;
-
-	if ( diskinfo != NULL ) {
-
-		for (b=0; b<12; b++) diskinfo->volume_label[b] = fins_cmnd.body[bodylen++];
-		diskinfo->volume_label[12] = 0;
-
-		datetime                   = fins_cmnd.body[bodylen++];
-		datetime                 <<= 8;
-		datetime                  += fins_cmnd.body[bodylen++];
-		datetime                 <<= 8;
-		datetime                  += fins_cmnd.body[bodylen++];
-		datetime                 <<= 8;
-		datetime                  += fins_cmnd.body[bodylen++];
-
-		diskinfo->year             = ((datetime >> 25) & 0x7f) + 1980;
-		diskinfo->month            =  (datetime >> 21) & 0x0f;
-		diskinfo->day              =  (datetime >> 16) & 0x1f;
-		diskinfo->hour             =  (datetime >> 11) & 0x1f;
-		diskinfo->min              =  (datetime >>  5) & 0x3f;
-		diskinfo->sec              = ((datetime      ) & 0x1f) * 2;
-
-		diskinfo->total_capacity   = fins_cmnd.body[bodylen++];
-		diskinfo->total_capacity <<= 8;
-		diskinfo->total_capacity  += fins_cmnd.body[bodylen++];
-		diskinfo->total_capacity <<= 8;
-		diskinfo->total_capacity  += fins_cmnd.body[bodylen++];
-		diskinfo->total_capacity <<= 8;
-		diskinfo->total_capacity  += fins_cmnd.body[bodylen++];
-
-		diskinfo->free_capacity    = fins_cmnd.body[bodylen++];
-		diskinfo->free_capacity  <<= 8;
-		diskinfo->free_capacity   += fins_cmnd.body[bodylen++];
-		diskinfo->free_capacity  <<= 8;
-		diskinfo->free_capacity   += fins_cmnd.body[bodylen++];
-		diskinfo->free_capacity  <<= 8;
-		diskinfo->free_capacity   += fins_cmnd.body[bodylen++];
-
-		diskinfo->total_files      = fins_cmnd.body[bodylen++];
-		diskinfo->total_files    <<= 8;
-		diskinfo->total_files     += fins_cmnd.body[bodylen++];
-	}
-	else bodylen += 26;
+	if ( diskinfo != NULL ) XX_finslib_decode_diskinfo( & fins_cmnd.body[2], diskinfo );
+
+	bodylen = 28;
 
 	*num_files   = fins_cmnd.body[bodylen++] & 0x7f;
 	*num_files <<= 8;
@@ -137,44 +93,202 @@ int finslib_file_name_read( struct fins_sys_tp *sys, struct fins_diskinfo_tp *di
 
 	for (a=0; a<*num_files; a++) {
 
-		for (b=0; b<12; b++) fileinfo[a].filename[b] = fins_cmnd.body[bodylen++];
-		fileinfo[a].filename[12] = 0;
-
-		datetime               = fins_cmnd.body[bodylen++];
-		datetime             <<= 8;
-		datetime              += fins_cmnd.body[bodylen++];
-		datetime             <<= 8;
-		datetime              += fins_cmnd.body[bodylen++];
-		datetime             <<= 8;
-		datetime              += fins_cmnd.body[bodylen++];
-
-		fileinfo[a].year       = ((datetime >> 25) & 0x7f) + 1980;
-		fileinfo[a].month      =  (datetime >> 21) & 0x0f;
-		fileinfo[a].day        =  (datetime >> 16) & 0x1f;
-		fileinfo[a].hour       =  (datetime >> 11) & 0x1f;
-		fileinfo[a].min        =  (datetime >>  5) & 0x3f;
-		fileinfo[a].sec        = ((datetime      ) & 0x1f) * 2;
-
-		fileinfo[a].size       = fins_cmnd.body[bodylen++];
-		fileinfo[a].size     <<= 8;
-		fileinfo[a].size      += fins_cmnd.body[bodylen++];
-		fileinfo[a].size     <<= 8;
-		fileinfo[a].size      += fins_cmnd.body[bodylen++];
-		fileinfo[a].size     <<= 8;
-		fileinfo[a].size      += fins_cmnd.body[bodylen++];
-
-		bodylen++;
-
-		fileinfo[a].read_only    = fins_cmnd.body[bodylen] & 0x01;
-		fileinfo[a].hidden       = fins_cmnd.body[bodylen] & 0x02;
-		fileinfo[a].system       = fins_cmnd.body[bodylen] & 0x04;
-		fileinfo[a].volume_label = fins_cmnd.body[bodylen] & 0x08;
-		fileinfo[a].directory    = fins_cmnd.body[bodylen] & 0x10;
-		fileinfo[a].archive      = fins_cmnd.body[bodylen] & 0x20;
-
-		bodylen++;
+		XX_finslib_decode_fileinfo( & fins_cmnd.body[bodylen], & fileinfo[a] );
+		bodylen += FINS_FILEINFO_RECORD_LEN;
 	}
 
 	return FINS_RETVAL_SUCCESS;
 
 }  /* finslib_file_name_read */
+
+/*
+ * void XX_finslib_file_name_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, uint16_t start_file, size_t num_files );
+ *
+ * The function XX_finslib_file_name_read_command() builds a command which
+ * reads a block of directory entries from a disk in a remote PLC. The path
+ * must have been checked by the caller.
+ */
+
+void XX_finslib_file_name_read_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, uint16_t start_file, size_t num_files ) {
+
+	size_t b;
+	size_t dirlen;
+
+	if ( path == NULL ) dirlen = 0;
+	else                dirlen = strlen( path );
+
+	XX_finslib_init_command( sys, command, 0x22, 0x01 );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = (disk       >> 8) & 0xff;
+	command->body[(*bodylen)++] = (disk           ) & 0xff;
+	command->body[(*bodylen)++] = (start_file >> 8) & 0xff;
+	command->body[(*bodylen)++] = (start_file     ) & 0xff;
+	command->body[(*bodylen)++] = (num_files  >> 8) & 0xff;
+	command->body[(*bodylen)++] = (num_files      ) & 0xff;
+	command->body[(*bodylen)++] = (dirlen     >> 8) & 0xff;
+	command->body[(*bodylen)++] = (dirlen         ) & 0xff;
+
+	for (b=0; b<dirlen; b++) command->body[(*bodylen)++] = path[b];
+
+}  /* XX_finslib_file_name_read_command */
+
+/*
+ * void XX_finslib_decode_diskinfo( const unsigned char *data, struct fins_diskinfo_tp *diskinfo );
+ *
+ * The function XX_finslib_decode_diskinfo() decodes the volume information
+ * which is returned by the PLC in front of the directory entries.
+ */
+
+void XX_finslib_decode_diskinfo( const unsigned char *data, struct fins_diskinfo_tp *diskinfo ) {
+
+	size_t b;
+	size_t pos;
+	uint32_t datetime;
+
+	pos = 0;
+
+	for (b=0; b<12; b++) diskinfo->volume_label[b] = data[pos++];
+	diskinfo->volume_label[12] = 0;
+
+	datetime                   = data[pos++];
+	datetime                 <<= 8;
+	datetime                  += data[pos++];
+	datetime                 <<= 8;
+	datetime                  += data[pos++];
+	datetime                 <<= 8;
+	datetime                  += data[pos++];
+
+	diskinfo->year             = ((datetime >> 25) & 0x7f) + 1980;
+	diskinfo->month            =  (datetime >> 21) & 0x0f;
+	diskinfo->day              =  (datetime >> 16) & 0x1f;
+	diskinfo->hour             =  (datetime >> 11) & 0x1f;
+	diskinfo->min              =  (datetime >>  5) & 0x3f;
+	diskinfo->sec              = ((datetime      ) & 0x1f) * 2;
+
+	diskinfo->total_capacity   = data[pos++];
+	diskinfo->total_capacity <<= 8;
+	diskinfo->total_capacity  += data[pos++];
+	diskinfo->total_capacity <<= 8;
+	diskinfo->total_capacity  += data[pos++];
+	diskinfo->total_capacity <<= 8;
+	diskinfo->total_capacity  += data[pos++];
+
+	diskinfo->free_capacity    = data[pos++];
+	diskinfo->free_capacity  <<= 8;
+	diskinfo->free_capacity   += data[pos++];
+	diskinfo->free_capacity  <<= 8;
+	diskinfo->free_capacity   += data[pos++];
+	diskinfo->free_capacity  <<= 8;
+	diskinfo->free_capacity   += data[pos++];
+
+	diskinfo->total_files      = data[pos++];
+	diskinfo->total_files    <<= 8;
+	diskinfo->total_files     += data[pos++];
+
+}  /* XX_finslib_decode_diskinfo */
+
+/*
+ * void XX_finslib_decode_fileinfo( const unsigned char *data, struct fins_fileinfo_tp *fileinfo );
+ *
+ * The function XX_finslib_decode_fileinfo() decodes one directory entry as it
+ * is returned by the PLC.
+ */
+
+void XX_finslib_decode_fileinfo( const unsigned char *data, struct fins_fileinfo_tp *fileinfo ) {
+
+	size_t b;
+	size_t pos;
+	uint32_t datetime;
+
+	pos = 0;
+
+	for (b=0; b<12; b++) fileinfo->filename[b] = data[pos++];
+	fileinfo->filename[12] = 0;
+
+	datetime               = data[pos++];
+	datetime             <<= 8;
+	datetime              += data[pos++];
+	datetime             <<= 8;
+	datetime              += data[pos++];
+	datetime             <<= 8;
+	datetime              += data[pos++];
+
+	fileinfo->year         = ((datetime >> 25) & 0x7f) + 1980;
+	fileinfo->month        =  (datetime >> 21) & 0x0f;
+	fileinfo->day          =  (datetime >> 16) & 0x1f;
+	fileinfo->hour         =  (datetime >> 11) & 0x1f;
+	fileinfo->min          =  (datetime >>  5) & 0x3f;
+	fileinfo->sec          = ((datetime      ) & 0x1f) * 2;
+
+	fileinfo->size         = data[pos++];
+	fileinfo->size       <<= 8;
+	fileinfo->size        += data[pos++];
+	fileinfo->size       <<= 8;
+	fileinfo->size        += data[pos++];
+	fileinfo->size       <<= 8;
+	fileinfo->size        += data[pos++];
+
+	pos++;
+
+	fileinfo->read_only    = data[pos] & 0x01;
+	fileinfo->hidden       = data[pos] & 0x02;
+	fileinfo->system       = data[pos] & 0x04;
+	fileinfo->volume_label = data[pos] & 0x08;
+	fileinfo->directory    = data[pos] & 0x10;
+	fileinfo->archive      = data[pos] & 0x20;
+
+}  /* XX_finslib_decode_fileinfo */
+
+/*
+ * int finslib_file_info( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, struct fins_fileinfo_tp *fileinfo );
+ *
+ * The function finslib_file_info() searches the directory entry of a single
+ * file on a disk of a remote PLC. The directory is read in blocks of file
+ * names until the file is found. If the file does not exist the value
+ * FINS_RETVAL_RD_ERR_FILE_MISSING is returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_info( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, struct fins_fileinfo_tp *fileinfo ) {
+
+	struct fins_fileinfo_tp entry[FILE_INFO_BLOCK];
+	size_t num_files;
+	size_t a;
+	size_t b;
+	uint16_t start_file;
+	char filename_83[13];
+	int retval;
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( fileinfo == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	if ( ( retval = finslib_filename_to_83( filename, filename_83 ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	start_file = 0;
+
+	do {
+		num_files = FILE_INFO_BLOCK;
+
+		if ( ( retval = finslib_file_name_read( sys, NULL, entry, disk, path, start_file, & num_files ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+		for (a=0; a<num_files; a++) {
+
+			for (b=0; b<12; b++) if ( toupper( (unsigned char) entry[a].filename[b] ) != toupper( (unsigned char) filename_83[b] ) ) break;
+
+			if ( b == 12 ) {
+
+				*fileinfo = entry[a];
+				return FINS_RETVAL_SUCCESS;
+			}
+		}
+
+		start_file += (uint16_t) num_files;
+
+	} while ( num_files == FILE_INFO_BLOCK );
+
+	return FINS_RETVAL_RD_ERR_FILE_MISSING;
+
+}  /* finslib_file_info */
@@ -46,16 +46,43 @@
 int finslib_file_write( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t file_position, size_t num_bytes, uint16_t write_mode ) {
 
 	struct fins_command_tp fins_cmnd;
+	size_t bodylen;
+	int retval;
+
+	if ( sys == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	if ( ( retval = XX_finslib_file_write_command( sys, & fins_cmnd, & bodylen, disk, path, filename, data, file_position, num_bytes, write_mode ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_file_write */
+
+/*
+ * int XX_finslib_file_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t file_position, size_t num_bytes, uint16_t write_mode );
+ *
+ * The function XX_finslib_file_write_command() checks the parameters of a
+ * file write and builds the FINS command to write a block of data to a file.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_file_write_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t file_position, size_t num_bytes, uint16_t write_mode ) {
+
 	size_t a;
 	size_t dirlen;
-	size_t bodylen;
 	char filename_83[13];
 	int retval;
 
-	if ( sys         == NULL                ) return FINS_RETVAL_NOT_INITIALIZED;
-	if ( num_bytes   >  0  &&  data == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
-	if ( num_bytes   >  1900                ) return FINS_RETVAL_BODY_TOO_LONG;
-	if ( sys->sockfd == INVALID_SOCKET      ) return FINS_RETVAL_NOT_CONNECTED;
+	if ( sys         == NULL                      ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( command     == NULL                      ) return FINS_RETVAL_NO_COMMAND;
+	if ( bodylen     == NULL                      ) return FINS_RETVAL_NO_COMMAND_LENGTH;
+	if ( num_bytes   >  0  &&  data == NULL       ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( num_bytes   >  FINS_MAX_FILE_WRITE_BYTES ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( sys->sockfd == INVALID_SOCKET            ) return FINS_RETVAL_NOT_CONNECTED;
 
 	if ( disk != FINS_DISK_MEMORY_CARD  &&  disk != FINS_DISK_EM_FILE_MEMORY ) return FINS_RETVAL_INVALID_DISK;
 	if ( ! finslib_valid_directory( path )                                   ) return FINS_RETVAL_INVALID_PATH;
@@ -66,35 +93,31 @@ int finslib_file_write( struct fins_sys_tp *sys, uint16_t disk, const char *path
 	if ( path == NULL ) dirlen = 0;
 	else                dirlen = strlen( path );
 
-	XX_finslib_init_command( sys, & fins_cmnd, 0x22, 0x03 );
-
-	bodylen = 0;
-
-	fins_cmnd.body[bodylen++] = (disk       >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (disk           ) & 0xff;
-	fins_cmnd.body[bodylen++] = (write_mode >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (write_mode     ) & 0xff;
+	XX_finslib_init_command( sys, command, 0x22, 0x03 );
 
-	for (a=0; a<12; a++) fins_cmnd.body[bodylen++] = filename_83[a];
+	*bodylen = 0;
 
-	fins_cmnd.body[bodylen++] = (file_position >> 24) & 0xff;
-	fins_cmnd.body[bodylen++] = (file_position >> 16) & 0xff;
-	fins_cmnd.body[bodylen++] = (file_position >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (file_position      ) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_bytes     >>  8) & 0xff;
-	fins_cmnd.body[bodylen++] = (num_bytes          ) & 0xff;
+	command->body[(*bodylen)++] = (disk       >> 8) & 0xff;
+	command->body[(*bodylen)++] = (disk           ) & 0xff;
+	command->body[(*bodylen)++] = (write_mode >> 8) & 0xff;
+	command->body[(*bodylen)++] = (write_mode     ) & 0xff;
 
-	for (a=0; a<num_bytes; a++) fins_cmnd.body[bodylen++] = data[a];
+	for (a=0; a<12; a++) command->body[(*bodylen)++] = filename_83[a];
 
-	fins_cmnd.body[bodylen++] = (dirlen >> 8) & 0xff;
-	fins_cmnd.body[bodylen++] = (dirlen     ) & 0xff;
+	command->body[(*bodylen)++] = (file_position >> 24) & 0xff;
+	command->body[(*bodylen)++] = (file_position >> 16) & 0xff;
+	command->body[(*bodylen)++] = (file_position >>  8) & 0xff;
+	command->body[(*bodylen)++] = (file_position      ) & 0xff;
+	command->body[(*bodylen)++] = (num_bytes     >>  8) & 0xff;
+	command->body[(*bodylen)++] = (num_bytes          ) & 0xff;
 
-	for (a=0; a<dirlen; a++) fins_cmnd.body[bodylen++] = path[a];
+	for (a=0; a<num_bytes; a++) command->body[(*bodylen)++] = data[a];
 
-	if ( ( retval = XX_finslib_communicate( sys, & fins_cmnd, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	command->body[(*bodylen)++] = (dirlen >> 8) & 0xff;
+	command->body[(*bodylen)++] = (dirlen     ) & 0xff;
 
-	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
+	for (a=0; a<dirlen; a++) command->body[(*bodylen)++] = path[a];
 
 	return FINS_RETVAL_SUCCESS;
 
-}  /* finslib_file_write */
+}  /* XX_finslib_file_write_command */
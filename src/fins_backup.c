@@ -0,0 +1,555 @@
+/*
+ * Library: libfins
+ * File:    src/fins_backup.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_backup.c contains routines to make a backup of the
+ * complete user program of a remote PLC and to restore it. The program area
+ * is read and written with a number of 03 06 and 03 07 commands in flight at
+ * the same time. The number of bytes to read is bounded by the program area
+ * size reported by the CPU unit, or by the size in the fins_model[] table if
+ * the CPU unit does not report it. The end of the program is signalled by the
+ * PLC with the last data flag.
+ *
+ * A backup file starts with a 48 byte header containing the text "FINSPRG",
+ * a version byte, the model of the CPU unit padded with zeros to 24 bytes,
+ * the block size, the number of blocks, the size of the program in bytes and
+ * the CRC-32 checksum of the complete program. Each block follows as a 12 byte
+ * record header and the data of the block. The record header contains the
+ * start address of the block, the length of the block with the most
+ * significant bit set for the last block, two reserved bytes and the CRC-32
+ * checksum of the data of the block. All numbers are stored most significant
+ * byte first.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define BACKUP_VERSION		0x01
+#define BACKUP_FILE_HEADER	48
+#define BACKUP_BLOCK_HEADER	12
+#define BACKUP_MODEL_LEN	24
+#define BACKUP_LAST_BLOCK	0x8000
+
+									/********************************************************/
+struct image_tp {							/*							*/
+	unsigned char *		data;					/* The program read from the PLC			*/
+	size_t			size;					/* Number of bytes allocated for the data		*/
+	size_t			num_bytes;				/* Number of bytes of the program read			*/
+	size_t			max_bytes;				/* Size of the program area or 0 if unknown		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct block_tp {							/*							*/
+	uint32_t		address;				/* Start address of the block in the program area	*/
+	size_t			num_bytes;				/* Number of bytes in the block				*/
+	const unsigned char *	data;					/* Data of the block					*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct restore_tp {							/*							*/
+	struct block_tp *	block;					/* Blocks read from the backup file			*/
+	size_t			num_blocks;				/* Number of blocks					*/
+	size_t			first_block;				/* Block written by the first command of a pipeline	*/
+};									/*							*/
+									/********************************************************/
+
+static int			build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			load_backup( const char *filename, unsigned char **buffer, struct restore_tp *restore );
+static size_t			program_area_bytes( const struct fins_cpudata_tp *cpudata );
+static int			read_image( struct fins_sys_tp *sys, struct image_tp *image, size_t max_bytes, size_t depth );
+static int			write_backup( FILE *fp, const char *model, const struct image_tp *image );
+static int			write_program( struct fins_sys_tp *sys, const unsigned char *header, struct restore_tp *restore, size_t depth, int verify );
+
+/*
+ * int finslib_program_backup( struct fins_sys_tp *sys, const char *filename, size_t depth, size_t *num_bytes );
+ *
+ * The function finslib_program_backup() reads the complete user program from
+ * the program area of a remote PLC and stores it in a backup file. An
+ * existing file with the same name is overwritten. At most depth read
+ * commands are in flight at the same time. The size of the program in bytes
+ * is stored in num_bytes if that parameter is not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_program_backup( struct fins_sys_tp *sys, const char *filename, size_t depth, size_t *num_bytes ) {
+
+	FILE *fp;
+	int retval;
+	struct image_tp image;
+	struct fins_cpudata_tp cpudata;
+
+	if ( num_bytes != NULL ) *num_bytes = 0;
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( filename == NULL ) return FINS_RETVAL_BACKUP_INVALID;
+
+	if ( ( retval = finslib_cpu_unit_data_read( sys, & cpudata ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( ( retval = read_image( sys, & image, program_area_bytes( & cpudata ), depth ) ) != FINS_RETVAL_SUCCESS ) {
+
+		free( image.data );
+		return retval;
+	}
+
+	fp = fopen( filename, "wb" );
+
+	if ( fp == NULL ) {
+
+		free( image.data );
+		return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	retval = write_backup( fp, cpudata.model, & image );
+
+	if ( fclose( fp ) != 0  &&  retval == FINS_RETVAL_SUCCESS ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  num_bytes != NULL ) *num_bytes = image.num_bytes;
+
+	free( image.data );
+
+	return retval;
+
+}  /* finslib_program_backup */
+
+/*
+ * int finslib_program_restore( struct fins_sys_tp *sys, const char *filename, size_t depth, int verify );
+ *
+ * The function finslib_program_restore() writes the user program stored in a
+ * backup file to the program area of a remote PLC. The checksums in the file
+ * are checked and the model of the PLC must be the same as the model from
+ * which the backup was made before anything is written. All blocks except the
+ * last are written with at most depth commands in flight. The last block is
+ * written when all other blocks have been confirmed and marks the end of the
+ * transfer. The PLC must be in program mode. The verify parameter is either
+ * FINS_VERIFY_NONE or FINS_VERIFY_READ_BACK in which case the program is read
+ * back afterwards and compared with the backup.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_program_restore( struct fins_sys_tp *sys, const char *filename, size_t depth, int verify ) {
+
+	int retval;
+	unsigned char *buffer;
+	struct restore_tp restore;
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( filename == NULL ) return FINS_RETVAL_BACKUP_INVALID;
+
+	if ( verify != FINS_VERIFY_NONE  &&  verify != FINS_VERIFY_READ_BACK ) return FINS_RETVAL_INVALID_VERIFY_MODE;
+
+	retval = load_backup( filename, & buffer, & restore );
+
+	if ( retval == FINS_RETVAL_SUCCESS ) retval = write_program( sys, buffer, & restore, depth, verify );
+
+	free( restore.block );
+	free( buffer );
+
+	return retval;
+
+}  /* finslib_program_restore */
+
+/*
+ * static int write_program( struct fins_sys_tp *sys, const unsigned char *header, struct restore_tp *restore, size_t depth, int verify );
+ *
+ * The function write_program() writes the blocks of a backup which has been
+ * loaded and checked to the program area of a PLC.
+ */
+
+static int write_program( struct fins_sys_tp *sys, const unsigned char *header, struct restore_tp *restore, size_t depth, int verify ) {
+
+	int retval;
+	struct image_tp image;
+	struct fins_cpudata_tp cpudata;
+
+	if ( ( retval = finslib_cpu_unit_data_read( sys, & cpudata ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( header[8] != 0  &&  strncmp( (const char *) header+8, cpudata.model, BACKUP_MODEL_LEN ) != 0 ) return FINS_RETVAL_BACKUP_MODEL_MISMATCH;
+
+	restore->first_block = 0;
+
+	if ( ( retval = XX_finslib_pipeline( sys, restore->num_blocks-1, depth, build_write, handle_write, restore ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	restore->first_block = restore->num_blocks-1;
+
+	if ( ( retval = XX_finslib_pipeline( sys, 1, 1, build_write, handle_write, restore ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( verify != FINS_VERIFY_READ_BACK ) return FINS_RETVAL_SUCCESS;
+
+	retval = read_image( sys, & image, program_area_bytes( & cpudata ), depth );
+
+	if ( retval == FINS_RETVAL_SUCCESS ) {
+
+		if ( image.num_bytes != XX_finslib_get_uint32( header+40 )                                 ) retval = FINS_RETVAL_VERIFY_FAILED;
+		if ( finslib_crc32( 0, image.data, image.num_bytes ) != XX_finslib_get_uint32( header+44 ) ) retval = FINS_RETVAL_VERIFY_FAILED;
+	}
+
+	free( image.data );
+
+	return retval;
+
+}  /* write_program */
+
+/*
+ * static size_t program_area_bytes( const struct fins_cpudata_tp *cpudata );
+ *
+ * The function program_area_bytes() returns the size of the program area of a
+ * PLC in bytes. The size reported by the CPU unit in Kwords is used if
+ * available, otherwise the size in words from the fins_model[] table. If the
+ * size is not known 0 is returned.
+ */
+
+static size_t program_area_bytes( const struct fins_cpudata_tp *cpudata ) {
+
+	const struct fins_mcap_tp *mcap;
+
+	if ( cpudata->program_area_size > 0 ) return (size_t) cpudata->program_area_size * 1024 * 2;
+
+	mcap = XX_finslib_model_capabilities( cpudata->model );
+
+	return ( mcap != NULL ) ? mcap->pa_size * 2 : 0;
+
+}  /* program_area_bytes */
+
+/*
+ * static int read_image( struct fins_sys_tp *sys, struct image_tp *image, size_t max_bytes, size_t depth );
+ *
+ * The function read_image() reads the program from the program area of a PLC
+ * in memory until the PLC flags the last block or max_bytes have been read.
+ * If max_bytes is 0 reading only stops at the last block. The caller must
+ * free the data in the image, also when an error is returned.
+ */
+
+static int read_image( struct fins_sys_tp *sys, struct image_tp *image, size_t max_bytes, size_t depth ) {
+
+	image->data      = NULL;
+	image->size      = 0;
+	image->num_bytes = 0;
+	image->max_bytes = max_bytes;
+
+	return XX_finslib_pipeline( sys, (size_t) -1, depth, build_read, handle_read, image );
+
+}  /* read_image */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the command which reads the next block of
+ * the program area. The pipeline is ended when the size of the program area
+ * has been reached.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	size_t offset;
+	size_t num_bytes;
+	struct image_tp *image;
+
+	image     = context;
+	offset    = index * FINS_MAX_PROGRAM_AREA_BYTES;
+	num_bytes = FINS_MAX_PROGRAM_AREA_BYTES;
+
+	if ( image->max_bytes > 0 ) {
+
+		if ( offset >= image->max_bytes ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+		if ( num_bytes > image->max_bytes - offset ) num_bytes = image->max_bytes - offset;
+	}
+
+	return XX_finslib_program_area_read_command( sys, command, bodylen, (uint32_t) offset, num_bytes );
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() adds a block read from the program area to the
+ * image in memory. Only the block flagged as last by the PLC may be shorter
+ * than requested, because the following blocks were requested at fixed
+ * addresses. When the last block arrives, the pipeline is ended and the
+ * responses to blocks beyond the end of the program are discarded.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	size_t offset;
+	size_t requested;
+	size_t num_bytes;
+	size_t size;
+	bool last_data;
+	unsigned char *data;
+	struct image_tp *image;
+
+	(void) sys;
+
+	if ( bodylen < 10 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	image     = context;
+	offset    = index * FINS_MAX_PROGRAM_AREA_BYTES;
+	requested = FINS_MAX_PROGRAM_AREA_BYTES;
+
+	if ( image->max_bytes > 0  &&  requested > image->max_bytes - offset ) requested = image->max_bytes - offset;
+
+	last_data   = response->body[8] & 0x80;
+	num_bytes   = response->body[8] & 0x7f;
+	num_bytes <<= 8;
+	num_bytes  += response->body[9];
+
+	if ( bodylen < 10 + num_bytes               ) return FINS_RETVAL_BODY_TOO_SHORT;
+	if ( num_bytes > requested                  ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( num_bytes < requested  &&  ! last_data ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	if ( offset + num_bytes > image->size ) {
+
+		size = ( image->size > 0 ) ? image->size : 16 * FINS_MAX_PROGRAM_AREA_BYTES;
+		while ( size < offset + num_bytes ) size *= 2;
+
+		data = realloc( image->data, size );
+		if ( data == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		image->data = data;
+		image->size = size;
+	}
+
+	memcpy( image->data + offset, & response->body[10], num_bytes );
+
+	image->num_bytes = offset + num_bytes;
+
+	return ( last_data ) ? FINS_RETVAL_SUCCESS_LAST_DATA : FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static int write_backup( FILE *fp, const char *model, const struct image_tp *image );
+ *
+ * The function write_backup() writes a program read from a PLC to a backup
+ * file in blocks of the maximum program area transfer size.
+ */
+
+static int write_backup( FILE *fp, const char *model, const struct image_tp *image ) {
+
+	size_t offset;
+	size_t num_blocks;
+	size_t num_bytes;
+	uint16_t length;
+	unsigned char buf[BACKUP_FILE_HEADER];
+
+	num_blocks = ( image->num_bytes + FINS_MAX_PROGRAM_AREA_BYTES - 1 ) / FINS_MAX_PROGRAM_AREA_BYTES;
+	if ( num_blocks == 0 ) num_blocks = 1;
+
+	memset( buf, 0, BACKUP_FILE_HEADER );
+
+	memcpy( buf, "FINSPRG", 7 );
+	buf[7] = BACKUP_VERSION;
+	strncpy( (char *) buf+8, model, BACKUP_MODEL_LEN-1 );
+	XX_finslib_put_uint32( buf+32, FINS_MAX_PROGRAM_AREA_BYTES );
+	XX_finslib_put_uint32( buf+36, (uint32_t) num_blocks );
+	XX_finslib_put_uint32( buf+40, (uint32_t) image->num_bytes );
+	XX_finslib_put_uint32( buf+44, finslib_crc32( 0, image->data, image->num_bytes ) );
+
+	if ( fwrite( buf, 1, BACKUP_FILE_HEADER, fp ) != BACKUP_FILE_HEADER ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	offset = 0;
+
+	do {
+		num_bytes = image->num_bytes - offset;
+		if ( num_bytes > FINS_MAX_PROGRAM_AREA_BYTES ) num_bytes = FINS_MAX_PROGRAM_AREA_BYTES;
+
+		length = (uint16_t) num_bytes;
+		if ( offset + num_bytes >= image->num_bytes ) length |= BACKUP_LAST_BLOCK;
+
+		XX_finslib_put_uint32( buf, (uint32_t) offset );
+		buf[4] = (length >> 8) & 0xff;
+		buf[5] = (length     ) & 0xff;
+		buf[6] = 0;
+		buf[7] = 0;
+		XX_finslib_put_uint32( buf+8, finslib_crc32( 0, image->data + offset, num_bytes ) );
+
+		if ( fwrite( buf, 1, BACKUP_BLOCK_HEADER, fp ) != BACKUP_BLOCK_HEADER ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+		if ( num_bytes > 0  &&  fwrite( image->data + offset, 1, num_bytes, fp ) != num_bytes ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+		offset += num_bytes;
+
+	} while ( offset < image->num_bytes );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* write_backup */
+
+/*
+ * static int load_backup( const char *filename, unsigned char **buffer, struct restore_tp *restore );
+ *
+ * The function load_backup() reads a backup file in memory and checks the
+ * header, the layout of the blocks and all checksums. The blocks in the
+ * restore structure point in the buffer. The caller must free the buffer and
+ * the list of blocks, also when an error is returned.
+ */
+
+static int load_backup( const char *filename, unsigned char **buffer, struct restore_tp *restore ) {
+
+	FILE *fp;
+	long file_size;
+	size_t a;
+	size_t pos;
+	size_t num_bytes;
+	uint16_t length;
+	uint32_t crc;
+	struct block_tp *block;
+
+	*buffer             = NULL;
+	restore->block      = NULL;
+	restore->num_blocks = 0;
+
+	fp = fopen( filename, "rb" );
+	if ( fp == NULL ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fseek( fp, 0, SEEK_END ) != 0  ||  ( file_size = ftell( fp ) ) < 0  ||  fseek( fp, 0, SEEK_SET ) != 0 ) {
+
+		fclose( fp );
+		return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	if ( file_size < BACKUP_FILE_HEADER ) {
+
+		fclose( fp );
+		return FINS_RETVAL_BACKUP_INVALID;
+	}
+
+	*buffer = malloc( (size_t) file_size );
+
+	if ( *buffer == NULL ) {
+
+		fclose( fp );
+		return FINS_RETVAL_OUT_OF_MEMORY;
+	}
+
+	if ( fread( *buffer, 1, (size_t) file_size, fp ) != (size_t) file_size ) {
+
+		fclose( fp );
+		return FINS_RETVAL_BACKUP_INVALID;
+	}
+
+	fclose( fp );
+
+	restore->num_blocks = XX_finslib_get_uint32( *buffer+36 );
+
+	if ( memcmp( *buffer, "FINSPRG", 7 ) != 0                            ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( (*buffer)[7] != BACKUP_VERSION                                  ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( (*buffer)[8+BACKUP_MODEL_LEN-1] != 0                            ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( XX_finslib_get_uint32( *buffer+32 ) != FINS_MAX_PROGRAM_AREA_BYTES         ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( restore->num_blocks == 0                                        ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( restore->num_blocks > (size_t) file_size / BACKUP_BLOCK_HEADER  ) return FINS_RETVAL_BACKUP_INVALID;
+
+	restore->block = calloc( restore->num_blocks, sizeof(struct block_tp) );
+	if ( restore->block == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	pos       = BACKUP_FILE_HEADER;
+	num_bytes = 0;
+	crc       = 0;
+
+	for (a=0; a<restore->num_blocks; a++) {
+
+		block = & restore->block[a];
+
+		if ( pos + BACKUP_BLOCK_HEADER > (size_t) file_size ) return FINS_RETVAL_BACKUP_INVALID;
+
+		length           = (uint16_t) ( ( (*buffer)[pos+4] << 8 ) + (*buffer)[pos+5] );
+		block->address   = XX_finslib_get_uint32( *buffer+pos );
+		block->num_bytes = length & ~BACKUP_LAST_BLOCK;
+		block->data      = *buffer + pos + BACKUP_BLOCK_HEADER;
+
+		if ( block->num_bytes > FINS_MAX_PROGRAM_AREA_BYTES                                    ) return FINS_RETVAL_BACKUP_INVALID;
+		if ( pos + BACKUP_BLOCK_HEADER + block->num_bytes > (size_t) file_size                 ) return FINS_RETVAL_BACKUP_INVALID;
+		if ( ( ( length & BACKUP_LAST_BLOCK ) != 0 ) != ( a+1 == restore->num_blocks )         ) return FINS_RETVAL_BACKUP_INVALID;
+		if ( block->address != num_bytes                                                       ) return FINS_RETVAL_BACKUP_INVALID;
+		if ( finslib_crc32( 0, block->data, block->num_bytes ) != XX_finslib_get_uint32( *buffer+pos+8 )  ) return FINS_RETVAL_BACKUP_INVALID;
+
+		crc        = finslib_crc32( crc, block->data, block->num_bytes );
+		num_bytes += block->num_bytes;
+		pos       += BACKUP_BLOCK_HEADER + block->num_bytes;
+	}
+
+	if ( pos       != (size_t) file_size      ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( num_bytes != XX_finslib_get_uint32( *buffer+40 ) ) return FINS_RETVAL_BACKUP_INVALID;
+	if ( crc       != XX_finslib_get_uint32( *buffer+44 ) ) return FINS_RETVAL_BACKUP_INVALID;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* load_backup */
+
+/*
+ * static int build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_write() builds the command which writes a block of a
+ * backup to the program area. The last block of the backup is marked as the
+ * end of the program transfer.
+ */
+
+static int build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	struct block_tp *block;
+	struct restore_tp *restore;
+
+	restore = context;
+	index  += restore->first_block;
+	block   = & restore->block[index];
+
+	return XX_finslib_program_area_write_command( sys, command, bodylen, block->data, block->address, block->num_bytes, index+1 == restore->num_blocks );
+
+}  /* build_write */
+
+/*
+ * static int handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_write() checks the response of the PLC to a program
+ * area write.
+ */
+
+static int handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	(void) sys;
+	(void) index;
+	(void) response;
+	(void) context;
+
+	if ( bodylen != 10 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_write */
@@ -0,0 +1,404 @@
+/*
+ * Library: libfins
+ * File:    src/fins_cache.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_cache.c contains an optional cache for memory area
+ * read responses. When several parts of an application read the same memory
+ * area of a PLC within a short period of time, only the first read is sent to
+ * the PLC. Following reads of the same or a smaller range are answered from
+ * the cache until the entry expires. Commands which change memory areas
+ * invalidate the affected cache entries.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+									/********************************************************/
+struct cache_entry_tp {							/*							*/
+	bool			used;					/* Entry contains a valid response			*/
+	uint8_t			area;					/* FINS area code of the read				*/
+	uint32_t		word;					/* Start word address of the read			*/
+	uint8_t			bit;					/* Start bit number of the read				*/
+	size_t			num_elements;				/* Number of elements read				*/
+	size_t			element_size;				/* Number of bytes per element in the response		*/
+	int64_t			stamp;					/* Time in milliseconds the response was received	*/
+	unsigned char		data[FINS_BODY_LEN];			/* Data returned by the PLC without end code		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_cache_tp {							/*							*/
+	int			ttl_msec;				/* Milliseconds a response remains valid		*/
+	size_t			num_entries;				/* Number of entries in the cache			*/
+	struct cache_entry_tp *	entry;					/* The cache entries					*/
+};									/*							*/
+									/********************************************************/
+
+static void	invalidate_range( struct fins_cache_tp *cache, uint32_t word, size_t num_words );
+static size_t	words_spanned( const struct cache_entry_tp *entry );
+
+/*
+ * int finslib_cache_enable( struct fins_sys_tp *sys, int ttl_msec, size_t num_entries );
+ *
+ * The function finslib_cache_enable() attaches a read cache to a connection.
+ * Responses to memory area reads are kept for ttl_msec milliseconds. At most
+ * num_entries different reads are cached at the same time. Calling the
+ * function on a connection which already has a cache replaces that cache.
+ * A ttl_msec of zero or less is rejected and leaves an existing cache in
+ * place. Use finslib_cache_disable() to remove the cache.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_cache_enable( struct fins_sys_tp *sys, int ttl_msec, size_t num_entries ) {
+
+	struct fins_cache_tp *cache;
+
+	if ( sys         == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( ttl_msec    <= 0    ) return FINS_RETVAL_INVALID_PERIOD;
+	if ( num_entries == 0    ) num_entries = FINS_CACHE_DEFAULT_ENTRIES;
+
+	cache = calloc( 1, sizeof(struct fins_cache_tp) );
+	if ( cache == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	cache->entry = calloc( num_entries, sizeof(struct cache_entry_tp) );
+
+	if ( cache->entry == NULL ) {
+
+		free( cache );
+		return FINS_RETVAL_OUT_OF_MEMORY;
+	}
+
+	cache->ttl_msec    = ttl_msec;
+	cache->num_entries = num_entries;
+
+	finslib_cache_disable( sys );
+
+	sys->cache = cache;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_cache_enable */
+
+/*
+ * void finslib_cache_disable( struct fins_sys_tp *sys );
+ *
+ * The function finslib_cache_disable() removes the read cache from a
+ * connection and releases the memory associated with it.
+ */
+
+void finslib_cache_disable( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->cache == NULL ) return;
+
+	free( sys->cache->entry );
+	free( sys->cache );
+
+	sys->cache = NULL;
+
+}  /* finslib_cache_disable */
+
+/*
+ * void finslib_cache_flush( struct fins_sys_tp *sys );
+ *
+ * The function finslib_cache_flush() invalidates all entries in the read
+ * cache of a connection. Applications should call this function when the
+ * memory of the PLC may have been changed by another FINS client.
+ */
+
+void finslib_cache_flush( struct fins_sys_tp *sys ) {
+
+	size_t a;
+
+	if ( sys == NULL  ||  sys->cache == NULL ) return;
+
+	for (a=0; a<sys->cache->num_entries; a++) sys->cache->entry[a].used = false;
+
+}  /* finslib_cache_flush */
+
+/*
+ * bool XX_finslib_cache_lookup( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen );
+ *
+ * The function XX_finslib_cache_lookup() checks if a memory area read command
+ * can be answered from the cache. This is the case if a valid entry exists
+ * for the same area which contains the complete requested range. On a hit the
+ * command is replaced by the response a PLC would have sent and true is
+ * returned.
+ */
+
+bool XX_finslib_cache_lookup( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen ) {
+
+	size_t a;
+	size_t b;
+	size_t len;
+	size_t offset;
+	size_t num_elements;
+	uint32_t word;
+	uint32_t first;
+	uint32_t req_first;
+	uint8_t bit;
+	int64_t now;
+	unsigned char request_header[FINS_HEADER_LEN];
+	struct cache_entry_tp *entry;
+
+	if ( sys == NULL  ||  sys->cache == NULL                                ) return false;
+	if ( command->header[FINS_MRC] != 0x01  ||  command->header[FINS_SRC] != 0x01 ) return false;
+	if ( *bodylen != 6                                                    ) return false;
+
+	word           = command->body[1];
+	word         <<= 8;
+	word          += command->body[2];
+	bit            = command->body[3];
+	num_elements   = command->body[4];
+	num_elements <<= 8;
+	num_elements  += command->body[5];
+
+	if ( num_elements == 0 ) return false;
+
+	now = finslib_monotonic_msec_timer();
+
+	for (a=0; a<sys->cache->num_entries; a++) {
+
+		entry = & sys->cache->entry[a];
+
+		if ( ! entry->used                                       ) continue;
+		if ( entry->area != command->body[0]                     ) continue;
+		if ( now - entry->stamp >= sys->cache->ttl_msec          ) { entry->used = false; continue; }
+
+		/*
+		 * Bit areas return one byte per bit and may start at any bit
+		 * number. Word areas return two or more bytes per element and the
+		 * bit number is always zero.
+		 */
+
+		if ( entry->element_size == 1 ) {
+
+			first     = entry->word * 16 + entry->bit;
+			req_first = word        * 16 + bit;
+		}
+
+		else {
+			if ( bit != 0  ||  entry->bit != 0 ) continue;
+
+			first     = entry->word;
+			req_first = word;
+		}
+
+		if ( req_first < first                                             ) continue;
+		if ( req_first + num_elements > first + entry->num_elements        ) continue;
+
+		offset = ( req_first - first ) * entry->element_size;
+		len    = num_elements * entry->element_size;
+
+		for (b=0; b<FINS_HEADER_LEN; b++) request_header[b] = command->header[b];
+
+		XX_finslib_response_header( command, request_header );
+
+		command->body[0] = 0x00;
+		command->body[1] = 0x00;
+
+		memcpy( command->body + 2, entry->data + offset, len );
+
+		*bodylen = 2 + len;
+
+		return true;
+	}
+
+	return false;
+
+}  /* XX_finslib_cache_lookup */
+
+/*
+ * void XX_finslib_cache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen );
+ *
+ * The function XX_finslib_cache_invalidate() removes the cache entries which
+ * may be affected by a command before it is sent to the PLC. Writes, fills
+ * and transfers only invalidate entries overlapping the destination range.
+ * Other commands which may change memory areas as a side effect invalidate
+ * the whole cache.
+ */
+
+void XX_finslib_cache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen ) {
+
+	uint32_t word;
+	size_t num_elements;
+	size_t element_size;
+	uint8_t mrc;
+	uint8_t src;
+
+	if ( sys == NULL  ||  sys->cache == NULL ) return;
+
+	mrc = command->header[FINS_MRC];
+	src = command->header[FINS_SRC];
+
+	if ( mrc == 0x01  &&  ( src == 0x01  ||  src == 0x04 ) ) return;
+
+	if ( mrc == 0x01  &&  src == 0x02  &&  bodylen > 6 ) {
+
+		word           = command->body[1];
+		word         <<= 8;
+		word          += command->body[2];
+		num_elements   = command->body[4];
+		num_elements <<= 8;
+		num_elements  += command->body[5];
+
+		if ( num_elements == 0 ) return;
+
+		element_size = ( bodylen - 6 ) / num_elements;
+
+		if ( element_size <= 1 ) invalidate_range( sys->cache, word, ( command->body[3] + num_elements + 15 ) / 16 );
+		else                     invalidate_range( sys->cache, word, ( num_elements * element_size + 1 ) / 2  );
+
+		return;
+	}
+
+	if ( mrc == 0x01  &&  src == 0x03  &&  bodylen >= 8 ) {
+
+		word           = command->body[1];
+		word         <<= 8;
+		word          += command->body[2];
+		num_elements   = command->body[4];
+		num_elements <<= 8;
+		num_elements  += command->body[5];
+
+		invalidate_range( sys->cache, word, num_elements );
+		return;
+	}
+
+	if ( mrc == 0x01  &&  src == 0x05  &&  bodylen >= 10 ) {
+
+		word           = command->body[5];
+		word         <<= 8;
+		word          += command->body[6];
+		num_elements   = command->body[8];
+		num_elements <<= 8;
+		num_elements  += command->body[9];
+
+		invalidate_range( sys->cache, word, num_elements );
+		return;
+	}
+
+	if ( mrc == 0x01                                          ||
+	     mrc == 0x03                                          ||
+	     mrc == 0x04                                          ||
+	     mrc == 0x23                                          ||
+	   ( mrc == 0x22  &&  src >= 0x0a  &&  src <= 0x0c )       ) finslib_cache_flush( sys );
+
+}  /* XX_finslib_cache_invalidate */
+
+/*
+ * void XX_finslib_cache_store( struct fins_sys_tp *sys, const unsigned char *request_body, const struct fins_command_tp *response, size_t bodylen );
+ *
+ * The function XX_finslib_cache_store() stores the successful response to a
+ * memory area read in the cache. The oldest entry is replaced if no free
+ * entry is available.
+ */
+
+void XX_finslib_cache_store( struct fins_sys_tp *sys, const unsigned char *request_body, const struct fins_command_tp *response, size_t bodylen ) {
+
+	size_t a;
+	size_t num_elements;
+	int64_t now;
+	struct cache_entry_tp *entry;
+
+	if ( sys == NULL  ||  sys->cache == NULL                                      ) return;
+	if ( response->header[FINS_MRC] != 0x01  ||  response->header[FINS_SRC] != 0x01 ) return;
+	if ( bodylen <= 2  ||  response->body[0] != 0x00  ||  response->body[1] != 0x00 ) return;
+
+	num_elements   = request_body[4];
+	num_elements <<= 8;
+	num_elements  += request_body[5];
+
+	if ( num_elements == 0  ||  ( bodylen - 2 ) % num_elements != 0 ) return;
+
+	now   = finslib_monotonic_msec_timer();
+	entry = & sys->cache->entry[0];
+
+	for (a=0; a<sys->cache->num_entries; a++) {
+
+		if ( ! sys->cache->entry[a].used                      ) { entry = & sys->cache->entry[a]; break; }
+		if ( sys->cache->entry[a].stamp < entry->stamp        )   entry = & sys->cache->entry[a];
+	}
+
+	entry->used           = true;
+	entry->area           = request_body[0];
+	entry->word           = request_body[1];
+	entry->word         <<= 8;
+	entry->word          += request_body[2];
+	entry->bit            = request_body[3];
+	entry->num_elements   = num_elements;
+	entry->element_size   = ( bodylen - 2 ) / num_elements;
+	entry->stamp          = now;
+
+	memcpy( entry->data, response->body + 2, bodylen - 2 );
+
+}  /* XX_finslib_cache_store */
+
+/*
+ * static void invalidate_range( struct fins_cache_tp *cache, uint32_t word, size_t num_words );
+ *
+ * The function invalidate_range() removes all cache entries which overlap a
+ * range of words. Bit and word area codes of the same memory differ, and
+ * different memory areas use the same word numbers. The area code is
+ * therefore ignored and some entries may be removed unnecessarily.
+ */
+
+static void invalidate_range( struct fins_cache_tp *cache, uint32_t word, size_t num_words ) {
+
+	size_t a;
+	struct cache_entry_tp *entry;
+
+	for (a=0; a<cache->num_entries; a++) {
+
+		entry = & cache->entry[a];
+
+		if ( ! entry->used                                    ) continue;
+		if ( entry->word + words_spanned( entry ) <= word     ) continue;
+		if ( word + num_words <= entry->word                  ) continue;
+
+		entry->used = false;
+	}
+
+}  /* invalidate_range */
+
+/*
+ * static size_t words_spanned( const struct cache_entry_tp *entry );
+ *
+ * The function words_spanned() returns the number of PLC words covered by the
+ * data in a cache entry.
+ */
+
+static size_t words_spanned( const struct cache_entry_tp *entry ) {
+
+	if ( entry->element_size == 1 ) return ( entry->bit + entry->num_elements + 15 ) / 16;
+
+	return ( entry->num_elements * entry->element_size + 1 ) / 2;
+
+}  /* words_spanned */
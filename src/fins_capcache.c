@@ -0,0 +1,492 @@
+/*
+ * Library: libfins
+ * File:    src/fins_capcache.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_capcache.c contains routines to keep the
+ * capabilities of PLCs in a local cache file. The address of memory areas can
+ * only be resolved after the FINS mode of a PLC is known, which normally
+ * requires a CPU unit data read after every connect. With the capability
+ * cache that information is taken from the file, so that a connection can be
+ * used right away. The profile is checked against the PLC later, when the
+ * application has time for it.
+ *
+ * The cache file starts with a 16 byte header containing the text "FINSCAP",
+ * a version byte, the number of records and a CRC-32 over all records. Every
+ * record of CAPCACHE_RECORD_LEN bytes describes one endpoint, identified by
+ * its IP address, port and remote network, node and unit. All numbers are
+ * stored most significant byte first. A file which cannot be read or is
+ * corrupt is ignored and the cache then starts empty.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fins.h"
+
+#define CAPCACHE_VERSION	0x01
+#define CAPCACHE_HEADER_LEN	16
+#define CAPCACHE_RECORD_LEN	192
+#define CAPCACHE_ADDRESS_LEN	128
+#define CAPCACHE_PATH_LEN	512
+
+									/********************************************************/
+struct capcache_entry_tp {						/*							*/
+	char			address[CAPCACHE_ADDRESS_LEN];		/* IP address of the PLC				*/
+	uint16_t		port;					/* Port of the PLC					*/
+	uint8_t			remote_net;				/* Network of the PLC					*/
+	uint8_t			remote_node;				/* Node of the PLC					*/
+	uint8_t			remote_unit;				/* Unit of the PLC					*/
+	bool			verified;				/* Profile checked with the PLC since loading		*/
+	struct fins_capability_tp capability;				/* The capability profile				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_capcache_tp {						/*							*/
+	char			filename[CAPCACHE_PATH_LEN];		/* Name of the cache file				*/
+	bool			dirty;					/* Entries changed since the last save			*/
+	size_t			num_entries;				/* Number of endpoints in the cache			*/
+	size_t			max_entries;				/* Number of entries allocated				*/
+	struct capcache_entry_tp *entry;				/* The endpoints					*/
+};									/*							*/
+									/********************************************************/
+
+static struct capcache_entry_tp *	find_entry( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys );
+static void				load_file( struct fins_capcache_tp *capcache );
+static int				learn( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed );
+
+/*
+ * struct fins_capcache_tp *finslib_capcache_open( const char *filename, int *error_val );
+ *
+ * The function finslib_capcache_open() creates a capability cache and loads
+ * the profiles stored in a cache file. A file which does not exist or which
+ * is invalid results in an empty cache. The profiles are written back to the
+ * same file with finslib_capcache_save(). On error NULL is returned and the
+ * reason is stored in error_val if that is not NULL.
+ */
+
+struct fins_capcache_tp *finslib_capcache_open( const char *filename, int *error_val ) {
+
+	struct fins_capcache_tp *capcache;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( filename == NULL  ||  filename[0] == 0  ||  strlen( filename ) + 4 >= CAPCACHE_PATH_LEN ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_INVALID_FILENAME;
+		return NULL;
+	}
+
+	capcache = calloc( 1, sizeof(struct fins_capcache_tp) );
+
+	if ( capcache == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	snprintf( capcache->filename, CAPCACHE_PATH_LEN, "%s", filename );
+
+	load_file( capcache );
+
+	return capcache;
+
+}  /* finslib_capcache_open */
+
+/*
+ * void finslib_capcache_close( struct fins_capcache_tp *capcache );
+ *
+ * The function finslib_capcache_close() releases the memory associated with a
+ * capability cache. Changes which have not been saved are lost.
+ */
+
+void finslib_capcache_close( struct fins_capcache_tp *capcache ) {
+
+	if ( capcache == NULL ) return;
+
+	free( capcache->entry );
+	free( capcache );
+
+}  /* finslib_capcache_close */
+
+/*
+ * int finslib_capcache_save( struct fins_capcache_tp *capcache );
+ *
+ * The function finslib_capcache_save() writes the profiles in a capability
+ * cache to the cache file if they changed since the file was loaded or last
+ * saved. The file is written under a temporary name first and renamed when
+ * complete.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_capcache_save( struct fins_capcache_tp *capcache ) {
+
+	FILE *fp;
+	size_t a;
+	size_t len;
+	int retval;
+	uint32_t crc;
+	unsigned char *rec;
+	unsigned char *buf;
+	char temp[CAPCACHE_PATH_LEN+4];
+	const struct capcache_entry_tp *entry;
+
+	if ( capcache == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( ! capcache->dirty ) return FINS_RETVAL_SUCCESS;
+
+	len = CAPCACHE_HEADER_LEN + capcache->num_entries * CAPCACHE_RECORD_LEN;
+
+	buf = calloc( 1, len );
+	if ( buf == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	for (a=0; a<capcache->num_entries; a++) {
+
+		entry = & capcache->entry[a];
+		rec   = buf + CAPCACHE_HEADER_LEN + a * CAPCACHE_RECORD_LEN;
+
+		memcpy( rec,     entry->address,            strlen( entry->address )            );
+		memcpy( rec+128, entry->capability.model,   strlen( entry->capability.model )   );
+		memcpy( rec+148, entry->capability.version, strlen( entry->capability.version ) );
+
+		rec[168] = (entry->port >> 8) & 0xff;
+		rec[169] = (entry->port     ) & 0xff;
+		rec[170] = entry->remote_net;
+		rec[171] = entry->remote_node;
+		rec[172] = entry->remote_unit;
+		rec[173] = (unsigned char) entry->capability.plc_mode;
+
+		XX_finslib_put_uint32( rec+176, (uint32_t) entry->capability.program_area_words );
+		XX_finslib_put_uint32( rec+180, (uint32_t) entry->capability.em_banks           );
+		XX_finslib_put_uint64( rec+184, (uint64_t) entry->capability.verified           );
+	}
+
+	crc = finslib_crc32( 0, buf + CAPCACHE_HEADER_LEN, len - CAPCACHE_HEADER_LEN );
+
+	memcpy( buf, "FINSCAP", 7 );
+	buf[7] = CAPCACHE_VERSION;
+	XX_finslib_put_uint32( buf+ 8, (uint32_t) capcache->num_entries );
+	XX_finslib_put_uint32( buf+12, crc                              );
+
+	snprintf( temp, sizeof(temp), "%s.tmp", capcache->filename );
+
+	fp = fopen( temp, "wb" );
+
+	if ( fp == NULL ) {
+
+		free( buf );
+		return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	retval = FINS_RETVAL_SUCCESS;
+
+	if ( fwrite( buf, 1, len, fp ) != len ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fclose( fp ) != 0  &&  retval == FINS_RETVAL_SUCCESS ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	free( buf );
+
+#if defined(_WIN32)
+	if ( retval == FINS_RETVAL_SUCCESS ) remove( capcache->filename );
+#endif  /* defined(_WIN32) */
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  rename( temp, capcache->filename ) != 0 ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		remove( temp );
+		return retval;
+	}
+
+	capcache->dirty = false;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_capcache_save */
+
+/*
+ * int finslib_capcache_apply( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys );
+ *
+ * The function finslib_capcache_apply() prepares a connection with the
+ * capability profile of its PLC. If the cache contains a profile for the
+ * endpoint, the FINS mode, model and version are copied to the connection
+ * without communicating with the PLC. Otherwise the profile is read from the
+ * PLC with a CPU unit data read and added to the cache.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_capcache_apply( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys ) {
+
+	struct capcache_entry_tp *entry;
+
+	if ( capcache == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	entry = find_entry( capcache, sys );
+
+	if ( entry == NULL ) return learn( capcache, sys, NULL );
+
+	sys->plc_mode = entry->capability.plc_mode;
+
+	memcpy( sys->model,   entry->capability.model,   21 );
+	memcpy( sys->version, entry->capability.version, 21 );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_capcache_apply */
+
+/*
+ * int finslib_capcache_verify( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed );
+ *
+ * The function finslib_capcache_verify() checks the cached capability profile
+ * of a PLC against the PLC itself. The check is only done once for every
+ * endpoint after the cache has been loaded, so the function can be called at
+ * any convenient moment without extra cost. If the profile has changed, the
+ * cache and the connection are updated and changed is set to true.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_capcache_verify( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed ) {
+
+	struct capcache_entry_tp *entry;
+
+	if ( changed  != NULL ) *changed = false;
+	if ( capcache == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	entry = find_entry( capcache, sys );
+
+	if ( entry != NULL  &&  entry->verified ) return FINS_RETVAL_SUCCESS;
+
+	return learn( capcache, sys, changed );
+
+}  /* finslib_capcache_verify */
+
+/*
+ * bool finslib_capcache_lookup( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys, struct fins_capability_tp *capability );
+ *
+ * The function finslib_capcache_lookup() returns the cached capability profile
+ * of the PLC connected through sys without communicating with the PLC. The
+ * function returns true if a profile was found and false otherwise.
+ */
+
+bool finslib_capcache_lookup( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys, struct fins_capability_tp *capability ) {
+
+	const struct capcache_entry_tp *entry;
+
+	if ( capcache == NULL  ||  sys == NULL  ||  capability == NULL ) return false;
+
+	entry = find_entry( capcache, sys );
+	if ( entry == NULL ) return false;
+
+	*capability = entry->capability;
+
+	return true;
+
+}  /* finslib_capcache_lookup */
+
+/*
+ * static int learn( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed );
+ *
+ * The function learn() reads the capability profile of a PLC with a CPU unit
+ * data read and stores it in the cache. The sizes which the CPU unit does not
+ * report are taken from the fins_model[] table if the model is known there.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int learn( struct fins_capcache_tp *capcache, struct fins_sys_tp *sys, bool *changed ) {
+
+	int retval;
+	size_t new_max;
+	struct fins_cpudata_tp cpudata;
+	struct fins_capability_tp capability;
+	struct capcache_entry_tp *entry;
+	struct capcache_entry_tp *new_entry;
+	const struct fins_mcap_tp *mcap;
+
+	if ( ( retval = finslib_cpu_unit_data_read( sys, & cpudata ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	memset( & capability, 0, sizeof(capability) );
+
+	memcpy( capability.model,   cpudata.model,   21 );
+	memcpy( capability.version, cpudata.version, 21 );
+
+	mcap = XX_finslib_model_capabilities( cpudata.model );
+
+	capability.plc_mode           = sys->plc_mode;
+	capability.program_area_words = (size_t) cpudata.program_area_size * 1024;
+	capability.em_banks           = (size_t) cpudata.em_non_file_memory_size;
+	capability.verified           = time( NULL );
+
+	if ( capability.program_area_words == 0  &&  mcap != NULL ) capability.program_area_words = mcap->pa_size;
+	if ( capability.em_banks           == 0  &&  mcap != NULL ) capability.em_banks           = mcap->ex_banks;
+
+	entry = find_entry( capcache, sys );
+
+	if ( entry == NULL ) {
+
+		if ( capcache->num_entries >= capcache->max_entries ) {
+
+			new_max   = ( capcache->max_entries == 0 ) ? 16 : 2 * capcache->max_entries;
+			new_entry = realloc( capcache->entry, new_max * sizeof(struct capcache_entry_tp) );
+			if ( new_entry == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+			capcache->entry       = new_entry;
+			capcache->max_entries = new_max;
+		}
+
+		entry = & capcache->entry[ capcache->num_entries++ ];
+
+		memset( entry, 0, sizeof(struct capcache_entry_tp) );
+
+		snprintf( entry->address, CAPCACHE_ADDRESS_LEN, "%s", sys->address );
+
+		entry->port        = sys->port;
+		entry->remote_net  = sys->remote_net;
+		entry->remote_node = sys->remote_node;
+		entry->remote_unit = sys->remote_unit;
+	}
+
+	else if ( changed != NULL ) {
+
+		*changed = ( strcmp( entry->capability.model,   capability.model   ) != 0  ||
+			     strcmp( entry->capability.version, capability.version ) != 0  ||
+			     entry->capability.plc_mode           != capability.plc_mode           ||
+			     entry->capability.program_area_words != capability.program_area_words ||
+			     entry->capability.em_banks           != capability.em_banks              );
+	}
+
+	entry->capability = capability;
+	entry->verified   = true;
+	capcache->dirty   = true;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* learn */
+
+/*
+ * static struct capcache_entry_tp *find_entry( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys );
+ *
+ * The function find_entry() returns the cache entry for the endpoint of a
+ * connection, or NULL if the endpoint is not in the cache.
+ */
+
+static struct capcache_entry_tp *find_entry( struct fins_capcache_tp *capcache, const struct fins_sys_tp *sys ) {
+
+	size_t a;
+	struct capcache_entry_tp *entry;
+
+	for (a=0; a<capcache->num_entries; a++) {
+
+		entry = & capcache->entry[a];
+
+		if ( entry->port        == sys->port         &&
+		     entry->remote_net  == sys->remote_net   &&
+		     entry->remote_node == sys->remote_node  &&
+		     entry->remote_unit == sys->remote_unit  &&
+		     strcmp( entry->address, sys->address ) == 0 ) return entry;
+	}
+
+	return NULL;
+
+}  /* find_entry */
+
+/*
+ * static void load_file( struct fins_capcache_tp *capcache );
+ *
+ * The function load_file() reads the profiles from the cache file. Nothing is
+ * loaded if the file does not exist, has a different version or fails the
+ * CRC check.
+ */
+
+static void load_file( struct fins_capcache_tp *capcache ) {
+
+	FILE *fp;
+	size_t a;
+	size_t num_records;
+	unsigned char header[CAPCACHE_HEADER_LEN];
+	unsigned char *buf;
+	const unsigned char *rec;
+	struct capcache_entry_tp *entry;
+
+	fp = fopen( capcache->filename, "rb" );
+	if ( fp == NULL ) return;
+
+	if ( fread( header, 1, CAPCACHE_HEADER_LEN, fp ) != CAPCACHE_HEADER_LEN  ||  memcmp( header, "FINSCAP", 7 ) != 0  ||  header[7] != CAPCACHE_VERSION ) {
+
+		fclose( fp );
+		return;
+	}
+
+	num_records = XX_finslib_get_uint32( header+8 );
+
+	buf   = malloc( num_records * CAPCACHE_RECORD_LEN + 1 );
+	entry = calloc( num_records + 1, sizeof(struct capcache_entry_tp) );
+
+	if ( buf == NULL  ||  entry == NULL  ||  fread( buf, 1, num_records * CAPCACHE_RECORD_LEN, fp ) != num_records * CAPCACHE_RECORD_LEN  ||  fgetc( fp ) != EOF  ||
+	     finslib_crc32( 0, buf, num_records * CAPCACHE_RECORD_LEN ) != XX_finslib_get_uint32( header+12 ) ) {
+
+		fclose( fp );
+		free( buf   );
+		free( entry );
+		return;
+	}
+
+	fclose( fp );
+
+	for (a=0; a<num_records; a++) {
+
+		rec = buf + a * CAPCACHE_RECORD_LEN;
+
+		memcpy( entry[a].address,            rec,     CAPCACHE_ADDRESS_LEN-1 );
+		memcpy( entry[a].capability.model,   rec+128, 20                     );
+		memcpy( entry[a].capability.version, rec+148, 20                     );
+
+		entry[a].port                          = (uint16_t) ( ( rec[168] << 8 ) | rec[169] );
+		entry[a].remote_net                    = rec[170];
+		entry[a].remote_node                   = rec[171];
+		entry[a].remote_unit                   = rec[172];
+		entry[a].capability.plc_mode           = rec[173];
+		entry[a].capability.program_area_words = XX_finslib_get_uint32( rec+176 );
+		entry[a].capability.em_banks           = XX_finslib_get_uint32( rec+180 );
+		entry[a].capability.verified           = (time_t) XX_finslib_get_uint64( rec+184 );
+	}
+
+	free( buf );
+
+	capcache->entry       = entry;
+	capcache->num_entries = num_records;
+	capcache->max_entries = num_records + 1;
+
+}  /* load_file */
@@ -0,0 +1,272 @@
+/*
+ * Library: libfins
+ * File:    src/fins_capture.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_capture.c contains routines to record all FINS
+ * frames sent and received over a connection in a compact binary capture file
+ * and to read such a file back. Captures of production traffic can be
+ * replayed later to reproduce performance problems offline.
+ *
+ * A capture file starts with a 16 byte header containing the characters
+ * "FINSCAP", a version byte and the wall clock time at which the capture
+ * started as a 64 bit number of seconds. Each frame follows as a 12 byte
+ * record header and the FINS header and body of the frame. The record header
+ * contains the direction, a reserved byte, the length of the frame as a 16 bit
+ * number and the time in nanoseconds since the start of the capture as a 64
+ * bit number. All numbers are stored most significant byte first.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define CAPTURE_VERSION		0x01
+#define CAPTURE_FILE_HEADER	16
+#define CAPTURE_RECORD_HEADER	12
+
+									/********************************************************/
+struct fins_capture_tp {						/*							*/
+	FILE *			fp;					/* The capture file					*/
+	int64_t			start_nsec;				/* Monotonic time at which the capture started		*/
+	time_t			start_time;				/* Wall clock time at which the capture started		*/
+};									/*							*/
+									/********************************************************/
+
+/*
+ * int finslib_capture_start( struct fins_sys_tp *sys, const char *filename );
+ *
+ * The function finslib_capture_start() starts recording all FINS frames sent
+ * and received over a connection in a capture file. An existing file with the
+ * same name is overwritten. A capture which was already running on the
+ * connection is stopped first.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_capture_start( struct fins_sys_tp *sys, const char *filename ) {
+
+	unsigned char buf[CAPTURE_FILE_HEADER];
+	struct fins_capture_tp *capture;
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( filename == NULL ) return FINS_RETVAL_CAPTURE_INVALID;
+
+	capture = calloc( 1, sizeof(struct fins_capture_tp) );
+	if ( capture == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	capture->fp = fopen( filename, "wb" );
+
+	if ( capture->fp == NULL ) {
+
+		free( capture );
+		return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	capture->start_nsec = finslib_monotonic_nsec_timer();
+	capture->start_time = time( NULL );
+
+	memcpy( buf, "FINSCAP", 7 );
+	buf[7] = CAPTURE_VERSION;
+	XX_finslib_put_uint64( buf+8, (uint64_t) capture->start_time );
+
+	if ( fwrite( buf, 1, CAPTURE_FILE_HEADER, capture->fp ) != CAPTURE_FILE_HEADER ) {
+
+		fclose( capture->fp );
+		free( capture );
+		return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	finslib_capture_stop( sys );
+
+	sys->capture = capture;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_capture_start */
+
+/*
+ * void finslib_capture_stop( struct fins_sys_tp *sys );
+ *
+ * The function finslib_capture_stop() stops recording frames on a connection
+ * and closes the capture file.
+ */
+
+void finslib_capture_stop( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->capture == NULL ) return;
+
+	finslib_capture_close( sys->capture );
+	sys->capture = NULL;
+
+}  /* finslib_capture_stop */
+
+/*
+ * struct fins_capture_tp *finslib_capture_open( const char *filename, int *error_val );
+ *
+ * The function finslib_capture_open() opens an existing capture file for
+ * reading. The frames can then be read one by one with the function
+ * finslib_capture_next(). On error NULL is returned and the reason is stored
+ * in the error_val parameter if that is not NULL.
+ */
+
+struct fins_capture_tp *finslib_capture_open( const char *filename, int *error_val ) {
+
+	unsigned char buf[CAPTURE_FILE_HEADER];
+	struct fins_capture_tp *capture;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( filename == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_CAPTURE_INVALID;
+		return NULL;
+	}
+
+	capture = calloc( 1, sizeof(struct fins_capture_tp) );
+
+	if ( capture == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	capture->fp = fopen( filename, "rb" );
+
+	if ( capture->fp == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_ERRNO_BASE + errno;
+		free( capture );
+		return NULL;
+	}
+
+	if ( fread( buf, 1, CAPTURE_FILE_HEADER, capture->fp ) != CAPTURE_FILE_HEADER  ||
+	     memcmp( buf, "FINSCAP", 7 ) != 0                                           ||
+	     buf[7] != CAPTURE_VERSION                                                     ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_CAPTURE_INVALID;
+		finslib_capture_close( capture );
+		return NULL;
+	}
+
+	capture->start_time = (time_t) XX_finslib_get_uint64( buf+8 );
+
+	return capture;
+
+}  /* finslib_capture_open */
+
+/*
+ * int finslib_capture_next( struct fins_capture_tp *capture, struct fins_capframe_tp *capframe );
+ *
+ * The function finslib_capture_next() reads the next frame from a capture file
+ * opened with finslib_capture_open(). When all frames have been read the value
+ * FINS_RETVAL_CAPTURE_END is returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_capture_next( struct fins_capture_tp *capture, struct fins_capframe_tp *capframe ) {
+
+	size_t len;
+	size_t num;
+	unsigned char buf[CAPTURE_RECORD_HEADER];
+
+	if ( capture     == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( capture->fp == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( capframe    == NULL ) return FINS_RETVAL_NO_COMMAND;
+
+	num = fread( buf, 1, CAPTURE_RECORD_HEADER, capture->fp );
+
+	if ( num == 0                     ) return FINS_RETVAL_CAPTURE_END;
+	if ( num != CAPTURE_RECORD_HEADER ) return FINS_RETVAL_CAPTURE_INVALID;
+
+	len   = buf[2];
+	len <<= 8;
+	len  += buf[3];
+
+	if ( len < FINS_HEADER_LEN  ||  len > FINS_HEADER_LEN + FINS_BODY_LEN ) return FINS_RETVAL_CAPTURE_INVALID;
+
+	if ( fread( capframe->frame.header, 1, FINS_HEADER_LEN,       capture->fp ) != FINS_HEADER_LEN       ) return FINS_RETVAL_CAPTURE_INVALID;
+	if ( fread( capframe->frame.body,   1, len - FINS_HEADER_LEN, capture->fp ) != len - FINS_HEADER_LEN ) return FINS_RETVAL_CAPTURE_INVALID;
+
+	capframe->direction = buf[0];
+	capframe->nsec      = (int64_t) XX_finslib_get_uint64( buf+4 );
+	capframe->bodylen   = len - FINS_HEADER_LEN;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_capture_next */
+
+/*
+ * void finslib_capture_close( struct fins_capture_tp *capture );
+ *
+ * The function finslib_capture_close() closes a capture file and releases the
+ * associated memory.
+ */
+
+void finslib_capture_close( struct fins_capture_tp *capture ) {
+
+	if ( capture == NULL ) return;
+
+	if ( capture->fp != NULL ) fclose( capture->fp );
+
+	free( capture );
+
+}  /* finslib_capture_close */
+
+/*
+ * void XX_finslib_capture( struct fins_sys_tp *sys, uint8_t direction, const struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function XX_finslib_capture() appends one frame to the capture file of
+ * a connection. If the frame cannot be written the capture is stopped to
+ * prevent a partial record from corrupting the rest of the file.
+ */
+
+void XX_finslib_capture( struct fins_sys_tp *sys, uint8_t direction, const struct fins_command_tp *frame, size_t bodylen ) {
+
+	size_t len;
+	unsigned char buf[CAPTURE_RECORD_HEADER];
+
+	if ( sys == NULL  ||  sys->capture == NULL  ||  frame == NULL ) return;
+	if ( bodylen > FINS_BODY_LEN                                  ) return;
+
+	len = FINS_HEADER_LEN + bodylen;
+
+	buf[0] = direction;
+	buf[1] = 0x00;
+	buf[2] = (len >> 8) & 0xff;
+	buf[3] = (len     ) & 0xff;
+	XX_finslib_put_uint64( buf+4, (uint64_t) ( finslib_monotonic_nsec_timer() - sys->capture->start_nsec ) );
+
+	if ( fwrite( buf,           1, CAPTURE_RECORD_HEADER, sys->capture->fp ) != CAPTURE_RECORD_HEADER  ||
+	     fwrite( frame->header, 1, FINS_HEADER_LEN,       sys->capture->fp ) != FINS_HEADER_LEN        ||
+	     fwrite( frame->body,   1, bodylen,               sys->capture->fp ) != bodylen                   ) finslib_capture_stop( sys );
+
+}  /* XX_finslib_capture */
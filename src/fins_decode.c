@@ -47,6 +47,9 @@
  * Bit references must use the DOT notation, for example H82.1 to generate
  * the proper address. Some applications use a notation without a dot like
  * H8201, but this is not supported by this function.
+ *
+ * Extended memory banks are addressed with the bank number and an underscore
+ * in front of the address, for example E3_100 for word 100 in bank 3.
  */
 
 bool XX_finslib_decode_address( const char *str, struct fins_address_tp *address ) {
@@ -73,7 +76,21 @@ bool XX_finslib_decode_address( const char *str, struct fins_address_tp *address
 		ptr++;
 	}
 	if ( isalpha( *ptr ) ) return true;
-	
+
+	if ( num_char == 1  &&  name[0] == 'E'  &&  isdigit( ptr[0] )  &&  ptr[1] == '_' ) {
+
+		name[num_char] = *ptr;
+		num_char++;
+		ptr++;
+	}
+
+	if ( num_char == 2  &&  name[0] == 'E'  &&  *ptr == '_' ) {
+
+		name[num_char] = *ptr;
+		num_char++;
+		ptr++;
+	}
+
 	while ( num_char < 4 ) name[num_char++] = 0;
 
 	while ( isspace( *ptr ) ) ptr++;
@@ -0,0 +1,386 @@
+/*
+ * Library: libfins
+ * File:    src/fins_dircache.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_dircache.c contains an optional cache for complete
+ * directory listings of the file memory of a PLC. Listings are stored by the
+ * directory walker and used by finslib_file_name_read() and the walker itself
+ * until they expire, so that repeated listings of the same directories do not
+ * cause any traffic. Commands which change the file memory invalidate the
+ * affected directories, or the whole cache if the affected directories cannot
+ * be determined from the command.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+									/********************************************************/
+struct dircache_entry_tp {						/*							*/
+	uint16_t		disk;					/* Disk on which the directory resides			*/
+	char			path[FINS_MAX_PATH_LEN+1];		/* Path of the directory				*/
+	int64_t			stamp;					/* Time in milliseconds the listing was read		*/
+	struct fins_diskinfo_tp	diskinfo;				/* Volume information returned with the listing		*/
+	size_t			num_files;				/* Number of entries in the directory			*/
+	struct fins_fileinfo_tp *fileinfo;				/* The entries in the directory				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_dircache_tp {						/*							*/
+	int			ttl_msec;				/* Milliseconds a listing remains valid			*/
+	size_t			num_entries;				/* Number of directories in the cache			*/
+	size_t			max_entries;				/* Number of directories allocated			*/
+	struct dircache_entry_tp *entry;				/* The cached directories				*/
+};									/*							*/
+									/********************************************************/
+
+static struct dircache_entry_tp *	find_entry( struct fins_dircache_tp *dircache, uint16_t disk, const char *path );
+static void				invalidate_path( struct fins_dircache_tp *dircache, uint16_t disk, const unsigned char *path, size_t dirlen );
+static void				remove_entry( struct fins_dircache_tp *dircache, size_t index );
+static bool				same_path( const char *path1, const unsigned char *path2, size_t len2 );
+
+/*
+ * int finslib_dircache_enable( struct fins_sys_tp *sys, int ttl_msec );
+ *
+ * The function finslib_dircache_enable() attaches a directory listing cache
+ * to a connection. Listings are kept for ttl_msec milliseconds. Calling the
+ * function on a connection which already has a listing cache replaces that
+ * cache. A ttl_msec of zero or less is rejected and leaves an existing cache
+ * in place.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_dircache_enable( struct fins_sys_tp *sys, int ttl_msec ) {
+
+	struct fins_dircache_tp *dircache;
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( ttl_msec <= 0    ) return FINS_RETVAL_INVALID_PERIOD;
+
+	dircache = calloc( 1, sizeof(struct fins_dircache_tp) );
+	if ( dircache == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	dircache->ttl_msec = ttl_msec;
+
+	finslib_dircache_disable( sys );
+
+	sys->dircache = dircache;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_dircache_enable */
+
+/*
+ * void finslib_dircache_disable( struct fins_sys_tp *sys );
+ *
+ * The function finslib_dircache_disable() removes the directory listing cache
+ * from a connection and releases the memory associated with it.
+ */
+
+void finslib_dircache_disable( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->dircache == NULL ) return;
+
+	finslib_dircache_flush( sys );
+
+	free( sys->dircache->entry );
+	free( sys->dircache );
+
+	sys->dircache = NULL;
+
+}  /* finslib_dircache_disable */
+
+/*
+ * void finslib_dircache_flush( struct fins_sys_tp *sys );
+ *
+ * The function finslib_dircache_flush() removes all listings from the
+ * directory listing cache of a connection. Applications should call this
+ * function when the file memory of the PLC may have been changed by another
+ * FINS client.
+ */
+
+void finslib_dircache_flush( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->dircache == NULL ) return;
+
+	while ( sys->dircache->num_entries > 0 ) remove_entry( sys->dircache, sys->dircache->num_entries-1 );
+
+}  /* finslib_dircache_flush */
+
+/*
+ * bool XX_finslib_dircache_lookup( struct fins_sys_tp *sys, uint16_t disk, const char *path, struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp **fileinfo, size_t *num_files );
+ *
+ * The function XX_finslib_dircache_lookup() checks if a valid listing of a
+ * directory is present in the cache. On a hit the volume information is
+ * copied to the caller, a pointer to the cached entries and their number are
+ * returned and the function returns true. The pointer remains valid until the
+ * next change of the cache.
+ */
+
+bool XX_finslib_dircache_lookup( struct fins_sys_tp *sys, uint16_t disk, const char *path, struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp **fileinfo, size_t *num_files ) {
+
+	struct dircache_entry_tp *entry;
+
+	if ( sys == NULL  ||  sys->dircache == NULL ) return false;
+
+	entry = find_entry( sys->dircache, disk, path );
+
+	if ( entry == NULL ) return false;
+
+	if ( finslib_monotonic_msec_timer() - entry->stamp > sys->dircache->ttl_msec ) {
+
+		remove_entry( sys->dircache, (size_t) ( entry - sys->dircache->entry ) );
+		return false;
+	}
+
+	if ( diskinfo != NULL ) *diskinfo = entry->diskinfo;
+
+	*fileinfo  = entry->fileinfo;
+	*num_files = entry->num_files;
+
+	return true;
+
+}  /* XX_finslib_dircache_lookup */
+
+/*
+ * int XX_finslib_dircache_store( struct fins_sys_tp *sys, uint16_t disk, const char *path, const struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp *fileinfo, size_t num_files );
+ *
+ * The function XX_finslib_dircache_store() stores the complete listing of a
+ * directory in the cache. An older listing of the same directory is replaced.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_dircache_store( struct fins_sys_tp *sys, uint16_t disk, const char *path, const struct fins_diskinfo_tp *diskinfo, const struct fins_fileinfo_tp *fileinfo, size_t num_files ) {
+
+	size_t max_entries;
+	struct fins_fileinfo_tp *copy;
+	struct dircache_entry_tp *entry;
+	struct dircache_entry_tp *list;
+
+	if ( sys  == NULL  ||  sys->dircache == NULL              ) return FINS_RETVAL_SUCCESS;
+	if ( path != NULL  &&  strlen( path ) > FINS_MAX_PATH_LEN ) return FINS_RETVAL_INVALID_PATH;
+
+	copy = NULL;
+
+	if ( num_files > 0 ) {
+
+		copy = malloc( num_files * sizeof(struct fins_fileinfo_tp) );
+		if ( copy == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		memcpy( copy, fileinfo, num_files * sizeof(struct fins_fileinfo_tp) );
+	}
+
+	entry = find_entry( sys->dircache, disk, path );
+
+	if ( entry == NULL ) {
+
+		if ( sys->dircache->num_entries >= sys->dircache->max_entries ) {
+
+			max_entries = ( sys->dircache->max_entries == 0 ) ? 16 : 2 * sys->dircache->max_entries;
+			list        = realloc( sys->dircache->entry, max_entries * sizeof(struct dircache_entry_tp) );
+
+			if ( list == NULL ) {
+
+				free( copy );
+				return FINS_RETVAL_OUT_OF_MEMORY;
+			}
+
+			sys->dircache->entry       = list;
+			sys->dircache->max_entries = max_entries;
+		}
+
+		entry = & sys->dircache->entry[ sys->dircache->num_entries++ ];
+
+		entry->disk     = disk;
+		entry->fileinfo = NULL;
+
+		if ( path == NULL ) entry->path[0] = 0;
+		else                strcpy( entry->path, path );
+	}
+
+	free( entry->fileinfo );
+
+	entry->stamp     = finslib_monotonic_msec_timer();
+	entry->num_files = num_files;
+	entry->fileinfo  = copy;
+
+	if ( diskinfo != NULL ) entry->diskinfo = *diskinfo;
+	else                    memset( & entry->diskinfo, 0, sizeof(struct fins_diskinfo_tp) );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_dircache_store */
+
+/*
+ * void XX_finslib_dircache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen );
+ *
+ * The function XX_finslib_dircache_invalidate() removes the listings which
+ * may be affected by a command before it is sent to the PLC. Writing,
+ * deleting and renaming files and creating directories invalidate the
+ * directory in the command and all directories below it. Other commands which
+ * change the file memory flush the whole cache.
+ */
+
+void XX_finslib_dircache_invalidate( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen ) {
+
+	uint16_t disk;
+	size_t pos;
+	size_t dirlen;
+	uint8_t mrc;
+	uint8_t src;
+
+	if ( sys == NULL  ||  sys->dircache == NULL ) return;
+
+	mrc = command->header[FINS_MRC];
+	src = command->header[FINS_SRC];
+
+	if ( mrc != 0x22                  ) return;
+	if ( src == 0x01  ||  src == 0x02 ) return;
+
+	pos = 0;
+
+	if      ( src == 0x03  &&  bodylen >= 22 ) pos = 22 + ( ( command->body[20] << 8 ) | command->body[21] );
+	else if ( src == 0x05  &&  bodylen >=  4 ) pos =  4 + 12 * ( ( command->body[2] << 8 ) | command->body[3] );
+	else if ( src == 0x08                    ) pos = 26;
+	else if ( src == 0x15                    ) pos = 16;
+
+	if ( pos == 0  ||  pos + 2 > bodylen ) {
+
+		finslib_dircache_flush( sys );
+		return;
+	}
+
+	disk   = (uint16_t) ( ( command->body[0] << 8 ) | command->body[1] );
+	dirlen = ( command->body[pos] << 8 ) | command->body[pos+1];
+
+	if ( pos + 2 + dirlen > bodylen ) {
+
+		finslib_dircache_flush( sys );
+		return;
+	}
+
+	invalidate_path( sys->dircache, disk, & command->body[pos+2], dirlen );
+
+}  /* XX_finslib_dircache_invalidate */
+
+/*
+ * static void invalidate_path( struct fins_dircache_tp *dircache, uint16_t disk, const unsigned char *path, size_t dirlen );
+ *
+ * The function invalidate_path() removes the listing of a directory and of
+ * all directories below it from the cache.
+ */
+
+static void invalidate_path( struct fins_dircache_tp *dircache, uint16_t disk, const unsigned char *path, size_t dirlen ) {
+
+	size_t a;
+	struct dircache_entry_tp *entry;
+
+	a = dircache->num_entries;
+
+	while ( a > 0 ) {
+
+		a--;
+		entry = & dircache->entry[a];
+
+		if ( entry->disk != disk                                              ) continue;
+		if ( strlen( entry->path ) < dirlen                                   ) continue;
+		if ( entry->path[dirlen] != 0  &&  entry->path[dirlen] != '\\'        ) continue;
+		if ( ! same_path( entry->path, path, dirlen )                         ) continue;
+
+		remove_entry( dircache, a );
+	}
+
+}  /* invalidate_path */
+
+/*
+ * static struct dircache_entry_tp *find_entry( struct fins_dircache_tp *dircache, uint16_t disk, const char *path );
+ *
+ * The function find_entry() returns the cache entry of a directory or NULL if
+ * the directory is not in the cache.
+ */
+
+static struct dircache_entry_tp *find_entry( struct fins_dircache_tp *dircache, uint16_t disk, const char *path ) {
+
+	size_t a;
+	size_t len;
+
+	if ( path == NULL ) path = "";
+
+	len = strlen( path );
+
+	for (a=0; a<dircache->num_entries; a++) {
+
+		if ( dircache->entry[a].disk != disk                                         ) continue;
+		if ( strlen( dircache->entry[a].path ) != len                                ) continue;
+		if ( ! same_path( dircache->entry[a].path, (const unsigned char *) path, len ) ) continue;
+
+		return & dircache->entry[a];
+	}
+
+	return NULL;
+
+}  /* find_entry */
+
+/*
+ * static void remove_entry( struct fins_dircache_tp *dircache, size_t index );
+ *
+ * The function remove_entry() removes an entry from the cache by moving the
+ * last entry in its place.
+ */
+
+static void remove_entry( struct fins_dircache_tp *dircache, size_t index ) {
+
+	free( dircache->entry[index].fileinfo );
+
+	dircache->num_entries--;
+
+	if ( index != dircache->num_entries ) dircache->entry[index] = dircache->entry[ dircache->num_entries ];
+
+}  /* remove_entry */
+
+/*
+ * static bool same_path( const char *path1, const unsigned char *path2, size_t len2 );
+ *
+ * The function same_path() compares the first len2 characters of two paths
+ * without regard to case, as DOS paths are case insensitive.
+ */
+
+static bool same_path( const char *path1, const unsigned char *path2, size_t len2 ) {
+
+	size_t a;
+
+	for (a=0; a<len2; a++) if ( toupper( (unsigned char) path1[a] ) != toupper( path2[a] ) ) return false;
+
+	return true;
+
+}  /* same_path */
@@ -0,0 +1,381 @@
+/*
+ * Library: libfins
+ * File:    src/fins_discover.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_discover.c contains a routine to find the FINS
+ * nodes which are present in a range of node numbers, optionally on more than
+ * one FINS network. A CPU unit data read command is sent to every candidate
+ * node from one UDP socket. A limited number of requests is in flight at the
+ * same time and every request has its own short deadline, so that nodes which
+ * do not exist only cost a fraction of a second while the scan of the other
+ * nodes continues.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+									/********************************************************/
+struct discover_slot_tp {						/*							*/
+	bool			used;					/* A request for a target is in flight			*/
+	size_t			target;					/* Index of the target in the scan			*/
+	uint8_t			net;					/* FINS network of the target				*/
+	uint8_t			node;					/* FINS node of the target				*/
+	uint8_t			sid;					/* Service ID of the request in flight			*/
+	int			tries;					/* Number of times the request has been sent		*/
+	int64_t			sent_time;				/* Time in msec at which the request was sent		*/
+	int64_t			deadline;				/* Time in msec at which the request times out		*/
+	struct sockaddr_in	addr;					/* IP address and port the request is sent to		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct discover_tp {							/*							*/
+	const struct fins_discover_tp *spec;				/* Parameters of the scan				*/
+	SOCKET			sockfd;					/* Socket used to send and receive			*/
+	uint32_t		base_ip;				/* IP address in host byte order			*/
+	size_t			nodes_per_net;				/* Number of nodes scanned on every network		*/
+	size_t			num_targets;				/* Total number of nodes to scan			*/
+	size_t			next_target;				/* Next node to send a request to			*/
+	size_t			parallel;				/* Maximum number of requests in flight			*/
+	int			timeout_msec;				/* Time to wait for each response			*/
+	uint8_t			next_sid;				/* Service ID for the next request			*/
+	struct discover_slot_tp	*slot;					/* Requests in flight					*/
+	struct fins_nodeinfo_tp	*nodes;					/* Table with the nodes found				*/
+	size_t			max_nodes;				/* Number of entries in the table			*/
+	size_t			num_nodes;				/* Number of nodes found so far				*/
+};									/*							*/
+									/********************************************************/
+
+static int	compare_nodes( const void *p1, const void *p2 );
+static void	copy_text( char *dst, const unsigned char *src, size_t len );
+static void	receive_response( struct discover_tp *disc );
+static int	send_request( struct discover_tp *disc, struct discover_slot_tp *slot );
+static bool	sid_in_use( const struct discover_tp *disc, uint8_t sid );
+
+/*
+ * int finslib_discover( const struct fins_discover_tp *spec, struct fins_nodeinfo_tp *nodes, size_t max_nodes, size_t *num_nodes );
+ *
+ * The function finslib_discover() scans the nodes described in spec and
+ * stores the nodes which respond in the nodes table. At most max_nodes nodes
+ * are stored. The table is sorted on network and node number. The number of
+ * nodes stored is returned in num_nodes.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_discover( const struct fins_discover_tp *spec, struct fins_nodeinfo_tp *nodes, size_t max_nodes, size_t *num_nodes ) {
+
+	size_t a;
+	int retval;
+	int error_val;
+	int64_t now;
+	int64_t wait;
+	struct in_addr ip;
+	struct discover_tp disc;
+	struct timeval tv;
+	fd_set readfds;
+
+	if ( num_nodes     != NULL                             ) *num_nodes = 0;
+	if ( spec          == NULL                             ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( nodes         == NULL  ||  num_nodes == NULL      ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( spec->address == NULL  ||  spec->address[0] == 0  ) return FINS_RETVAL_NO_READ_ADDRESS;
+
+	if ( spec->first_net > spec->last_net  ||  spec->first_node > spec->last_node ) return FINS_RETVAL_SUCCESS;
+
+	if ( finslib_inet_pton( AF_INET, spec->address, & ip ) != 1 ) return FINS_RETVAL_INVALID_IP_ADDRESS;
+
+	memset( & disc, 0, sizeof(disc) );
+
+	disc.spec          = spec;
+	disc.base_ip       = ntohl( ip.s_addr );
+	disc.nodes_per_net = (size_t) ( spec->last_node - spec->first_node ) + 1;
+	disc.num_targets   = (size_t) ( spec->last_net  - spec->first_net  ) + 1;
+	disc.num_targets  *= disc.nodes_per_net;
+	disc.parallel      = ( spec->parallel     == 0 ) ? FINS_DISCOVER_DEFAULT_PARALLEL : spec->parallel;
+	disc.timeout_msec  = ( spec->timeout_msec <= 0 ) ? FINS_DISCOVER_DEFAULT_TIMEOUT  : spec->timeout_msec;
+	disc.nodes         = nodes;
+	disc.max_nodes     = max_nodes;
+
+	if ( disc.parallel > FINS_DISCOVER_MAX_PARALLEL ) disc.parallel = FINS_DISCOVER_MAX_PARALLEL;
+	if ( disc.parallel > disc.num_targets           ) disc.parallel = disc.num_targets;
+
+	disc.slot = calloc( disc.parallel, sizeof(struct discover_slot_tp) );
+	if ( disc.slot == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	disc.sockfd = XX_finslib_server_socket( FINS_COMM_TYPE_UDP, 0, & error_val );
+
+	if ( disc.sockfd == INVALID_SOCKET ) {
+
+		free( disc.slot );
+		return error_val;
+	}
+
+	retval = FINS_RETVAL_SUCCESS;
+
+	while ( retval == FINS_RETVAL_SUCCESS ) {
+
+		now  = finslib_monotonic_msec_timer();
+		wait = -1;
+
+		for (a=0; a<disc.parallel; a++) {
+
+			if ( disc.slot[a].used  &&  now >= disc.slot[a].deadline ) {
+
+				if ( disc.slot[a].tries > spec->retries ) disc.slot[a].used = false;
+				else                                      send_request( & disc, & disc.slot[a] );
+			}
+
+			if ( ! disc.slot[a].used  &&  disc.next_target < disc.num_targets ) {
+
+				disc.slot[a].used   = true;
+				disc.slot[a].target = disc.next_target++;
+				disc.slot[a].tries  = 0;
+
+				send_request( & disc, & disc.slot[a] );
+			}
+
+			if ( disc.slot[a].used  &&  ( wait < 0  ||  disc.slot[a].deadline - now < wait ) ) wait = disc.slot[a].deadline - now;
+		}
+
+		if ( wait < 0 ) break;
+
+		FD_ZERO( & readfds );
+		FD_SET( disc.sockfd, & readfds );
+
+		tv.tv_sec  = (long) ( wait / 1000 );
+		tv.tv_usec = (long) ( wait % 1000 ) * 1000;
+
+		switch( select( (int) disc.sockfd + 1, & readfds, NULL, NULL, & tv ) ) {
+
+			case -1 :
+				retval = XX_finslib_socket_error();
+				break;
+
+			case 0 :
+				break;
+
+			default :
+				receive_response( & disc );
+				break;
+		}
+	}
+
+	closesocket( disc.sockfd );
+	free( disc.slot );
+
+	qsort( nodes, disc.num_nodes, sizeof(struct fins_nodeinfo_tp), compare_nodes );
+
+	*num_nodes = disc.num_nodes;
+
+	return retval;
+
+}  /* finslib_discover */
+
+/*
+ * static int send_request( struct discover_tp *disc, struct discover_slot_tp *slot );
+ *
+ * The function send_request() sends a CPU unit data read command to the target
+ * of a slot. Every attempt gets a Service ID which is not used by any other
+ * request in flight, so that each response can be matched with its request.
+ * A request which cannot be sent, for example because the host is
+ * unreachable, is treated as a request without a response.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int send_request( struct discover_tp *disc, struct discover_slot_tp *slot ) {
+
+	const struct fins_discover_tp *spec;
+	unsigned char header[FINS_HEADER_LEN];
+
+	spec = disc->spec;
+
+	slot->net  = (uint8_t) ( spec->first_net  + slot->target / disc->nodes_per_net );
+	slot->node = (uint8_t) ( spec->first_node + slot->target % disc->nodes_per_net );
+
+	while ( sid_in_use( disc, disc->next_sid ) ) disc->next_sid++;
+
+	slot->sid = disc->next_sid++;
+	slot->tries++;
+	slot->sent_time = finslib_monotonic_msec_timer();
+	slot->deadline  = slot->sent_time + disc->timeout_msec;
+
+	memset( & slot->addr, 0, sizeof(slot->addr) );
+
+	slot->addr.sin_family      = AF_INET;
+	slot->addr.sin_port        = htons( ( spec->port == 0 ) ? FINS_DEFAULT_PORT : spec->port );
+	slot->addr.sin_addr.s_addr = htonl( ( spec->node_in_address ) ? ( ( disc->base_ip & 0xffffff00 ) | slot->node ) : disc->base_ip );
+
+	header[FINS_ICF] = 0x80;
+	header[FINS_RSV] = 0x00;
+	header[FINS_GCT] = 0x02;
+	header[FINS_DNA] = slot->net;
+	header[FINS_DA1] = slot->node;
+	header[FINS_DA2] = 0x00;
+	header[FINS_SNA] = spec->local_net;
+	header[FINS_SA1] = spec->local_node;
+	header[FINS_SA2] = 0x00;
+	header[FINS_SID] = slot->sid;
+	header[FINS_MRC] = 0x05;
+	header[FINS_SRC] = 0x01;
+
+	if ( sendto( disc->sockfd, (const char *) header, FINS_HEADER_LEN, 0, (const struct sockaddr *) & slot->addr, sizeof(slot->addr) ) != FINS_HEADER_LEN ) {
+
+		slot->tries    = spec->retries + 1;
+		slot->deadline = slot->sent_time;
+
+		return XX_finslib_socket_error();
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* send_request */
+
+/*
+ * static bool sid_in_use( const struct discover_tp *disc, uint8_t sid );
+ *
+ * The function sid_in_use() returns true if a request with the Service ID sid
+ * is still waiting for a response.
+ */
+
+static bool sid_in_use( const struct discover_tp *disc, uint8_t sid ) {
+
+	size_t a;
+
+	for (a=0; a<disc->parallel; a++) {
+
+		if ( disc->slot[a].used  &&  disc->slot[a].tries > 0  &&  disc->slot[a].sid == sid ) return true;
+	}
+
+	return false;
+
+}  /* sid_in_use */
+
+/*
+ * static void receive_response( struct discover_tp *disc );
+ *
+ * The function receive_response() receives one datagram and, if it is a valid
+ * response to one of the requests in flight, adds the responding node to the
+ * table. Datagrams which cannot be matched are ignored.
+ */
+
+static void receive_response( struct discover_tp *disc ) {
+
+	size_t a;
+	int recvlen;
+	socklen_t addrlen;
+	struct sockaddr_in from;
+	struct discover_slot_tp *slot;
+	struct fins_nodeinfo_tp *node;
+	unsigned char buf[FINS_HEADER_LEN+FINS_BODY_LEN];
+
+	addrlen = sizeof(from);
+	recvlen = recvfrom( disc->sockfd, (char *) buf, (int) sizeof(buf), 0, (struct sockaddr *) & from, & addrlen );
+
+	if ( recvlen < FINS_HEADER_LEN + 42      ) return;
+	if ( ( buf[FINS_ICF] & 0x40 ) == 0x00    ) return;
+	if ( buf[FINS_MRC] != 0x05  ||  buf[FINS_SRC] != 0x01 ) return;
+
+	for (a=0; a<disc->parallel; a++) {
+
+		slot = & disc->slot[a];
+
+		if ( slot->used  &&  slot->sid == buf[FINS_SID]  &&  slot->node == buf[FINS_SA1]  &&  slot->addr.sin_addr.s_addr == from.sin_addr.s_addr ) break;
+	}
+
+	if ( a >= disc->parallel ) return;
+
+	slot->used = false;
+
+	if ( ( buf[FINS_HEADER_LEN] & 0x7f ) != 0x00  ||  ( buf[FINS_HEADER_LEN+1] & 0x3f ) != 0x00 ) return;
+	if ( disc->num_nodes >= disc->max_nodes ) return;
+
+	node = & disc->nodes[ disc->num_nodes++ ];
+
+	memset( node, 0, sizeof(struct fins_nodeinfo_tp) );
+
+	finslib_inet_ntop( AF_INET, & from.sin_addr, node->address, sizeof(node->address) );
+
+	node->net      = slot->net;
+	node->node     = slot->node;
+	node->unit     = buf[FINS_SA2];
+	node->rtt_msec = (int) ( finslib_monotonic_msec_timer() - slot->sent_time );
+
+	copy_text( node->model,   & buf[FINS_HEADER_LEN+2],  20 );
+	copy_text( node->version, & buf[FINS_HEADER_LEN+22], 20 );
+
+	node->plc_mode = XX_finslib_model_to_plc_mode( node->model );
+
+}  /* receive_response */
+
+/*
+ * static void copy_text( char *dst, const unsigned char *src, size_t len );
+ *
+ * The function copy_text() copies a space padded text field from a response
+ * to a nul terminated string without the trailing spaces.
+ */
+
+static void copy_text( char *dst, const unsigned char *src, size_t len ) {
+
+	memcpy( dst, src, len );
+	dst[len] = 0;
+
+	while ( len > 0  &&  ( dst[len-1] == 0  ||  isspace( (unsigned char) dst[len-1] ) ) ) dst[--len] = 0;
+
+}  /* copy_text */
+
+/*
+ * static int compare_nodes( const void *p1, const void *p2 );
+ *
+ * The function compare_nodes() is used to sort the table of nodes found on
+ * network and node number.
+ */
+
+static int compare_nodes( const void *p1, const void *p2 ) {
+
+	const struct fins_nodeinfo_tp *n1;
+	const struct fins_nodeinfo_tp *n2;
+
+	n1 = p1;
+	n2 = p2;
+
+	if ( n1->net  != n2->net  ) return ( n1->net  < n2->net  ) ? -1 : 1;
+	if ( n1->node != n2->node ) return ( n1->node < n2->node ) ? -1 : 1;
+
+	return 0;
+
+}  /* compare_nodes */
@@ -0,0 +1,265 @@
+/*
+ * Library: libfins
+ * File:    src/fins_download.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_download.c contains routines to download complete
+ * files from the memory card or EM file memory of a remote PLC. The file is
+ * read with a number of 22 02 file read commands in flight at the same time
+ * and passed in order to a callback function or written to a file descriptor.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else  /* defined(_WIN32) */
+#include <unistd.h>
+#endif  /* defined(_WIN32) */
+
+#include "fins.h"
+
+									/********************************************************/
+struct download_tp {							/*							*/
+	uint16_t		disk;					/* Disk on which the file is located			*/
+	const char *		path;					/* Directory in which the file is located		*/
+	const char *		filename;				/* Name of the file					*/
+	size_t			file_position;				/* Position where the download starts			*/
+	size_t			file_size;				/* Size of the file in the directory entry		*/
+	size_t			num_bytes;				/* Number of bytes passed to the sink			*/
+	fins_sink_callback_tp	sink;					/* Function which receives the data			*/
+	void *			context;				/* Parameter passed to the sink function		*/
+};									/*							*/
+									/********************************************************/
+
+static int	build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static size_t	block_size( const struct download_tp *download, size_t index );
+static int	fd_sink( const unsigned char *data, size_t num_bytes, void *context );
+static int	handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+
+/*
+ * int finslib_file_download( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, fins_sink_callback_tp sink, void *context, size_t depth, size_t *num_bytes );
+ *
+ * The function finslib_file_download() reads a file from a disk of a remote
+ * PLC starting at file_position until the end of the file and passes the data
+ * in order to the sink function. At most depth read commands are in flight at
+ * the same time. The size of the file is taken from its directory entry and
+ * every block received is verified against it.
+ *
+ * The number of bytes passed to the sink is stored in num_bytes if that
+ * parameter is not NULL, also when an error occurs. An interrupted download
+ * can therefore be resumed by calling the function again with file_position
+ * increased by that number.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_download( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, fins_sink_callback_tp sink, void *context, size_t depth, size_t *num_bytes ) {
+
+	size_t num_command;
+	int retval;
+	struct download_tp download;
+	struct fins_fileinfo_tp fileinfo;
+
+	if ( num_bytes != NULL ) *num_bytes = 0;
+
+	if ( sys  == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( sink == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	if ( ( retval = finslib_file_info( sys, disk, path, filename, & fileinfo ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( file_position > fileinfo.size ) return FINS_RETVAL_FILE_SIZE_MISMATCH;
+
+	download.disk          = disk;
+	download.path          = path;
+	download.filename      = filename;
+	download.file_position = file_position;
+	download.file_size     = fileinfo.size;
+	download.num_bytes     = 0;
+	download.sink          = sink;
+	download.context       = context;
+
+	num_command = ( download.file_size - file_position + FINS_MAX_FILE_READ_BYTES - 1 ) / FINS_MAX_FILE_READ_BYTES;
+
+	retval = XX_finslib_pipeline( sys, num_command, depth, build_read, handle_read, & download );
+
+	if ( num_bytes != NULL ) *num_bytes = download.num_bytes;
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  file_position + download.num_bytes != download.file_size ) return FINS_RETVAL_FILE_SIZE_MISMATCH;
+
+	return retval;
+
+}  /* finslib_file_download */
+
+/*
+ * int finslib_file_download_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, int fd, size_t depth, size_t *num_bytes );
+ *
+ * The function finslib_file_download_fd() downloads a file from a disk of a
+ * remote PLC like finslib_file_download() and writes the data to an open file
+ * descriptor.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_download_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, size_t file_position, int fd, size_t depth, size_t *num_bytes ) {
+
+	if ( fd < 0 ) {
+
+		if ( num_bytes != NULL ) *num_bytes = 0;
+		return FINS_RETVAL_NO_DATA_BLOCK;
+	}
+
+	return finslib_file_download( sys, disk, path, filename, file_position, fd_sink, & fd, depth, num_bytes );
+
+}  /* finslib_file_download_fd */
+
+/*
+ * static size_t block_size( const struct download_tp *download, size_t index );
+ *
+ * The function block_size() returns the number of bytes requested by one of
+ * the read commands of a download. Only the last block can be shorter than
+ * the maximum.
+ */
+
+static size_t block_size( const struct download_tp *download, size_t index ) {
+
+	size_t position;
+
+	position = download->file_position + index * FINS_MAX_FILE_READ_BYTES;
+
+	if ( download->file_size - position < FINS_MAX_FILE_READ_BYTES ) return download->file_size - position;
+
+	return FINS_MAX_FILE_READ_BYTES;
+
+}  /* block_size */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the file read command for one block of a
+ * download.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	struct download_tp *download;
+
+	download = context;
+
+	return XX_finslib_file_read_command( sys, command, bodylen, download->disk, download->path, download->filename,
+					download->file_position + index * FINS_MAX_FILE_READ_BYTES, block_size( download, index ) );
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() checks the response to a file read command
+ * against the expected position and size and passes the data to the sink.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	uint32_t file_size;
+	uint32_t position;
+	size_t length;
+	int retval;
+	struct download_tp *download;
+
+	(void) sys;
+
+	download = context;
+
+	if ( bodylen < 12 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	file_size   = response->body[2];
+	file_size <<= 8;
+	file_size  += response->body[3];
+	file_size <<= 8;
+	file_size  += response->body[4];
+	file_size <<= 8;
+	file_size  += response->body[5];
+
+	position    = response->body[6];
+	position  <<= 8;
+	position   += response->body[7];
+	position  <<= 8;
+	position   += response->body[8];
+	position  <<= 8;
+	position   += response->body[9];
+
+	length      = response->body[10];
+	length    <<= 8;
+	length     += response->body[11];
+
+	if ( bodylen < 12 + length ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	if ( file_size != download->file_size                                         ||
+	     position  != download->file_position + index * FINS_MAX_FILE_READ_BYTES  ||
+	     length    != block_size( download, index )                                   ) return FINS_RETVAL_FILE_SIZE_MISMATCH;
+
+	if ( ( retval = download->sink( response->body + 12, length, download->context ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	download->num_bytes += length;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static int fd_sink( const unsigned char *data, size_t num_bytes, void *context );
+ *
+ * The function fd_sink() writes downloaded data to the file descriptor to
+ * which the context parameter points.
+ */
+
+static int fd_sink( const unsigned char *data, size_t num_bytes, void *context ) {
+
+	int fd;
+	int written;
+
+	fd = *(int *) context;
+
+	while ( num_bytes > 0 ) {
+
+#if defined(_WIN32)
+		written = _write( fd, data, (unsigned int) num_bytes );
+#else  /* defined(_WIN32) */
+		written = (int) write( fd, data, num_bytes );
+#endif  /* defined(_WIN32) */
+
+		if ( written < 0  &&  errno == EINTR ) continue;
+		if ( written < 0                     ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+		data      += written;
+		num_bytes -= (size_t) written;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* fd_sink */
@@ -70,6 +70,20 @@ const char *finslib_errmsg( int error_code, char *buffer, size_t buffer_len ) {
 		case FINS_RETVAL_ABORTED                     : snprintf( buffer, buffer_len, "Services was aborted"                               ); break;
 		case FINS_RETVAL_MAX_ERROR_COUNT             : snprintf( buffer, buffer_len, "Connection closed: error count exceeded"            ); break;
 		case FINS_RETVAL_SYNC_ERROR                  : snprintf( buffer, buffer_len, "Synchronization error"                              ); break;
+		case FINS_RETVAL_NOT_SUPPORTED               : snprintf( buffer, buffer_len, "Function not supported in this build"               ); break;
+		case FINS_RETVAL_CAPTURE_END                 : snprintf( buffer, buffer_len, "No more frames in the capture file"                 ); break;
+		case FINS_RETVAL_CAPTURE_INVALID             : snprintf( buffer, buffer_len, "Invalid or truncated capture file"                  ); break;
+		case FINS_RETVAL_FILE_SIZE_MISMATCH          : snprintf( buffer, buffer_len, "File size differs from directory entry"             ); break;
+		case FINS_RETVAL_VERIFY_FAILED               : snprintf( buffer, buffer_len, "Data read back differs from data written"           ); break;
+		case FINS_RETVAL_BACKUP_INVALID              : snprintf( buffer, buffer_len, "Program backup file is invalid or corrupt"          ); break;
+		case FINS_RETVAL_BACKUP_MODEL_MISMATCH       : snprintf( buffer, buffer_len, "Program backup was made from another PLC model"     ); break;
+		case FINS_RETVAL_SNAPSHOT_INVALID            : snprintf( buffer, buffer_len, "Snapshot manifest or object missing or corrupt"     ); break;
+		case FINS_RETVAL_IMAGE_INVALID               : snprintf( buffer, buffer_len, "Memory image file missing or corrupt"               ); break;
+		case FINS_RETVAL_INVALID_PERIOD              : snprintf( buffer, buffer_len, "Invalid period, interval or deadband"               ); break;
+		case FINS_RETVAL_SHM_INVALID                 : snprintf( buffer, buffer_len, "Shared memory process image missing or corrupt"     ); break;
+		case FINS_RETVAL_HISTORY_INVALID             : snprintf( buffer, buffer_len, "History file missing or corrupt"                    ); break;
+		case FINS_RETVAL_INVALID_TAG                 : snprintf( buffer, buffer_len, "Invalid, duplicate or unknown tag"                  ); break;
+		case FINS_RETVAL_STILL_CONNECTED             : snprintf( buffer, buffer_len, "FINS context still has an open connection"          ); break;
 
 		case FINS_RETVAL_CLOSED_BY_REMOTE            : snprintf( buffer, buffer_len, "FINS/TCP connection closed by remote"               ); break;
 		case FINS_RETVAL_NO_FINS_HEADER              : snprintf( buffer, buffer_len, "FINS/TCP missing FINS header"                       ); break;
@@ -102,6 +116,7 @@ const char *finslib_errmsg( int error_code, char *buffer, size_t buffer_len ) {
 		case FINS_RETVAL_INVALID_DISK                : snprintf( buffer, buffer_len, "Invalid disk"                                       ); break;
 		case FINS_RETVAL_INVALID_PATH                : snprintf( buffer, buffer_len, "Invalid path"                                       ); break;
 		case FINS_RETVAL_INVALID_FILENAME            : snprintf( buffer, buffer_len, "Invalid filename"                                   ); break;
+		case FINS_RETVAL_INVALID_VERIFY_MODE         : snprintf( buffer, buffer_len, "Invalid verification mode"                          ); break;
 
 		case FINS_RETVAL_INVALID_DATE                : snprintf( buffer, buffer_len, "Invalid date"                                       ); break;
 
@@ -0,0 +1,431 @@
+/*
+ * Library: libfins
+ * File:    src/fins_filewalk.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_filewalk.c contains a routine to list a directory
+ * tree in the file memory of a PLC. The walk proceeds in rounds. In every
+ * round the next page of every directory which is not complete yet is read,
+ * with several commands in flight at the same time, so that sibling
+ * directories are listed in parallel. Subdirectories found in a round are
+ * listed from the next round on. Complete listings are stored in the
+ * directory listing cache of the connection if one is enabled, and listings
+ * found in that cache are used without contacting the PLC.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define WALK_PAGE_FILES		20
+
+									/********************************************************/
+struct walk_dir_tp {							/*							*/
+	char			path[FINS_MAX_PATH_LEN+1];		/* Path of the directory				*/
+	struct fins_diskinfo_tp	diskinfo;				/* Volume information returned with the listing		*/
+	size_t			num_files;				/* Number of entries read so far			*/
+	size_t			max_files;				/* Number of entries allocated				*/
+	struct fins_fileinfo_tp *fileinfo;				/* The entries read so far				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct walk_request_tp {						/*							*/
+	size_t			dir;					/* Index of the directory to read			*/
+	size_t			start_file;				/* First entry to read					*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct walk_tp {							/*							*/
+	struct fins_sys_tp *	sys;					/* Connection to the PLC				*/
+	uint16_t		disk;					/* Disk which is walked					*/
+	fins_walk_callback_tp	callback;				/* Function called for every entry or NULL		*/
+	void *			context;				/* Parameter passed to the callback function		*/
+	struct walk_dir_tp *	dir;					/* All directories found				*/
+	size_t			num_dirs;				/* Number of directories found				*/
+	size_t			max_dirs;				/* Number of directories allocated			*/
+	struct walk_request_tp *round;					/* Pages read in the current round			*/
+	size_t			num_round;				/* Number of pages in the current round			*/
+	size_t			max_round;				/* Number of pages allocated for the current round	*/
+	struct walk_request_tp *next;					/* Pages to read in the next round			*/
+	size_t			num_next;				/* Number of pages for the next round			*/
+	size_t			max_next;				/* Number of pages allocated for the next round		*/
+	size_t			build_index;				/* Index of the next page to request			*/
+	size_t			handle_index;				/* Index of the next page to handle			*/
+	size_t			num_entries;				/* Number of entries passed to the callback		*/
+};									/*							*/
+									/********************************************************/
+
+static int			add_dir( struct walk_tp *walk, const char *path );
+static int			add_request( struct walk_tp *walk, size_t dir, size_t start_file );
+static int			build_page( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			complete_dir( struct walk_tp *walk, size_t dir, bool from_cache );
+static int			handle_page( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static void			name_from_83( const char *filename_83, char *name );
+static int			walk_tree( struct walk_tp *walk, const char *path, size_t depth );
+
+/*
+ * int finslib_file_walk( struct fins_sys_tp *sys, uint16_t disk, const char *path, fins_walk_callback_tp callback, void *context, size_t depth, size_t *num_entries );
+ *
+ * The function finslib_file_walk() lists the directory path on a disk of a
+ * remote PLC and all directories below it. Every entry is passed to the
+ * callback function together with the path of the directory it was found in.
+ * The callback may be NULL if the walk is only used to fill the directory
+ * listing cache. At most depth commands are in flight at the same time. If
+ * num_entries is not NULL the number of entries found is stored there.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_walk( struct fins_sys_tp *sys, uint16_t disk, const char *path, fins_walk_callback_tp callback, void *context, size_t depth, size_t *num_entries ) {
+
+	int retval;
+	size_t a;
+	struct walk_tp walk;
+
+	if ( num_entries != NULL           ) *num_entries = 0;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	if ( disk != FINS_DISK_MEMORY_CARD  &&  disk != FINS_DISK_EM_FILE_MEMORY ) return FINS_RETVAL_INVALID_DISK;
+
+	if ( ! finslib_valid_directory( path ) ) return FINS_RETVAL_INVALID_PATH;
+
+	memset( & walk, 0, sizeof(walk) );
+
+	walk.sys      = sys;
+	walk.disk     = disk;
+	walk.callback = callback;
+	walk.context  = context;
+
+	retval = walk_tree( & walk, path, depth );
+
+	for (a=0; a<walk.num_dirs; a++) free( walk.dir[a].fileinfo );
+
+	free( walk.dir   );
+	free( walk.round );
+	free( walk.next  );
+
+	if ( num_entries != NULL ) *num_entries = walk.num_entries;
+
+	return retval;
+
+}  /* finslib_file_walk */
+
+/*
+ * static int walk_tree( struct walk_tp *walk, const char *path, size_t depth );
+ *
+ * The function walk_tree() runs the rounds of a walk until no directory is
+ * left to be read.
+ */
+
+static int walk_tree( struct walk_tp *walk, const char *path, size_t depth ) {
+
+	int retval;
+	size_t swap_max;
+	struct walk_request_tp *swap;
+
+	if ( ( retval = add_dir( walk, ( path == NULL ) ? "" : path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	while ( walk->num_next > 0 ) {
+
+		swap               = walk->round;
+		swap_max           = walk->max_round;
+		walk->round        = walk->next;
+		walk->max_round    = walk->max_next;
+		walk->num_round    = walk->num_next;
+		walk->next         = swap;
+		walk->max_next     = swap_max;
+		walk->num_next     = 0;
+		walk->build_index  = 0;
+		walk->handle_index = 0;
+
+		if ( ( retval = XX_finslib_pipeline( walk->sys, walk->num_round, depth, build_page, handle_page, walk ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* walk_tree */
+
+/*
+ * static int add_dir( struct walk_tp *walk, const char *path );
+ *
+ * The function add_dir() adds a directory to a walk. If the listing of the
+ * directory is in the cache it is handled immediately. Otherwise the first
+ * page of the directory is scheduled for the next round.
+ */
+
+static int add_dir( struct walk_tp *walk, const char *path ) {
+
+	size_t max_dirs;
+	size_t num_cached;
+	struct walk_dir_tp *dir;
+	struct walk_dir_tp *list;
+	const struct fins_fileinfo_tp *cached;
+
+	if ( walk->num_dirs >= walk->max_dirs ) {
+
+		max_dirs = ( walk->max_dirs == 0 ) ? 16 : 2 * walk->max_dirs;
+		list     = realloc( walk->dir, max_dirs * sizeof(struct walk_dir_tp) );
+
+		if ( list == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		walk->dir      = list;
+		walk->max_dirs = max_dirs;
+	}
+
+	dir = & walk->dir[ walk->num_dirs++ ];
+
+	memset( dir, 0, sizeof(struct walk_dir_tp) );
+	strcpy( dir->path, path );
+
+	if ( XX_finslib_dircache_lookup( walk->sys, walk->disk, path, & dir->diskinfo, & cached, & num_cached ) ) {
+
+		if ( num_cached > 0 ) {
+
+			dir->fileinfo = malloc( num_cached * sizeof(struct fins_fileinfo_tp) );
+			if ( dir->fileinfo == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+			memcpy( dir->fileinfo, cached, num_cached * sizeof(struct fins_fileinfo_tp) );
+		}
+
+		dir->num_files = num_cached;
+		dir->max_files = num_cached;
+
+		return complete_dir( walk, walk->num_dirs-1, true );
+	}
+
+	return add_request( walk, walk->num_dirs-1, 0 );
+
+}  /* add_dir */
+
+/*
+ * static int add_request( struct walk_tp *walk, size_t dir, size_t start_file );
+ *
+ * The function add_request() schedules a page of a directory to be read in
+ * the next round.
+ */
+
+static int add_request( struct walk_tp *walk, size_t dir, size_t start_file ) {
+
+	size_t max_next;
+	struct walk_request_tp *list;
+
+	if ( walk->num_next >= walk->max_next ) {
+
+		max_next = ( walk->max_next == 0 ) ? 16 : 2 * walk->max_next;
+		list     = realloc( walk->next, max_next * sizeof(struct walk_request_tp) );
+
+		if ( list == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		walk->next     = list;
+		walk->max_next = max_next;
+	}
+
+	walk->next[ walk->num_next ].dir        = dir;
+	walk->next[ walk->num_next ].start_file = start_file;
+	walk->num_next++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* add_request */
+
+/*
+ * static int build_page( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_page() builds the command which reads the next page of
+ * the current round.
+ */
+
+static int build_page( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	struct walk_tp *walk;
+	struct walk_request_tp *request;
+
+	(void) index;
+
+	walk = context;
+
+	if ( walk->build_index >= walk->num_round ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+	request = & walk->round[ walk->build_index++ ];
+
+	XX_finslib_file_name_read_command( sys, command, bodylen, walk->disk, walk->dir[ request->dir ].path, (uint16_t) request->start_file, WALK_PAGE_FILES );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_page */
+
+/*
+ * static int handle_page( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_page() adds the entries of a page to its directory. If
+ * the page was the last one, the directory is complete. Otherwise the next
+ * page is scheduled for the next round.
+ */
+
+static int handle_page( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	size_t a;
+	size_t pos;
+	size_t num_files;
+	size_t max_files;
+	bool last;
+	struct walk_tp *walk;
+	struct walk_dir_tp *dir;
+	struct walk_request_tp request;
+	struct fins_fileinfo_tp *list;
+
+	(void) sys;
+	(void) index;
+
+	walk    = context;
+	request = walk->round[ walk->handle_index++ ];
+	dir     = & walk->dir[ request.dir ];
+
+	if ( bodylen < 30 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	if ( request.start_file == 0 ) XX_finslib_decode_diskinfo( & response->body[2], & dir->diskinfo );
+
+	num_files = ( ( response->body[28] & 0x7f ) << 8 ) | response->body[29];
+	last      = ( response->body[28] & 0x80 ) != 0  ||  num_files < WALK_PAGE_FILES;
+
+	if ( num_files > WALK_PAGE_FILES                           ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( bodylen   < 30 + num_files * FINS_FILEINFO_RECORD_LEN ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	if ( dir->num_files + num_files > dir->max_files ) {
+
+		max_files = dir->num_files + num_files + 2 * WALK_PAGE_FILES;
+		list      = realloc( dir->fileinfo, max_files * sizeof(struct fins_fileinfo_tp) );
+
+		if ( list == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		dir->fileinfo  = list;
+		dir->max_files = max_files;
+	}
+
+	pos = 30;
+
+	for (a=0; a<num_files; a++) {
+
+		XX_finslib_decode_fileinfo( & response->body[pos], & dir->fileinfo[ dir->num_files++ ] );
+		pos += FINS_FILEINFO_RECORD_LEN;
+	}
+
+	if ( last ) return complete_dir( walk, request.dir, false );
+
+	return add_request( walk, request.dir, request.start_file + num_files );
+
+}  /* handle_page */
+
+/*
+ * static int complete_dir( struct walk_tp *walk, size_t dir, bool from_cache );
+ *
+ * The function complete_dir() is called when all entries of a directory are
+ * known. The listing is stored in the cache, the entries are passed to the
+ * callback function and the subdirectories are added to the walk.
+ */
+
+static int complete_dir( struct walk_tp *walk, size_t dir, bool from_cache ) {
+
+	int retval;
+	size_t a;
+	size_t len;
+	char name[13];
+	char path[FINS_MAX_PATH_LEN+1];
+	struct fins_fileinfo_tp entry;
+
+	if ( ! from_cache ) {
+
+		retval = XX_finslib_dircache_store( walk->sys, walk->disk, walk->dir[dir].path, & walk->dir[dir].diskinfo, walk->dir[dir].fileinfo, walk->dir[dir].num_files );
+		if ( retval != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	for (a=0; a<walk->dir[dir].num_files; a++) {
+
+		entry = walk->dir[dir].fileinfo[a];
+
+		if ( entry.filename[0] == '.' ) continue;
+
+		walk->num_entries++;
+
+		if ( walk->callback != NULL ) {
+
+			if ( ( retval = walk->callback( walk->dir[dir].path, & entry, walk->context ) ) != FINS_RETVAL_SUCCESS ) return retval;
+		}
+
+		if ( ! entry.directory  ||  entry.volume_label ) continue;
+
+		name_from_83( entry.filename, name );
+
+		len = strlen( walk->dir[dir].path );
+		if ( len + 1 + strlen( name ) > FINS_MAX_PATH_LEN ) continue;
+
+		strcpy( path, walk->dir[dir].path );
+		path[len] = '\\';
+		strcpy( path+len+1, name );
+
+		if ( ( retval = add_dir( walk, path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	free( walk->dir[dir].fileinfo );
+
+	walk->dir[dir].fileinfo  = NULL;
+	walk->dir[dir].num_files = 0;
+	walk->dir[dir].max_files = 0;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* complete_dir */
+
+/*
+ * static void name_from_83( const char *filename_83, char *name );
+ *
+ * The function name_from_83() converts a filename in the expanded 8.3 format
+ * returned by the PLC to a normal filename without padding spaces.
+ */
+
+static void name_from_83( const char *filename_83, char *name ) {
+
+	size_t a;
+	size_t len;
+
+	len = 0;
+
+	for (a=0; a<8  &&  filename_83[a]; a++) if ( filename_83[a] != ' ' ) name[len++] = filename_83[a];
+
+	if ( a == 8  &&  filename_83[8] == '.'  &&  filename_83[9] != ' '  &&  filename_83[9] != 0 ) {
+
+		name[len++] = '.';
+		for (a=9; a<12  &&  filename_83[a]; a++) if ( filename_83[a] != ' ' ) name[len++] = filename_83[a];
+	}
+
+	name[len] = 0;
+
+}  /* name_from_83 */
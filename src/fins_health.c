@@ -0,0 +1,201 @@
+/*
+ * Library: libfins
+ * File:    src/fins_health.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_health.c contains routines to read the overall
+ * health of one or more remote PLCs. The CPU unit status, the cycle time, the
+ * clock and the messages of a PLC are requested with four commands which are
+ * sent back to back without waiting for the responses. When more than one PLC
+ * is queried, the commands to all PLCs are sent before the first response is
+ * collected, so that the time needed is determined by the slowest PLC rather
+ * than by the sum of all round trips.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define HEALTH_NUM_COMMANDS	4
+
+static int	build_health( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int	handle_health( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+
+/*
+ * int finslib_health_read( struct fins_sys_tp *sys, struct fins_health_tp *health );
+ *
+ * The function finslib_health_read() reads the CPU unit status, the cycle
+ * time, the clock and the messages of a remote PLC in one pipelined exchange
+ * and stores the results in one structure.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_health_read( struct fins_sys_tp *sys, struct fins_health_tp *health ) {
+
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( health      == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	memset( health, 0, sizeof(struct fins_health_tp) );
+
+	return XX_finslib_pipeline( sys, HEALTH_NUM_COMMANDS, HEALTH_NUM_COMMANDS, build_health, handle_health, health );
+
+}  /* finslib_health_read */
+
+/*
+ * int finslib_health_read_multi( struct fins_sys_tp **sys, struct fins_health_tp *health, int *retval, size_t num_sys );
+ *
+ * The function finslib_health_read_multi() reads the health of num_sys remote
+ * PLCs at the same time. The commands for all PLCs are sent first and the
+ * responses are collected afterwards. The result for the PLC connected
+ * through sys[i] is stored in health[i] and its return code in retval[i].
+ * Connections which are NULL or not connected get an error code in retval and
+ * do not stop the other queries.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ * The function only fails as a whole if the parameters are invalid or no
+ * memory is available. It succeeds even if one or more of the individual
+ * queries failed.
+ */
+
+int finslib_health_read_multi( struct fins_sys_tp **sys, struct fins_health_tp *health, int *retval, size_t num_sys ) {
+
+	size_t a;
+	int result;
+	void **context;
+
+	if ( num_sys == 0                                  ) return FINS_RETVAL_SUCCESS;
+	if ( sys     == NULL                               ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( health  == NULL  ||  retval == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	context = malloc( num_sys * sizeof(void *) );
+	if ( context == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	for (a=0; a<num_sys; a++) {
+
+		memset( & health[a], 0, sizeof(struct fins_health_tp) );
+		context[a] = & health[a];
+	}
+
+	result = XX_finslib_pipeline_multi( sys, num_sys, HEALTH_NUM_COMMANDS, build_health, handle_health, context, retval );
+
+	free( context );
+
+	return result;
+
+}  /* finslib_health_read_multi */
+
+/*
+ * static int build_health( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_health() builds one of the commands of a health query.
+ * All eight messages are requested because the CPU unit status which tells
+ * which messages exist is read in the same exchange.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int build_health( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	(void) context;
+
+	*bodylen = 0;
+
+	switch( index ) {
+
+		case 0 :
+			XX_finslib_init_command( sys, command, 0x06, 0x01 );
+			break;
+
+		case 1 :
+			XX_finslib_init_command( sys, command, 0x06, 0x20 );
+			command->body[(*bodylen)++] = 0x01;
+			break;
+
+		case 2 :
+			XX_finslib_init_command( sys, command, 0x07, 0x01 );
+			break;
+
+		case 3 :
+			XX_finslib_init_command( sys, command, 0x09, 0x20 );
+			command->body[(*bodylen)++] = 0x00;
+			command->body[(*bodylen)++] = FINS_MSG_ALL;
+			break;
+
+		default :
+			return FINS_RETVAL_SUCCESS_LAST_DATA;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_health */
+
+/*
+ * static int handle_health( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_health() decodes the response to one of the commands of
+ * a health query in the health structure passed as context.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int handle_health( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	struct fins_health_tp *health;
+
+	(void) sys;
+
+	health = context;
+
+	switch( index ) {
+
+		case 0 :
+			if ( bodylen != 28 ) return FINS_RETVAL_BODY_TOO_SHORT;
+			XX_finslib_decode_cpustatus( & response->body[2], & health->status );
+			break;
+
+		case 1 :
+			if ( bodylen != 14 ) return FINS_RETVAL_BODY_TOO_SHORT;
+			XX_finslib_decode_cycletime( & response->body[2], & health->cycle_time );
+			break;
+
+		case 2 :
+			if ( bodylen != 9 ) return FINS_RETVAL_BODY_TOO_SHORT;
+			XX_finslib_decode_datetime( & response->body[2], & health->clock );
+			break;
+
+		case 3 :
+			if ( bodylen < 4 ) return FINS_RETVAL_BODY_TOO_SHORT;
+			health->num_messages = XX_finslib_decode_msgdata( & response->body[2], bodylen-2, health->messages );
+			break;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_health */
@@ -0,0 +1,1229 @@
+/*
+ * Library: libfins
+ * File:    src/fins_historian.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_historian.c contains a local historian which
+ * stores timestamped samples of polled data items in a compact file. The
+ * samples of every tag are collected in memory in a compressed chunk, and a
+ * chunk is appended to the file when it is full or when the historian is
+ * flushed. Each chunk contains the samples of one tag only, so the file is
+ * organized in columns per tag.
+ *
+ * Timestamps are stored as the difference between the current and previous
+ * interval between samples. With a constant poll rate this is usually zero
+ * and takes one bit. Floating point values are stored as the exclusive or
+ * with the previous value, of which only the bits which differ are written.
+ * Integer values are stored as the difference between successive changes.
+ * Both methods need one bit for a value which did not change. The encodings
+ * follow those described for the Gorilla time series database.
+ *
+ * A history file starts with a 16 byte header with the text "FINSHIS" and a
+ * version byte. Every chunk starts with a 56 byte header with the tag name
+ * padded with zeros to 12 bytes, the kind of values, three reserved bytes,
+ * the number of samples, the number of bytes of compressed data, the lowest
+ * and highest time in the chunk, the time of the first sample, the CRC-32 of
+ * the data and the CRC-32 of the first 52 bytes of the chunk header. Samples
+ * need not be added in time order, so the first time is stored separately
+ * from the lowest time as the start for decoding the time differences. The
+ * compressed data follows and is padded to a multiple of eight bytes. All
+ * numbers are stored most significant byte first. A chunk which was only
+ * partially written when the writer stopped is removed when the file is
+ * opened for writing again.
+ *
+ * Readers map the file in memory and build a time index from the chunk
+ * headers, which is sorted by tag and time. A range query only decodes the
+ * chunks of the tag which overlap the requested time range.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else  /* defined(_WIN32) */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  /* defined(_WIN32) */
+
+#include "fins.h"
+
+#define HIST_VERSION		0x02
+#define HIST_HEADER		16
+#define HIST_CHUNK_HEADER	56
+#define HIST_CHUNK_BYTES	4096
+#define HIST_SAMPLE_BYTES	24
+#define HIST_NAME_LEN		12
+#define HIST_MIN_SERIES		16
+
+#define HIST_KIND_INT		1
+#define HIST_KIND_FLOAT		2
+
+									/********************************************************/
+struct series_tp {							/*							*/
+	char			name[HIST_NAME_LEN];			/* Name of the tag padded with zeros			*/
+	uint8_t			kind;					/* Kind of values in the current chunk			*/
+	uint32_t		num_samples;				/* Number of samples in the current chunk		*/
+	int64_t			min_time;				/* Lowest time in the current chunk			*/
+	int64_t			max_time;				/* Highest time in the current chunk			*/
+	int64_t			first_time;				/* Time of the first sample in the current chunk	*/
+	int64_t			prev_time;				/* Time of the previous sample				*/
+	int64_t			prev_delta;				/* Interval before the previous sample			*/
+	uint64_t		prev_value;				/* Bits of the previous value				*/
+	int64_t			prev_change;				/* Change of the previous integer value			*/
+	int			prev_leading;				/* Leading zeros of the previous XOR, or -1		*/
+	int			prev_trailing;				/* Trailing zeros of the previous XOR			*/
+	uint64_t		acc;					/* Bits not yet stored in the buffer			*/
+	unsigned		acc_bits;				/* Number of bits in the accumulator			*/
+	size_t			num_bytes;				/* Number of bytes in the buffer			*/
+	unsigned char *		buffer;					/* Compressed data of the current chunk			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_historian_tp {						/*							*/
+	FILE *			fp;					/* The history file					*/
+	struct series_tp *	series;					/* The tags seen so far					*/
+	size_t			num_series;				/* Number of tags					*/
+	size_t			max_series;				/* Number of tags allocated				*/
+	size_t *		slot;					/* Hash table with the series index plus one		*/
+	size_t			num_slots;				/* Number of slots in the hash table			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct index_tp {							/*							*/
+	char			name[HIST_NAME_LEN];			/* Name of the tag padded with zeros			*/
+	uint8_t			kind;					/* Kind of values in the chunk				*/
+	uint32_t		num_samples;				/* Number of samples in the chunk			*/
+	int64_t			min_time;				/* Lowest time in the chunk				*/
+	int64_t			max_time;				/* Highest time in the chunk				*/
+	int64_t			first_time;				/* Time of the first sample in the chunk		*/
+	size_t			offset;					/* Offset of the compressed data in the file		*/
+	size_t			num_bytes;				/* Number of bytes of compressed data			*/
+	uint32_t		crc;					/* CRC-32 of the compressed data			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_history_tp {						/*							*/
+	unsigned char *		base;					/* Start of the mapped file				*/
+	size_t			size;					/* Size of the mapped file				*/
+	struct index_tp *	index;					/* Chunks sorted by tag and time			*/
+	size_t			num_chunks;				/* Number of chunks in the index			*/
+#if defined(_WIN32)							/*							*/
+	HANDLE			file;					/* Handle of the history file				*/
+	HANDLE			mapping;				/* Handle of the file mapping				*/
+#endif									/*							*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct bitreader_tp {							/*							*/
+	const unsigned char *	data;					/* Compressed data					*/
+	size_t			num_bits;				/* Number of bits in the data				*/
+	size_t			pos;					/* Position of the next bit				*/
+	bool			error;					/* Read past the end of the data			*/
+};									/*							*/
+									/********************************************************/
+
+static int			add_sample( struct fins_historian_tp *historian, struct series_tp *series, int64_t time_msec, uint8_t kind, uint64_t value );
+static int			build_index( struct fins_history_tp *history );
+static int			compare_index( const void *a, const void *b );
+static int			decode_chunk( const struct fins_history_tp *history, const struct index_tp *chunk, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples );
+static int64_t			get_dod( struct bitreader_tp *reader );
+static uint64_t			get_bits( struct bitreader_tp *reader, unsigned num_bits );
+static bool			grow_series( struct fins_historian_tp *historian );
+static int			item_sample( const struct fins_multidata_tp *item, uint8_t *kind, uint64_t *value );
+static int			leading_zeros( uint64_t value );
+static void			put_bits( struct series_tp *series, uint64_t value, unsigned num_bits );
+static void			put_dod( struct series_tp *series, int64_t dod );
+static int			scan_chunks( FILE *fp, uint64_t *valid_end );
+static struct series_tp *	search_series( struct fins_historian_tp *historian, const char *name );
+static int			trailing_zeros( uint64_t value );
+static int			write_chunk( struct fins_historian_tp *historian, struct series_tp *series );
+
+/*
+ * struct fins_historian_tp *finslib_historian_open( const char *filename, int *error_val );
+ *
+ * The function finslib_historian_open() opens a history file for appending
+ * samples. The file is created if it does not exist. The chunks in an
+ * existing file are checked and a chunk which was only partially written is
+ * removed. On error NULL is returned and the reason is stored in the
+ * error_val parameter if that is not NULL.
+ */
+
+struct fins_historian_tp *finslib_historian_open( const char *filename, int *error_val ) {
+
+	int retval;
+	uint64_t valid_end;
+	unsigned char header[HIST_HEADER];
+	struct fins_historian_tp *historian;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( filename == NULL  ||  filename[0] == 0 ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_INVALID_FILENAME;
+		return NULL;
+	}
+
+	historian = calloc( 1, sizeof(struct fins_historian_tp) );
+
+	if ( historian == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	retval        = FINS_RETVAL_SUCCESS;
+	historian->fp = fopen( filename, "r+b" );
+
+	if ( historian->fp != NULL ) {
+
+		if      ( fread( header, 1, HIST_HEADER, historian->fp ) != HIST_HEADER                ) retval = FINS_RETVAL_HISTORY_INVALID;
+		else if ( memcmp( header, "FINSHIS", 7 ) != 0  ||  header[7] != HIST_VERSION           ) retval = FINS_RETVAL_HISTORY_INVALID;
+		else     retval = scan_chunks( historian->fp, & valid_end );
+	}
+
+	else if ( errno == ENOENT ) {
+
+		memset( header, 0, HIST_HEADER );
+		memcpy( header, "FINSHIS", 7 );
+		header[7] = HIST_VERSION;
+
+		historian->fp = fopen( filename, "w+b" );
+
+		if      ( historian->fp == NULL                                          ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+		else if ( fwrite( header, 1, HIST_HEADER, historian->fp ) != HIST_HEADER ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	else retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		if ( historian->fp != NULL ) fclose( historian->fp );
+		free( historian );
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	return historian;
+
+}  /* finslib_historian_open */
+
+/*
+ * static int scan_chunks( FILE *fp, uint64_t *valid_end );
+ *
+ * The function scan_chunks() walks over the chunk headers of a history file
+ * which has just been opened for appending and positions the file after the
+ * last complete chunk. A chunk is only complete if the checksums of both its
+ * header and its data are correct. Anything after that chunk is left over
+ * from a writer which stopped in the middle of a chunk and is cut off.
+ */
+
+static int scan_chunks( FILE *fp, uint64_t *valid_end ) {
+
+	long file_size;
+	uint64_t num_bytes;
+	unsigned char header[HIST_CHUNK_HEADER];
+	unsigned char data[HIST_CHUNK_BYTES];
+
+	if ( fseek( fp, 0, SEEK_END ) != 0  ||  ( file_size = ftell( fp ) ) < 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	*valid_end = HIST_HEADER;
+
+	while ( *valid_end + HIST_CHUNK_HEADER <= (uint64_t) file_size ) {
+
+		if ( fseek( fp, (long) *valid_end, SEEK_SET ) != 0                                      ) return FINS_RETVAL_ERRNO_BASE + errno;
+		if ( fread( header, 1, HIST_CHUNK_HEADER, fp ) != HIST_CHUNK_HEADER                     ) return FINS_RETVAL_ERRNO_BASE + errno;
+		if ( finslib_crc32( 0, header, 52 ) != XX_finslib_get_uint32( header+52 )                          ) break;
+
+		num_bytes = XX_finslib_get_uint32( header+20 );
+
+		if ( num_bytes % 8 != 0  ||  num_bytes > HIST_CHUNK_BYTES  ||  num_bytes > (uint64_t) file_size - *valid_end - HIST_CHUNK_HEADER ) break;
+
+		if ( fread( data, 1, (size_t) num_bytes, fp ) != num_bytes                               ) return FINS_RETVAL_ERRNO_BASE + errno;
+		if ( finslib_crc32( 0, data, (size_t) num_bytes ) != XX_finslib_get_uint32( header+48 )             ) break;
+
+		*valid_end += HIST_CHUNK_HEADER + num_bytes;
+	}
+
+	if ( *valid_end < (uint64_t) file_size ) {
+
+		fflush( fp );
+#if defined(_WIN32)
+		if ( _chsize_s( _fileno( fp ), (__int64) *valid_end ) != 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+#else  /* defined(_WIN32) */
+		if ( ftruncate( fileno( fp ), (off_t) *valid_end ) != 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+#endif  /* defined(_WIN32) */
+	}
+
+	if ( fseek( fp, (long) *valid_end, SEEK_SET ) != 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* scan_chunks */
+
+/*
+ * int finslib_historian_add( struct fins_historian_tp *historian, int64_t time_msec, const struct fins_multidata_tp *items, size_t num_items );
+ *
+ * The function finslib_historian_add() adds one sample of each of a number
+ * of data items to the historian, all with the same time. This matches the
+ * items read from a PLC in one poll. The tag of a sample is the address of
+ * its item. Items without a data type are skipped.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_historian_add( struct fins_historian_tp *historian, int64_t time_msec, const struct fins_multidata_tp *items, size_t num_items ) {
+
+	int retval;
+	size_t a;
+	uint8_t kind;
+	uint64_t value;
+	struct series_tp *series;
+
+	if ( historian == NULL                 ) return FINS_RETVAL_HISTORY_INVALID;
+	if ( items == NULL  &&  num_items > 0  ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	for (a=0; a<num_items; a++) {
+
+		if ( item_sample( & items[a], & kind, & value ) != FINS_RETVAL_SUCCESS ) continue;
+
+		series = search_series( historian, items[a].address );
+		if ( series == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		if ( ( retval = add_sample( historian, series, time_msec, kind, value ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_historian_add */
+
+/*
+ * static int item_sample( const struct fins_multidata_tp *item, uint8_t *kind, uint64_t *value );
+ *
+ * The function item_sample() returns the value of a data item as the bits of
+ * a double for floating point items and as a 64 bit integer for all others.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int item_sample( const struct fins_multidata_tp *item, uint8_t *kind, uint64_t *value ) {
+
+	double dfloat;
+
+	*kind = HIST_KIND_INT;
+
+	switch ( item->type ) {
+
+		case FINS_DATA_TYPE_INT16       :
+		case FINS_DATA_TYPE_SBCD16_0    :
+		case FINS_DATA_TYPE_SBCD16_1    :
+		case FINS_DATA_TYPE_SBCD16_2    :
+		case FINS_DATA_TYPE_SBCD16_3    : *value = (uint64_t) (int64_t) item->int16;	return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_INT32       :
+		case FINS_DATA_TYPE_SBCD32_0    :
+		case FINS_DATA_TYPE_SBCD32_1    :
+		case FINS_DATA_TYPE_SBCD32_2    :
+		case FINS_DATA_TYPE_SBCD32_3    : *value = (uint64_t) (int64_t) item->int32;	return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_UINT16      :
+		case FINS_DATA_TYPE_BCD16       : *value = item->uint16;			return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_UINT32      :
+		case FINS_DATA_TYPE_BCD32       : *value = item->uint32;			return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_BIT         :
+		case FINS_DATA_TYPE_BIT_FORCED  : *value = ( item->bit ) ? 1 : 0;		return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_WORD_FORCED : *value = item->word;				return FINS_RETVAL_SUCCESS;
+
+		case FINS_DATA_TYPE_FLOAT       :
+		case FINS_DATA_TYPE_DOUBLE      :
+
+			dfloat = ( item->type == FINS_DATA_TYPE_FLOAT ) ? (double) item->sfloat : item->dfloat;
+			*kind  = HIST_KIND_FLOAT;
+			memcpy( value, & dfloat, sizeof(uint64_t) );
+
+			return FINS_RETVAL_SUCCESS;
+	}
+
+	return FINS_RETVAL_NO_DATA_BLOCK;
+
+}  /* item_sample */
+
+/*
+ * static struct series_tp *search_series( struct fins_historian_tp *historian, const char *name );
+ *
+ * The function search_series() returns the series of a tag. A new series is
+ * created the first time a tag is seen. The series are found through an open
+ * addressing hash table on the tag name. NULL is returned if there is not
+ * enough memory for a new series.
+ */
+
+static struct series_tp *search_series( struct fins_historian_tp *historian, const char *name ) {
+
+	size_t a;
+	size_t len;
+	size_t pos;
+	uint32_t hash;
+	char key[HIST_NAME_LEN];
+	struct series_tp *series;
+	const char *end;
+
+	end = memchr( name, 0, HIST_NAME_LEN );
+	len = ( end != NULL ) ? (size_t) ( end - name ) : HIST_NAME_LEN;
+
+	memset( key, 0, HIST_NAME_LEN );
+	memcpy( key, name, len );
+
+	hash = 2166136261u;
+	for (a=0; a<len; a++) hash = ( hash ^ (unsigned char) key[a] ) * 16777619u;
+
+	if ( historian->num_slots > 0 ) {
+
+		pos = hash & ( historian->num_slots - 1 );
+
+		while ( historian->slot[pos] != 0 ) {
+
+			series = & historian->series[ historian->slot[pos] - 1 ];
+			if ( memcmp( series->name, key, HIST_NAME_LEN ) == 0 ) return series;
+
+			pos = ( pos + 1 ) & ( historian->num_slots - 1 );
+		}
+	}
+
+	if ( historian->num_series >= historian->max_series  &&  ! grow_series( historian ) ) return NULL;
+
+	series = & historian->series[ historian->num_series ];
+
+	memset( series, 0, sizeof(struct series_tp) );
+	memcpy( series->name, key, HIST_NAME_LEN );
+
+	series->buffer = malloc( HIST_CHUNK_BYTES );
+	if ( series->buffer == NULL ) return NULL;
+
+	historian->num_series++;
+
+	pos = hash & ( historian->num_slots - 1 );
+	while ( historian->slot[pos] != 0 ) pos = ( pos + 1 ) & ( historian->num_slots - 1 );
+	historian->slot[pos] = historian->num_series;
+
+	return series;
+
+}  /* search_series */
+
+/*
+ * static bool grow_series( struct fins_historian_tp *historian );
+ *
+ * The function grow_series() doubles the number of series for which room is
+ * allocated and rebuilds the hash table, which always has at least twice as
+ * many slots as there are series.
+ *
+ * The function returns true if the series have been enlarged.
+ */
+
+static bool grow_series( struct fins_historian_tp *historian ) {
+
+	size_t a;
+	size_t pos;
+	size_t len;
+	size_t max_series;
+	uint32_t hash;
+	size_t *slot;
+	struct series_tp *series;
+
+	max_series = ( historian->max_series == 0 ) ? HIST_MIN_SERIES : 2 * historian->max_series;
+
+	series = realloc( historian->series, max_series * sizeof(struct series_tp) );
+	if ( series == NULL ) return false;
+
+	historian->series = series;
+
+	slot = calloc( 2 * max_series, sizeof(size_t) );
+	if ( slot == NULL ) return false;
+
+	for (a=0; a<historian->num_series; a++) {
+
+		hash = 2166136261u;
+		for (len=0; len<HIST_NAME_LEN  &&  series[a].name[len]; len++) hash = ( hash ^ (unsigned char) series[a].name[len] ) * 16777619u;
+
+		pos = hash & ( 2 * max_series - 1 );
+		while ( slot[pos] != 0 ) pos = ( pos + 1 ) & ( 2 * max_series - 1 );
+		slot[pos] = a + 1;
+	}
+
+	if ( historian->slot != NULL ) free( historian->slot );
+
+	historian->slot       = slot;
+	historian->num_slots  = 2 * max_series;
+	historian->max_series = max_series;
+
+	return true;
+
+}  /* grow_series */
+
+/*
+ * static int add_sample( struct fins_historian_tp *historian, struct series_tp *series, int64_t time_msec, uint8_t kind, uint64_t value );
+ *
+ * The function add_sample() compresses one sample into the current chunk of a
+ * series. The chunk is written to the file first if the worst case size of a
+ * sample does not fit anymore, or if the kind of values changed. The first
+ * sample of a chunk stores the value in full, its time is in the chunk
+ * header.
+ */
+
+static int add_sample( struct fins_historian_tp *historian, struct series_tp *series, int64_t time_msec, uint8_t kind, uint64_t value ) {
+
+	int retval;
+	int leading;
+	int trailing;
+	int64_t delta;
+	int64_t change;
+	uint64_t xor;
+
+	if ( series->num_samples > 0  &&  ( series->kind != kind  ||  series->num_bytes + HIST_SAMPLE_BYTES > HIST_CHUNK_BYTES ) ) {
+
+		if ( ( retval = write_chunk( historian, series ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	if ( series->num_samples == 0 ) {
+
+		series->kind          = kind;
+		series->min_time      = time_msec;
+		series->max_time      = time_msec;
+		series->first_time    = time_msec;
+		series->prev_time     = time_msec;
+		series->prev_delta    = 0;
+		series->prev_value    = value;
+		series->prev_change   = 0;
+		series->prev_leading  = -1;
+		series->prev_trailing = 0;
+		series->num_samples   = 1;
+
+		put_bits( series, value, 64 );
+
+		return FINS_RETVAL_SUCCESS;
+	}
+
+	delta = time_msec - series->prev_time;
+
+	put_dod( series, delta - series->prev_delta );
+
+	series->prev_delta = delta;
+	series->prev_time  = time_msec;
+
+	if ( time_msec < series->min_time ) series->min_time = time_msec;
+	if ( time_msec > series->max_time ) series->max_time = time_msec;
+
+	if ( kind == HIST_KIND_INT ) {
+
+		change = (int64_t) ( value - series->prev_value );
+
+		put_dod( series, change - series->prev_change );
+
+		series->prev_change = change;
+	}
+
+	else {
+		xor = value ^ series->prev_value;
+
+		if ( xor == 0 ) put_bits( series, 0, 1 );
+
+		else {
+			leading  = leading_zeros( xor );
+			trailing = trailing_zeros( xor );
+
+			if ( leading > 31 ) leading = 31;
+
+			if ( series->prev_leading >= 0  &&  leading >= series->prev_leading  &&  trailing >= series->prev_trailing ) {
+
+				put_bits( series, 0x2, 2 );
+				put_bits( series, xor >> series->prev_trailing, (unsigned) ( 64 - series->prev_leading - series->prev_trailing ) );
+			}
+
+			else {
+				put_bits( series, 0x3, 2 );
+				put_bits( series, (uint64_t) leading, 5 );
+				put_bits( series, (uint64_t) ( ( 64 - leading - trailing ) & 0x3f ), 6 );
+				put_bits( series, xor >> trailing, (unsigned) ( 64 - leading - trailing ) );
+
+				series->prev_leading  = leading;
+				series->prev_trailing = trailing;
+			}
+		}
+	}
+
+	series->prev_value = value;
+	series->num_samples++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* add_sample */
+
+/*
+ * static void put_dod( struct series_tp *series, int64_t dod );
+ *
+ * The function put_dod() stores a difference between two successive
+ * differences with a variable number of bits. Small values, which are the
+ * most common ones, take the least space.
+ */
+
+static void put_dod( struct series_tp *series, int64_t dod ) {
+
+	if      ( dod == 0                        ) { put_bits( series, 0x0, 1 );                                          }
+	else if ( dod >=   -63  &&  dod <=   64   ) { put_bits( series, 0x2, 2 ); put_bits( series, (uint64_t) ( dod +   63 ),  7 ); }
+	else if ( dod >=  -255  &&  dod <=  256   ) { put_bits( series, 0x6, 3 ); put_bits( series, (uint64_t) ( dod +  255 ),  9 ); }
+	else if ( dod >= -2047  &&  dod <= 2048   ) { put_bits( series, 0xE, 4 ); put_bits( series, (uint64_t) ( dod + 2047 ), 12 ); }
+	else                                        { put_bits( series, 0xF, 4 ); put_bits( series, (uint64_t) dod,            64 ); }
+
+}  /* put_dod */
+
+/*
+ * static void put_bits( struct series_tp *series, uint64_t value, unsigned num_bits );
+ *
+ * The function put_bits() appends the lowest num_bits bits of a value to the
+ * compressed data of a series, most significant bit first. The bits are
+ * collected in a 64 bit accumulator which is stored when it is full.
+ */
+
+static void put_bits( struct series_tp *series, uint64_t value, unsigned num_bits ) {
+
+	unsigned take;
+	uint64_t mask;
+	uint64_t bits;
+
+	while ( num_bits > 0 ) {
+
+		take = 64 - series->acc_bits;
+		if ( take > num_bits ) take = num_bits;
+
+		mask = ( take == 64 ) ? ~ (uint64_t) 0 : ( (uint64_t) 1 << take ) - 1;
+		bits = ( value >> ( num_bits - take ) ) & mask;
+
+		series->acc      |= bits << ( 64 - series->acc_bits - take );
+		series->acc_bits += take;
+		num_bits         -= take;
+
+		if ( series->acc_bits == 64 ) {
+
+			XX_finslib_put_uint64( series->buffer + series->num_bytes, series->acc );
+
+			series->num_bytes += 8;
+			series->acc        = 0;
+			series->acc_bits   = 0;
+		}
+	}
+
+}  /* put_bits */
+
+/*
+ * static int write_chunk( struct fins_historian_tp *historian, struct series_tp *series );
+ *
+ * The function write_chunk() appends the current chunk of a series to the
+ * history file and starts a new empty chunk. The bits still in the
+ * accumulator are padded to a full word in the file only. The series is left
+ * unchanged until the whole chunk has been written, and after a failed write
+ * the file is positioned back at the start of the chunk, so a later attempt
+ * writes the same chunk again without losing any samples.
+ */
+
+static int write_chunk( struct fins_historian_tp *historian, struct series_tp *series ) {
+
+	int retval;
+	long start;
+	uint32_t crc;
+	size_t num_bytes;
+	unsigned char tail[8];
+	unsigned char header[HIST_CHUNK_HEADER];
+
+	if ( series->num_samples == 0 ) return FINS_RETVAL_SUCCESS;
+
+	XX_finslib_put_uint64( tail, series->acc );
+
+	num_bytes = series->num_bytes;
+	crc       = finslib_crc32( 0, series->buffer, series->num_bytes );
+
+	if ( series->acc_bits > 0 ) {
+
+		num_bytes += 8;
+		crc        = finslib_crc32( crc, tail, 8 );
+	}
+
+	memset( header, 0, HIST_CHUNK_HEADER );
+	memcpy( header, series->name, HIST_NAME_LEN );
+
+	header[12] = series->kind;
+	XX_finslib_put_uint32( header+16, series->num_samples );
+	XX_finslib_put_uint32( header+20, (uint32_t) num_bytes );
+	XX_finslib_put_uint64( header+24, (uint64_t) series->min_time );
+	XX_finslib_put_uint64( header+32, (uint64_t) series->max_time );
+	XX_finslib_put_uint64( header+40, (uint64_t) series->first_time );
+	XX_finslib_put_uint32( header+48, crc );
+	XX_finslib_put_uint32( header+52, finslib_crc32( 0, header, 52 ) );
+
+	if ( ( start = ftell( historian->fp ) ) < 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fwrite( header,         1, HIST_CHUNK_HEADER, historian->fp ) != HIST_CHUNK_HEADER  ||
+	     fwrite( series->buffer, 1, series->num_bytes, historian->fp ) != series->num_bytes  ||
+	     ( series->acc_bits > 0  &&  fwrite( tail, 1, 8, historian->fp ) != 8 ) ) {
+
+		retval = FINS_RETVAL_ERRNO_BASE + errno;
+		fseek( historian->fp, start, SEEK_SET );
+
+		return retval;
+	}
+
+	series->num_samples = 0;
+	series->num_bytes   = 0;
+	series->acc         = 0;
+	series->acc_bits    = 0;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* write_chunk */
+
+/*
+ * int finslib_historian_flush( struct fins_historian_tp *historian );
+ *
+ * The function finslib_historian_flush() writes the chunks of all tags which
+ * contain samples to the history file, even if they are not full, and flushes
+ * the file. Frequent flushing makes the samples visible to readers sooner but
+ * leads to smaller chunks which compress less well.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_historian_flush( struct fins_historian_tp *historian ) {
+
+	int retval;
+	size_t a;
+
+	if ( historian == NULL ) return FINS_RETVAL_HISTORY_INVALID;
+
+	for (a=0; a<historian->num_series; a++) {
+
+		if ( ( retval = write_chunk( historian, & historian->series[a] ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	if ( fflush( historian->fp ) != 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_historian_flush */
+
+/*
+ * void finslib_historian_close( struct fins_historian_tp *historian );
+ *
+ * The function finslib_historian_close() writes the remaining samples to the
+ * history file and closes it. Errors can not be reported, so an application
+ * which must know that all samples were written should call
+ * finslib_historian_flush() first.
+ */
+
+void finslib_historian_close( struct fins_historian_tp *historian ) {
+
+	size_t a;
+
+	if ( historian == NULL ) return;
+
+	finslib_historian_flush( historian );
+	fclose( historian->fp );
+
+	for (a=0; a<historian->num_series; a++) free( historian->series[a].buffer );
+
+	if ( historian->series != NULL ) free( historian->series );
+	if ( historian->slot   != NULL ) free( historian->slot   );
+
+	free( historian );
+
+}  /* finslib_historian_close */
+
+/*
+ * struct fins_history_tp *finslib_history_open( const char *filename, int *error_val );
+ *
+ * The function finslib_history_open() maps a history file in memory for
+ * queries and builds the time index of its chunks. Only the chunks which were
+ * completely written when the file was opened are visible. On error NULL is
+ * returned and the reason is stored in the error_val parameter if that is not
+ * NULL.
+ */
+
+struct fins_history_tp *finslib_history_open( const char *filename, int *error_val ) {
+
+	int retval;
+	struct fins_history_tp *history;
+#if defined(_WIN32)
+	LARGE_INTEGER file_size;
+#else  /* defined(_WIN32) */
+	int fd;
+	struct stat st;
+	void *base;
+#endif  /* defined(_WIN32) */
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( filename == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_INVALID_FILENAME;
+		return NULL;
+	}
+
+	history = calloc( 1, sizeof(struct fins_history_tp) );
+
+	if ( history == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+#if defined(_WIN32)
+
+	history->file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if ( history->file == INVALID_HANDLE_VALUE  ||  ! GetFileSizeEx( history->file, & file_size )  ||  file_size.QuadPart < HIST_HEADER ) {
+
+		if ( history->file != INVALID_HANDLE_VALUE ) CloseHandle( history->file );
+		free( history );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_HISTORY_INVALID;
+		return NULL;
+	}
+
+	history->size    = (size_t) file_size.QuadPart;
+	history->mapping = CreateFileMappingA( history->file, NULL, PAGE_READONLY, 0, 0, NULL );
+	history->base    = ( history->mapping != NULL ) ? MapViewOfFile( history->mapping, FILE_MAP_READ, 0, 0, history->size ) : NULL;
+
+	if ( history->base == NULL ) {
+
+		if ( history->mapping != NULL ) CloseHandle( history->mapping );
+		CloseHandle( history->file );
+		free( history );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_HISTORY_INVALID;
+		return NULL;
+	}
+
+#else  /* defined(_WIN32) */
+
+	fd = open( filename, O_RDONLY );
+
+	if ( fd < 0 ) {
+
+		free( history );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_ERRNO_BASE + errno;
+		return NULL;
+	}
+
+	if ( fstat( fd, & st ) != 0  ||  st.st_size < HIST_HEADER ) {
+
+		close( fd );
+		free( history );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_HISTORY_INVALID;
+		return NULL;
+	}
+
+	history->size = (size_t) st.st_size;
+	base          = mmap( NULL, history->size, PROT_READ, MAP_SHARED, fd, 0 );
+
+	close( fd );
+
+	if ( base == MAP_FAILED ) {
+
+		free( history );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_ERRNO_BASE + errno;
+		return NULL;
+	}
+
+	history->base = base;
+
+#endif  /* defined(_WIN32) */
+
+	if ( memcmp( history->base, "FINSHIS", 7 ) != 0  ||  history->base[7] != HIST_VERSION ) retval = FINS_RETVAL_HISTORY_INVALID;
+	else                                                                                   retval = build_index( history );
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		finslib_history_close( history );
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	return history;
+
+}  /* finslib_history_open */
+
+/*
+ * static int build_index( struct fins_history_tp *history );
+ *
+ * The function build_index() walks over the chunk headers of a mapped
+ * history file and builds an index of the chunks, sorted by tag and lowest
+ * time. The walk stops at the first chunk which is incomplete, which is a
+ * chunk the writer is still working on.
+ */
+
+static int build_index( struct fins_history_tp *history ) {
+
+	size_t pos;
+	size_t num_bytes;
+	size_t max_chunks;
+	const unsigned char *header;
+	struct index_tp *index;
+	struct index_tp *chunk;
+
+	max_chunks = 0;
+	pos        = HIST_HEADER;
+
+	while ( pos + HIST_CHUNK_HEADER <= history->size ) {
+
+		header = history->base + pos;
+
+		if ( finslib_crc32( 0, header, 52 ) != XX_finslib_get_uint32( header+52 ) ) break;
+
+		num_bytes = XX_finslib_get_uint32( header+20 );
+
+		if ( num_bytes > history->size - pos - HIST_CHUNK_HEADER ) break;
+
+		if ( history->num_chunks >= max_chunks ) {
+
+			max_chunks = ( max_chunks == 0 ) ? 64 : 2 * max_chunks;
+			index      = realloc( history->index, max_chunks * sizeof(struct index_tp) );
+
+			if ( index == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+			history->index = index;
+		}
+
+		chunk = & history->index[ history->num_chunks++ ];
+
+		memcpy( chunk->name, header, HIST_NAME_LEN );
+
+		chunk->kind        = header[12];
+		chunk->num_samples = XX_finslib_get_uint32( header+16 );
+		chunk->min_time    = (int64_t) XX_finslib_get_uint64( header+24 );
+		chunk->max_time    = (int64_t) XX_finslib_get_uint64( header+32 );
+		chunk->first_time  = (int64_t) XX_finslib_get_uint64( header+40 );
+		chunk->crc         = XX_finslib_get_uint32( header+48 );
+		chunk->offset      = pos + HIST_CHUNK_HEADER;
+		chunk->num_bytes   = num_bytes;
+
+		pos += HIST_CHUNK_HEADER + num_bytes;
+	}
+
+	if ( history->num_chunks > 1 ) qsort( history->index, history->num_chunks, sizeof(struct index_tp), compare_index );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_index */
+
+/*
+ * static int compare_index( const void *a, const void *b );
+ *
+ * The function compare_index() is the comparison function with which the
+ * chunk index is sorted on tag name, lowest time and position in the file.
+ */
+
+static int compare_index( const void *a, const void *b ) {
+
+	int cmp;
+	const struct index_tp *ia;
+	const struct index_tp *ib;
+
+	ia = a;
+	ib = b;
+
+	if ( ( cmp = memcmp( ia->name, ib->name, HIST_NAME_LEN ) ) != 0 ) return cmp;
+
+	if ( ia->min_time != ib->min_time ) return ( ia->min_time < ib->min_time ) ? -1 : 1;
+	if ( ia->offset   != ib->offset   ) return ( ia->offset   < ib->offset   ) ? -1 : 1;
+
+	return 0;
+
+}  /* compare_index */
+
+/*
+ * void finslib_history_close( struct fins_history_tp *history );
+ *
+ * The function finslib_history_close() unmaps a history file and releases
+ * its index.
+ */
+
+void finslib_history_close( struct fins_history_tp *history ) {
+
+	if ( history == NULL ) return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile( history->base );
+	CloseHandle( history->mapping );
+	CloseHandle( history->file );
+#else  /* defined(_WIN32) */
+	munmap( history->base, history->size );
+#endif  /* defined(_WIN32) */
+
+	if ( history->index != NULL ) free( history->index );
+
+	free( history );
+
+}  /* finslib_history_close */
+
+/*
+ * int finslib_history_query( const struct fins_history_tp *history, const char *tag, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples );
+ *
+ * The function finslib_history_query() returns the samples of a tag with a
+ * time from from_msec up to but not including to_msec. The chunks of the tag
+ * are found with a binary search in the index and only the chunks which
+ * overlap the time range are decompressed. At most max_samples samples are
+ * returned. If the buffer is full the query can be continued from the time of
+ * the last sample returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_history_query( const struct fins_history_tp *history, const char *tag, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples ) {
+
+	int retval;
+	size_t low;
+	size_t high;
+	size_t mid;
+	size_t len;
+	char key[HIST_NAME_LEN];
+	const struct index_tp *chunk;
+
+	if ( num_samples != NULL ) *num_samples = 0;
+
+	if ( history     == NULL                          ) return FINS_RETVAL_HISTORY_INVALID;
+	if ( tag         == NULL                          ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( samples     == NULL  ||  num_samples == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( ( len = strlen( tag ) ) > HIST_NAME_LEN      ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	memset( key, 0, HIST_NAME_LEN );
+	memcpy( key, tag, len );
+
+	low  = 0;
+	high = history->num_chunks;
+
+	while ( low < high ) {
+
+		mid = low + ( high - low ) / 2;
+
+		if ( memcmp( history->index[mid].name, key, HIST_NAME_LEN ) < 0 ) low  = mid + 1;
+		else                                                               high = mid;
+	}
+
+	for (; low < history->num_chunks  &&  *num_samples < max_samples; low++) {
+
+		chunk = & history->index[low];
+
+		if ( memcmp( chunk->name, key, HIST_NAME_LEN ) != 0 ) break;
+		if ( chunk->min_time >= to_msec                     ) break;
+		if ( chunk->max_time <  from_msec                   ) continue;
+
+		if ( ( retval = decode_chunk( history, chunk, from_msec, to_msec, samples, max_samples, num_samples ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_history_query */
+
+/*
+ * static int decode_chunk( const struct fins_history_tp *history, const struct index_tp *chunk, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples );
+ *
+ * The function decode_chunk() decompresses the samples of a chunk and adds
+ * those within the time range to the list of samples.
+ */
+
+static int decode_chunk( const struct fins_history_tp *history, const struct index_tp *chunk, int64_t from_msec, int64_t to_msec, struct fins_sample_tp *samples, size_t max_samples, size_t *num_samples ) {
+
+	uint32_t a;
+	int leading;
+	int trailing;
+	int length;
+	int64_t time_msec;
+	int64_t delta;
+	int64_t change;
+	uint64_t value;
+	struct bitreader_tp reader;
+
+	if ( finslib_crc32( 0, history->base + chunk->offset, chunk->num_bytes ) != chunk->crc ) return FINS_RETVAL_HISTORY_INVALID;
+
+	reader.data     = history->base + chunk->offset;
+	reader.num_bits = 8 * chunk->num_bytes;
+	reader.pos      = 0;
+	reader.error    = false;
+
+	time_msec = chunk->first_time;
+	delta     = 0;
+	change    = 0;
+	leading   = 0;
+	trailing  = 0;
+	value     = get_bits( & reader, 64 );
+
+	for (a=0; a<chunk->num_samples  &&  *num_samples < max_samples; a++) {
+
+		if ( a > 0 ) {
+
+			delta     += get_dod( & reader );
+			time_msec += delta;
+
+			if ( chunk->kind == HIST_KIND_INT ) {
+
+				change += get_dod( & reader );
+				value  += (uint64_t) change;
+			}
+
+			else if ( get_bits( & reader, 1 ) != 0 ) {
+
+				if ( get_bits( & reader, 1 ) != 0 ) {
+
+					leading  = (int) get_bits( & reader, 5 );
+					length   = (int) get_bits( & reader, 6 );
+					if ( length == 0 ) length = 64;
+					trailing = 64 - leading - length;
+
+					if ( trailing < 0 ) return FINS_RETVAL_HISTORY_INVALID;
+				}
+
+				value ^= get_bits( & reader, (unsigned) ( 64 - leading - trailing ) ) << trailing;
+			}
+		}
+
+		if ( reader.error ) return FINS_RETVAL_HISTORY_INVALID;
+
+		if ( time_msec < from_msec  ||  time_msec >= to_msec ) continue;
+
+		samples[*num_samples].time_msec = time_msec;
+
+		if ( chunk->kind == HIST_KIND_INT ) samples[*num_samples].value = (double) (int64_t) value;
+		else                                memcpy( & samples[*num_samples].value, & value, sizeof(double) );
+
+		(*num_samples)++;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* decode_chunk */
+
+/*
+ * static int64_t get_dod( struct bitreader_tp *reader );
+ *
+ * The function get_dod() reads a difference between two successive
+ * differences stored by put_dod().
+ */
+
+static int64_t get_dod( struct bitreader_tp *reader ) {
+
+	if ( get_bits( reader, 1 ) == 0 ) return 0;
+	if ( get_bits( reader, 1 ) == 0 ) return (int64_t) get_bits( reader,  7 ) -   63;
+	if ( get_bits( reader, 1 ) == 0 ) return (int64_t) get_bits( reader,  9 ) -  255;
+	if ( get_bits( reader, 1 ) == 0 ) return (int64_t) get_bits( reader, 12 ) - 2047;
+
+	return (int64_t) get_bits( reader, 64 );
+
+}  /* get_dod */
+
+/*
+ * static uint64_t get_bits( struct bitreader_tp *reader, unsigned num_bits );
+ *
+ * The function get_bits() reads a number of bits from compressed data, most
+ * significant bit first. Reading past the end of the data sets the error flag
+ * and returns zero bits.
+ */
+
+static uint64_t get_bits( struct bitreader_tp *reader, unsigned num_bits ) {
+
+	unsigned avail;
+	unsigned take;
+	uint64_t value;
+
+	if ( num_bits > reader->num_bits - reader->pos ) {
+
+		reader->error = true;
+		return 0;
+	}
+
+	value = 0;
+
+	while ( num_bits > 0 ) {
+
+		avail = 8 - (unsigned) ( reader->pos & 7 );
+		take  = ( avail < num_bits ) ? avail : num_bits;
+
+		value        = ( value << take ) | ( ( reader->data[ reader->pos >> 3 ] >> ( avail - take ) ) & ( ( 1u << take ) - 1 ) );
+		reader->pos += take;
+		num_bits    -= take;
+	}
+
+	return value;
+
+}  /* get_bits */
+
+/*
+ * static int leading_zeros( uint64_t value );
+ *
+ * The function leading_zeros() returns the number of zero bits before the
+ * most significant one bit of a value which is not zero.
+ */
+
+static int leading_zeros( uint64_t value ) {
+
+#if defined(__GNUC__)
+	return __builtin_clzll( value );
+#else  /* defined(__GNUC__) */
+	int count;
+
+	for (count=0; ( value & ( (uint64_t) 1 << 63 ) ) == 0; count++) value <<= 1;
+
+	return count;
+#endif  /* defined(__GNUC__) */
+
+}  /* leading_zeros */
+
+/*
+ * static int trailing_zeros( uint64_t value );
+ *
+ * The function trailing_zeros() returns the number of zero bits after the
+ * least significant one bit of a value which is not zero.
+ */
+
+static int trailing_zeros( uint64_t value ) {
+
+#if defined(__GNUC__)
+	return __builtin_ctzll( value );
+#else  /* defined(__GNUC__) */
+	int count;
+
+	for (count=0; ( value & 1 ) == 0; count++) value >>= 1;
+
+	return count;
+#endif  /* defined(__GNUC__) */
+
+}  /* trailing_zeros */
@@ -0,0 +1,747 @@
+/*
+ * Library: libfins
+ * File:    src/fins_image.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_image.c contains routines to store the memory
+ * areas of a PLC in an image file and to access such a file without loading
+ * it. The image is written while the areas are read from the PLC with a
+ * number of read commands in flight at the same time. An image file is opened
+ * by mapping it in memory, which takes the same time for every file size. The
+ * words of an area can then be accessed directly in the mapped file.
+ *
+ * An image file starts with a 128 byte header containing the text "FINSIMG",
+ * a version byte, the model and version of the CPU unit each padded with
+ * zeros to 24 bytes, the wall clock time at which the image was made as a 64
+ * bit number, the number of areas, the offset of the area directory and the
+ * FINS mode of the PLC. The area directory has a 32 byte entry for every area
+ * with the area name padded with zeros to 4 bytes, the FINS area code, three
+ * reserved bytes, the first word address, the number of words, the CRC-32 of
+ * the data, four reserved bytes and the offset of the data in the file as a
+ * 64 bit number. The data of every area starts at a multiple of IMAGE_ALIGN
+ * bytes and contains the words as received from the PLC. All numbers are
+ * stored most significant byte first.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+#define IMAGE_VERSION		0x01
+#define IMAGE_HEADER		128
+#define IMAGE_ENTRY		32
+#define IMAGE_ALIGN		4096
+#define IMAGE_MAX_AREAS		32
+#define IMAGE_NAME_LEN		24
+
+									/********************************************************/
+struct fins_image_tp {							/*							*/
+	unsigned char *		base;					/* Start of the mapped file				*/
+	size_t			size;					/* Size of the mapped file				*/
+	size_t			num_areas;				/* Number of areas in the directory			*/
+#if defined(_WIN32)							/*							*/
+	HANDLE			file;					/* Handle of the image file				*/
+	HANDLE			mapping;				/* Handle of the file mapping				*/
+#endif									/*							*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct entry_tp {							/*							*/
+	char			name[4];				/* Name of the area					*/
+	struct fins_memaddr_tp	memaddr;				/* Address handle of the first word of the area		*/
+	uint8_t			area;					/* FINS area code					*/
+	uint32_t		first_word;				/* First word address					*/
+	size_t			num_words;				/* Number of words in the area				*/
+	uint32_t		crc;					/* CRC-32 of the data of the area			*/
+	uint64_t		offset;					/* Offset of the data in the file			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct writer_tp {							/*							*/
+	FILE *			fp;					/* The temporary image file				*/
+	struct entry_tp		entry[IMAGE_MAX_AREAS];			/* The areas in the image				*/
+	size_t			num_areas;				/* Number of areas in the image				*/
+	size_t			build_area;				/* Area of the next command to build			*/
+	size_t			build_word;				/* Word of the next command to build			*/
+	size_t			handle_area;				/* Area of the next response to handle			*/
+	size_t			handle_word;				/* Word of the next response to handle			*/
+	uint64_t		position;				/* Number of bytes written to the file			*/
+};									/*							*/
+									/********************************************************/
+
+static const char *default_area[] = { "CIO", "W", "H", "A", "TIM", "CNT", "DM", NULL };
+
+static int			add_area( struct fins_sys_tp *sys, struct writer_tp *writer, const char *name );
+static int			build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static void			get_entry( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area );
+static int			handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			pad_file( struct writer_tp *writer, uint64_t offset );
+static int			write_directory( struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, int plc_mode );
+static int			write_image( struct fins_sys_tp *sys, struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, size_t depth );
+
+/*
+ * int finslib_image_write( struct fins_sys_tp *sys, const char *filename, const char * const *areas, size_t num_areas, size_t depth );
+ *
+ * The function finslib_image_write() reads complete memory areas from a PLC
+ * and stores them in an image file. The areas are given by name, for example
+ * "DM" or "E3_". If areas is NULL, the CIO, W, H, A, TIM, CNT and DM areas
+ * and the non-file EM banks reported by the CPU unit are stored. At most
+ * depth read commands are in flight at the same time. The file is written
+ * under a temporary name and only gets its final name when complete.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_write( struct fins_sys_tp *sys, const char *filename, const char * const *areas, size_t num_areas, size_t depth ) {
+
+	int a;
+	int retval;
+	size_t b;
+	char name[4];
+	char temp[1024];
+	struct writer_tp writer;
+	struct fins_cpudata_tp cpudata;
+
+	if ( sys      == NULL                    ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( filename == NULL                    ) return FINS_RETVAL_IMAGE_INVALID;
+	if ( areas    == NULL  &&  num_areas > 0 ) return FINS_RETVAL_NO_READ_ADDRESS;
+
+	if ( ( retval = finslib_cpu_unit_data_read( sys, & cpudata ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	memset( & writer, 0, sizeof(writer) );
+
+	if ( areas == NULL ) {
+
+		for (a=0; default_area[a] != NULL; a++) {
+
+			if ( ( retval = add_area( sys, & writer, default_area[a] ) ) != FINS_RETVAL_SUCCESS  &&  retval != FINS_RETVAL_INVALID_READ_AREA ) return retval;
+		}
+
+		for (a=0; a<cpudata.em_non_file_memory_size  &&  a<16; a++) {
+
+			snprintf( name, sizeof(name), "E%X_", a );
+
+			if ( ( retval = add_area( sys, & writer, name ) ) != FINS_RETVAL_SUCCESS  &&  retval != FINS_RETVAL_INVALID_READ_AREA ) return retval;
+		}
+	}
+
+	else {
+		for (b=0; b<num_areas; b++) {
+
+			if ( ( retval = add_area( sys, & writer, areas[b] ) ) != FINS_RETVAL_SUCCESS ) return retval;
+		}
+	}
+
+	if ( (size_t) snprintf( temp, sizeof(temp), "%s.tmp", filename ) >= sizeof(temp) ) return FINS_RETVAL_INVALID_FILENAME;
+
+	writer.fp = fopen( temp, "w+b" );
+	if ( writer.fp == NULL ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	retval = write_image( sys, & writer, & cpudata, depth );
+
+	if ( fclose( writer.fp ) != 0  &&  retval == FINS_RETVAL_SUCCESS ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+#if defined(_WIN32)
+	if ( retval == FINS_RETVAL_SUCCESS ) remove( filename );
+#endif  /* defined(_WIN32) */
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  rename( temp, filename ) != 0 ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) remove( temp );
+
+	return retval;
+
+}  /* finslib_image_write */
+
+/*
+ * static int add_area( struct fins_sys_tp *sys, struct writer_tp *writer, const char *name );
+ *
+ * The function add_area() looks up a word area by name in the list of memory
+ * areas of the PLC type and adds it to the image. The data of every area is
+ * placed at the next aligned offset in the file.
+ */
+
+static int add_area( struct fins_sys_tp *sys, struct writer_tp *writer, const char *name ) {
+
+	size_t a;
+	uint64_t offset;
+	struct entry_tp *entry;
+	struct fins_address_tp address;
+	struct fins_memaddr_tp memaddr;
+	const struct fins_area_tp *area_ptr;
+
+	if ( name == NULL  ||  strlen( name ) > 3   ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( writer->num_areas >= IMAGE_MAX_AREAS   ) return FINS_RETVAL_BODY_TOO_LONG;
+
+	memset( & address, 0, sizeof(address) );
+	for (a=0; name[a]; a++) address.name[a] = (char) toupper( (unsigned char) name[a] );
+
+	for (a=0; a<writer->num_areas; a++) {
+
+		if ( strcmp( writer->entry[a].name, address.name ) == 0 ) return FINS_RETVAL_SUCCESS;
+	}
+
+	area_ptr = XX_finslib_search_area( sys, & address, 16, FI_RD, false );
+	if ( area_ptr == NULL ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	address.main_address = area_ptr->low_id;
+	if ( XX_finslib_resolve_memaddr( sys->plc_mode, & address, 16, FI_RD, & memaddr ) ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	if ( writer->num_areas == 0 ) offset = IMAGE_HEADER + IMAGE_MAX_AREAS * IMAGE_ENTRY;
+	else {
+		entry  = & writer->entry[ writer->num_areas-1 ];
+		offset = entry->offset + 2 * entry->num_words;
+	}
+
+	offset = ( offset + IMAGE_ALIGN - 1 ) / IMAGE_ALIGN * IMAGE_ALIGN;
+
+	entry = & writer->entry[ writer->num_areas++ ];
+
+	memcpy( entry->name, address.name, 4 );
+
+	entry->memaddr    = memaddr;
+	entry->area       = area_ptr->area;
+	entry->first_word = area_ptr->low_id;
+	entry->num_words  = area_ptr->high_id - area_ptr->low_id + 1;
+	entry->crc        = 0;
+	entry->offset     = offset;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* add_area */
+
+/*
+ * static int write_image( struct fins_sys_tp *sys, struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, size_t depth );
+ *
+ * The function write_image() streams the data of all areas from the PLC to
+ * the image file and writes the header and directory when all data is in.
+ */
+
+static int write_image( struct fins_sys_tp *sys, struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, size_t depth ) {
+
+	int retval;
+	size_t a;
+	size_t num_command;
+
+	num_command = 0;
+
+	for (a=0; a<writer->num_areas; a++) num_command += ( writer->entry[a].num_words + FINS_MAX_READ_WORDS_SYSWAY - 1 ) / FINS_MAX_READ_WORDS_SYSWAY;
+
+	if ( ( retval = XX_finslib_pipeline( sys, num_command, depth, build_read, handle_read, writer ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( ( retval = pad_file( writer, ( writer->position + IMAGE_ALIGN - 1 ) / IMAGE_ALIGN * IMAGE_ALIGN ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return write_directory( writer, cpudata, sys->plc_mode );
+
+}  /* write_image */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the command which reads the next chunk of
+ * words of the areas in the image.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	int retval;
+	size_t num_words;
+	struct entry_tp *entry;
+	struct writer_tp *writer;
+
+	(void) index;
+
+	writer = context;
+
+	if ( writer->build_area >= writer->num_areas ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+	entry     = & writer->entry[ writer->build_area ];
+	num_words = entry->num_words - writer->build_word;
+
+	if ( num_words > FINS_MAX_READ_WORDS_SYSWAY ) num_words = FINS_MAX_READ_WORDS_SYSWAY;
+
+	retval = XX_finslib_memory_area_read_word_command( sys, command, bodylen, & entry->memaddr, writer->build_word, num_words );
+
+	writer->build_word += num_words;
+
+	if ( writer->build_word >= entry->num_words ) {
+
+		writer->build_area++;
+		writer->build_word = 0;
+	}
+
+	return retval;
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() appends a chunk of words received from the PLC
+ * to the image file. The responses arrive in the order of the commands, so
+ * the file is written sequentially.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	int retval;
+	size_t num_words;
+	struct entry_tp *entry;
+	struct writer_tp *writer;
+
+	(void) sys;
+	(void) index;
+
+	writer    = context;
+	entry     = & writer->entry[ writer->handle_area ];
+	num_words = entry->num_words - writer->handle_word;
+
+	if ( num_words > FINS_MAX_READ_WORDS_SYSWAY ) num_words = FINS_MAX_READ_WORDS_SYSWAY;
+
+	if ( bodylen != 2 + 2*num_words ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	if ( writer->handle_word == 0  &&  ( retval = pad_file( writer, entry->offset ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( fwrite( & response->body[2], 1, 2*num_words, writer->fp ) != 2*num_words ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	entry->crc          = finslib_crc32( entry->crc, & response->body[2], 2*num_words );
+	writer->position   += 2*num_words;
+	writer->handle_word += num_words;
+
+	if ( writer->handle_word >= entry->num_words ) {
+
+		writer->handle_area++;
+		writer->handle_word = 0;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static int pad_file( struct writer_tp *writer, uint64_t offset );
+ *
+ * The function pad_file() writes zeros to the image file until the given
+ * offset has been reached.
+ */
+
+static int pad_file( struct writer_tp *writer, uint64_t offset ) {
+
+	size_t len;
+	static const unsigned char zero[IMAGE_ALIGN];
+
+	while ( writer->position < offset ) {
+
+		len = ( offset - writer->position > IMAGE_ALIGN ) ? IMAGE_ALIGN : (size_t) ( offset - writer->position );
+
+		if ( fwrite( zero, 1, len, writer->fp ) != len ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+		writer->position += len;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* pad_file */
+
+/*
+ * static int write_directory( struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, int plc_mode );
+ *
+ * The function write_directory() writes the header and area directory at the
+ * start of the image file, in the space which was left free for them.
+ */
+
+static int write_directory( struct writer_tp *writer, const struct fins_cpudata_tp *cpudata, int plc_mode ) {
+
+	size_t a;
+	unsigned char buf[IMAGE_HEADER];
+	struct entry_tp *entry;
+
+	memset( buf, 0, IMAGE_HEADER );
+
+	memcpy( buf, "FINSIMG", 7 );
+	buf[7] = IMAGE_VERSION;
+	strncpy( (char *) buf+8,  cpudata->model,   IMAGE_NAME_LEN-1 );
+	strncpy( (char *) buf+32, cpudata->version, IMAGE_NAME_LEN-1 );
+	XX_finslib_put_uint64( buf+56, (uint64_t) time( NULL ) );
+	XX_finslib_put_uint32( buf+64, (uint32_t) writer->num_areas );
+	XX_finslib_put_uint32( buf+68, IMAGE_HEADER );
+	XX_finslib_put_uint32( buf+72, (uint32_t) plc_mode );
+
+	if ( fseek( writer->fp, 0, SEEK_SET ) != 0                          ) return FINS_RETVAL_ERRNO_BASE + errno;
+	if ( fwrite( buf, 1, IMAGE_HEADER, writer->fp ) != IMAGE_HEADER     ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	for (a=0; a<writer->num_areas; a++) {
+
+		entry = & writer->entry[a];
+
+		memset( buf, 0, IMAGE_ENTRY );
+		memcpy( buf, entry->name, 4 );
+		buf[4] = entry->area;
+		XX_finslib_put_uint32( buf+ 8, entry->first_word );
+		XX_finslib_put_uint32( buf+12, (uint32_t) entry->num_words );
+		XX_finslib_put_uint32( buf+16, entry->crc );
+		XX_finslib_put_uint64( buf+24, entry->offset );
+
+		if ( fwrite( buf, 1, IMAGE_ENTRY, writer->fp ) != IMAGE_ENTRY ) return FINS_RETVAL_ERRNO_BASE + errno;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* write_directory */
+
+/*
+ * struct fins_image_tp *finslib_image_open( const char *filename, int *error_val );
+ *
+ * The function finslib_image_open() maps an image file in memory and checks
+ * its header and directory. The data itself is not read, so opening takes the
+ * same time for every file size. On error NULL is returned and the reason is
+ * stored in the error_val parameter if that is not NULL.
+ */
+
+struct fins_image_tp *finslib_image_open( const char *filename, int *error_val ) {
+
+	size_t a;
+	uint64_t offset;
+	uint64_t num_bytes;
+	const unsigned char *entry;
+	struct fins_image_tp *image;
+#if defined(_WIN32)
+	LARGE_INTEGER file_size;
+#else  /* defined(_WIN32) */
+	int fd;
+	struct stat st;
+	void *base;
+#endif  /* defined(_WIN32) */
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( filename == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+		return NULL;
+	}
+
+	image = calloc( 1, sizeof(struct fins_image_tp) );
+
+	if ( image == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+#if defined(_WIN32)
+
+	image->file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if ( image->file == INVALID_HANDLE_VALUE  ||  ! GetFileSizeEx( image->file, & file_size )  ||  file_size.QuadPart < IMAGE_HEADER ) {
+
+		if ( image->file != INVALID_HANDLE_VALUE ) CloseHandle( image->file );
+		free( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+		return NULL;
+	}
+
+	image->size    = (size_t) file_size.QuadPart;
+	image->mapping = CreateFileMappingA( image->file, NULL, PAGE_READONLY, 0, 0, NULL );
+	image->base    = ( image->mapping != NULL ) ? MapViewOfFile( image->mapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+
+	if ( image->base == NULL ) {
+
+		if ( image->mapping != NULL ) CloseHandle( image->mapping );
+		CloseHandle( image->file );
+		free( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+		return NULL;
+	}
+
+#else  /* defined(_WIN32) */
+
+	fd = open( filename, O_RDONLY );
+
+	if ( fd < 0 ) {
+
+		free( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_ERRNO_BASE + errno;
+		return NULL;
+	}
+
+	if ( fstat( fd, & st ) != 0  ||  st.st_size < IMAGE_HEADER ) {
+
+		close( fd );
+		free( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+		return NULL;
+	}
+
+	image->size = (size_t) st.st_size;
+	base        = mmap( NULL, image->size, PROT_READ, MAP_SHARED, fd, 0 );
+
+	close( fd );
+
+	if ( base == MAP_FAILED ) {
+
+		free( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_ERRNO_BASE + errno;
+		return NULL;
+	}
+
+	image->base = base;
+
+#endif  /* defined(_WIN32) */
+
+	image->num_areas = XX_finslib_get_uint32( image->base+64 );
+
+	if ( memcmp( image->base, "FINSIMG", 7 ) != 0                                                     ||
+	     image->base[7] != IMAGE_VERSION                                                              ||
+	     XX_finslib_get_uint32( image->base+68 ) != IMAGE_HEADER                                                 ||
+	     image->num_areas > ( image->size - IMAGE_HEADER ) / IMAGE_ENTRY                                  ) {
+
+		finslib_image_close( image );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+		return NULL;
+	}
+
+	for (a=0; a<image->num_areas; a++) {
+
+		entry     = image->base + IMAGE_HEADER + a*IMAGE_ENTRY;
+		offset    = XX_finslib_get_uint64( entry+24 );
+		num_bytes = 2 * (uint64_t) XX_finslib_get_uint32( entry+12 );
+
+		if ( entry[3] != 0  ||  offset > image->size  ||  num_bytes > image->size - offset ) {
+
+			finslib_image_close( image );
+			if ( error_val != NULL ) *error_val = FINS_RETVAL_IMAGE_INVALID;
+			return NULL;
+		}
+	}
+
+	return image;
+
+}  /* finslib_image_open */
+
+/*
+ * void finslib_image_close( struct fins_image_tp *image );
+ *
+ * The function finslib_image_close() unmaps an image file. Pointers to the
+ * data of the image are no longer valid afterwards.
+ */
+
+void finslib_image_close( struct fins_image_tp *image ) {
+
+	if ( image == NULL ) return;
+
+#if defined(_WIN32)
+	UnmapViewOfFile( image->base );
+	CloseHandle( image->mapping );
+	CloseHandle( image->file );
+#else  /* defined(_WIN32) */
+	munmap( image->base, image->size );
+#endif  /* defined(_WIN32) */
+
+	free( image );
+
+}  /* finslib_image_close */
+
+/*
+ * int finslib_image_info( const struct fins_image_tp *image, struct fins_imageinfo_tp *info );
+ *
+ * The function finslib_image_info() returns the information about the PLC
+ * from the header of an image file.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_info( const struct fins_image_tp *image, struct fins_imageinfo_tp *info ) {
+
+	if ( image == NULL ) return FINS_RETVAL_IMAGE_INVALID;
+	if ( info  == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	memcpy( info->model,   image->base+8,  20 );
+	memcpy( info->version, image->base+32, 20 );
+
+	info->model[20]   = 0;
+	info->version[20] = 0;
+	info->time        = (time_t) XX_finslib_get_uint64( image->base+56 );
+	info->plc_mode    = (int) XX_finslib_get_uint32( image->base+72 );
+	info->num_areas   = image->num_areas;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_image_info */
+
+/*
+ * int finslib_image_area( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area );
+ *
+ * The function finslib_image_area() returns the description of an area in an
+ * image by its position in the directory. This allows all areas of an image
+ * to be enumerated.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_area( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area ) {
+
+	if ( image == NULL              ) return FINS_RETVAL_IMAGE_INVALID;
+	if ( area  == NULL              ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( index >= image->num_areas  ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	get_entry( image, index, area );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_image_area */
+
+/*
+ * int finslib_image_find( const struct fins_image_tp *image, const char *name, struct fins_imagearea_tp *area );
+ *
+ * The function finslib_image_find() returns the description of an area in an
+ * image by its name. The data pointer in the description points directly in
+ * the mapped file.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_find( const struct fins_image_tp *image, const char *name, struct fins_imagearea_tp *area ) {
+
+	size_t a;
+	size_t b;
+	char upper[4];
+
+	if ( image == NULL                     ) return FINS_RETVAL_IMAGE_INVALID;
+	if ( area  == NULL                     ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( name  == NULL  ||  strlen( name ) > 3 ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	memset( upper, 0, 4 );
+	for (b=0; name[b]; b++) upper[b] = (char) toupper( (unsigned char) name[b] );
+
+	for (a=0; a<image->num_areas; a++) {
+
+		if ( memcmp( image->base + IMAGE_HEADER + a*IMAGE_ENTRY, upper, 4 ) == 0 ) {
+
+			get_entry( image, a, area );
+			return FINS_RETVAL_SUCCESS;
+		}
+	}
+
+	return FINS_RETVAL_INVALID_READ_AREA;
+
+}  /* finslib_image_find */
+
+/*
+ * int finslib_image_read_word( const struct fins_image_tp *image, const char *address, uint16_t *value );
+ *
+ * The function finslib_image_read_word() returns the value of one word in an
+ * image, for example "DM100" or "E2_5000".
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_read_word( const struct fins_image_tp *image, const char *address, uint16_t *value ) {
+
+	int retval;
+	size_t offset;
+	struct fins_address_tp decoded;
+	struct fins_imagearea_tp area;
+
+	if ( image   == NULL                                ) return FINS_RETVAL_IMAGE_INVALID;
+	if ( address == NULL                                ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( value   == NULL                                ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( XX_finslib_decode_address( address, & decoded ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	if ( ( retval = finslib_image_find( image, decoded.name, & area ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( decoded.main_address <  area.first_word                  ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( decoded.main_address >= area.first_word + area.num_words ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	offset = 2 * ( decoded.main_address - area.first_word );
+	*value = (uint16_t) ( ( area.data[offset] << 8 ) | area.data[offset+1] );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_image_read_word */
+
+/*
+ * int finslib_image_verify( const struct fins_image_tp *image );
+ *
+ * The function finslib_image_verify() checks the CRC-32 of the data of all
+ * areas in an image. This reads the complete file.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_image_verify( const struct fins_image_tp *image ) {
+
+	size_t a;
+	struct fins_imagearea_tp area;
+
+	if ( image == NULL ) return FINS_RETVAL_IMAGE_INVALID;
+
+	for (a=0; a<image->num_areas; a++) {
+
+		get_entry( image, a, & area );
+
+		if ( finslib_crc32( 0, area.data, 2*area.num_words ) != XX_finslib_get_uint32( image->base + IMAGE_HEADER + a*IMAGE_ENTRY + 16 ) ) return FINS_RETVAL_IMAGE_INVALID;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_image_verify */
+
+/*
+ * static void get_entry( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area );
+ *
+ * The function get_entry() decodes an entry of the area directory of an
+ * image.
+ */
+
+static void get_entry( const struct fins_image_tp *image, size_t index, struct fins_imagearea_tp *area ) {
+
+	const unsigned char *entry;
+
+	entry = image->base + IMAGE_HEADER + index*IMAGE_ENTRY;
+
+	memcpy( area->name, entry, 4 );
+
+	area->area       = entry[4];
+	area->first_word = XX_finslib_get_uint32( entry+ 8 );
+	area->num_words  = XX_finslib_get_uint32( entry+12 );
+	area->data       = image->base + XX_finslib_get_uint64( entry+24 );
+
+}  /* get_entry */
@@ -32,6 +32,7 @@
  * FINS protocol.
  */
 
+#include <string.h>
 #include "fins.h"
 
 /*
@@ -39,22 +40,54 @@
  *
  * The function XX_finslib_init_command() initializes a FINS command structure
  * which will be used to contain a command which is to be sent to a remote FINS
- * server like an Omron PLC.
+ * server like an Omron PLC. The fields which are the same for all commands on
+ * a connection are copied from the header prepared by XX_finslib_init_header().
+ * Applications may change the network, node and unit fields of a connection
+ * at any time. The prepared header is therefore compared with these fields
+ * first and built again when one of them differs.
  */
 
 void XX_finslib_init_command( struct fins_sys_tp *sys, struct fins_command_tp *command, uint8_t mrc, uint8_t src ) {
 
-	command->header[FINS_ICF] = 0x80;
-	command->header[FINS_RSV] = 0x00;
-	command->header[FINS_GCT] = 0x02;
-	command->header[FINS_DNA] = sys->remote_net;
-	command->header[FINS_DA1] = sys->remote_node;
-	command->header[FINS_DA2] = sys->remote_unit;
-	command->header[FINS_SNA] = sys->local_net;
-	command->header[FINS_SA1] = sys->local_node;
-	command->header[FINS_SA2] = sys->local_unit;
+	if ( sys->header[FINS_DNA] != sys->remote_net   ||
+	     sys->header[FINS_DA1] != sys->remote_node  ||
+	     sys->header[FINS_DA2] != sys->remote_unit  ||
+	     sys->header[FINS_SNA] != sys->local_net    ||
+	     sys->header[FINS_SA1] != sys->local_node   ||
+	     sys->header[FINS_SA2] != sys->local_unit      ) XX_finslib_init_header( sys );
+
+	memcpy( command->header, sys->header, FINS_SID );
+
 	command->header[FINS_SID] = sys->sid++;
 	command->header[FINS_MRC] = mrc;
 	command->header[FINS_SRC] = src;
 
+	XX_FINS_TRACE( sys, FINS_TRACE_BUILD, command->header, FINS_RETVAL_SUCCESS );
+
 } /* XX_finslib_init_command */
+
+/*
+ * void XX_finslib_init_header( struct fins_sys_tp *sys );
+ *
+ * The function XX_finslib_init_header() prepares the part of the FINS header
+ * which does not change between commands on a connection. It is called when
+ * a connection is prepared and again by XX_finslib_init_command() when the
+ * network, node or unit addresses in the connection have changed.
+ */
+
+void XX_finslib_init_header( struct fins_sys_tp *sys ) {
+
+	sys->header[FINS_ICF] = 0x80;
+	sys->header[FINS_RSV] = 0x00;
+	sys->header[FINS_GCT] = 0x02;
+	sys->header[FINS_DNA] = sys->remote_net;
+	sys->header[FINS_DA1] = sys->remote_node;
+	sys->header[FINS_DA2] = sys->remote_unit;
+	sys->header[FINS_SNA] = sys->local_net;
+	sys->header[FINS_SA1] = sys->local_node;
+	sys->header[FINS_SA2] = sys->local_unit;
+	sys->header[FINS_SID] = 0x00;
+	sys->header[FINS_MRC] = 0x00;
+	sys->header[FINS_SRC] = 0x00;
+
+} /* XX_finslib_init_header */
@@ -113,9 +113,67 @@ static void init_system( struct fins_sys_tp *sys, int error_max ) {
 	sys->error_max     = error_max;
 	sys->last_error    = FINS_RETVAL_SUCCESS;
 	sys->error_changed = false;
+	sys->cache         = NULL;
+	sys->stats         = NULL;
+	sys->trace         = NULL;
+	sys->capture       = NULL;
+	sys->dircache      = NULL;
+	sys->allocated     = false;
 
 }  /* init_system */
 
+/*
+ * int finslib_connection_init( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int error_max );
+ *
+ * The function finslib_connection_init() prepares a connection structure in
+ * memory provided by the caller. The structure can then be passed to
+ * finslib_tcp_connect() or finslib_udp_connect() which will use it instead of
+ * allocating a new one. This allows applications with a large number of PLCs
+ * to keep all connections in one array or pool without any allocation per
+ * connection. The memory is not released by finslib_disconnect().
+ *
+ * The memory must either be filled with zeros or hold a structure which was
+ * prepared earlier with this function. A structure with an open connection
+ * is rejected and must first be closed with finslib_disconnect(). Caches,
+ * statistics, traces and captures still attached to the structure are
+ * released before it is cleared.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_connection_init( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int error_max ) {
+
+	if ( sys     == NULL                     ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( address == NULL  ||  address[0] == 0 ) return FINS_RETVAL_NO_READ_ADDRESS;
+
+	if ( sys->comm_type != FINS_COMM_TYPE_UNKNOWN  &&  sys->sockfd != INVALID_SOCKET ) return FINS_RETVAL_STILL_CONNECTED;
+
+	if ( port < FINS_PORT_RESERVED  ||  port >= FINS_PORT_MAX ) port = FINS_DEFAULT_PORT;
+
+	finslib_cache_disable( sys );
+	finslib_stats_disable( sys );
+	finslib_trace_disable( sys );
+	finslib_capture_stop( sys );
+	finslib_dircache_disable( sys );
+
+	init_system( sys, error_max );
+
+	sys->port        = port;
+	sys->local_net   = local_net;
+	sys->local_node  = local_node;
+	sys->local_unit  = local_unit;
+	sys->remote_net  = remote_net;
+	sys->remote_node = remote_node;
+	sys->remote_unit = remote_unit;
+
+	snprintf( sys->address, 128, "%s", address );
+
+	XX_finslib_init_header( sys );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_connection_init */
+
 /*
  * int finslib_tcp_connect( const char *address, int port );
  *
@@ -137,6 +195,7 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 	int retval;
 	int keep_alive;
 	int new_error;
+	bool reconnect;
 	uint32_t command;
 	uint32_t errorcode;
 	struct sockaddr_in ws_addr;
@@ -151,6 +210,8 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 		return sys;
 	}
 
+	reconnect = ( sys != NULL );
+
 	if ( sys == NULL ) {
 
 		if ( port < FINS_PORT_RESERVED  ||  port >= FINS_PORT_MAX ) port = FINS_DEFAULT_PORT;
@@ -161,7 +222,7 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 			return NULL;
 		}
 
-		sys = malloc( sizeof(struct fins_sys_tp) );
+		sys = calloc( 1, sizeof(struct fins_sys_tp) );
 
 		if ( sys == NULL ) {
 
@@ -169,21 +230,13 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 			return NULL;
 		}
 
-		init_system( sys, error_max );
+		finslib_connection_init( sys, address, port, local_net, local_node, local_unit, remote_net, remote_node, remote_unit, error_max );
 
-		sys->comm_type   = FINS_COMM_TYPE_TCP;
-		sys->port        = port;
-		sys->local_net   = local_net;
-		sys->local_node  = local_node;
-		sys->local_unit  = local_unit;
-		sys->remote_net  = remote_net;
-		sys->remote_node = remote_node;
-		sys->remote_unit = remote_unit;
-
-		snprintf( sys->address, 128, "%s", address );
+		sys->allocated = true;
 	}
 
-	sys->sockfd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	sys->comm_type = FINS_COMM_TYPE_TCP;
+	sys->sockfd    = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
 
 	if ( sys->sockfd == INVALID_SOCKET ) return fins_close_socket_with_error( sys, error_val );
 
@@ -322,6 +375,10 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 	sys->local_node    = fins_tcp_header[19];
 	sys->remote_node   = fins_tcp_header[23];
 
+	XX_finslib_init_header( sys );
+
+	if ( reconnect ) XX_finslib_stats_reconnect( sys );
+
 	sys->error_changed = ( FINS_RETVAL_SUCCESS != sys->last_error );
 	sys->last_error    =   FINS_RETVAL_SUCCESS;
 
@@ -337,6 +394,7 @@ struct fins_sys_tp *finslib_tcp_connect( struct fins_sys_tp *sys, const char *ad
 
 struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t local_unit, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, int *error_val, int error_max ) {
 
+	bool reconnect;
 	struct sockaddr_in ws_addr;
 	struct timeval tv ={ 0 };
 
@@ -347,6 +405,8 @@ struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *ad
 		return sys;
 	}
 
+	reconnect = ( sys != NULL );
+
 	if ( sys == NULL ) {
 
 		if ( port < FINS_PORT_RESERVED  ||  port >= FINS_PORT_MAX ) port = FINS_DEFAULT_PORT;
@@ -357,7 +417,7 @@ struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *ad
 			return NULL;
 		}
 
-		sys = malloc( sizeof(struct fins_sys_tp) );
+		sys = calloc( 1, sizeof(struct fins_sys_tp) );
 
 		if ( sys == NULL ) {
 
@@ -365,21 +425,13 @@ struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *ad
 			return NULL;
 		}
 
-		init_system( sys, error_max );
-
-		sys->comm_type   = FINS_COMM_TYPE_UDP;
-		sys->port        = port;
-		sys->local_net   = local_net;
-		sys->local_node  = local_node;
-		sys->local_unit  = local_unit;
-		sys->remote_net  = remote_net;
-		sys->remote_node = remote_node;
-		sys->remote_unit = remote_unit;
+		finslib_connection_init( sys, address, port, local_net, local_node, local_unit, remote_net, remote_node, remote_unit, error_max );
 
-		snprintf( sys->address, 128, "%s", address );
+		sys->allocated = true;
 	}
 
-	sys->sockfd = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	sys->comm_type = FINS_COMM_TYPE_UDP;
+	sys->sockfd    = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
 
 	tv.tv_sec  = SEND_TIMEOUT;
 	tv.tv_usec = 0;
@@ -401,6 +453,8 @@ struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *ad
 
 	if ( bind( sys->sockfd, (struct sockaddr *) &ws_addr, sizeof(ws_addr) ) < 0 ) return fins_close_socket_with_error( sys, error_val );
 
+	if ( reconnect ) XX_finslib_stats_reconnect( sys );
+
 	return sys;
 
 }  /* finslib_udp_connect */
@@ -409,8 +463,9 @@ struct fins_sys_tp *finslib_udp_connect( struct fins_sys_tp *sys, const char *ad
  * void finslib_disconnect( fins_sys_tp *sys );
  *
  * The function finslib_disconnect() disconnects a FINS client connection
- * and frees the memory associated with it. The function will only return if
- * the action succeeded. Otherwise it may hang indefinitely.
+ * and frees the memory associated with it. A structure prepared by the caller
+ * with finslib_connection_init() is left in place. The function will only
+ * return if the action succeeded. Otherwise it may hang indefinitely.
  */
 
 void finslib_disconnect( struct fins_sys_tp *sys ) {
@@ -418,7 +473,13 @@ void finslib_disconnect( struct fins_sys_tp *sys ) {
 	if ( sys == NULL ) return;
 
 	fins_close_socket( sys );
-	free( sys );
+	finslib_cache_disable( sys );
+	finslib_stats_disable( sys );
+	finslib_trace_disable( sys );
+	finslib_capture_stop( sys );
+	finslib_dircache_disable( sys );
+
+	if ( sys->allocated ) free( sys );
 
 }  /* finslib_disconnect */
 
@@ -829,55 +890,38 @@ static int fins_recv_tcp_command( struct fins_sys_tp *sys, int total_len, struct
 }  /* fins_recv_tcp_command */
 
 /*
- * int XX_finslib_communicate( fins_sys_tp *sys, fins_command_tp *command, size_t *bodylen, bool wait_response );
+ * int XX_finslib_send_command( fins_sys_tp *sys, fins_command_tp *command, size_t bodylen );
  *
- * The function XX_finslib_communicate() is the function used by outside
- * routines to perform the actual communication with a FINS server. The
- * function both sends the command and receives the response and hides all the
- * details of the low level communication for the calling routine.
+ * The function XX_finslib_send_command() sends a FINS command to the remote
+ * PLC without waiting for the response. Together with the function
+ * XX_finslib_recv_response() it allows callers to have more than one command
+ * in flight on a single connection. Responses are matched with their command
+ * through the Service ID in the header.
  *
  * The function returns a success or error code from the list FINS_RETVAL_...
  */
 
-int XX_finslib_communicate( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, bool wait_response ) {
+int XX_finslib_send_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t bodylen ) {
 
-	int a;
-	int recvlen;
 	int retval;
 	int error_val;
-	socklen_t addrlen;
-	uint16_t endcode;
-	unsigned char sent_header[FINS_HEADER_LEN] ={ 0 };
-	unsigned char waste_buffer[BUFLEN];
 	struct sockaddr_in cs_addr;
 
 	if ( sys         == NULL           ) return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED   );
 	if ( command     == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND        );
-	if ( bodylen     == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND_LENGTH );
 	if ( sys->sockfd == INVALID_SOCKET ) return check_error_count( sys, FINS_RETVAL_NOT_CONNECTED     );
 
-	error_val = FINS_RETVAL_SUCCESS;
-
-	for (a=0; a<FINS_HEADER_LEN; a++) sent_header[a] = command->header[a];
-
-
+	XX_FINS_TRACE( sys, FINS_TRACE_SEND_START, command->header, FINS_RETVAL_SUCCESS );
 
 	if ( sys->comm_type == FINS_COMM_TYPE_TCP ) {
 
-		if ( ( retval = fins_send_tcp_header(  sys, *bodylen          ) ) != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
-		if ( ( retval = fins_send_tcp_command( sys, *bodylen, command ) ) != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
-
-		if ( ! wait_response ) return FINS_RETVAL_SUCCESS;
+		retval = fins_send_tcp_header( sys, bodylen );
+		if ( retval == FINS_RETVAL_SUCCESS ) retval = fins_send_tcp_command( sys, bodylen, command );
 
-		recvlen = fins_recv_tcp_header( sys, & error_val );
-
-		if ( recvlen <  0 ) return check_error_count( sys, error_val                  );
-		if ( recvlen == 0 ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
-
-		if ( ( retval = fins_recv_tcp_command( sys, recvlen, command ) ) != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
+		return XX_finslib_send_complete( sys, command, bodylen, retval );
 	}
 
-	else if ( sys->comm_type == FINS_COMM_TYPE_UDP ) {
+	if ( sys->comm_type == FINS_COMM_TYPE_UDP ) {
 
 		memset( & cs_addr, 0, sizeof(cs_addr) );
 
@@ -905,9 +949,73 @@ int XX_finslib_communicate( struct fins_sys_tp *sys, struct fins_command_tp *com
 			return error_val;
 		}
 
-		if ( ( retval = fins_send_udp_command( sys, *bodylen, command, & cs_addr ) ) != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
+		retval = fins_send_udp_command( sys, bodylen, command, & cs_addr );
+
+		return XX_finslib_send_complete( sys, command, bodylen, retval );
+	}
+
+	return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED );
+
+}  /* XX_finslib_send_command */
+
+/*
+ * int XX_finslib_send_complete( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen, int retval );
+ *
+ * The function XX_finslib_send_complete() finishes the transmission of a
+ * command after the I/O itself has been done with result retval. Tracing,
+ * capturing and the error counter of the connection are updated. The function
+ * is shared by XX_finslib_send_command() and the I/O backends which send
+ * commands for more than one connection in one batch.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_send_complete( struct fins_sys_tp *sys, const struct fins_command_tp *command, size_t bodylen, int retval ) {
+
+	if ( sys     == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( command == NULL ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND );
+
+	XX_FINS_TRACE( sys, FINS_TRACE_SEND_END, command->header, retval );
+
+	if ( retval != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
+
+	if ( sys->capture != NULL ) XX_finslib_capture( sys, FINS_CAPTURE_SENT, command, bodylen );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_send_complete */
+
+/*
+ * int XX_finslib_recv_response( fins_sys_tp *sys, const unsigned char *sent_header, fins_command_tp *response, size_t *bodylen );
+ *
+ * The function XX_finslib_recv_response() receives the next response frame
+ * from the remote PLC. No check is done if the frame belongs to a specific
+ * command. That is the task of the calling routine which can use the function
+ * XX_finslib_check_response() for that purpose. On success the length of the
+ * received body is returned in the bodylen parameter. The sent_header is the
+ * header of the oldest command waiting for a response, or NULL if unknown.
+ * It only labels the trace events recorded before the header of the response
+ * itself is available.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_recv_response( struct fins_sys_tp *sys, const unsigned char *sent_header, struct fins_command_tp *response, size_t *bodylen ) {
+
+	int recvlen;
+	int retval;
+	int error_val;
+	socklen_t addrlen;
+	struct sockaddr_in cs_addr;
+
+	if ( sys         == NULL           ) return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED   );
+	if ( response    == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND        );
+	if ( bodylen     == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND_LENGTH );
+	if ( sys->sockfd == INVALID_SOCKET ) return check_error_count( sys, FINS_RETVAL_NOT_CONNECTED     );
+
+	error_val = FINS_RETVAL_SUCCESS;
 
-		if ( ! wait_response ) return FINS_RETVAL_SUCCESS;
+	if ( sys->comm_type == FINS_COMM_TYPE_UDP ) {
 
 		/* Receive the data in the FINS command structure
 		 * Header and body have a total length of FINS_HEADER_LEN + FINS_BODY_LEN
@@ -922,48 +1030,200 @@ int XX_finslib_communicate( struct fins_sys_tp *sys, struct fins_command_tp *com
 #endif
 
 		addrlen = sizeof( cs_addr );
-		recvlen = recvfrom( sys->sockfd, command->header, MAX_MSG, 0, (struct sockaddr*)&cs_addr, &addrlen);
+		recvlen = recvfrom( sys->sockfd, response->header, MAX_MSG, 0, (struct sockaddr*)&cs_addr, &addrlen);
 
 #if defined(_MSC_VER)
 #pragma warning(pop)
 #endif
 
-		if ( recvlen < 0               ) return check_error_count( sys, FINS_RETVAL_ERRNO_BASE + errno );
-		if ( recvlen < FINS_HEADER_LEN ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT     );
+		return XX_finslib_recv_complete( sys, sent_header, response, recvlen, ( recvlen < 0 ) ? FINS_RETVAL_ERRNO_BASE + errno : FINS_RETVAL_SUCCESS, bodylen );
 	}
 
-	else return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED );
+	if ( sys->comm_type != FINS_COMM_TYPE_TCP ) return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED );
 
+	recvlen = fins_recv_tcp_header( sys, & error_val );
 
+	XX_FINS_TRACE( sys, FINS_TRACE_RECV_FIRST, sent_header, ( recvlen < 0 ) ? error_val : FINS_RETVAL_SUCCESS );
 
-	if ( command->header[FINS_ICF]  !=  (sent_header[FINS_ICF] | 0x40)  ||
-	     command->header[FINS_RSV]  !=                           0x00   ||
-	     command->header[FINS_DNA]  !=   sent_header[FINS_SNA]          ||
-	     command->header[FINS_DA1]  !=   sent_header[FINS_SA1]          ||
-	     command->header[FINS_DA2]  !=   sent_header[FINS_SA2]          ||
-	     command->header[FINS_SNA]  !=   sent_header[FINS_DNA]          ||
-	     command->header[FINS_SA1]  !=   sent_header[FINS_DA1]          ||
-	     command->header[FINS_SA2]  !=   sent_header[FINS_DA2]          ||
-	     command->header[FINS_SID]  !=   sent_header[FINS_SID]          ||
-	     command->header[FINS_MRC]  !=   sent_header[FINS_MRC]          ||
-	     command->header[FINS_SRC]  !=   sent_header[FINS_SRC]              ) {
+	if ( recvlen <  0               ) return check_error_count( sys, error_val                  );
+	if ( recvlen == 0               ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
+
+	if ( ( retval = fins_recv_tcp_command( sys, recvlen, response ) ) != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval );
+
+	if ( recvlen <  FINS_HEADER_LEN ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
+
+	*bodylen = recvlen - FINS_HEADER_LEN;
+
+	XX_FINS_TRACE( sys, FINS_TRACE_RECV_END, response->header, FINS_RETVAL_SUCCESS );
+
+	if ( sys->capture != NULL ) XX_finslib_capture( sys, FINS_CAPTURE_RECEIVED, response, *bodylen );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_recv_response */
+
+/*
+ * int XX_finslib_recv_complete( struct fins_sys_tp *sys, const unsigned char *sent_header, const struct fins_command_tp *response, int recvlen, int retval, size_t *bodylen );
+ *
+ * The function XX_finslib_recv_complete() finishes the reception of a
+ * datagram of recvlen bytes which has been stored in response, or the failed
+ * attempt to receive one when retval is not FINS_RETVAL_SUCCESS. Tracing,
+ * capturing and the error counter of the connection are updated and the
+ * length of the body is returned in bodylen. The trace events are labeled
+ * with the header of the response, or with sent_header if no complete header
+ * was received. The function is shared by XX_finslib_recv_response() and the
+ * I/O backends which receive responses for more than one connection in one
+ * batch.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_recv_complete( struct fins_sys_tp *sys, const unsigned char *sent_header, const struct fins_command_tp *response, int recvlen, int retval, size_t *bodylen ) {
+
+#if ! defined(FINS_ENABLE_TRACE)
+	(void) sent_header;
+#endif  /* ! defined(FINS_ENABLE_TRACE) */
+
+	if ( sys      == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( response == NULL ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND        );
+	if ( bodylen  == NULL ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND_LENGTH );
+
+	XX_FINS_TRACE( sys, FINS_TRACE_RECV_FIRST, ( retval == FINS_RETVAL_SUCCESS  &&  recvlen >= FINS_HEADER_LEN ) ? response->header : sent_header, retval );
+
+	if ( retval  != FINS_RETVAL_SUCCESS ) return check_error_count( sys, retval                     );
+	if ( recvlen <  FINS_HEADER_LEN     ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
+
+	*bodylen = recvlen - FINS_HEADER_LEN;
+
+	XX_FINS_TRACE( sys, FINS_TRACE_RECV_END, response->header, FINS_RETVAL_SUCCESS );
+
+	if ( sys->capture != NULL ) XX_finslib_capture( sys, FINS_CAPTURE_RECEIVED, response, *bodylen );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_recv_complete */
+
+/*
+ * int XX_finslib_check_response( fins_sys_tp *sys, const unsigned char *sent_header, const fins_command_tp *response, size_t bodylen );
+ *
+ * The function XX_finslib_check_response() verifies that a received response
+ * matches the header of the command which was sent and returns the end code
+ * found in the response body. If the response doesn't match, any data still
+ * waiting on a TCP connection is flushed and a synchronization error is
+ * returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_check_response( struct fins_sys_tp *sys, const unsigned char *sent_header, const struct fins_command_tp *response, size_t bodylen ) {
+
+	uint16_t endcode;
+	unsigned char waste_buffer[BUFLEN];
+
+	if ( sys         == NULL ) return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED );
+	if ( sent_header == NULL ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND      );
+	if ( response    == NULL ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND      );
+
+	if ( response->header[FINS_ICF]  !=  (sent_header[FINS_ICF] | 0x40)  ||
+	     response->header[FINS_RSV]  !=                           0x00   ||
+	     response->header[FINS_DNA]  !=   sent_header[FINS_SNA]          ||
+	     response->header[FINS_DA1]  !=   sent_header[FINS_SA1]          ||
+	     response->header[FINS_DA2]  !=   sent_header[FINS_SA2]          ||
+	     response->header[FINS_SNA]  !=   sent_header[FINS_DNA]          ||
+	     response->header[FINS_SA1]  !=   sent_header[FINS_DA1]          ||
+	     response->header[FINS_SA2]  !=   sent_header[FINS_DA2]          ||
+	     response->header[FINS_SID]  !=   sent_header[FINS_SID]          ||
+	     response->header[FINS_MRC]  !=   sent_header[FINS_MRC]          ||
+	     response->header[FINS_SRC]  !=   sent_header[FINS_SRC]              ) {
 
 		if ( sys->comm_type == FINS_COMM_TYPE_TCP ) while ( fins_tcp_recv( sys, waste_buffer, BUFLEN ) > 0 ) {};
 
 		return check_error_count( sys, FINS_RETVAL_SYNC_ERROR );
 	}
 
-	recvlen -= FINS_HEADER_LEN;
-	*bodylen = recvlen;
+	if ( bodylen < 2 ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
 
-	if ( recvlen < 2 ) return check_error_count( sys, FINS_RETVAL_BODY_TOO_SHORT );
-
-	endcode   = command->body[0] & 0x7f;
+	endcode   = response->body[0] & 0x7f;
 	endcode <<= 8;
-	endcode  += command->body[1] & 0x3f;
+	endcode  += response->body[1] & 0x3f;
+
+	XX_FINS_TRACE( sys, FINS_TRACE_DECODE_END, response->header, endcode );
 
 	return check_error_count( sys, endcode );
 
+}  /* XX_finslib_check_response */
+
+/*
+ * int XX_finslib_communicate( fins_sys_tp *sys, fins_command_tp *command, size_t *bodylen, bool wait_response );
+ *
+ * The function XX_finslib_communicate() is the function used by outside
+ * routines to perform the actual communication with a FINS server. The
+ * function both sends the command and receives the response and hides all the
+ * details of the low level communication for the calling routine.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_communicate( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, bool wait_response ) {
+
+	int a;
+	int retval;
+	size_t sent_len;
+	size_t recv_len;
+	int64_t start_time;
+	unsigned char sent_header[FINS_HEADER_LEN] ={ 0 };
+	unsigned char sent_body[6] ={ 0 };
+
+	if ( sys         == NULL           ) return check_error_count( sys, FINS_RETVAL_NOT_INITIALIZED   );
+	if ( command     == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND        );
+	if ( bodylen     == NULL           ) return check_error_count( sys, FINS_RETVAL_NO_COMMAND_LENGTH );
+	if ( sys->sockfd == INVALID_SOCKET ) return check_error_count( sys, FINS_RETVAL_NOT_CONNECTED     );
+
+	if ( sys->cache != NULL ) {
+
+		if ( wait_response  &&  XX_finslib_cache_lookup( sys, command, bodylen ) ) {
+
+			XX_finslib_stats_command( sys, command->header, 0, 0, 0, FINS_RETVAL_SUCCESS, true );
+			return FINS_RETVAL_SUCCESS;
+		}
+
+		XX_finslib_cache_invalidate( sys, command, *bodylen );
+
+		for (a=0; a<6  &&  a<(int)*bodylen; a++) sent_body[a] = command->body[a];
+	}
+
+	if ( sys->dircache != NULL ) XX_finslib_dircache_invalidate( sys, command, *bodylen );
+
+	for (a=0; a<FINS_HEADER_LEN; a++) sent_header[a] = command->header[a];
+
+	sent_len   = 0;
+	recv_len   = 0;
+	start_time = ( sys->stats != NULL ) ? finslib_monotonic_nsec_timer() : 0;
+
+	retval = XX_finslib_send_command( sys, command, *bodylen );
+
+	if ( retval == FINS_RETVAL_SUCCESS ) {
+
+		sent_len = FINS_HEADER_LEN + *bodylen;
+
+		if ( wait_response ) {
+
+			retval = XX_finslib_recv_response( sys, sent_header, command, bodylen );
+
+			if ( retval == FINS_RETVAL_SUCCESS ) {
+
+				recv_len = FINS_HEADER_LEN + *bodylen;
+				retval   = XX_finslib_check_response( sys, sent_header, command, *bodylen );
+			}
+		}
+	}
+
+	if ( sys->stats != NULL ) XX_finslib_stats_command( sys, sent_header, sent_len, recv_len, finslib_monotonic_nsec_timer() - start_time, retval, false );
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  wait_response  &&  sys->cache != NULL ) XX_finslib_cache_store( sys, sent_body, command, *bodylen );
+
+	return retval;
+
 }  /* XX_finslib_communicate */
 
 /*
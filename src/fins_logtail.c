@@ -0,0 +1,417 @@
+/*
+ * Library: libfins
+ * File:    src/fins_logtail.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_logtail.c contains routines to follow the error
+ * log and the write access log of a remote PLC. Instead of reading the whole
+ * log at every poll, the number of records already seen and a copy of the
+ * last record are kept in a tail structure owned by the caller. A poll reads
+ * that last record again to check that the log still continues from there,
+ * and then fetches only the new records with several read commands in flight.
+ *
+ * When a log is full, the PLC drops the oldest record for every new one and
+ * the number of stored records no longer changes. A log can also be cleared
+ * with the commands 21 03 and 21 41. In both cases the record at the old
+ * position differs from the copy in the tail. The whole log is then read and
+ * the records after the last one seen are delivered.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+									/********************************************************/
+struct tail_tp {							/*							*/
+	struct fins_logtail_tp *tail;					/* Paging state of the caller				*/
+	uint8_t			src;					/* Sub request code of the log read command		*/
+	size_t			record_len;				/* Number of bytes in one log record			*/
+	fins_errorlog_callback_tp  error_callback;			/* Function receiving error log records			*/
+	fins_accesslog_callback_tp access_callback;			/* Function receiving access log records		*/
+	void *			context;				/* Parameter passed to the callback function		*/
+	unsigned char *		buffer;					/* Records from base up to stored			*/
+	size_t			base;					/* Record number of the first record in the buffer	*/
+	size_t			stored;					/* Number of records stored in the PLC			*/
+	size_t			build_record;				/* First record of the next command to build		*/
+	size_t			handle_record;				/* First record of the next response to handle		*/
+};									/*							*/
+									/********************************************************/
+
+static void			build_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint8_t src, size_t start_record, size_t num_records );
+static int			build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			deliver( struct tail_tp *tail, size_t first, size_t *num_new );
+static int			handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			log_tail( struct fins_sys_tp *sys, struct tail_tp *tail, size_t depth, size_t *num_new );
+static int			probe( struct fins_sys_tp *sys, struct tail_tp *tail, size_t start_record, struct fins_command_tp *command, size_t *num_records );
+
+/*
+ * void finslib_log_tail_reset( struct fins_logtail_tp *tail );
+ *
+ * The function finslib_log_tail_reset() initializes a tail structure. The
+ * next poll with the structure delivers all records in the log.
+ */
+
+void finslib_log_tail_reset( struct fins_logtail_tp *tail ) {
+
+	if ( tail == NULL ) return;
+
+	memset( tail, 0, sizeof(struct fins_logtail_tp) );
+
+}  /* finslib_log_tail_reset */
+
+/*
+ * int finslib_error_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_errorlog_callback_tp callback, void *context, size_t depth, size_t *num_new );
+ *
+ * The function finslib_error_log_tail() passes the records which were added
+ * to the error log of a remote PLC since the previous call with the same tail
+ * structure to the callback function, oldest first. At most depth read
+ * commands are in flight at the same time. If num_new is not NULL the number
+ * of records delivered is stored there.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_error_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_errorlog_callback_tp callback, void *context, size_t depth, size_t *num_new ) {
+
+	struct tail_tp state;
+
+	if ( num_new     != NULL           ) *num_new = 0;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( tail        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( callback    == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	memset( & state, 0, sizeof(state) );
+
+	state.tail           = tail;
+	state.src            = 0x02;
+	state.record_len     = FINS_ERRORLOG_RECORD_LEN;
+	state.error_callback = callback;
+	state.context        = context;
+
+	return log_tail( sys, & state, depth, num_new );
+
+}  /* finslib_error_log_tail */
+
+/*
+ * int finslib_access_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_accesslog_callback_tp callback, void *context, size_t depth, size_t *num_new );
+ *
+ * The function finslib_access_log_tail() passes the records which were added
+ * to the write access log of a remote PLC since the previous call with the
+ * same tail structure to the callback function, oldest first. At most depth
+ * read commands are in flight at the same time. If num_new is not NULL the
+ * number of records delivered is stored there.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_access_log_tail( struct fins_sys_tp *sys, struct fins_logtail_tp *tail, fins_accesslog_callback_tp callback, void *context, size_t depth, size_t *num_new ) {
+
+	struct tail_tp state;
+
+	if ( num_new     != NULL           ) *num_new = 0;
+	if ( sys         == NULL           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( tail        == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( callback    == NULL           ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->sockfd == INVALID_SOCKET ) return FINS_RETVAL_NOT_CONNECTED;
+
+	memset( & state, 0, sizeof(state) );
+
+	state.tail            = tail;
+	state.src             = 0x40;
+	state.record_len      = FINS_ACCESSLOG_RECORD_LEN;
+	state.access_callback = callback;
+	state.context         = context;
+
+	return log_tail( sys, & state, depth, num_new );
+
+}  /* finslib_access_log_tail */
+
+/*
+ * static int log_tail( struct fins_sys_tp *sys, struct tail_tp *tail, size_t depth, size_t *num_new );
+ *
+ * The function log_tail() reads the new records of a log and delivers them.
+ * The last record seen before is read first. If it is unchanged, only the
+ * records after it are fetched. Otherwise the log has wrapped or was cleared
+ * and the complete log is fetched to find where the new records start.
+ */
+
+static int log_tail( struct fins_sys_tp *sys, struct tail_tp *tail, size_t depth, size_t *num_new ) {
+
+	int retval;
+	bool search;
+	size_t start;
+	size_t num_records;
+	size_t num_command;
+	size_t first;
+	size_t a;
+	struct fins_command_tp command;
+
+	start = ( tail->tail->valid  &&  tail->tail->seen > 0 ) ? tail->tail->seen - 1 : 0;
+
+	retval = probe( sys, tail, start, & command, & num_records );
+
+	if ( retval == FINS_RETVAL_PARAM_START_ADDRESS_ERROR  &&  start > 0 ) {
+
+		start  = 0;
+		retval = probe( sys, tail, start, & command, & num_records );
+	}
+
+	if ( retval == FINS_RETVAL_PARAM_START_ADDRESS_ERROR ) tail->stored = 0;
+	else if ( retval != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( tail->stored == 0 ) {
+
+		finslib_log_tail_reset( tail->tail );
+		return FINS_RETVAL_SUCCESS;
+	}
+
+	search = false;
+
+	if ( tail->tail->valid ) {
+
+		if ( tail->stored < tail->tail->seen ) search = true;
+		if ( num_records  == 0               ) search = true;
+		else if ( memcmp( & command.body[8], tail->tail->last, tail->record_len ) != 0 ) search = true;
+	}
+
+	if ( search  &&  start > 0 ) {
+
+		tail->base  = 0;
+		num_records = 0;
+	}
+
+	else tail->base = start;
+
+	if ( tail->base + num_records > tail->stored ) num_records = tail->stored - tail->base;
+
+	tail->buffer = malloc( ( tail->stored - tail->base ) * tail->record_len );
+	if ( tail->buffer == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	memcpy( tail->buffer, & command.body[8], num_records * tail->record_len );
+
+	tail->build_record  = tail->base + num_records;
+	tail->handle_record = tail->base + num_records;
+	num_command         = ( tail->stored - tail->build_record + FINS_MAX_LOG_READ_RECORDS - 1 ) / FINS_MAX_LOG_READ_RECORDS;
+
+	retval = XX_finslib_pipeline( sys, num_command, depth, build_read, handle_read, tail );
+
+	if ( retval == FINS_RETVAL_SUCCESS ) {
+
+		first = 0;
+
+		if ( search ) {
+
+			for (a=tail->stored; a>tail->base; a--) {
+
+				if ( memcmp( tail->buffer + ( a - 1 - tail->base ) * tail->record_len, tail->tail->last, tail->record_len ) == 0 ) {
+
+					first = a;
+					break;
+				}
+			}
+		}
+
+		else if ( tail->tail->valid ) first = start + 1;
+
+		retval = deliver( tail, first, num_new );
+	}
+
+	free( tail->buffer );
+
+	return retval;
+
+}  /* log_tail */
+
+/*
+ * static int probe( struct fins_sys_tp *sys, struct tail_tp *tail, size_t start_record, struct fins_command_tp *command, size_t *num_records );
+ *
+ * The function probe() reads the first page of records of a log from the
+ * given record number. The response is left in the command structure and the
+ * number of records stored in the PLC is kept in the tail state.
+ */
+
+static int probe( struct fins_sys_tp *sys, struct tail_tp *tail, size_t start_record, struct fins_command_tp *command, size_t *num_records ) {
+
+	int retval;
+	size_t bodylen;
+
+	build_command( sys, command, & bodylen, tail->src, start_record, FINS_MAX_LOG_READ_RECORDS );
+
+	if ( ( retval = XX_finslib_communicate( sys, command, & bodylen, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( bodylen < 8 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	tail->stored = ( command->body[4] << 8 ) | command->body[5];
+	*num_records = ( command->body[6] << 8 ) | command->body[7];
+
+	if ( *num_records > FINS_MAX_LOG_READ_RECORDS           ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( bodylen < 8 + *num_records * tail->record_len ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* probe */
+
+/*
+ * static void build_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint8_t src, size_t start_record, size_t num_records );
+ *
+ * The function build_command() builds a command which reads a number of
+ * records from a log.
+ */
+
+static void build_command( struct fins_sys_tp *sys, struct fins_command_tp *command, size_t *bodylen, uint8_t src, size_t start_record, size_t num_records ) {
+
+	XX_finslib_init_command( sys, command, 0x21, src );
+
+	*bodylen = 0;
+
+	command->body[(*bodylen)++] = (start_record >> 8) & 0xff;
+	command->body[(*bodylen)++] = (start_record     ) & 0xff;
+	command->body[(*bodylen)++] = (num_records  >> 8) & 0xff;
+	command->body[(*bodylen)++] = (num_records      ) & 0xff;
+
+}  /* build_command */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the command which reads the next page of
+ * records of a log.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	size_t num_records;
+	struct tail_tp *tail;
+
+	(void) index;
+
+	tail = context;
+
+	if ( tail->build_record >= tail->stored ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+	num_records = tail->stored - tail->build_record;
+	if ( num_records > FINS_MAX_LOG_READ_RECORDS ) num_records = FINS_MAX_LOG_READ_RECORDS;
+
+	build_command( sys, command, bodylen, tail->src, tail->build_record, num_records );
+
+	tail->build_record += num_records;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() copies a page of records to the buffer. If the
+ * PLC returns fewer records than asked for, the log has shrunk since the
+ * first page was read and the remaining pages are not needed.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	size_t num_records;
+	size_t expected;
+	struct tail_tp *tail;
+
+	(void) sys;
+	(void) index;
+
+	tail = context;
+
+	if ( bodylen < 8 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	expected    = tail->stored - tail->handle_record;
+	num_records = ( response->body[6] << 8 ) | response->body[7];
+
+	if ( expected    > FINS_MAX_LOG_READ_RECORDS            ) expected = FINS_MAX_LOG_READ_RECORDS;
+	if ( num_records > expected                             ) return FINS_RETVAL_BODY_TOO_LONG;
+	if ( bodylen     < 8 + num_records * tail->record_len   ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	memcpy( tail->buffer + ( tail->handle_record - tail->base ) * tail->record_len, & response->body[8], num_records * tail->record_len );
+
+	tail->handle_record += num_records;
+
+	if ( num_records < expected ) {
+
+		tail->stored = tail->handle_record;
+		return FINS_RETVAL_SUCCESS_LAST_DATA;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static int deliver( struct tail_tp *tail, size_t first, size_t *num_new );
+ *
+ * The function deliver() decodes the records from the given record number up
+ * to the end of the log and passes them to the callback function. The tail
+ * structure is updated after every record, so that a record refused by the
+ * callback is delivered again on the next poll.
+ */
+
+static int deliver( struct tail_tp *tail, size_t first, size_t *num_new ) {
+
+	int retval;
+	size_t a;
+	const unsigned char *record;
+	struct fins_errordata_tp errordata;
+	struct fins_accessdata_tp accessdata;
+
+	for (a=first; a<tail->stored; a++) {
+
+		record = tail->buffer + ( a - tail->base ) * tail->record_len;
+
+		if ( tail->error_callback != NULL ) {
+
+			XX_finslib_decode_errordata( record, & errordata );
+			retval = tail->error_callback( & errordata, tail->context );
+		}
+
+		else {
+			XX_finslib_decode_accessdata( record, & accessdata );
+			retval = tail->access_callback( & accessdata, tail->context );
+		}
+
+		if ( retval != FINS_RETVAL_SUCCESS ) return retval;
+
+		memcpy( tail->tail->last, record, tail->record_len );
+
+		tail->tail->seen  = a + 1;
+		tail->tail->valid = true;
+
+		if ( num_new != NULL ) (*num_new)++;
+	}
+
+	tail->tail->seen = tail->stored;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* deliver */
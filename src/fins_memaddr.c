@@ -0,0 +1,141 @@
+/*
+ * Library: libfins
+ * File:    src/fins_memaddr.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_memaddr.c contains routines to work with address
+ * handles. An address handle contains a PLC memory address in the form used
+ * in FINS commands, i.e. an area code and an encoded word and bit number.
+ * Functions like finslib_memaddr_read_uint16() take a handle instead of an
+ * address string, so that an address which is used over and over again has
+ * to be decoded and searched in the area table only once.
+ */
+
+#include "fins.h"
+
+#define MEMADDR_ACCESS_ALL	( FI_RD | FI_WR | FI_FILL | FI_MRD | FI_TRS | FI_TRD )
+
+/*
+ * int finslib_memaddr_resolve( int plc_mode, const char *address, int bits, struct fins_memaddr_tp *memaddr );
+ *
+ * The function finslib_memaddr_resolve() converts an address string to an
+ * address handle for PLCs which communicate in the FINS mode plc_mode. The
+ * parameter bits is 16 for a handle to access words and 1 for a handle to
+ * access bits. The handle can be used with all finslib_memaddr_...()
+ * functions which the memory area allows.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_memaddr_resolve( int plc_mode, const char *address, int bits, struct fins_memaddr_tp *memaddr ) {
+
+	struct fins_address_tp decoded;
+
+	if ( address == NULL                                                                      ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( memaddr == NULL                                                                      ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( bits    != 1  &&  bits != 16                                                         ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( XX_finslib_decode_address( address, & decoded )                                      ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( XX_finslib_resolve_memaddr( plc_mode, & decoded, bits, MEMADDR_ACCESS_ALL, memaddr ) ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_memaddr_resolve */
+
+/*
+ * int XX_finslib_resolve_start( const struct fins_sys_tp *sys, const char *start, int bits, uint32_t access, struct fins_memaddr_tp *memaddr );
+ *
+ * The function XX_finslib_resolve_start() converts the address string passed
+ * to one of the finslib_memory_area_...() functions to an address handle for
+ * the access needed by that function. The error codes are the same as those
+ * the functions returned before they used address handles, so the codes for
+ * a write address are returned when the access is a write, fill or transfer
+ * destination.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_resolve_start( const struct fins_sys_tp *sys, const char *start, int bits, uint32_t access, struct fins_memaddr_tp *memaddr ) {
+
+	bool write;
+	struct fins_address_tp address;
+
+	write = ( ( access & ( FI_WR | FI_FILL | FI_TRD ) ) != 0 );
+
+	if ( sys   == NULL                                 ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( start == NULL                                 ) return ( write ) ? FINS_RETVAL_NO_WRITE_ADDRESS      : FINS_RETVAL_NO_READ_ADDRESS;
+	if ( XX_finslib_decode_address( start, & address ) ) return ( write ) ? FINS_RETVAL_INVALID_WRITE_ADDRESS : FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	if ( XX_finslib_resolve_memaddr( sys->plc_mode, & address, bits, access, memaddr ) ) {
+
+		if ( access & FI_FILL ) return FINS_RETVAL_INVALID_FILL_AREA;
+		if ( write            ) return FINS_RETVAL_INVALID_WRITE_AREA;
+
+		return FINS_RETVAL_INVALID_READ_AREA;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_resolve_start */
+
+/*
+ * bool XX_finslib_check_memaddr( const struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int bits, uint32_t access );
+ *
+ * The function XX_finslib_check_memaddr() checks if an address handle can be
+ * used on a connection for an access with elements of the given number of
+ * bits. The function returns false if the handle can be used and true
+ * otherwise.
+ */
+
+bool XX_finslib_check_memaddr( const struct fins_sys_tp *sys, const struct fins_memaddr_tp *memaddr, int bits, uint32_t access ) {
+
+	if ( memaddr->plc_mode != sys->plc_mode ) return true;
+	if ( memaddr->bits     != bits          ) return true;
+	if ( ( memaddr->access & access ) == 0  ) return true;
+
+	return false;
+
+}  /* XX_finslib_check_memaddr */
+
+/*
+ * bool XX_finslib_check_memaddr_range( const struct fins_memaddr_tp *memaddr, size_t num_words );
+ *
+ * The function XX_finslib_check_memaddr_range() checks if a range of
+ * num_words words starting at an address handle fits in the memory area of
+ * the handle and can be addressed in FINS commands. For handles where the
+ * size of the area is unknown only the last check is done. The function
+ * returns false if the range fits and true otherwise.
+ */
+
+bool XX_finslib_check_memaddr_range( const struct fins_memaddr_tp *memaddr, size_t num_words ) {
+
+	if ( memaddr->start     >  0xFFFF                                ) return true;
+	if ( num_words          >  0x10000 - memaddr->start              ) return true;
+	if ( memaddr->num_words != 0  &&  num_words > memaddr->num_words ) return true;
+
+	return false;
+
+}  /* XX_finslib_check_memaddr_range */
@@ -31,6 +31,8 @@
  * and specifications important for proper FINS communications.
  */
 
+#include <string.h>
+
 #include "fins.h"
 
 /*
@@ -162,3 +164,26 @@ struct fins_mcap_tp fins_model[] = {
 	{ NULL,             FINS_MODE_UNKNOWN, 0,        0       }
 
 };  /* fins_mcap */
+
+/*
+ * const struct fins_mcap_tp *XX_finslib_model_capabilities( const char *model );
+ *
+ * The function XX_finslib_model_capabilities() looks up a CPU model in the
+ * fins_model[] table. A pointer to the specifications of the model is
+ * returned, or NULL if the model is not in the table.
+ */
+
+const struct fins_mcap_tp *XX_finslib_model_capabilities( const char *model ) {
+
+	size_t a;
+
+	if ( model == NULL ) return NULL;
+
+	for (a=0; fins_model[a].model != NULL; a++) {
+
+		if ( strcmp( fins_model[a].model, model ) == 0 ) return & fins_model[a];
+	}
+
+	return NULL;
+
+}  /* XX_finslib_model_capabilities */
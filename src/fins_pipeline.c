@@ -0,0 +1,463 @@
+/*
+ * Library: libfins
+ * File:    src/fins_pipeline.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_pipeline.c contains a routine to execute a series
+ * of FINS commands with more than one command in flight on a connection. The
+ * time the PLC needs to process a command then overlaps with the network
+ * round trips of the other commands, which greatly speeds up large transfers
+ * over links with a high latency.
+ *
+ * Responses are matched with their command through the Service ID. They are
+ * handed to the caller in the order in which the commands were built, even if
+ * they arrive in a different order.
+ *
+ * A second routine executes a small series of commands on many connections at
+ * the same time. If the library was compiled with FINS_ENABLE_IO_URING the
+ * batch is handed to the io_uring backend first, and the blocking socket
+ * calls are only used when that backend is not available.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+									/********************************************************/
+struct pipeline_slot_tp {						/*							*/
+	bool			received;				/* A matching response has been received		*/
+	size_t			sent_len;				/* Number of bytes sent for the command			*/
+	size_t			bodylen;				/* Length of the body of the frame			*/
+	int64_t			start_time;				/* Time at which the command was sent			*/
+	unsigned char		header[FINS_HEADER_LEN];		/* Header of the command which was sent			*/
+	struct fins_command_tp	frame;					/* The command and later its response			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct multi_state_tp {							/*							*/
+	size_t			num_sent;				/* Number of commands sent over the connection		*/
+	bool			stopped;				/* The handle function asked to ignore the rest		*/
+	bool			received[FINS_PIPELINE_MAX_DEPTH];	/* The response to the command has been received	*/
+	size_t			sent_len[FINS_PIPELINE_MAX_DEPTH];	/* Number of bytes sent for the command			*/
+	int64_t			start_time[FINS_PIPELINE_MAX_DEPTH];	/* Time at which the command was sent			*/
+	unsigned char		header[FINS_PIPELINE_MAX_DEPTH][FINS_HEADER_LEN];	/* Header of the command which was sent		*/
+};									/*							*/
+									/********************************************************/
+
+static void	drain( struct fins_sys_tp *sys, size_t outstanding );
+static int	multi_recv( struct fins_sys_tp *sys, struct multi_state_tp *state, fins_pipeline_handle_tp handle, void *context );
+static int	multi_send( struct fins_sys_tp *sys, struct multi_state_tp *state, size_t num_command, fins_pipeline_build_tp build, void *context );
+
+/*
+ * int XX_finslib_pipeline( struct fins_sys_tp *sys, size_t num_command, size_t depth, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void *context );
+ *
+ * The function XX_finslib_pipeline() executes num_command commands with at
+ * most depth of them waiting for a response at the same time. The build
+ * function is called to fill each command, and the handle function is called
+ * with each response in the order of the commands. A depth of 0 selects the
+ * default depth.
+ *
+ * The build function must only fill the command and not send it. The
+ * XX_finslib_..._command() builders of the file, program area and memory
+ * area commands work this way, so that more than one of their commands can be
+ * in flight at the same time.
+ *
+ * If the build function returns FINS_RETVAL_SUCCESS_LAST_DATA the command is
+ * not sent and no new commands are built. The commands already in flight are
+ * finished normally. If the handle function returns this value, the responses
+ * to the commands still in flight are discarded and the function returns
+ * success. This allows the number of commands to be open ended, with the end
+ * determined either by the caller or by the PLC. Any other error from the
+ * build or handle function, the network or the PLC stops the pipeline and is
+ * returned.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_pipeline( struct fins_sys_tp *sys, size_t num_command, size_t depth, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void *context ) {
+
+	size_t a;
+	size_t next_send;
+	size_t next_handle;
+	size_t bodylen;
+	size_t outstanding;
+	bool stop;
+	int retval;
+	struct pipeline_slot_tp *slot;
+	struct pipeline_slot_tp slots[FINS_PIPELINE_MAX_DEPTH];
+	struct fins_command_tp response;
+
+	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( build       == NULL  ||  handle == NULL       ) return FINS_RETVAL_NO_COMMAND;
+	if ( sys->sockfd == INVALID_SOCKET                 ) return FINS_RETVAL_NOT_CONNECTED;
+
+	if ( depth == 0                       ) depth = FINS_PIPELINE_DEFAULT_DEPTH;
+	if ( depth >  FINS_PIPELINE_MAX_DEPTH ) depth = FINS_PIPELINE_MAX_DEPTH;
+
+	next_send   = 0;
+	next_handle = 0;
+	outstanding = 0;
+	stop        = false;
+
+	while ( next_handle < next_send  ||  ( ! stop  &&  next_send < num_command ) ) {
+
+		while ( ! stop  &&  next_send < num_command  &&  next_send - next_handle < depth ) {
+
+			slot = & slots[ next_send % depth ];
+
+			retval = build( sys, next_send, & slot->frame, & bodylen, context );
+
+			if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) {
+
+				stop = true;
+				break;
+			}
+
+			if ( retval != FINS_RETVAL_SUCCESS ) {
+
+				drain( sys, outstanding );
+				return retval;
+			}
+
+			if ( sys->cache    != NULL ) XX_finslib_cache_invalidate(    sys, & slot->frame, bodylen );
+			if ( sys->dircache != NULL ) XX_finslib_dircache_invalidate( sys, & slot->frame, bodylen );
+
+			memcpy( slot->header, slot->frame.header, FINS_HEADER_LEN );
+
+			slot->received   = false;
+			slot->sent_len   = FINS_HEADER_LEN + bodylen;
+			slot->start_time = ( sys->stats != NULL ) ? finslib_monotonic_nsec_timer() : 0;
+
+			if ( ( retval = XX_finslib_send_command( sys, & slot->frame, bodylen ) ) != FINS_RETVAL_SUCCESS ) {
+
+				if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->header, 0, 0, 0, retval, false );
+
+				drain( sys, outstanding );
+				return retval;
+			}
+
+			outstanding++;
+			next_send++;
+		}
+
+		if ( next_handle >= next_send ) continue;
+
+		slot = & slots[ next_handle % depth ];
+
+		if ( slot->received ) {
+
+			retval = handle( sys, next_handle, & slot->frame, slot->bodylen, context );
+			next_handle++;
+
+			if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) {
+
+				drain( sys, outstanding );
+				return FINS_RETVAL_SUCCESS;
+			}
+
+			if ( retval != FINS_RETVAL_SUCCESS ) {
+
+				drain( sys, outstanding );
+				return retval;
+			}
+
+			continue;
+		}
+
+		if ( ( retval = XX_finslib_recv_response( sys, slot->header, & response, & bodylen ) ) != FINS_RETVAL_SUCCESS ) {
+
+			if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->header, slot->sent_len, 0, 0, retval, false );
+
+			return retval;
+		}
+
+		for (a=next_handle; a<next_send; a++) {
+
+			slot = & slots[ a % depth ];
+
+			if ( ! slot->received  &&  slot->header[FINS_SID] == response.header[FINS_SID] ) break;
+		}
+
+		if ( a >= next_send ) {
+
+			/*
+			 * A datagram with an unknown Service ID is most likely a late
+			 * response to an earlier command which timed out and is ignored.
+			 * On a stream connection it means that the connection is out of
+			 * sync.
+			 */
+
+			if ( sys->comm_type == FINS_COMM_TYPE_UDP ) continue;
+
+			return XX_finslib_check_response( sys, slots[ next_handle % depth ].header, & response, bodylen );
+		}
+
+		outstanding--;
+
+		retval = XX_finslib_check_response( sys, slot->header, & response, bodylen );
+
+		if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->header, slot->sent_len, FINS_HEADER_LEN + bodylen, finslib_monotonic_nsec_timer() - slot->start_time, retval, false );
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			drain( sys, outstanding );
+			return retval;
+		}
+
+		memcpy( slot->frame.header, response.header, FINS_HEADER_LEN );
+		memcpy( slot->frame.body,   response.body,   bodylen         );
+
+		slot->bodylen  = bodylen;
+		slot->received = true;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_pipeline */
+
+/*
+ * static void drain( struct fins_sys_tp *sys, size_t outstanding );
+ *
+ * The function drain() receives and discards the responses of the commands
+ * still in flight after a pipeline has been stopped because of an error. This
+ * prevents these responses from being mistaken for responses to later
+ * commands on the same connection.
+ */
+
+static void drain( struct fins_sys_tp *sys, size_t outstanding ) {
+
+	size_t bodylen;
+	struct fins_command_tp response;
+
+	while ( outstanding > 0 ) {
+
+		if ( XX_finslib_recv_response( sys, NULL, & response, & bodylen ) != FINS_RETVAL_SUCCESS ) return;
+
+		outstanding--;
+	}
+
+}  /* drain */
+
+/*
+ * int XX_finslib_pipeline_multi( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval );
+ *
+ * The function XX_finslib_pipeline_multi() executes the same series of at
+ * most FINS_PIPELINE_MAX_DEPTH commands on num_sys connections at the same
+ * time. All commands are sent before the first response is collected, so that
+ * the time needed is determined by the slowest PLC rather than by the sum of
+ * all round trips. The build and handle functions are called for connection
+ * sys[i] with context[i]. Responses are handed to the handle function in the
+ * order in which they arrive. The result for each connection is stored in
+ * retval[i]. A connection which is NULL or not connected gets an error code
+ * and does not stop the other connections.
+ *
+ * When the library was compiled with FINS_ENABLE_IO_URING, the io_uring
+ * backend is tried first. If it is not available for this batch, the commands
+ * are sent and received with the blocking socket calls.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ * The function only fails as a whole if the parameters are invalid or no
+ * memory is available. It succeeds even if one or more of the connections
+ * failed.
+ */
+
+int XX_finslib_pipeline_multi( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval ) {
+
+	size_t a;
+	struct multi_state_tp *state;
+
+	if ( num_sys     == 0                              ) return FINS_RETVAL_SUCCESS;
+	if ( sys         == NULL                           ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( build       == NULL  ||  handle == NULL       ) return FINS_RETVAL_NO_COMMAND;
+	if ( num_command >  FINS_PIPELINE_MAX_DEPTH        ) return FINS_RETVAL_NO_COMMAND;
+	if ( context     == NULL  ||  retval == NULL       ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	for (a=0; a<num_sys; a++) {
+
+		if      ( sys[a]         == NULL           ) retval[a] = FINS_RETVAL_NOT_INITIALIZED;
+		else if ( sys[a]->sockfd == INVALID_SOCKET ) retval[a] = FINS_RETVAL_NOT_CONNECTED;
+		else                                         retval[a] = FINS_RETVAL_SUCCESS;
+	}
+
+	if ( XX_finslib_uring_pipeline( sys, num_sys, num_command, build, handle, context, retval ) ) return FINS_RETVAL_SUCCESS;
+
+	state = calloc( num_sys, sizeof(struct multi_state_tp) );
+	if ( state == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	for (a=0; a<num_sys; a++) {
+
+		if ( retval[a] == FINS_RETVAL_SUCCESS ) retval[a] = multi_send( sys[a], & state[a], num_command, build, context[a] );
+	}
+
+	for (a=0; a<num_sys; a++) {
+
+		if ( state[a].num_sent == 0 ) continue;
+
+		if ( retval[a] == FINS_RETVAL_SUCCESS ) retval[a] = multi_recv( sys[a], & state[a], handle, context[a] );
+		else                                               multi_recv( sys[a], & state[a], handle, context[a] );
+	}
+
+	free( state );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_pipeline_multi */
+
+/*
+ * static int multi_send( struct fins_sys_tp *sys, struct multi_state_tp *state, size_t num_command, fins_pipeline_build_tp build, void *context );
+ *
+ * The function multi_send() builds and sends the commands for one connection
+ * of a multi connection pipeline without waiting for the responses. The
+ * headers of the commands are kept in the state so that the responses can be
+ * matched later on.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int multi_send( struct fins_sys_tp *sys, struct multi_state_tp *state, size_t num_command, fins_pipeline_build_tp build, void *context ) {
+
+	size_t a;
+	size_t bodylen;
+	int retval;
+	struct fins_command_tp fins_cmnd;
+
+	for (a=0; a<num_command; a++) {
+
+		retval = build( sys, a, & fins_cmnd, & bodylen, context );
+
+		if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) return FINS_RETVAL_SUCCESS;
+		if ( retval != FINS_RETVAL_SUCCESS           ) return retval;
+
+		if ( sys->cache    != NULL ) XX_finslib_cache_invalidate(    sys, & fins_cmnd, bodylen );
+		if ( sys->dircache != NULL ) XX_finslib_dircache_invalidate( sys, & fins_cmnd, bodylen );
+
+		memcpy( state->header[a], fins_cmnd.header, FINS_HEADER_LEN );
+
+		state->received[a]   = false;
+		state->sent_len[a]   = FINS_HEADER_LEN + bodylen;
+		state->start_time[a] = ( sys->stats != NULL ) ? finslib_monotonic_nsec_timer() : 0;
+
+		if ( ( retval = XX_finslib_send_command( sys, & fins_cmnd, bodylen ) ) != FINS_RETVAL_SUCCESS ) {
+
+			if ( sys->stats != NULL ) XX_finslib_stats_command( sys, state->header[a], 0, 0, 0, retval, false );
+
+			return retval;
+		}
+
+		state->num_sent++;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* multi_send */
+
+/*
+ * static int multi_recv( struct fins_sys_tp *sys, struct multi_state_tp *state, fins_pipeline_handle_tp handle, void *context );
+ *
+ * The function multi_recv() collects the responses to the commands sent by
+ * multi_send() and passes them to the handle function. All responses are
+ * received even if one of them reports an error, so that the connection is
+ * left in a clean state for the next command.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int multi_recv( struct fins_sys_tp *sys, struct multi_state_tp *state, fins_pipeline_handle_tp handle, void *context ) {
+
+	size_t a;
+	size_t bodylen;
+	size_t outstanding;
+	int retval;
+	int first_error;
+	const unsigned char *expected;
+	struct fins_command_tp response;
+
+	first_error = FINS_RETVAL_SUCCESS;
+	outstanding = state->num_sent;
+
+	while ( outstanding > 0 ) {
+
+		expected = NULL;
+
+		for (a=0; a<state->num_sent; a++) {
+
+			if ( ! state->received[a] ) { expected = state->header[a]; break; }
+		}
+
+		if ( ( retval = XX_finslib_recv_response( sys, expected, & response, & bodylen ) ) != FINS_RETVAL_SUCCESS ) {
+
+			if ( sys->stats != NULL ) {
+
+				for (a=0; a<state->num_sent; a++) {
+
+					if ( ! state->received[a] ) XX_finslib_stats_command( sys, state->header[a], state->sent_len[a], 0, 0, retval, false );
+				}
+			}
+
+			return ( first_error != FINS_RETVAL_SUCCESS ) ? first_error : retval;
+		}
+
+		for (a=0; a<state->num_sent; a++) {
+
+			if ( ! state->received[a]  &&  state->header[a][FINS_SID] == response.header[FINS_SID] ) break;
+		}
+
+		if ( a >= state->num_sent ) {
+
+			/*
+			 * As in the pipeline, an unknown Service ID on a UDP
+			 * connection is a late response to an earlier command.
+			 */
+
+			if ( sys->comm_type == FINS_COMM_TYPE_UDP ) continue;
+
+			return XX_finslib_check_response( sys, state->header[0], & response, bodylen );
+		}
+
+		state->received[a] = true;
+		outstanding--;
+
+		retval = XX_finslib_check_response( sys, state->header[a], & response, bodylen );
+
+		if ( sys->stats != NULL ) XX_finslib_stats_command( sys, state->header[a], state->sent_len[a], FINS_HEADER_LEN + bodylen, finslib_monotonic_nsec_timer() - state->start_time[a], retval, false );
+
+		if ( retval == FINS_RETVAL_SUCCESS  &&  ! state->stopped ) retval = handle( sys, a, & response, bodylen, context );
+
+		if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) {
+
+			state->stopped = true;
+			retval         = FINS_RETVAL_SUCCESS;
+		}
+
+		if ( retval != FINS_RETVAL_SUCCESS  &&  first_error == FINS_RETVAL_SUCCESS ) first_error = retval;
+	}
+
+	return first_error;
+
+}  /* multi_recv */
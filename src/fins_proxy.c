@@ -0,0 +1,1425 @@
+/*
+ * Library: libfins
+ * File:    src/fins_proxy.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_proxy.c contains a FINS proxy which accepts
+ * commands from many FINS/TCP and FINS/UDP clients and forwards them over a
+ * small pool of upstream connections to one or more PLCs. Omron Ethernet units
+ * only allow a limited number of FINS/TCP connections and node addresses. The
+ * proxy shares those scarce resources between all local clients.
+ *
+ * Commands are pipelined on the upstream connections. The Service ID and the
+ * node addresses in the FINS header are rewritten on the way to the PLC and
+ * restored in the response. Identical memory area reads (01 01) which are in
+ * flight at the same time are coalesced into one upstream command and the
+ * response is sent to every client which asked for it.
+ *
+ * The commands of one client are kept in order. As long as a client has
+ * commands in flight, its next commands go to the same upstream connection,
+ * where the PLC executes them in the order received. A read is only coalesced
+ * when the client has nothing queued and no other command than reads in
+ * flight, so a client never receives data from before its own write.
+ *
+ * Commands with the "response not required" bit set in the ICF field are
+ * forwarded without being tracked. The PLC does not answer them and the
+ * proxy never replies to them, not even with an error. Because such a
+ * command is not in flight, a next command of the same client may go to
+ * another upstream connection of the pool.
+ *
+ * All sockets of the proxy are handled without blocking. Upstream FINS/TCP
+ * connections are opened in the background and their node address handshake
+ * and responses are collected in a buffer until a complete message has been
+ * received, so a slow or unreachable PLC never stalls the other routes.
+ * Responses to FINS/TCP clients which can not be sent at once are kept in an
+ * output buffer per client and sent when the socket becomes writable. A
+ * client which doesn't read its responses is disconnected when that buffer
+ * overflows, so it can never stall the proxy.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+#define PROXY_TCP_BUFLEN	(16+FINS_HEADER_LEN+FINS_BODY_LEN)
+#define PROXY_OUT_BUFLEN	(FINS_PROXY_MAX_IN_FLIGHT*PROXY_TCP_BUFLEN)
+
+#define PROXY_UP_IDLE		0			/* No connection, waiting for the retry time		*/
+#define PROXY_UP_CONNECTING	1			/* TCP connection is being established			*/
+#define PROXY_UP_HANDSHAKE	2			/* Waiting for the FINS/TCP node address response	*/
+#define PROXY_UP_READY		3			/* Connection can carry commands			*/
+
+#if defined(_WIN32)
+typedef const char	setsockopt_tp;
+#else
+typedef void		setsockopt_tp;
+#endif
+
+									/********************************************************/
+struct proxy_requester_tp {						/*							*/
+	int			client;					/* Index of TCP client, -1 for an UDP client		*/
+	unsigned int		generation;				/* Generation of the client slot when request arrived	*/
+	struct sockaddr_in	udp_addr;				/* Return address of an UDP client			*/
+	unsigned char		header[FINS_HEADER_LEN];		/* Original header of the request			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct proxy_client_tp {						/*							*/
+	SOCKET			sockfd;					/* Socket or INVALID_SOCKET if the slot is free		*/
+	unsigned int		generation;				/* Incremented every time the slot is reused		*/
+	uint8_t			node;					/* FINS node number assigned to the client		*/
+	size_t			inlen;					/* Number of bytes in the input buffer			*/
+	unsigned char		inbuf[PROXY_TCP_BUFLEN];		/* Partially received FINS/TCP message			*/
+	size_t			outlen;					/* Number of bytes in the output buffer			*/
+	unsigned char		outbuf[PROXY_OUT_BUFLEN];		/* Responses waiting until the socket is writable	*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct proxy_pending_tp {						/*							*/
+	bool			used;					/* Slot contains a command waiting for a response	*/
+	uint8_t			sid;					/* Service ID used on the upstream connection		*/
+	time_t			sent;					/* Time the command was sent upstream			*/
+	bool			coalesce;				/* Other clients may share the response			*/
+	unsigned char		key[6];					/* Body of the 01 01 read used for coalescing		*/
+	size_t			num_waiters;				/* Number of clients waiting for this response		*/
+	struct proxy_requester_tp waiter[FINS_PROXY_MAX_WAITERS];	/* Clients waiting for this response		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct proxy_upstream_tp {						/*							*/
+	int			state;					/* One of the PROXY_UP_... states			*/
+	time_t			retry;					/* Earliest time for a new connection attempt		*/
+	time_t			deadline;				/* Time the connection must be established		*/
+	uint8_t			next_sid;				/* Next Service ID to use on this connection		*/
+	size_t			in_flight;				/* Number of commands waiting for a response		*/
+	struct fins_sys_tp	conn;					/* Connection with the PLC				*/
+	size_t			inlen;					/* Number of bytes in the input buffer			*/
+	unsigned char		inbuf[PROXY_TCP_BUFLEN];		/* Partially received FINS/TCP message			*/
+	struct proxy_pending_tp	pending[FINS_PROXY_MAX_IN_FLIGHT];	/* Commands waiting for a response		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct proxy_queued_tp {						/*							*/
+	struct proxy_requester_tp requester;				/* Client which sent the command			*/
+	time_t			queued;					/* Time the command was queued				*/
+	size_t			bodylen;				/* Length of the command body				*/
+	struct fins_command_tp	frame;					/* The command itself					*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct proxy_route_tp {							/*							*/
+	bool			used;					/* Route is configured					*/
+	uint8_t			match_node;				/* Destination node clients use, 0 for default route	*/
+	uint8_t			comm_type;				/* FINS/TCP or FINS/UDP upstream			*/
+	char			address[128];				/* IP address of the PLC				*/
+	uint16_t		port;					/* Port number of the PLC				*/
+	uint8_t			local_net;				/* Local network used upstream				*/
+	uint8_t			local_node;				/* Local node used upstream				*/
+	uint8_t			remote_net;				/* Network of the PLC					*/
+	uint8_t			remote_node;				/* Node of the PLC					*/
+	uint8_t			remote_unit;				/* Unit of the PLC					*/
+	size_t			pool_size;				/* Number of upstream connections			*/
+	size_t			q_head;					/* First queued command					*/
+	size_t			q_len;					/* Number of queued commands				*/
+	struct proxy_upstream_tp upstream[FINS_PROXY_MAX_POOL];		/* Pool of upstream connections				*/
+	struct proxy_queued_tp	queue[FINS_PROXY_QUEUE_LEN];		/* Commands waiting for a free upstream slot		*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_proxy_tp {							/*							*/
+	SOCKET			tcp_listen;				/* Socket accepting FINS/TCP clients			*/
+	SOCKET			udp_sock;				/* Socket receiving FINS/UDP commands			*/
+	uint8_t			node;					/* Node number the proxy reports to its clients		*/
+	uint8_t			next_client_node;			/* Next node number to hand out to a client		*/
+	struct proxy_client_tp	client[FINS_PROXY_MAX_CLIENTS];		/* Connected FINS/TCP clients				*/
+	struct proxy_route_tp	route[FINS_PROXY_MAX_ROUTES];		/* Upstream PLCs					*/
+};									/*							*/
+									/********************************************************/
+
+static void	close_client( struct fins_proxy_tp *proxy, int index );
+static void	dispatch_queue( struct fins_proxy_tp *proxy, struct proxy_route_tp *route );
+static void	flush_client( struct fins_proxy_tp *proxy, int index );
+static void	handle_request( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *in, struct fins_command_tp *frame, size_t bodylen );
+static void	handle_tcp_message( struct fins_proxy_tp *proxy, int index, const unsigned char *msg, size_t msglen );
+static void	read_client( struct fins_proxy_tp *proxy, int index );
+static void	read_udp( struct fins_proxy_tp *proxy );
+static void	read_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up );
+static void	connect_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up );
+static void	handle_response( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up, struct fins_command_tp *frame, size_t bodylen );
+static void	open_upstream( struct proxy_route_tp *route, struct proxy_upstream_tp *up, time_t now );
+static void	reply( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen );
+static void	reply_error( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, uint16_t endcode );
+static void	reset_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up, uint16_t endcode );
+static bool	requester_queued( const struct proxy_route_tp *route, const struct proxy_requester_tp *requester );
+static struct proxy_upstream_tp *requester_upstream( struct proxy_route_tp *route, const struct proxy_requester_tp *requester, bool *only_reads );
+static bool	same_requester( const struct proxy_requester_tp *a, const struct proxy_requester_tp *b );
+static void	send_client( struct fins_proxy_tp *proxy, int index, const unsigned char *data, size_t len );
+static bool	send_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen );
+static bool	set_nonblocking( SOCKET sockfd );
+static bool	socket_would_block( bool connecting );
+static uint32_t	tcp_command( const unsigned char *msg );
+
+/*
+ * struct fins_proxy_tp *finslib_proxy_create( uint16_t port, uint8_t proxy_node, int *error_val );
+ *
+ * The function finslib_proxy_create() creates a new FINS proxy which listens
+ * for FINS/TCP clients and FINS/UDP datagrams on the specified port. The
+ * proxy_node parameter is the FINS node number the proxy reports to its
+ * FINS/TCP clients. Upstream PLCs are added with finslib_proxy_add_upstream().
+ * On error NULL is returned and the reason stored in error_val.
+ */
+
+struct fins_proxy_tp *finslib_proxy_create( uint16_t port, uint8_t proxy_node, int *error_val ) {
+
+	int a;
+	struct fins_proxy_tp *proxy;
+
+	if ( port < FINS_PORT_RESERVED  ||  port >= FINS_PORT_MAX ) port = FINS_DEFAULT_PORT;
+
+	proxy = calloc( 1, sizeof(struct fins_proxy_tp) );
+
+	if ( proxy == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	proxy->node             = proxy_node;
+	proxy->next_client_node = 1;
+	proxy->udp_sock         = INVALID_SOCKET;
+
+	for (a=0; a<FINS_PROXY_MAX_CLIENTS; a++) proxy->client[a].sockfd = INVALID_SOCKET;
+
+	proxy->tcp_listen = XX_finslib_server_socket( FINS_COMM_TYPE_TCP, port, error_val );
+
+	if ( proxy->tcp_listen == INVALID_SOCKET ) {
+
+		free( proxy );
+		return NULL;
+	}
+
+	proxy->udp_sock = XX_finslib_server_socket( FINS_COMM_TYPE_UDP, port, error_val );
+
+	if ( proxy->udp_sock == INVALID_SOCKET ) {
+
+		closesocket( proxy->tcp_listen );
+		free( proxy );
+		return NULL;
+	}
+
+	if ( ! set_nonblocking( proxy->tcp_listen )  ||  ! set_nonblocking( proxy->udp_sock ) ) {
+
+		if ( error_val != NULL ) *error_val = XX_finslib_socket_error();
+
+		closesocket( proxy->tcp_listen );
+		closesocket( proxy->udp_sock   );
+		free( proxy );
+		return NULL;
+	}
+
+	return proxy;
+
+}  /* finslib_proxy_create */
+
+/*
+ * int finslib_proxy_add_upstream( struct fins_proxy_tp *proxy, uint8_t match_node, uint8_t comm_type, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, size_t pool_size );
+ *
+ * The function finslib_proxy_add_upstream() adds a PLC to the proxy. Client
+ * commands with a destination node equal to match_node are forwarded to this
+ * PLC. A match_node of 0 makes the PLC the default destination for commands
+ * which do not match any other route. Up to pool_size connections are opened
+ * to the PLC and commands are distributed over them.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_proxy_add_upstream( struct fins_proxy_tp *proxy, uint8_t match_node, uint8_t comm_type, const char *address, uint16_t port, uint8_t local_net, uint8_t local_node, uint8_t remote_net, uint8_t remote_node, uint8_t remote_unit, size_t pool_size ) {
+
+	int a;
+	struct proxy_route_tp *route;
+
+	if ( proxy   == NULL                                                    ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( address == NULL  ||  address[0] == 0                               ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( comm_type != FINS_COMM_TYPE_TCP  &&  comm_type != FINS_COMM_TYPE_UDP ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	if ( pool_size < 1                  ) pool_size = 1;
+	if ( pool_size > FINS_PROXY_MAX_POOL ) pool_size = FINS_PROXY_MAX_POOL;
+
+	route = NULL;
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		if ( ! proxy->route[a].used ) { route = & proxy->route[a]; break; }
+	}
+
+	if ( route == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	memset( route, 0, sizeof(struct proxy_route_tp) );
+
+	route->used        = true;
+	route->match_node  = match_node;
+	route->comm_type   = comm_type;
+	route->port        = port;
+	route->local_net   = local_net;
+	route->local_node  = local_node;
+	route->remote_net  = remote_net;
+	route->remote_node = remote_node;
+	route->remote_unit = remote_unit;
+	route->pool_size   = pool_size;
+
+	snprintf( route->address, 128, "%s", address );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_proxy_add_upstream */
+
+/*
+ * void finslib_proxy_destroy( struct fins_proxy_tp *proxy );
+ *
+ * The function finslib_proxy_destroy() closes all client and upstream
+ * connections of a proxy and releases the memory associated with it.
+ */
+
+void finslib_proxy_destroy( struct fins_proxy_tp *proxy ) {
+
+	int a;
+	size_t b;
+
+	if ( proxy == NULL ) return;
+
+	for (a=0; a<FINS_PROXY_MAX_CLIENTS; a++) close_client( proxy, a );
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		for (b=0; b<proxy->route[a].pool_size; b++) {
+
+			if ( proxy->route[a].upstream[b].state != PROXY_UP_IDLE ) finslib_disconnect( & proxy->route[a].upstream[b].conn );
+		}
+	}
+
+	if ( proxy->tcp_listen != INVALID_SOCKET ) closesocket( proxy->tcp_listen );
+	if ( proxy->udp_sock   != INVALID_SOCKET ) closesocket( proxy->udp_sock   );
+
+	free( proxy );
+
+}  /* finslib_proxy_destroy */
+
+/*
+ * int finslib_proxy_poll( struct fins_proxy_tp *proxy, int timeout_msec );
+ *
+ * The function finslib_proxy_poll() performs one iteration of the proxy event
+ * loop. It waits at most timeout_msec milliseconds for activity on any of the
+ * client or upstream sockets and handles all activity found. A daemon calls
+ * this function repeatedly.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_proxy_poll( struct fins_proxy_tp *proxy, int timeout_msec ) {
+
+	int a;
+	int retval;
+	bool ready;
+	size_t b;
+	size_t c;
+	time_t now;
+	SOCKET maxfd;
+	SOCKET sockfd;
+	fd_set readfds;
+	fd_set writefds;
+	fd_set exceptfds;
+	struct timeval tv;
+	struct proxy_route_tp *route;
+	struct proxy_upstream_tp *up;
+	struct proxy_requester_tp requester;
+
+	if ( proxy == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	now = finslib_monotonic_sec_timer();
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		route = & proxy->route[a];
+		if ( ! route->used ) continue;
+
+		for (b=0; b<route->pool_size; b++) {
+
+			up = & route->upstream[b];
+
+			if ( up->state != PROXY_UP_IDLE   &&  up->conn.sockfd == INVALID_SOCKET ) reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+			if ( up->state != PROXY_UP_READY  &&  up->state != PROXY_UP_IDLE  &&  now >= up->deadline ) reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+
+			if ( up->state == PROXY_UP_IDLE  &&  now >= up->retry ) open_upstream( route, up, now );
+		}
+
+		dispatch_queue( proxy, route );
+	}
+
+	FD_ZERO( & readfds   );
+	FD_ZERO( & writefds  );
+	FD_ZERO( & exceptfds );
+
+	FD_SET( proxy->tcp_listen, & readfds );
+	FD_SET( proxy->udp_sock,   & readfds );
+
+	maxfd = ( proxy->tcp_listen > proxy->udp_sock ) ? proxy->tcp_listen : proxy->udp_sock;
+
+	for (a=0; a<FINS_PROXY_MAX_CLIENTS; a++) {
+
+		sockfd = proxy->client[a].sockfd;
+		if ( sockfd == INVALID_SOCKET ) continue;
+
+		FD_SET( sockfd, & readfds );
+		if ( proxy->client[a].outlen > 0 ) FD_SET( sockfd, & writefds );
+		if ( sockfd > maxfd ) maxfd = sockfd;
+	}
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		for (b=0; b<proxy->route[a].pool_size; b++) {
+
+			up = & proxy->route[a].upstream[b];
+			if ( up->state == PROXY_UP_IDLE ) continue;
+
+			if ( up->state == PROXY_UP_CONNECTING ) {
+
+				FD_SET( up->conn.sockfd, & writefds  );
+				FD_SET( up->conn.sockfd, & exceptfds );
+			}
+
+			else FD_SET( up->conn.sockfd, & readfds );
+
+			if ( up->conn.sockfd > maxfd ) maxfd = up->conn.sockfd;
+		}
+	}
+
+	if ( timeout_msec < 0 ) timeout_msec = 0;
+
+	tv.tv_sec  =  timeout_msec / 1000;
+	tv.tv_usec = (timeout_msec % 1000) * 1000;
+
+	retval = select( (int) maxfd + 1, & readfds, & writefds, & exceptfds, & tv );
+
+	if ( retval < 0 ) return XX_finslib_socket_error();
+
+	if ( retval > 0 ) {
+
+		if ( FD_ISSET( proxy->udp_sock, & readfds ) ) read_udp( proxy );
+
+		for (a=0; a<FINS_PROXY_MAX_CLIENTS; a++) {
+
+			if ( proxy->client[a].sockfd != INVALID_SOCKET  &&  FD_ISSET( proxy->client[a].sockfd, & writefds ) ) flush_client( proxy, a );
+			if ( proxy->client[a].sockfd != INVALID_SOCKET  &&  FD_ISSET( proxy->client[a].sockfd, & readfds  ) ) read_client( proxy, a );
+		}
+
+		for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+			for (b=0; b<proxy->route[a].pool_size; b++) {
+
+				up = & proxy->route[a].upstream[b];
+
+				if ( up->state == PROXY_UP_CONNECTING ) {
+
+					if ( FD_ISSET( up->conn.sockfd, & writefds )  ||  FD_ISSET( up->conn.sockfd, & exceptfds ) ) connect_upstream( proxy, up );
+				}
+
+				else if ( up->state != PROXY_UP_IDLE  &&  FD_ISSET( up->conn.sockfd, & readfds ) ) read_upstream( proxy, & proxy->route[a], up );
+			}
+		}
+
+		if ( FD_ISSET( proxy->tcp_listen, & readfds ) ) {
+
+			sockfd = XX_finslib_server_accept( proxy->tcp_listen );
+
+			if ( sockfd != INVALID_SOCKET ) {
+
+				for (a=0; a<FINS_PROXY_MAX_CLIENTS; a++) {
+
+					if ( proxy->client[a].sockfd == INVALID_SOCKET ) break;
+				}
+
+				if ( a < FINS_PROXY_MAX_CLIENTS  &&  set_nonblocking( sockfd ) ) {
+
+					proxy->client[a].sockfd = sockfd;
+					proxy->client[a].node   = 0;
+					proxy->client[a].inlen  = 0;
+					proxy->client[a].outlen = 0;
+					proxy->client[a].generation++;
+				}
+
+				else closesocket( sockfd );
+			}
+		}
+	}
+
+	/*
+	 * Commands which did not receive a response in time are answered with a
+	 * timeout error to all clients waiting for them. Queued commands which
+	 * could not be sent in time are answered with an error as well, which
+	 * tells the client whether the PLC is unreachable or just too busy.
+	 */
+
+	now = finslib_monotonic_sec_timer();
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		route = & proxy->route[a];
+		if ( ! route->used ) continue;
+
+		for (b=0; b<route->pool_size; b++) {
+
+			up = & route->upstream[b];
+
+			for (c=0; c<FINS_PROXY_MAX_IN_FLIGHT; c++) {
+
+				if ( ! up->pending[c].used  ||  now < up->pending[c].sent + FINS_PROXY_TIMEOUT ) continue;
+
+				while ( up->pending[c].num_waiters > 0 ) {
+
+					requester = up->pending[c].waiter[ --up->pending[c].num_waiters ];
+					reply_error( proxy, & requester, FINS_RETVAL_DEST_TIMEOUT );
+				}
+
+				up->pending[c].used = false;
+				up->in_flight--;
+			}
+		}
+
+		dispatch_queue( proxy, route );
+
+		ready = false;
+
+		for (b=0; b<route->pool_size; b++) {
+
+			if ( route->upstream[b].state == PROXY_UP_READY ) ready = true;
+		}
+
+		while ( route->q_len > 0  &&  now >= route->queue[ route->q_head ].queued + FINS_PROXY_TIMEOUT ) {
+
+			reply_error( proxy, & route->queue[ route->q_head ].requester, ( ready ) ? FINS_RETVAL_DEST_TIMEOUT : FINS_RETVAL_DEST_NOT_IN_NETWORK );
+
+			route->q_head = ( route->q_head + 1 ) % FINS_PROXY_QUEUE_LEN;
+			route->q_len--;
+		}
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_proxy_poll */
+
+/*
+ * static void close_client( struct fins_proxy_tp *proxy, int index );
+ *
+ * The function close_client() closes the connection with a FINS/TCP client
+ * and frees its slot. Responses which arrive later for this client are
+ * discarded because the generation of the slot no longer matches.
+ */
+
+static void close_client( struct fins_proxy_tp *proxy, int index ) {
+
+	if ( proxy->client[index].sockfd == INVALID_SOCKET ) return;
+
+	closesocket( proxy->client[index].sockfd );
+
+	proxy->client[index].sockfd = INVALID_SOCKET;
+	proxy->client[index].inlen  = 0;
+	proxy->client[index].outlen = 0;
+	proxy->client[index].generation++;
+
+}  /* close_client */
+
+/*
+ * static void send_client( struct fins_proxy_tp *proxy, int index, const unsigned char *data, size_t len );
+ *
+ * The function send_client() sends data to a FINS/TCP client. What can not be
+ * sent without blocking is appended to the output buffer of the client and
+ * sent later by flush_client(). Data is never sent directly while older data
+ * is still waiting, to keep the responses in order. The client is
+ * disconnected when the send fails or the output buffer overflows.
+ */
+
+static void send_client( struct fins_proxy_tp *proxy, int index, const unsigned char *data, size_t len ) {
+
+	int sendlen;
+	struct proxy_client_tp *client;
+
+	client  = & proxy->client[index];
+	sendlen = 0;
+
+	if ( client->outlen == 0 ) {
+
+		sendlen = send( client->sockfd, (const char *) data, (int) len, 0 );
+
+		if ( sendlen < 0 ) {
+
+			if ( ! socket_would_block( false ) ) { close_client( proxy, index ); return; }
+
+			sendlen = 0;
+		}
+	}
+
+	if ( len - sendlen > PROXY_OUT_BUFLEN - client->outlen ) { close_client( proxy, index ); return; }
+
+	memcpy( client->outbuf + client->outlen, data + sendlen, len - sendlen );
+	client->outlen += len - sendlen;
+
+}  /* send_client */
+
+/*
+ * static void flush_client( struct fins_proxy_tp *proxy, int index );
+ *
+ * The function flush_client() sends as much of the output buffer of a
+ * FINS/TCP client as the socket accepts without blocking.
+ */
+
+static void flush_client( struct fins_proxy_tp *proxy, int index ) {
+
+	int sendlen;
+	struct proxy_client_tp *client;
+
+	client  = & proxy->client[index];
+	sendlen = send( client->sockfd, (const char *) client->outbuf, (int) client->outlen, 0 );
+
+	if ( sendlen < 0 ) {
+
+		if ( ! socket_would_block( false ) ) close_client( proxy, index );
+		return;
+	}
+
+	client->outlen -= sendlen;
+	memmove( client->outbuf, client->outbuf + sendlen, client->outlen );
+
+}  /* flush_client */
+
+/*
+ * static void read_client( struct fins_proxy_tp *proxy, int index );
+ *
+ * The function read_client() reads the data available on the socket of a
+ * FINS/TCP client and handles every complete FINS/TCP message received.
+ */
+
+static void read_client( struct fins_proxy_tp *proxy, int index ) {
+
+	int recvlen;
+	int error_val;
+	size_t msglen;
+	struct proxy_client_tp *client;
+
+	client  = & proxy->client[index];
+	recvlen = recv( client->sockfd, (char *) client->inbuf + client->inlen, (int) (PROXY_TCP_BUFLEN - client->inlen), 0 );
+
+	if ( recvlen <= 0 ) { close_client( proxy, index ); return; }
+
+	client->inlen += recvlen;
+
+	for (;;) {
+
+		msglen = XX_finslib_server_tcp_message_len( client->inbuf, client->inlen, & error_val );
+
+		if ( error_val != FINS_RETVAL_SUCCESS ) { close_client( proxy, index ); return; }
+		if ( msglen == 0  ||  msglen > client->inlen ) return;
+
+		handle_tcp_message( proxy, index, client->inbuf, msglen );
+
+		if ( client->sockfd == INVALID_SOCKET ) return;
+
+		client->inlen -= msglen;
+		memmove( client->inbuf, client->inbuf + msglen, client->inlen );
+	}
+
+}  /* read_client */
+
+/*
+ * static void handle_tcp_message( struct fins_proxy_tp *proxy, int index, const unsigned char *msg, size_t msglen );
+ *
+ * The function handle_tcp_message() processes one complete FINS/TCP message
+ * from a client. This is either the node address handshake at the start of a
+ * connection, or a FINS frame which must be forwarded to a PLC.
+ */
+
+static void handle_tcp_message( struct fins_proxy_tp *proxy, int index, const unsigned char *msg, size_t msglen ) {
+
+	uint32_t command;
+	unsigned char answer[24];
+	struct fins_command_tp frame;
+	struct proxy_requester_tp requester;
+	struct proxy_client_tp *client;
+
+	client  = & proxy->client[index];
+	command = tcp_command( msg );
+
+	if ( command == 0x00000000  &&  msglen >= 20 ) {
+
+		client->node = msg[19];
+
+		if ( client->node == 0 ) {
+
+			if ( proxy->next_client_node == proxy->node ) proxy->next_client_node++;
+			if ( proxy->next_client_node == 0  ||  proxy->next_client_node > 254 ) proxy->next_client_node = 1;
+			if ( proxy->next_client_node == proxy->node ) proxy->next_client_node++;
+
+			client->node = proxy->next_client_node++;
+		}
+
+		XX_finslib_server_tcp_header( answer, 0x00000001, 0x00000000, 8 );
+
+		answer[16] = 0x00;
+		answer[17] = 0x00;
+		answer[18] = 0x00;
+		answer[19] = client->node;
+		answer[20] = 0x00;
+		answer[21] = 0x00;
+		answer[22] = 0x00;
+		answer[23] = proxy->node;
+
+		send_client( proxy, index, answer, 24 );
+
+		return;
+	}
+
+	if ( command != 0x00000002  ||  msglen < 16 + FINS_HEADER_LEN ) {
+
+		XX_finslib_server_tcp_header( answer, 0x00000003, 0x00000003, 0 );
+		send( client->sockfd, (const char *) answer, 16, 0 );
+		close_client( proxy, index );
+
+		return;
+	}
+
+	memset( & requester, 0, sizeof(requester) );
+
+	requester.client     = index;
+	requester.generation = client->generation;
+
+	memcpy( frame.header, msg + 16,                 FINS_HEADER_LEN                );
+	memcpy( frame.body,   msg + 16 + FINS_HEADER_LEN, msglen - 16 - FINS_HEADER_LEN );
+
+	handle_request( proxy, & requester, & frame, msglen - 16 - FINS_HEADER_LEN );
+
+}  /* handle_tcp_message */
+
+/*
+ * static void read_udp( struct fins_proxy_tp *proxy );
+ *
+ * The function read_udp() receives one FINS/UDP datagram and forwards the
+ * command in it. The address of the sender is remembered for the response.
+ */
+
+static void read_udp( struct fins_proxy_tp *proxy ) {
+
+	int recvlen;
+	socklen_t addrlen;
+	struct fins_command_tp frame;
+	struct proxy_requester_tp requester;
+
+	memset( & requester, 0, sizeof(requester) );
+
+	requester.client = -1;
+	addrlen          = sizeof( requester.udp_addr );
+
+	recvlen = recvfrom( proxy->udp_sock, (char *) frame.header, FINS_HEADER_LEN + FINS_BODY_LEN, 0, (struct sockaddr *) & requester.udp_addr, & addrlen );
+
+	if ( recvlen < FINS_HEADER_LEN ) return;
+
+	handle_request( proxy, & requester, & frame, recvlen - FINS_HEADER_LEN );
+
+}  /* read_udp */
+
+/*
+ * static void handle_request( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *in, struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function handle_request() decides what to do with a FINS command
+ * received from a client. The command is either added as an extra waiter to
+ * an identical read already in flight, sent to a free upstream connection, or
+ * queued until an upstream connection has room for it. A read is only added
+ * to a read in flight if that doesn't change the order in which the commands
+ * of the client are executed. Commands which need no response are never
+ * added to a read in flight, as there is no response to share.
+ */
+
+static void handle_request( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *in, struct fins_command_tp *frame, size_t bodylen ) {
+
+	int a;
+	size_t b;
+	size_t c;
+	size_t slot;
+	bool only_reads;
+	struct proxy_route_tp *route;
+	struct proxy_upstream_tp *pinned;
+	struct proxy_pending_tp *pending;
+	struct proxy_requester_tp requester;
+
+	if ( frame->header[FINS_ICF] & 0x40 ) return;
+
+	requester = *in;
+	memcpy( requester.header, frame->header, FINS_HEADER_LEN );
+
+	route = NULL;
+
+	for (a=0; a<FINS_PROXY_MAX_ROUTES; a++) {
+
+		if ( ! proxy->route[a].used ) continue;
+
+		if ( proxy->route[a].match_node == frame->header[FINS_DA1] ) { route = & proxy->route[a]; break; }
+		if ( proxy->route[a].match_node == 0  &&  route == NULL    )   route = & proxy->route[a];
+	}
+
+	if ( route == NULL ) { reply_error( proxy, & requester, FINS_RETVAL_DEST_NOT_IN_NETWORK ); return; }
+
+	if ( frame->header[FINS_MRC] == 0x01  &&  frame->header[FINS_SRC] == 0x01  &&  bodylen == 6  &&  ! ( frame->header[FINS_ICF] & 0x01 )  &&  ! requester_queued( route, & requester ) ) {
+
+		pinned = requester_upstream( route, & requester, & only_reads );
+
+		for (b=0; b<route->pool_size  &&  only_reads; b++) {
+
+			if ( pinned != NULL  &&  pinned != & route->upstream[b] ) continue;
+
+			for (c=0; c<FINS_PROXY_MAX_IN_FLIGHT; c++) {
+
+				pending = & route->upstream[b].pending[c];
+
+				if ( ! pending->used  ||  ! pending->coalesce                 ) continue;
+				if ( pending->num_waiters >= FINS_PROXY_MAX_WAITERS          ) continue;
+				if ( memcmp( pending->key, frame->body, 6 )                   ) continue;
+
+				pending->waiter[ pending->num_waiters++ ] = requester;
+				return;
+			}
+		}
+	}
+
+	if ( route->q_len == 0  &&  send_upstream( proxy, route, & requester, frame, bodylen ) ) return;
+
+	if ( route->q_len >= FINS_PROXY_QUEUE_LEN ) { reply_error( proxy, & requester, FINS_RETVAL_DEST_NODE_BUSY ); return; }
+
+	slot = ( route->q_head + route->q_len ) % FINS_PROXY_QUEUE_LEN;
+
+	route->queue[slot].requester = requester;
+	route->queue[slot].queued    = finslib_monotonic_sec_timer();
+	route->queue[slot].bodylen   = bodylen;
+	route->queue[slot].frame     = *frame;
+	route->q_len++;
+
+}  /* handle_request */
+
+/*
+ * static bool send_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function send_upstream() sends a command to the least loaded upstream
+ * connection of a route which still has room for another command in flight.
+ * If the client already has commands in flight, the command must go to the
+ * connection with those commands to keep them in order. The header is
+ * rewritten with the addresses and a Service ID of that connection. If no
+ * connection is available, false is returned and the caller should queue the
+ * command. A command which needs no response is sent without taking a
+ * pending slot, because no response will arrive to free it again.
+ */
+
+static bool send_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen ) {
+
+	size_t a;
+	size_t b;
+	struct proxy_upstream_tp *up;
+	struct proxy_pending_tp *pending;
+
+	up = requester_upstream( route, requester, NULL );
+
+	if ( up != NULL ) {
+
+		if ( up->state     != PROXY_UP_READY          ) return false;
+		if ( up->in_flight >= FINS_PROXY_MAX_IN_FLIGHT ) return false;
+	}
+
+	else {
+		for (a=0; a<route->pool_size; a++) {
+
+			if ( route->upstream[a].state     != PROXY_UP_READY          ) continue;
+			if ( route->upstream[a].in_flight >= FINS_PROXY_MAX_IN_FLIGHT ) continue;
+
+			if ( up == NULL  ||  route->upstream[a].in_flight < up->in_flight ) up = & route->upstream[a];
+		}
+
+		if ( up == NULL ) return false;
+	}
+
+	pending = NULL;
+
+	if ( ! ( frame->header[FINS_ICF] & 0x01 ) ) {
+
+		for (a=0; a<FINS_PROXY_MAX_IN_FLIGHT; a++) {
+
+			if ( ! up->pending[a].used ) { pending = & up->pending[a]; break; }
+		}
+
+		if ( pending == NULL ) return false;
+	}
+
+	/*
+	 * Pick a Service ID which is not used by any other command in flight on
+	 * this connection, so that responses can be matched unambiguously.
+	 */
+
+	for (a=0; a<FINS_PROXY_MAX_IN_FLIGHT; a++) {
+
+		for (b=0; b<FINS_PROXY_MAX_IN_FLIGHT; b++) {
+
+			if ( up->pending[b].used  &&  up->pending[b].sid == up->next_sid ) break;
+		}
+
+		if ( b == FINS_PROXY_MAX_IN_FLIGHT ) break;
+
+		up->next_sid++;
+	}
+
+	frame->header[FINS_DNA] = up->conn.remote_net;
+	frame->header[FINS_DA1] = up->conn.remote_node;
+	frame->header[FINS_DA2] = up->conn.remote_unit;
+	frame->header[FINS_SNA] = up->conn.local_net;
+	frame->header[FINS_SA1] = up->conn.local_node;
+	frame->header[FINS_SA2] = up->conn.local_unit;
+	frame->header[FINS_SID] = up->next_sid++;
+
+	if ( pending != NULL ) {
+
+		pending->used        = true;
+		pending->sid         = frame->header[FINS_SID];
+		pending->sent        = finslib_monotonic_sec_timer();
+		pending->num_waiters = 1;
+		pending->waiter[0]   = *requester;
+		pending->coalesce    = ( frame->header[FINS_MRC] == 0x01  &&  frame->header[FINS_SRC] == 0x01  &&  bodylen == 6 );
+
+		if ( pending->coalesce ) memcpy( pending->key, frame->body, 6 );
+
+		up->in_flight++;
+	}
+
+	if ( XX_finslib_send_command( & up->conn, frame, bodylen ) != FINS_RETVAL_SUCCESS ) reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+
+	return true;
+
+}  /* send_upstream */
+
+/*
+ * static bool same_requester( const struct proxy_requester_tp *a, const struct proxy_requester_tp *b );
+ *
+ * The function same_requester() returns true if two requests were sent by the
+ * same client. FINS/TCP clients are identified by their slot and generation,
+ * FINS/UDP clients by their IP address and port.
+ */
+
+static bool same_requester( const struct proxy_requester_tp *a, const struct proxy_requester_tp *b ) {
+
+	if ( a->client != b->client ) return false;
+	if ( a->client >= 0         ) return ( a->generation == b->generation );
+
+	return ( a->udp_addr.sin_addr.s_addr == b->udp_addr.sin_addr.s_addr  &&  a->udp_addr.sin_port == b->udp_addr.sin_port );
+
+}  /* same_requester */
+
+/*
+ * static struct proxy_upstream_tp *requester_upstream( struct proxy_route_tp *route, const struct proxy_requester_tp *requester, bool *only_reads );
+ *
+ * The function requester_upstream() returns the upstream connection of a
+ * route on which a client has commands in flight, or NULL if the client has
+ * no commands in flight. If only_reads is not NULL, it is set to true when
+ * all these commands are reads which may be coalesced.
+ */
+
+static struct proxy_upstream_tp *requester_upstream( struct proxy_route_tp *route, const struct proxy_requester_tp *requester, bool *only_reads ) {
+
+	size_t a;
+	size_t b;
+	size_t c;
+	struct proxy_upstream_tp *found;
+	const struct proxy_pending_tp *pending;
+
+	found = NULL;
+
+	if ( only_reads != NULL ) *only_reads = true;
+
+	for (a=0; a<route->pool_size; a++) {
+
+		for (b=0; b<FINS_PROXY_MAX_IN_FLIGHT; b++) {
+
+			pending = & route->upstream[a].pending[b];
+			if ( ! pending->used ) continue;
+
+			for (c=0; c<pending->num_waiters; c++) {
+
+				if ( ! same_requester( & pending->waiter[c], requester ) ) continue;
+
+				found = & route->upstream[a];
+
+				if ( only_reads != NULL  &&  ! pending->coalesce ) *only_reads = false;
+			}
+		}
+	}
+
+	return found;
+
+}  /* requester_upstream */
+
+/*
+ * static bool requester_queued( const struct proxy_route_tp *route, const struct proxy_requester_tp *requester );
+ *
+ * The function requester_queued() returns true if a client has commands in
+ * the queue of a route which are not sent upstream yet.
+ */
+
+static bool requester_queued( const struct proxy_route_tp *route, const struct proxy_requester_tp *requester ) {
+
+	size_t a;
+
+	for (a=0; a<route->q_len; a++) {
+
+		if ( same_requester( & route->queue[ ( route->q_head + a ) % FINS_PROXY_QUEUE_LEN ].requester, requester ) ) return true;
+	}
+
+	return false;
+
+}  /* requester_queued */
+
+/*
+ * static void dispatch_queue( struct fins_proxy_tp *proxy, struct proxy_route_tp *route );
+ *
+ * The function dispatch_queue() sends queued commands of a route upstream as
+ * long as there is room on one of the upstream connections.
+ */
+
+static void dispatch_queue( struct fins_proxy_tp *proxy, struct proxy_route_tp *route ) {
+
+	struct proxy_queued_tp *queued;
+
+	while ( route->q_len > 0 ) {
+
+		queued = & route->queue[ route->q_head ];
+
+		if ( ! send_upstream( proxy, route, & queued->requester, & queued->frame, queued->bodylen ) ) return;
+
+		route->q_head = ( route->q_head + 1 ) % FINS_PROXY_QUEUE_LEN;
+		route->q_len--;
+	}
+
+}  /* dispatch_queue */
+
+/*
+ * static void open_upstream( struct proxy_route_tp *route, struct proxy_upstream_tp *up, time_t now );
+ *
+ * The function open_upstream() starts a new connection with the PLC of a
+ * route without waiting for it. A FINS/UDP connection can be used right away.
+ * A FINS/TCP connection first has to be established and to complete the node
+ * address handshake before commands are sent over it. If the connection can
+ * not be started, a new attempt is made after a short delay.
+ */
+
+static void open_upstream( struct proxy_route_tp *route, struct proxy_upstream_tp *up, time_t now ) {
+
+	int error_val;
+	int keep_alive;
+	struct sockaddr_in cs_addr;
+	struct fins_sys_tp *sys;
+
+	sys          = & up->conn;
+	up->inlen    = 0;
+	up->retry    = now + FINS_PROXY_RETRY;
+	up->deadline = now + FINS_PROXY_TIMEOUT;
+
+	if ( finslib_connection_init( sys, route->address, route->port, route->local_net, route->local_node, 0, route->remote_net, route->remote_node, route->remote_unit, 0 ) != FINS_RETVAL_SUCCESS ) return;
+
+	if ( route->comm_type == FINS_COMM_TYPE_UDP ) {
+
+		finslib_udp_connect( sys, route->address, route->port, route->local_net, route->local_node, 0, route->remote_net, route->remote_node, route->remote_unit, & error_val, 0 );
+
+		if ( sys->sockfd == INVALID_SOCKET ) return;
+
+		if ( ! set_nonblocking( sys->sockfd ) ) { finslib_disconnect( sys ); return; }
+
+		up->state = PROXY_UP_READY;
+		return;
+	}
+
+	memset( & cs_addr, 0, sizeof(cs_addr) );
+
+	cs_addr.sin_family = AF_INET;
+	cs_addr.sin_port   = htons( sys->port );
+
+	if ( finslib_inet_pton( AF_INET, sys->address, & cs_addr.sin_addr.s_addr ) != 1 ) return;
+
+	sys->comm_type = FINS_COMM_TYPE_TCP;
+	sys->sockfd    = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+	if ( sys->sockfd == INVALID_SOCKET ) return;
+
+	keep_alive = true;
+	setsockopt( sys->sockfd, SOL_SOCKET, SO_KEEPALIVE, (setsockopt_tp *) & keep_alive, sizeof(keep_alive) );
+
+	if ( ! set_nonblocking( sys->sockfd ) ) { finslib_disconnect( sys ); return; }
+
+	if ( connect( sys->sockfd, (struct sockaddr *) & cs_addr, sizeof(cs_addr) ) < 0  &&  ! socket_would_block( true ) ) {
+
+		finslib_disconnect( sys );
+		return;
+	}
+
+	up->state = PROXY_UP_CONNECTING;
+
+}  /* open_upstream */
+
+/*
+ * static void connect_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up );
+ *
+ * The function connect_upstream() is called when a FINS/TCP connection which
+ * is being established becomes writable. If the connection succeeded, the
+ * node address request is sent and the response is collected by
+ * read_upstream().
+ */
+
+static void connect_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up ) {
+
+	int error_code;
+	socklen_t optlen;
+	unsigned char request[20];
+
+	error_code = 0;
+	optlen     = sizeof(error_code);
+
+	if ( getsockopt( up->conn.sockfd, SOL_SOCKET, SO_ERROR, (char *) & error_code, & optlen ) < 0  ||  error_code != 0 ) {
+
+		reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+		return;
+	}
+
+	XX_finslib_server_tcp_header( request, 0x00000000, 0x00000000, 4 );
+
+	request[16] = 0x00;
+	request[17] = 0x00;
+	request[18] = 0x00;
+	request[19] = 0x00;		/* Get node number automatically	*/
+
+	if ( send( up->conn.sockfd, (const char *) request, 20, 0 ) != 20 ) {
+
+		reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+		return;
+	}
+
+	up->state = PROXY_UP_HANDSHAKE;
+	up->inlen = 0;
+
+}  /* connect_upstream */
+
+/*
+ * static void read_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up );
+ *
+ * The function read_upstream() reads the data available on an upstream
+ * socket without blocking. A FINS/UDP socket delivers one response per
+ * datagram. On a FINS/TCP socket the data is appended to the input buffer of
+ * the connection and every complete message in it is handled. The first
+ * message on a new FINS/TCP connection is the node address response of the
+ * handshake.
+ */
+
+static void read_upstream( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up ) {
+
+	int recvlen;
+	int error_val;
+	size_t msglen;
+	size_t bodylen;
+	struct fins_command_tp frame;
+
+	if ( up->conn.comm_type == FINS_COMM_TYPE_UDP ) {
+
+		recvlen = recv( up->conn.sockfd, (char *) frame.header, FINS_HEADER_LEN + FINS_BODY_LEN, 0 );
+
+		if ( recvlen < 0  &&  socket_would_block( false ) ) return;
+
+		if ( recvlen < 0 ) {
+
+			XX_finslib_recv_complete( & up->conn, NULL, & frame, recvlen, XX_finslib_socket_error(), & bodylen );
+			reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK );
+			return;
+		}
+
+		if ( XX_finslib_recv_complete( & up->conn, NULL, & frame, recvlen, FINS_RETVAL_SUCCESS, & bodylen ) == FINS_RETVAL_SUCCESS ) handle_response( proxy, route, up, & frame, bodylen );
+
+		return;
+	}
+
+	recvlen = recv( up->conn.sockfd, (char *) up->inbuf + up->inlen, (int) (PROXY_TCP_BUFLEN - up->inlen), 0 );
+
+	if ( recvlen < 0  &&  socket_would_block( false ) ) return;
+	if ( recvlen <= 0 ) { reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK ); return; }
+
+	up->inlen += recvlen;
+
+	if ( up->state == PROXY_UP_HANDSHAKE ) {
+
+		if ( up->inlen < 24 ) return;
+
+		if ( tcp_command( up->inbuf ) != 0x00000001 ) { reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK ); return; }
+
+		up->conn.local_node  = up->inbuf[19];
+		up->conn.remote_node = up->inbuf[23];
+
+		XX_finslib_init_header( & up->conn );
+
+		up->state  = PROXY_UP_READY;
+		up->inlen -= 24;
+		memmove( up->inbuf, up->inbuf + 24, up->inlen );
+
+		dispatch_queue( proxy, route );
+	}
+
+	while ( up->state == PROXY_UP_READY ) {
+
+		msglen = XX_finslib_server_tcp_message_len( up->inbuf, up->inlen, & error_val );
+
+		if ( error_val != FINS_RETVAL_SUCCESS ) { reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK ); return; }
+		if ( msglen == 0  ||  msglen > up->inlen ) return;
+
+		if ( tcp_command( up->inbuf ) != 0x00000002 ) { reset_upstream( proxy, up, FINS_RETVAL_DEST_NOT_IN_NETWORK ); return; }
+
+		memcpy( frame.header, up->inbuf + 16, msglen - 16 );
+
+		up->inlen -= msglen;
+		memmove( up->inbuf, up->inbuf + msglen, up->inlen );
+
+		if ( XX_finslib_recv_complete( & up->conn, NULL, & frame, (int) (msglen - 16), FINS_RETVAL_SUCCESS, & bodylen ) == FINS_RETVAL_SUCCESS ) handle_response( proxy, route, up, & frame, bodylen );
+	}
+
+}  /* read_upstream */
+
+/*
+ * static void handle_response( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up, struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function handle_response() forwards a response received from a PLC to
+ * every client waiting for it with the original header restored. Responses
+ * for which no command is in flight anymore are dropped.
+ */
+
+static void handle_response( struct fins_proxy_tp *proxy, struct proxy_route_tp *route, struct proxy_upstream_tp *up, struct fins_command_tp *frame, size_t bodylen ) {
+
+	size_t a;
+	struct proxy_pending_tp *pending;
+
+	pending = NULL;
+
+	for (a=0; a<FINS_PROXY_MAX_IN_FLIGHT; a++) {
+
+		if ( up->pending[a].used  &&  up->pending[a].sid == frame->header[FINS_SID] ) { pending = & up->pending[a]; break; }
+	}
+
+	if ( pending == NULL ) return;
+
+	for (a=0; a<pending->num_waiters; a++) reply( proxy, & pending->waiter[a], frame, bodylen );
+
+	pending->used        = false;
+	pending->num_waiters = 0;
+	up->in_flight--;
+
+	dispatch_queue( proxy, route );
+
+}  /* handle_response */
+
+/*
+ * static void reset_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up, uint16_t endcode );
+ *
+ * The function reset_upstream() closes a failing upstream connection. All
+ * clients with commands in flight on that connection receive an error
+ * response. A new connection is attempted after a short delay.
+ */
+
+static void reset_upstream( struct fins_proxy_tp *proxy, struct proxy_upstream_tp *up, uint16_t endcode ) {
+
+	size_t a;
+	struct proxy_requester_tp requester;
+
+	for (a=0; a<FINS_PROXY_MAX_IN_FLIGHT; a++) {
+
+		while ( up->pending[a].used  &&  up->pending[a].num_waiters > 0 ) {
+
+			requester = up->pending[a].waiter[ --up->pending[a].num_waiters ];
+			reply_error( proxy, & requester, endcode );
+		}
+
+		up->pending[a].used = false;
+	}
+
+	if ( up->state != PROXY_UP_IDLE ) finslib_disconnect( & up->conn );
+
+	up->state     = PROXY_UP_IDLE;
+	up->inlen     = 0;
+	up->in_flight = 0;
+	up->retry     = finslib_monotonic_sec_timer() + FINS_PROXY_RETRY;
+
+}  /* reset_upstream */
+
+/*
+ * static void reply( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function reply() sends a response frame to a client. The addresses and
+ * Service ID in the header are restored from the original request. Clients
+ * which sent a command with the "response not required" bit set get nothing.
+ */
+
+static void reply( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, struct fins_command_tp *frame, size_t bodylen ) {
+
+	unsigned char icf;
+	unsigned char gct;
+	unsigned char buf[16+FINS_HEADER_LEN+FINS_BODY_LEN];
+
+	if ( requester->header[FINS_ICF] & 0x01 ) return;
+
+	icf = frame->header[FINS_ICF];
+	gct = frame->header[FINS_GCT];
+
+	XX_finslib_response_header( frame, requester->header );
+
+	frame->header[FINS_ICF] = icf;
+	frame->header[FINS_GCT] = gct;
+
+	if ( requester->client < 0 ) {
+
+		sendto( proxy->udp_sock, (const char *) frame->header, (int) (FINS_HEADER_LEN + bodylen), 0, (const struct sockaddr *) & requester->udp_addr, sizeof(requester->udp_addr) );
+		return;
+	}
+
+	if ( proxy->client[ requester->client ].sockfd     == INVALID_SOCKET        ) return;
+	if ( proxy->client[ requester->client ].generation != requester->generation ) return;
+
+	XX_finslib_server_tcp_header( buf, 0x00000002, 0x00000000, FINS_HEADER_LEN + bodylen );
+
+	memcpy( buf+16,                 frame->header, FINS_HEADER_LEN );
+	memcpy( buf+16+FINS_HEADER_LEN, frame->body,   bodylen         );
+
+	send_client( proxy, requester->client, buf, 16 + FINS_HEADER_LEN + bodylen );
+
+}  /* reply */
+
+/*
+ * static void reply_error( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, uint16_t endcode );
+ *
+ * The function reply_error() sends a response with only an end code to a
+ * client. It is used when the proxy itself can not execute a command.
+ */
+
+static void reply_error( struct fins_proxy_tp *proxy, const struct proxy_requester_tp *requester, uint16_t endcode ) {
+
+	struct fins_command_tp frame;
+
+	XX_finslib_response_header( & frame, requester->header );
+
+	frame.body[0] = (endcode >> 8) & 0xff;
+	frame.body[1] = (endcode     ) & 0xff;
+
+	reply( proxy, requester, & frame, 2 );
+
+}  /* reply_error */
+
+/*
+ * static bool set_nonblocking( SOCKET sockfd );
+ *
+ * The function set_nonblocking() puts a socket in non-blocking mode. It
+ * returns false if that is not possible.
+ */
+
+static bool set_nonblocking( SOCKET sockfd ) {
+
+#if defined(_WIN32)
+	u_long mode;
+
+	mode = 1;
+
+	return ( ioctlsocket( sockfd, FIONBIO, & mode ) == 0 );
+#else
+	int flags;
+
+	flags = fcntl( sockfd, F_GETFL, 0 );
+	if ( flags < 0 ) return false;
+
+	return ( fcntl( sockfd, F_SETFL, flags | O_NONBLOCK ) == 0 );
+#endif
+
+}  /* set_nonblocking */
+
+/*
+ * static bool socket_would_block( bool connecting );
+ *
+ * The function socket_would_block() returns true if the last socket call
+ * failed only because it would have to wait on a non-blocking socket. The
+ * connecting parameter is true when that call was connect().
+ */
+
+static bool socket_would_block( bool connecting ) {
+
+#if defined(_WIN32)
+	(void) connecting;
+
+	return ( WSAGetLastError() == WSAEWOULDBLOCK );
+#else
+	if ( connecting ) return ( errno == EINPROGRESS );
+
+	return ( errno == EAGAIN  ||  errno == EWOULDBLOCK  ||  errno == EINTR );
+#endif
+
+}  /* socket_would_block */
+
+/*
+ * static uint32_t tcp_command( const unsigned char *msg );
+ *
+ * The function tcp_command() returns the command field of a FINS/TCP message.
+ */
+
+static uint32_t tcp_command( const unsigned char *msg ) {
+
+	uint32_t command;
+
+	command     = msg[8];
+	command   <<= 8;
+	command    += msg[9];
+	command   <<= 8;
+	command    += msg[10];
+	command   <<= 8;
+	command    += msg[11];
+
+	return command;
+
+}  /* tcp_command */
@@ -0,0 +1,381 @@
+/*
+ * Library: libfins
+ * File:    src/fins_schedule.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_schedule.c contains a scheduler which refreshes
+ * tags at different rates. Each tag is registered with its own period and an
+ * optional deadline. When the application calls finslib_schedule_tick(), all
+ * tags which are due are collected per PLC and read together with multiple
+ * memory area read commands, so that the tags of all rate groups on one PLC
+ * share the same frames.
+ *
+ * Slower tags which will become due before the next refresh of the fastest
+ * due tag on the same PLC are read early in the same frames. Their schedule
+ * keeps its phase, so that a tag is never refreshed more often than its
+ * period. This removes the extra frames which would otherwise be needed for
+ * slow tags whose due time falls between two fast refreshes.
+ *
+ * Tags are kept grouped per connection in the order in which they were added
+ * so that a tick is a single pass over all tags.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define SCHEDULE_MIN_TAGS	16
+
+									/********************************************************/
+struct schedule_tag_tp {						/*							*/
+	struct fins_sys_tp *		sys;				/* Connection of the PLC with the tag			*/
+	struct fins_multidata_tp *	item;				/* Caller owned address, type and value of the tag	*/
+	int				period_msec;			/* Refresh period in milliseconds			*/
+	int				deadline_msec;			/* Max msec after the due time for the read to end	*/
+	int64_t				next_due;			/* Monotonic msec time at which the tag is due		*/
+	int				retval;				/* Result of the last read				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_schedule_tp {						/*							*/
+	size_t				num_tags;			/* Number of registered tags				*/
+	size_t				max_tags;			/* Number of tags allocated				*/
+	struct schedule_tag_tp *	tag;				/* The tags grouped per connection			*/
+	struct fins_multidata_tp *	scratch;			/* Items of the tags read in one group			*/
+	size_t *			scratch_tag;			/* Tag index of each item in scratch			*/
+	struct fins_schedstats_tp	stats;				/* Timing statistics					*/
+};									/*							*/
+									/********************************************************/
+
+static int			read_group( struct fins_schedule_tp *schedule, size_t first, size_t last, int64_t now );
+
+/*
+ * struct fins_schedule_tp *finslib_schedule_create( int *error_val );
+ *
+ * The function finslib_schedule_create() creates an empty tag scheduler.
+ *
+ * The function returns a pointer to the scheduler, or NULL if no memory could
+ * be allocated. In that case an error code is returned in error_val.
+ */
+
+struct fins_schedule_tp *finslib_schedule_create( int *error_val ) {
+
+	struct fins_schedule_tp *schedule;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	schedule = calloc( 1, sizeof(struct fins_schedule_tp) );
+
+	if ( schedule == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	return schedule;
+
+}  /* finslib_schedule_create */
+
+/*
+ * void finslib_schedule_destroy( struct fins_schedule_tp *schedule );
+ *
+ * The function finslib_schedule_destroy() releases a scheduler. The items and
+ * connections registered with it are owned by the caller and left untouched.
+ */
+
+void finslib_schedule_destroy( struct fins_schedule_tp *schedule ) {
+
+	if ( schedule == NULL ) return;
+
+	free( schedule->tag         );
+	free( schedule->scratch     );
+	free( schedule->scratch_tag );
+	free( schedule              );
+
+}  /* finslib_schedule_destroy */
+
+/*
+ * int finslib_schedule_add( struct fins_schedule_tp *schedule, struct fins_sys_tp *sys, struct fins_multidata_tp *item, int period_msec, int deadline_msec );
+ *
+ * The function finslib_schedule_add() registers a tag with a scheduler. The
+ * address and type of the tag are taken from item, and each refresh stores
+ * the new value in the same item. The item must stay valid as long as the
+ * scheduler is used. A deadline of 0 means that the read must be finished
+ * within one period after the tag became due. The tag is due at the first
+ * tick after it has been added.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_schedule_add( struct fins_schedule_tp *schedule, struct fins_sys_tp *sys, struct fins_multidata_tp *item, int period_msec, int deadline_msec ) {
+
+	size_t a;
+	size_t pos;
+	size_t new_max;
+	struct schedule_tag_tp *new_tag;
+	struct fins_multidata_tp *new_scratch;
+	size_t *new_scratch_tag;
+
+	if ( schedule    == NULL                                                      ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys         == NULL                                                      ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( item        == NULL                                                      ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( item->type  <= FINS_DATA_TYPE_NONE  ||  item->type > FINS_DATA_TYPE_LAST ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( period_msec <= 0                    ||  deadline_msec < 0                ) return FINS_RETVAL_INVALID_PERIOD;
+
+	if ( schedule->num_tags >= schedule->max_tags ) {
+
+		new_max = ( schedule->max_tags == 0 ) ? SCHEDULE_MIN_TAGS : 2 * schedule->max_tags;
+
+		new_tag = realloc( schedule->tag, new_max * sizeof(struct schedule_tag_tp) );
+		if ( new_tag == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+		schedule->tag = new_tag;
+
+		new_scratch = realloc( schedule->scratch, new_max * sizeof(struct fins_multidata_tp) );
+		if ( new_scratch == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+		schedule->scratch = new_scratch;
+
+		new_scratch_tag = realloc( schedule->scratch_tag, new_max * sizeof(size_t) );
+		if ( new_scratch_tag == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+		schedule->scratch_tag = new_scratch_tag;
+
+		schedule->max_tags = new_max;
+	}
+
+	/*
+	 * The new tag is placed after the last tag of the same connection to
+	 * keep the tags of each PLC together.
+	 */
+
+	pos = schedule->num_tags;
+
+	for (a=schedule->num_tags; a>0; a--) {
+
+		if ( schedule->tag[a-1].sys == sys ) {
+
+			pos = a;
+			break;
+		}
+	}
+
+	memmove( & schedule->tag[pos+1], & schedule->tag[pos], ( schedule->num_tags - pos ) * sizeof(struct schedule_tag_tp) );
+
+	schedule->tag[pos].sys           = sys;
+	schedule->tag[pos].item          = item;
+	schedule->tag[pos].period_msec   = period_msec;
+	schedule->tag[pos].deadline_msec = ( deadline_msec > 0 ) ? deadline_msec : period_msec;
+	schedule->tag[pos].next_due      = finslib_monotonic_msec_timer();
+	schedule->tag[pos].retval        = FINS_RETVAL_SUCCESS;
+
+	schedule->num_tags++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_schedule_add */
+
+/*
+ * int finslib_schedule_tick( struct fins_schedule_tp *schedule, size_t *num_read );
+ *
+ * The function finslib_schedule_tick() reads all tags which are due, together
+ * with the tags which can be read early in the same frames. The number of
+ * tags refreshed is returned in num_read if it is not NULL. A failing PLC does
+ * not stop the refresh of the other PLCs.
+ *
+ * The function returns FINS_RETVAL_SUCCESS if all reads succeeded, or the
+ * error code of the first read which failed.
+ */
+
+int finslib_schedule_tick( struct fins_schedule_tp *schedule, size_t *num_read ) {
+
+	size_t first;
+	size_t last;
+	uint64_t tags_before;
+	int64_t now;
+	int retval;
+	int first_error;
+
+	if ( num_read != NULL ) *num_read = 0;
+
+	if ( schedule == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	now         = finslib_monotonic_msec_timer();
+	first_error = FINS_RETVAL_SUCCESS;
+	tags_before = schedule->stats.tags_read;
+	first       = 0;
+
+	while ( first < schedule->num_tags ) {
+
+		last = first + 1;
+		while ( last < schedule->num_tags  &&  schedule->tag[last].sys == schedule->tag[first].sys ) last++;
+
+		retval = read_group( schedule, first, last, now );
+		if ( retval != FINS_RETVAL_SUCCESS  &&  first_error == FINS_RETVAL_SUCCESS ) first_error = retval;
+
+		first = last;
+	}
+
+	if ( schedule->stats.tags_read > tags_before ) schedule->stats.ticks++;
+
+	if ( num_read != NULL ) *num_read = (size_t) ( schedule->stats.tags_read - tags_before );
+
+	return first_error;
+
+}  /* finslib_schedule_tick */
+
+/*
+ * static int read_group( struct fins_schedule_tp *schedule, size_t first, size_t last, int64_t now );
+ *
+ * The function read_group() reads the tags first up to last of one PLC which
+ * are due at time now. The shortest period of the due tags determines how
+ * far ahead slower tags are taken along.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+static int read_group( struct fins_schedule_tp *schedule, size_t first, size_t last, int64_t now ) {
+
+	size_t a;
+	size_t num_items;
+	int64_t horizon;
+	int64_t jitter;
+	int64_t done;
+	struct schedule_tag_tp *tag;
+	int retval;
+
+	horizon = -1;
+
+	for (a=first; a<last; a++) {
+
+		tag = & schedule->tag[a];
+
+		if ( tag->next_due <= now  &&  ( horizon < 0  ||  tag->period_msec < horizon ) ) horizon = tag->period_msec;
+	}
+
+	if ( horizon < 0 ) return FINS_RETVAL_SUCCESS;
+
+	num_items = 0;
+
+	for (a=first; a<last; a++) {
+
+		tag = & schedule->tag[a];
+
+		if ( tag->next_due > now + horizon                       ) continue;
+		if ( tag->next_due > now  &&  tag->period_msec <= horizon ) continue;
+
+		schedule->scratch[num_items]     = *tag->item;
+		schedule->scratch_tag[num_items] = a;
+		num_items++;
+	}
+
+	retval = finslib_multiple_memory_area_read( schedule->tag[first].sys, schedule->scratch, num_items );
+	done   = finslib_monotonic_msec_timer();
+
+	schedule->stats.frames += ( num_items + FINS_MAX_READ_ITEMS_MULTIPLE - 1 ) / FINS_MAX_READ_ITEMS_MULTIPLE;
+
+	for (a=0; a<num_items; a++) {
+
+		tag = & schedule->tag[ schedule->scratch_tag[a] ];
+
+		if ( retval == FINS_RETVAL_SUCCESS ) *tag->item = schedule->scratch[a];
+		else                                 schedule->stats.errors++;
+
+		tag->retval = retval;
+		schedule->stats.tags_read++;
+
+		if ( tag->next_due > now ) schedule->stats.tags_early++;
+		else {
+			jitter = now - tag->next_due;
+
+			schedule->stats.jitter_sum_msec += (uint64_t) jitter;
+			if ( jitter > schedule->stats.jitter_max_msec ) schedule->stats.jitter_max_msec = jitter;
+		}
+
+		if ( done > tag->next_due + tag->deadline_msec ) schedule->stats.overruns++;
+
+		/*
+		 * The schedule keeps its phase. Periods which were missed
+		 * completely are skipped instead of being caught up with a burst
+		 * of reads.
+		 */
+
+		tag->next_due += tag->period_msec;
+		if ( tag->next_due <= now ) tag->next_due = now + tag->period_msec;
+	}
+
+	return retval;
+
+}  /* read_group */
+
+/*
+ * int64_t finslib_schedule_next( const struct fins_schedule_tp *schedule );
+ *
+ * The function finslib_schedule_next() returns the number of milliseconds
+ * until the next tag is due. The application can sleep this long before it
+ * calls finslib_schedule_tick() again. The value is 0 if a tag is already due,
+ * and -1 if there are no tags.
+ */
+
+int64_t finslib_schedule_next( const struct fins_schedule_tp *schedule ) {
+
+	size_t a;
+	int64_t now;
+	int64_t next;
+
+	if ( schedule == NULL  ||  schedule->num_tags == 0 ) return -1;
+
+	next = schedule->tag[0].next_due;
+
+	for (a=1; a<schedule->num_tags; a++) {
+
+		if ( schedule->tag[a].next_due < next ) next = schedule->tag[a].next_due;
+	}
+
+	now = finslib_monotonic_msec_timer();
+
+	return ( next > now ) ? next - now : 0;
+
+}  /* finslib_schedule_next */
+
+/*
+ * int finslib_schedule_stats( const struct fins_schedule_tp *schedule, struct fins_schedstats_tp *stats );
+ *
+ * The function finslib_schedule_stats() returns a copy of the timing
+ * statistics of a scheduler.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_schedule_stats( const struct fins_schedule_tp *schedule, struct fins_schedstats_tp *stats ) {
+
+	if ( schedule == NULL  ||  stats == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	*stats = schedule->stats;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_schedule_stats */
@@ -153,13 +153,28 @@ static const struct fins_area_tp fins_area[] = {
 
 const struct fins_area_tp *XX_finslib_search_area( struct fins_sys_tp *sys, const struct fins_address_tp *address, int bits, uint32_t accs, bool force ) {
 
+	return XX_finslib_search_area_mode( sys->plc_mode, address, bits, accs, force );
+
+}  /* XX_finslib_search_area */
+
+/*
+ * const struct fins_area_tp *XX_finslib_search_area_mode( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t accs, bool force );
+ *
+ * The function XX_finslib_search_area_mode() returns a pointer to an area of
+ * a PLC with the given communication mode which matches the parameters, or
+ * NULL if no such area could be found. It allows addresses to be resolved
+ * before a connection with a PLC exists.
+ */
+
+const struct fins_area_tp *XX_finslib_search_area_mode( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t accs, bool force ) {
+
 	int a;
 
 	a = 0;
 
 	while ( fins_area[a].plc_mode != FINS_MODE_UNKNOWN ) {
 
-		if (   fins_area[a].plc_mode           != sys->plc_mode         ) { a++; continue; }
+		if (   fins_area[a].plc_mode           != plc_mode              ) { a++; continue; }
 		if (   fins_area[a].bits               != bits                  ) { a++; continue; }
 		if ( ( fins_area[a].access & accs )    == 0x00000000            ) { a++; continue; }
 		if (   fins_area[a].force              != force                 ) { a++; continue; }
@@ -174,4 +189,48 @@ const struct fins_area_tp *XX_finslib_search_area( struct fins_sys_tp *sys, cons
 
 	return & fins_area[a];
 
-}  /* XX_finslib_search_area */
+}  /* XX_finslib_search_area_mode */
+
+/*
+ * bool XX_finslib_resolve_memaddr( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t accs, struct fins_memaddr_tp *memaddr );
+ *
+ * The function XX_finslib_resolve_memaddr() converts a decoded address to an
+ * address handle for a PLC with the given communication mode. The area is
+ * searched with the access accs. Some areas have different access rights for
+ * parts of their range, so the access flags of the handle combine all areas
+ * with the same area code which contain the address. The function returns
+ * false on success and true if no matching area exists.
+ */
+
+bool XX_finslib_resolve_memaddr( int plc_mode, const struct fins_address_tp *address, int bits, uint32_t accs, struct fins_memaddr_tp *memaddr ) {
+
+	int a;
+	const struct fins_area_tp *area_ptr;
+
+	area_ptr = XX_finslib_search_area_mode( plc_mode, address, bits, accs, false );
+	if ( area_ptr == NULL ) return true;
+
+	memaddr->plc_mode  = plc_mode;
+	memaddr->area      = area_ptr->area;
+	memaddr->bits      = (uint8_t) bits;
+	memaddr->bit       = ( bits == 1 ) ? (uint8_t) ( address->sub_address & 0x0f ) : 0;
+	memaddr->start     = address->main_address + ( area_ptr->low_addr >> 8 ) - area_ptr->low_id;
+	memaddr->num_words = area_ptr->high_id - address->main_address + 1;
+	memaddr->access    = 0;
+
+	for (a=0; fins_area[a].plc_mode != FINS_MODE_UNKNOWN; a++) {
+
+		if ( fins_area[a].plc_mode != plc_mode               ) continue;
+		if ( fins_area[a].area     != area_ptr->area         ) continue;
+		if ( fins_area[a].bits     != bits                   ) continue;
+		if ( fins_area[a].force                              ) continue;
+		if ( fins_area[a].low_id   >  address->main_address  ) continue;
+		if ( fins_area[a].high_id  <  address->main_address  ) continue;
+		if ( strcmp( fins_area[a].name, address->name )      ) continue;
+
+		memaddr->access |= (uint32_t) fins_area[a].access;
+	}
+
+	return false;
+
+}  /* XX_finslib_resolve_memaddr */
@@ -0,0 +1,272 @@
+/*
+ * Library: libfins
+ * File:    src/fins_server.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_server.c contains low level routines for the server
+ * side of a FINS/TCP or FINS/UDP connection. They are used by applications
+ * which accept FINS commands from clients, like the FINS proxy.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <unistd.h>
+#include <netinet/in.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+#define SEND_TIMEOUT	10
+
+#if defined(_WIN32)
+typedef const char	setsockopt_tp;
+#else
+typedef void		setsockopt_tp;
+#endif
+
+/*
+ * SOCKET XX_finslib_server_socket( uint8_t comm_type, uint16_t port, int *error_val );
+ *
+ * The function XX_finslib_server_socket() creates a socket which listens for
+ * incoming FINS/TCP connections or FINS/UDP datagrams on a specific port. On
+ * error INVALID_SOCKET is returned and the reason is stored in the error_val
+ * parameter if that is not NULL.
+ */
+
+SOCKET XX_finslib_server_socket( uint8_t comm_type, uint16_t port, int *error_val ) {
+
+	SOCKET sockfd;
+	int reuse;
+	struct sockaddr_in ws_addr;
+
+	if ( comm_type == FINS_COMM_TYPE_TCP ) sockfd = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	else                                   sockfd = socket( AF_INET, SOCK_DGRAM,  IPPROTO_UDP );
+
+	if ( sockfd == INVALID_SOCKET ) {
+
+		if ( error_val != NULL ) *error_val = XX_finslib_socket_error();
+		return INVALID_SOCKET;
+	}
+
+	reuse = true;
+	setsockopt( sockfd, SOL_SOCKET, SO_REUSEADDR, (setsockopt_tp *) & reuse, sizeof(reuse) );
+
+	memset( & ws_addr, 0, sizeof(ws_addr) );
+
+	ws_addr.sin_family      = AF_INET;
+	ws_addr.sin_addr.s_addr = htonl( INADDR_ANY );
+	ws_addr.sin_port        = htons( port );
+
+	if ( bind( sockfd, (struct sockaddr *) & ws_addr, sizeof(ws_addr) ) < 0  ||
+	     ( comm_type == FINS_COMM_TYPE_TCP  &&  listen( sockfd, SOMAXCONN ) < 0 ) ) {
+
+		if ( error_val != NULL ) *error_val = XX_finslib_socket_error();
+		closesocket( sockfd );
+		return INVALID_SOCKET;
+	}
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	return sockfd;
+
+}  /* XX_finslib_server_socket */
+
+/*
+ * SOCKET XX_finslib_server_accept( SOCKET listenfd );
+ *
+ * The function XX_finslib_server_accept() accepts a new FINS/TCP client on a
+ * listening socket. A send timeout is set on the new connection to prevent a
+ * stalled client from blocking the server indefinitely.
+ */
+
+SOCKET XX_finslib_server_accept( SOCKET listenfd ) {
+
+	SOCKET sockfd;
+	struct timeval tv ={ 0 };
+
+	sockfd = accept( listenfd, NULL, NULL );
+	if ( sockfd == INVALID_SOCKET ) return INVALID_SOCKET;
+
+	tv.tv_sec  = SEND_TIMEOUT;
+	tv.tv_usec = 0;
+
+	setsockopt( sockfd, SOL_SOCKET, SO_SNDTIMEO, (setsockopt_tp *) & tv, sizeof(tv) );
+
+	return sockfd;
+
+}  /* XX_finslib_server_accept */
+
+/*
+ * size_t XX_finslib_server_tcp_message_len( const unsigned char *buf, size_t len, int *error_val );
+ *
+ * The function XX_finslib_server_tcp_message_len() inspects the start of a
+ * FINS/TCP message received from a client and returns the total length of
+ * that message including the FINS/TCP header. The value 0 is returned if not
+ * enough bytes have been received yet to determine the length, or if the
+ * message is invalid. In the latter case error_val is set accordingly.
+ */
+
+size_t XX_finslib_server_tcp_message_len( const unsigned char *buf, size_t len, int *error_val ) {
+
+	size_t msglen;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( buf == NULL  ||  len < 8 ) return 0;
+
+	if ( buf[0] != 'F'  ||  buf[1] != 'I'  ||  buf[2] != 'N'  ||  buf[3] != 'S' ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_NO_FINS_HEADER;
+		return 0;
+	}
+
+	msglen   = buf[4];
+	msglen <<= 8;
+	msglen  += buf[5];
+	msglen <<= 8;
+	msglen  += buf[6];
+	msglen <<= 8;
+	msglen  += buf[7];
+
+	if ( msglen < 8  ||  msglen > 8 + FINS_HEADER_LEN + FINS_BODY_LEN ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_DATA_LENGTH_TOO_LONG;
+		return 0;
+	}
+
+	return msglen + 8;
+
+}  /* XX_finslib_server_tcp_message_len */
+
+/*
+ * void XX_finslib_server_tcp_header( unsigned char *buf, uint32_t command, uint32_t errorcode, size_t datalen );
+ *
+ * The function XX_finslib_server_tcp_header() fills the 16 byte FINS/TCP
+ * header which precedes every message sent to a FINS/TCP client. The datalen
+ * parameter is the number of bytes following the header.
+ */
+
+void XX_finslib_server_tcp_header( unsigned char *buf, uint32_t command, uint32_t errorcode, size_t datalen ) {
+
+	datalen += 8;
+
+	buf[0]  = 'F';
+	buf[1]  = 'I';
+	buf[2]  = 'N';
+	buf[3]  = 'S';
+
+	buf[4]  = (datalen   >> 24) & 0xff;
+	buf[5]  = (datalen   >> 16) & 0xff;
+	buf[6]  = (datalen   >>  8) & 0xff;
+	buf[7]  = (datalen        ) & 0xff;
+
+	buf[8]  = (command   >> 24) & 0xff;
+	buf[9]  = (command   >> 16) & 0xff;
+	buf[10] = (command   >>  8) & 0xff;
+	buf[11] = (command        ) & 0xff;
+
+	buf[12] = (errorcode >> 24) & 0xff;
+	buf[13] = (errorcode >> 16) & 0xff;
+	buf[14] = (errorcode >>  8) & 0xff;
+	buf[15] = (errorcode      ) & 0xff;
+
+}  /* XX_finslib_server_tcp_header */
+
+/*
+ * int XX_finslib_server_send_tcp_frame( SOCKET sockfd, const struct fins_command_tp *frame, size_t bodylen );
+ *
+ * The function XX_finslib_server_send_tcp_frame() sends a FINS frame preceded
+ * by a FINS/TCP header to a connected client. The frame and header are sent
+ * in one system call to avoid splitting the message in two TCP segments.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_server_send_tcp_frame( SOCKET sockfd, const struct fins_command_tp *frame, size_t bodylen ) {
+
+	int sendlen;
+	unsigned char buf[16+FINS_HEADER_LEN+FINS_BODY_LEN];
+
+	if ( frame   == NULL          ) return FINS_RETVAL_NO_COMMAND;
+	if ( bodylen >  FINS_BODY_LEN ) return FINS_RETVAL_BODY_TOO_LONG;
+
+	XX_finslib_server_tcp_header( buf, 0x00000002, 0x00000000, FINS_HEADER_LEN + bodylen );
+
+	memcpy( buf+16,                 frame->header, FINS_HEADER_LEN );
+	memcpy( buf+16+FINS_HEADER_LEN, frame->body,   bodylen         );
+
+	sendlen = 16 + FINS_HEADER_LEN + (int) bodylen;
+
+	if ( send( sockfd, (const char *) buf, sendlen, 0 ) != sendlen ) return FINS_RETVAL_COMMAND_SEND_ERROR;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* XX_finslib_server_send_tcp_frame */
+
+/*
+ * void XX_finslib_response_header( struct fins_command_tp *response, const unsigned char *request_header );
+ *
+ * The function XX_finslib_response_header() fills the header of a response
+ * frame based on the header of the request it answers. Source and destination
+ * addresses are swapped and the response bit is set in the ICF field.
+ */
+
+void XX_finslib_response_header( struct fins_command_tp *response, const unsigned char *request_header ) {
+
+	response->header[FINS_ICF] = request_header[FINS_ICF] | 0x40;
+	response->header[FINS_RSV] = 0x00;
+	response->header[FINS_GCT] = request_header[FINS_GCT];
+	response->header[FINS_DNA] = request_header[FINS_SNA];
+	response->header[FINS_DA1] = request_header[FINS_SA1];
+	response->header[FINS_DA2] = request_header[FINS_SA2];
+	response->header[FINS_SNA] = request_header[FINS_DNA];
+	response->header[FINS_SA1] = request_header[FINS_DA1];
+	response->header[FINS_SA2] = request_header[FINS_DA2];
+	response->header[FINS_SID] = request_header[FINS_SID];
+	response->header[FINS_MRC] = request_header[FINS_MRC];
+	response->header[FINS_SRC] = request_header[FINS_SRC];
+
+}  /* XX_finslib_response_header */
+
+/*
+ * int XX_finslib_socket_error( void );
+ *
+ * The function XX_finslib_socket_error() returns the last socket error of the
+ * calling thread converted to a value from the list FINS_RETVAL_...
+ */
+
+int XX_finslib_socket_error( void ) {
+
+#if defined(_WIN32)
+	return XX_finslib_wsa_errorcode_to_fins_retval( WSAGetLastError() );
+#else
+	return FINS_RETVAL_ERRNO_BASE + errno;
+#endif
+
+}  /* XX_finslib_socket_error */
@@ -0,0 +1,164 @@
+/*
+ * Library: libfins
+ * File:    src/fins_sha256.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_sha256.c contains a routine to calculate the
+ * SHA-256 hash of a block of data as defined in FIPS 180-4. The hash is used
+ * as the name of blocks of PLC memory in a content addressed snapshot store,
+ * where two different blocks must never get the same name.
+ */
+
+#include <string.h>
+
+#include "fins.h"
+
+#define ROTR(x,n)	( ( (x) >> (n) ) | ( (x) << ( 32 - (n) ) ) )
+
+static void		sha256_block( uint32_t *state, const unsigned char *block );
+
+static const uint32_t sha256_k[64] = {
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+/*
+ * void finslib_sha256( const unsigned char *data, size_t num_bytes, unsigned char *hash );
+ *
+ * The function finslib_sha256() calculates the SHA-256 hash of a block of
+ * data and stores the FINS_SHA256_LEN bytes of the hash in the hash buffer.
+ */
+
+void finslib_sha256( const unsigned char *data, size_t num_bytes, unsigned char *hash ) {
+
+	size_t a;
+	size_t todo;
+	uint64_t num_bits;
+	uint32_t state[8];
+	unsigned char block[64];
+
+	if ( hash == NULL ) return;
+	if ( data == NULL ) num_bytes = 0;
+
+	state[0] = 0x6A09E667;
+	state[1] = 0xBB67AE85;
+	state[2] = 0x3C6EF372;
+	state[3] = 0xA54FF53A;
+	state[4] = 0x510E527F;
+	state[5] = 0x9B05688C;
+	state[6] = 0x1F83D9AB;
+	state[7] = 0x5BE0CD19;
+
+	num_bits = (uint64_t) num_bytes * 8;
+	todo     = num_bytes;
+
+	while ( todo >= 64 ) {
+
+		sha256_block( state, data );
+
+		data += 64;
+		todo -= 64;
+	}
+
+	memset( block, 0, 64 );
+	if ( todo > 0 ) memcpy( block, data, todo );
+	block[todo] = 0x80;
+
+	if ( todo >= 56 ) {
+
+		sha256_block( state, block );
+		memset( block, 0, 64 );
+	}
+
+	for (a=0; a<8; a++) block[63-a] = (unsigned char) ( num_bits >> ( 8*a ) );
+
+	sha256_block( state, block );
+
+	for (a=0; a<8; a++) {
+
+		hash[4*a  ] = (state[a] >> 24) & 0xff;
+		hash[4*a+1] = (state[a] >> 16) & 0xff;
+		hash[4*a+2] = (state[a] >>  8) & 0xff;
+		hash[4*a+3] = (state[a]      ) & 0xff;
+	}
+
+}  /* finslib_sha256 */
+
+/*
+ * static void sha256_block( uint32_t *state, const unsigned char *block );
+ *
+ * The function sha256_block() adds one block of 64 bytes to the state of a
+ * SHA-256 calculation.
+ */
+
+static void sha256_block( uint32_t *state, const unsigned char *block ) {
+
+	int a;
+	uint32_t w[64];
+	uint32_t v[8];
+	uint32_t s0;
+	uint32_t s1;
+	uint32_t t1;
+	uint32_t t2;
+
+	for (a=0; a<16; a++) w[a] = ( (uint32_t) block[4*a] << 24 ) | ( (uint32_t) block[4*a+1] << 16 ) | ( (uint32_t) block[4*a+2] << 8 ) | (uint32_t) block[4*a+3];
+
+	for (a=16; a<64; a++) {
+
+		s0   = ROTR( w[a-15],  7 ) ^ ROTR( w[a-15], 18 ) ^ ( w[a-15] >>  3 );
+		s1   = ROTR( w[a- 2], 17 ) ^ ROTR( w[a- 2], 19 ) ^ ( w[a- 2] >> 10 );
+		w[a] = w[a-16] + s0 + w[a-7] + s1;
+	}
+
+	for (a=0; a<8; a++) v[a] = state[a];
+
+	for (a=0; a<64; a++) {
+
+		s1   = ROTR( v[4], 6 ) ^ ROTR( v[4], 11 ) ^ ROTR( v[4], 25 );
+		t1   = v[7] + s1 + ( ( v[4] & v[5] ) ^ ( ~v[4] & v[6] ) ) + sha256_k[a] + w[a];
+		s0   = ROTR( v[0], 2 ) ^ ROTR( v[0], 13 ) ^ ROTR( v[0], 22 );
+		t2   = s0 + ( ( v[0] & v[1] ) ^ ( v[0] & v[2] ) ^ ( v[1] & v[2] ) );
+
+		v[7] = v[6];
+		v[6] = v[5];
+		v[5] = v[4];
+		v[4] = v[3] + t1;
+		v[3] = v[2];
+		v[2] = v[1];
+		v[1] = v[0];
+		v[0] = t1 + t2;
+	}
+
+	for (a=0; a<8; a++) state[a] += v[a];
+
+}  /* sha256_block */
@@ -0,0 +1,828 @@
+/*
+ * Library: libfins
+ * File:    src/fins_shm.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_shm.c contains routines to share a process image
+ * of a PLC between the processes on one computer. One publisher process reads
+ * a number of word blocks from the PLC and stores them in a named shared
+ * memory segment. Any number of other processes open the segment read only
+ * and read the words without sending commands to the PLC, so the load on the
+ * PLC does not depend on the number of local consumers.
+ *
+ * Every block in the segment has its own sequence counter which is odd while
+ * the publisher updates the words of the block. A reader copies the words and
+ * checks that the counter was even and unchanged during the copy, and retries
+ * otherwise. Readers therefore never block the publisher and always get the
+ * words of one refresh. The counter only changes when the words change. The
+ * refresh time of a block is stored outside the protection of the counter, so
+ * refreshing a block with the same words never makes a reader retry. A
+ * generation counter in the header is incremented after every refresh. Each
+ * block records the generation in which its contents last changed, which
+ * allows consumers to skip blocks which did not change.
+ *
+ * The segment is only shared between processes on the same computer and all
+ * numbers and words are stored in the byte order of that computer. It starts
+ * with a header, followed by a directory with one entry per block and the
+ * words of the blocks, each starting at a multiple of SHM_ALIGN bytes.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ! defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  /* ! defined(_WIN32) */
+
+#include "fins.h"
+
+#define SHM_MAGIC		"FINSSHM"
+#define SHM_VERSION		0x01
+#define SHM_ALIGN		64
+#define SHM_NAME_LEN		256
+#define SHM_MAX_RETRY		1000000
+
+									/********************************************************/
+struct shm_header_tp {							/*							*/
+	char			magic[7];				/* The text FINSSHM while the segment is valid		*/
+	uint8_t			version;				/* Version of the layout of the segment			*/
+	uint32_t		num_blocks;				/* Number of blocks in the directory			*/
+	uint32_t		entry_size;				/* Size of one directory entry				*/
+	uint64_t		size;					/* Total size of the segment in bytes			*/
+	volatile uint64_t	generation;				/* Number of completed refreshes			*/
+	uint8_t			reserved[32];				/* Pads the header to SHM_ALIGN bytes			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct shm_block_tp {							/*							*/
+	volatile uint32_t	sequence;				/* Odd while the block is being updated			*/
+	uint32_t		num_words;				/* Number of words in the block				*/
+	volatile uint64_t	generation;				/* Generation in which the words last changed		*/
+	volatile int64_t	time;					/* Wall clock time of the last refresh, not seqlocked	*/
+	uint64_t		offset;					/* Offset of the words in the segment			*/
+	char			start[FINS_SNAPSHOT_START_LEN];		/* Address of the first word of the block		*/
+	char			name[4];				/* Name of the memory area of the block			*/
+	uint32_t		first_word;				/* Address of the first word in the memory area		*/
+	uint8_t			reserved[8];				/* Pads the entry to SHM_ALIGN bytes			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_shm_tp {							/*							*/
+	void *			base;					/* Start of the mapped segment				*/
+	size_t			size;					/* Size of the mapped segment				*/
+	bool			owner;					/* The segment was created by this process		*/
+	char			name[SHM_NAME_LEN];			/* Name of the segment					*/
+	struct shm_header_tp *	header;					/* Header of the segment				*/
+	struct shm_block_tp *	block;					/* Directory of the blocks				*/
+	uint16_t *		staging;				/* Words of the block being refreshed			*/
+	size_t			build_block;				/* Block of the next command to build			*/
+	size_t			build_word;				/* Word of the next command to build			*/
+	struct fins_memaddr_tp	build_memaddr;				/* Address handle of the block being built		*/
+	size_t			handle_block;				/* Block of the next response to handle			*/
+	size_t			handle_word;				/* Word of the next response to handle			*/
+	uint64_t		generation;				/* Generation of the refresh in progress		*/
+	size_t			num_changed;				/* Number of blocks changed in this refresh		*/
+#if defined(_WIN32)							/*							*/
+	HANDLE			mapping;				/* Handle of the file mapping				*/
+#endif									/*							*/
+};									/*							*/
+									/********************************************************/
+
+static int			build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static void			commit_block( struct fins_shm_tp *shm, struct shm_block_tp *block );
+static int			create_segment( struct fins_shm_tp *shm );
+static int			handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			open_segment( struct fins_shm_tp *shm );
+static struct shm_block_tp *	search_block( const struct fins_shm_tp *shm, const char *start, size_t num_words, size_t *offset );
+static void			unmap_segment( struct fins_shm_tp *shm );
+
+/*
+ * struct fins_shm_tp *finslib_shm_create( const char *name, const struct fins_shmblock_tp *blocks, size_t num_blocks, int *error_val );
+ *
+ * The function finslib_shm_create() creates a named shared memory segment
+ * for a process image with the given blocks of words and opens it for
+ * publishing. Each block is given by the address of its first word and the
+ * number of words. A segment with the same name left behind by a previous
+ * publisher is replaced. The segment becomes visible to readers when it is
+ * completely initialized. On error NULL is returned and the reason is stored
+ * in the error_val parameter if that is not NULL.
+ */
+
+struct fins_shm_tp *finslib_shm_create( const char *name, const struct fins_shmblock_tp *blocks, size_t num_blocks, int *error_val ) {
+
+	int retval;
+	size_t a;
+	size_t max_words;
+	uint64_t offset;
+	struct fins_address_tp address;
+	struct shm_block_tp *block;
+	struct fins_shm_tp *shm;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	retval    = FINS_RETVAL_SUCCESS;
+	max_words = 0;
+	offset    = sizeof(struct shm_header_tp) + num_blocks * sizeof(struct shm_block_tp);
+
+	if      ( name   == NULL  ||  name[0] == 0  ||  strlen( name ) >= SHM_NAME_LEN ) retval = FINS_RETVAL_INVALID_FILENAME;
+	else if ( blocks == NULL  ||  num_blocks == 0  ||  num_blocks > UINT32_MAX      ) retval = FINS_RETVAL_NO_READ_ADDRESS;
+
+	for (a=0; retval == FINS_RETVAL_SUCCESS  &&  a<num_blocks; a++) {
+
+		if      ( blocks[a].num_words == 0  ||  blocks[a].num_words > UINT32_MAX                                ) retval = FINS_RETVAL_NO_READ_ADDRESS;
+		else if ( memchr( blocks[a].start, 0, FINS_SNAPSHOT_START_LEN ) == NULL                                  ) retval = FINS_RETVAL_INVALID_READ_ADDRESS;
+		else if ( XX_finslib_decode_address( blocks[a].start, & address )                                        ) retval = FINS_RETVAL_INVALID_READ_ADDRESS;
+
+		if ( blocks[a].num_words > max_words ) max_words = blocks[a].num_words;
+
+		offset = ( offset + SHM_ALIGN - 1 ) / SHM_ALIGN * SHM_ALIGN + 2 * (uint64_t) blocks[a].num_words;
+	}
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	shm = calloc( 1, sizeof(struct fins_shm_tp) );
+
+	if ( shm != NULL ) shm->staging = malloc( 2 * max_words );
+
+	if ( shm == NULL  ||  shm->staging == NULL ) {
+
+		if ( shm != NULL ) free( shm );
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	strcpy( shm->name, name );
+	shm->owner = true;
+	shm->size  = (size_t) offset;
+
+	if ( ( retval = create_segment( shm ) ) != FINS_RETVAL_SUCCESS ) {
+
+		free( shm->staging );
+		free( shm );
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	shm->header = shm->base;
+	shm->block  = (struct shm_block_tp *) ( shm->header + 1 );
+
+	shm->header->num_blocks = (uint32_t) num_blocks;
+	shm->header->entry_size = sizeof(struct shm_block_tp);
+	shm->header->size       = shm->size;
+	shm->header->generation = 0;
+
+	offset = sizeof(struct shm_header_tp) + num_blocks * sizeof(struct shm_block_tp);
+
+	for (a=0; a<num_blocks; a++) {
+
+		block  = & shm->block[a];
+		offset = ( offset + SHM_ALIGN - 1 ) / SHM_ALIGN * SHM_ALIGN;
+
+		XX_finslib_decode_address( blocks[a].start, & address );
+
+		memcpy( block->start, blocks[a].start, FINS_SNAPSHOT_START_LEN );
+		memcpy( block->name,  address.name,    4                       );
+
+		block->num_words  = (uint32_t) blocks[a].num_words;
+		block->first_word = address.main_address;
+		block->offset     = offset;
+
+		offset += 2 * (uint64_t) blocks[a].num_words;
+	}
+
+	FINS_MEMORY_BARRIER();
+
+	shm->header->version = SHM_VERSION;
+	memcpy( shm->header->magic, SHM_MAGIC, 7 );
+
+	return shm;
+
+}  /* finslib_shm_create */
+
+/*
+ * struct fins_shm_tp *finslib_shm_open( const char *name, int *error_val );
+ *
+ * The function finslib_shm_open() opens an existing shared memory segment
+ * with a process image for reading. The segment is mapped read only and its
+ * header and directory are checked. On error NULL is returned and the reason
+ * is stored in the error_val parameter if that is not NULL.
+ */
+
+struct fins_shm_tp *finslib_shm_open( const char *name, int *error_val ) {
+
+	int retval;
+	size_t a;
+	uint64_t directory;
+	const struct shm_block_tp *block;
+	struct fins_shm_tp *shm;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( name == NULL  ||  name[0] == 0  ||  strlen( name ) >= SHM_NAME_LEN ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_INVALID_FILENAME;
+		return NULL;
+	}
+
+	shm = calloc( 1, sizeof(struct fins_shm_tp) );
+
+	if ( shm == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	strcpy( shm->name, name );
+
+	if ( ( retval = open_segment( shm ) ) != FINS_RETVAL_SUCCESS ) {
+
+		free( shm );
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	shm->header = shm->base;
+	shm->block  = (struct shm_block_tp *) ( shm->header + 1 );
+	directory   = sizeof(struct shm_header_tp) + (uint64_t) shm->header->num_blocks * sizeof(struct shm_block_tp);
+	retval      = FINS_RETVAL_SUCCESS;
+
+	if ( memcmp( shm->header->magic, SHM_MAGIC, 7 ) != 0                     ||
+	     shm->header->version    != SHM_VERSION                             ||
+	     shm->header->entry_size != sizeof(struct shm_block_tp)             ||
+	     shm->header->size       >  shm->size                               ||
+	     directory               >  shm->size                                   ) retval = FINS_RETVAL_SHM_INVALID;
+
+	for (a=0; retval == FINS_RETVAL_SUCCESS  &&  a<shm->header->num_blocks; a++) {
+
+		block = & shm->block[a];
+
+		if ( block->offset < directory  ||  block->offset > shm->size  ||  2 * (uint64_t) block->num_words > shm->size - block->offset ) retval = FINS_RETVAL_SHM_INVALID;
+	}
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		finslib_shm_close( shm );
+		if ( error_val != NULL ) *error_val = retval;
+		return NULL;
+	}
+
+	return shm;
+
+}  /* finslib_shm_open */
+
+/*
+ * void finslib_shm_close( struct fins_shm_tp *shm );
+ *
+ * The function finslib_shm_close() unmaps a shared memory segment. If the
+ * segment was created by this process it is marked invalid and its name is
+ * removed, so that readers which still have it open notice that they must
+ * open the segment of a new publisher.
+ */
+
+void finslib_shm_close( struct fins_shm_tp *shm ) {
+
+	if ( shm == NULL ) return;
+
+	if ( shm->owner ) {
+
+		memset( shm->header->magic, 0, 7 );
+		FINS_MEMORY_BARRIER();
+	}
+
+	unmap_segment( shm );
+
+	if ( shm->staging != NULL ) free( shm->staging );
+
+	free( shm );
+
+}  /* finslib_shm_close */
+
+/*
+ * int finslib_shm_publish( struct fins_shm_tp *shm, struct fins_sys_tp *sys, size_t depth, size_t *num_changed );
+ *
+ * The function finslib_shm_publish() refreshes all blocks of a process image
+ * from the PLC. The words are read with at most depth read commands in flight
+ * at the same time. A block is only written to the segment when its words
+ * differ from the words already there, so readers of unchanged blocks never
+ * have to retry. The refresh time of every block is updated and the
+ * generation of the segment is incremented when all blocks are in. The number
+ * of blocks which changed is stored in num_changed if that is not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_shm_publish( struct fins_shm_tp *shm, struct fins_sys_tp *sys, size_t depth, size_t *num_changed ) {
+
+	int retval;
+	size_t a;
+	size_t num_command;
+
+	if ( num_changed != NULL ) *num_changed = 0;
+
+	if ( shm == NULL  ||  ! shm->owner ) return FINS_RETVAL_SHM_INVALID;
+	if ( sys == NULL                   ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	num_command = 0;
+
+	for (a=0; a<shm->header->num_blocks; a++) num_command += ( shm->block[a].num_words + FINS_MAX_READ_WORDS_SYSWAY - 1 ) / FINS_MAX_READ_WORDS_SYSWAY;
+
+	shm->build_block  = 0;
+	shm->build_word   = 0;
+	shm->handle_block = 0;
+	shm->handle_word  = 0;
+	shm->num_changed  = 0;
+	shm->generation   = shm->header->generation + 1;
+
+	retval = XX_finslib_pipeline( sys, num_command, depth, build_read, handle_read, shm );
+
+	if ( num_changed != NULL ) *num_changed = shm->num_changed;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) return retval;
+
+	FINS_MEMORY_BARRIER();
+	shm->header->generation = shm->generation;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_shm_publish */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the command which reads the next chunk of
+ * words of the blocks in the process image.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	int retval;
+	size_t num_words;
+	struct shm_block_tp *block;
+	struct fins_shm_tp *shm;
+
+	(void) index;
+
+	shm = context;
+
+	if ( shm->build_block >= shm->header->num_blocks ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+	block     = & shm->block[ shm->build_block ];
+	num_words = block->num_words - shm->build_word;
+
+	if ( num_words > FINS_MAX_READ_WORDS_SYSWAY ) num_words = FINS_MAX_READ_WORDS_SYSWAY;
+
+	if ( shm->build_word == 0 ) {
+
+		if ( ( retval = XX_finslib_resolve_start( sys, block->start, 16, FI_RD, & shm->build_memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	retval = XX_finslib_memory_area_read_word_command( sys, command, bodylen, & shm->build_memaddr, shm->build_word, num_words );
+
+	shm->build_word += num_words;
+
+	if ( shm->build_word >= block->num_words ) {
+
+		shm->build_block++;
+		shm->build_word = 0;
+	}
+
+	return retval;
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() stores a chunk of words received from the PLC
+ * in the staging buffer. When the last chunk of a block is in, the block is
+ * committed to the segment. The responses arrive in the order of the
+ * commands, so the blocks are completed one after the other.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	size_t a;
+	size_t num_words;
+	struct shm_block_tp *block;
+	struct fins_shm_tp *shm;
+
+	(void) sys;
+	(void) index;
+
+	shm       = context;
+	block     = & shm->block[ shm->handle_block ];
+	num_words = block->num_words - shm->handle_word;
+
+	if ( num_words > FINS_MAX_READ_WORDS_SYSWAY ) num_words = FINS_MAX_READ_WORDS_SYSWAY;
+
+	if ( bodylen != 2 + 2*num_words ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	for (a=0; a<num_words; a++) shm->staging[ shm->handle_word + a ] = (uint16_t) ( ( response->body[2+2*a] << 8 ) | response->body[3+2*a] );
+
+	shm->handle_word += num_words;
+
+	if ( shm->handle_word >= block->num_words ) {
+
+		commit_block( shm, block );
+
+		shm->handle_block++;
+		shm->handle_word = 0;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static void commit_block( struct fins_shm_tp *shm, struct shm_block_tp *block );
+ *
+ * The function commit_block() copies the staging buffer to a block in the
+ * segment if the words have changed, and sets the refresh time of the block.
+ * The sequence counter of the block is odd while the words are copied, and
+ * is left alone when the words did not change.
+ */
+
+static void commit_block( struct fins_shm_tp *shm, struct shm_block_tp *block ) {
+
+	bool changed;
+	uint16_t *data;
+
+	data    = (uint16_t *) ( (unsigned char *) shm->base + block->offset );
+	changed = ( block->generation == 0  ||  memcmp( data, shm->staging, 2 * block->num_words ) != 0 );
+
+	if ( changed ) {
+
+		block->sequence++;
+		FINS_MEMORY_BARRIER();
+
+		memcpy( data, shm->staging, 2 * block->num_words );
+		block->generation = shm->generation;
+
+		FINS_MEMORY_BARRIER();
+		block->sequence++;
+
+		shm->num_changed++;
+	}
+
+	block->time = (int64_t) time( NULL );
+
+}  /* commit_block */
+
+/*
+ * int finslib_shm_read( const struct fins_shm_tp *shm, const char *start, uint16_t *data, size_t num_words, uint64_t *generation );
+ *
+ * The function finslib_shm_read() copies a consistent range of words from a
+ * process image without locking. All words must be in the same block and are
+ * copied from the same refresh. The generation in which the block last
+ * changed is stored in the generation parameter if that is not NULL. The
+ * function can be used in both the publisher and the readers.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_shm_read( const struct fins_shm_tp *shm, const char *start, uint16_t *data, size_t num_words, uint64_t *generation ) {
+
+	long retry;
+	size_t offset;
+	uint32_t before;
+	uint32_t after;
+	uint64_t changed;
+	const struct shm_block_tp *block;
+
+	if ( shm       == NULL                                   ) return FINS_RETVAL_SHM_INVALID;
+	if ( start     == NULL                                   ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( data      == NULL                                   ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( num_words == 0                                      ) return FINS_RETVAL_SUCCESS;
+	if ( memcmp( shm->header->magic, SHM_MAGIC, 7 ) != 0     ) return FINS_RETVAL_SHM_INVALID;
+
+	block = search_block( shm, start, num_words, & offset );
+	if ( block == NULL ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	for (retry=0; retry<SHM_MAX_RETRY; retry++) {
+
+		before = block->sequence;
+		FINS_MEMORY_BARRIER();
+
+		if ( before & 1 ) continue;
+
+		memcpy( data, (const unsigned char *) shm->base + block->offset + 2*offset, 2*num_words );
+		changed = block->generation;
+
+		FINS_MEMORY_BARRIER();
+		after = block->sequence;
+
+		if ( before == after ) {
+
+			if ( generation != NULL ) *generation = changed;
+			return FINS_RETVAL_SUCCESS;
+		}
+	}
+
+	return FINS_RETVAL_SHM_INVALID;
+
+}  /* finslib_shm_read */
+
+/*
+ * int finslib_shm_info( const struct fins_shm_tp *shm, size_t index, struct fins_shmblock_tp *info );
+ *
+ * The function finslib_shm_info() returns the description of a block in a
+ * process image by its position in the directory, including the generation
+ * in which its words last changed and the time of its last refresh. This
+ * allows all blocks of a segment to be enumerated. The refresh time is not
+ * protected by the sequence counter and is read after the generation.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_shm_info( const struct fins_shm_tp *shm, size_t index, struct fins_shmblock_tp *info ) {
+
+	long retry;
+	uint32_t before;
+	const struct shm_block_tp *block;
+
+	if ( shm  == NULL                                        ) return FINS_RETVAL_SHM_INVALID;
+	if ( info == NULL                                        ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( memcmp( shm->header->magic, SHM_MAGIC, 7 ) != 0     ) return FINS_RETVAL_SHM_INVALID;
+	if ( index >= shm->header->num_blocks                    ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	block = & shm->block[index];
+
+	memcpy( info->start, block->start, FINS_SNAPSHOT_START_LEN );
+	info->start[FINS_SNAPSHOT_START_LEN-1] = 0;
+	info->num_words = block->num_words;
+
+	for (retry=0; retry<SHM_MAX_RETRY; retry++) {
+
+		before = block->sequence;
+		FINS_MEMORY_BARRIER();
+
+		if ( before & 1 ) continue;
+
+		info->generation = block->generation;
+
+		FINS_MEMORY_BARRIER();
+
+		if ( before == block->sequence ) {
+
+			info->time = (time_t) block->time;
+			return FINS_RETVAL_SUCCESS;
+		}
+	}
+
+	return FINS_RETVAL_SHM_INVALID;
+
+}  /* finslib_shm_info */
+
+/*
+ * uint64_t finslib_shm_generation( const struct fins_shm_tp *shm );
+ *
+ * The function finslib_shm_generation() returns the number of refreshes which
+ * the publisher has completed. A reader can poll this value to find out
+ * whether new data is available. The value 0 is returned if the segment is
+ * invalid or no refresh has completed yet.
+ */
+
+uint64_t finslib_shm_generation( const struct fins_shm_tp *shm ) {
+
+	if ( shm == NULL                                     ) return 0;
+	if ( memcmp( shm->header->magic, SHM_MAGIC, 7 ) != 0 ) return 0;
+
+	return shm->header->generation;
+
+}  /* finslib_shm_generation */
+
+/*
+ * static struct shm_block_tp *search_block( const struct fins_shm_tp *shm, const char *start, size_t num_words, size_t *offset );
+ *
+ * The function search_block() returns the block which contains a range of
+ * words and the position of the first word in that block, or NULL if the
+ * range is not completely inside one block.
+ */
+
+static struct shm_block_tp *search_block( const struct fins_shm_tp *shm, const char *start, size_t num_words, size_t *offset ) {
+
+	size_t a;
+	struct fins_address_tp address;
+	struct shm_block_tp *block;
+
+	if ( XX_finslib_decode_address( start, & address ) ) return NULL;
+
+	for (a=0; a<shm->header->num_blocks; a++) {
+
+		block = & shm->block[a];
+
+		if ( memcmp( block->name, address.name, 4 ) != 0                              ) continue;
+		if ( address.main_address < block->first_word                                 ) continue;
+		if ( address.main_address - block->first_word >= block->num_words             ) continue;
+		if ( num_words > block->num_words - ( address.main_address - block->first_word ) ) continue;
+
+		*offset = address.main_address - block->first_word;
+		return block;
+	}
+
+	return NULL;
+
+}  /* search_block */
+
+/*
+ * static int create_segment( struct fins_shm_tp *shm );
+ *
+ * The function create_segment() creates a new shared memory segment of the
+ * size and with the name stored in the handle and maps it read write. An old
+ * segment with the same name is removed first, so that readers which still
+ * have it mapped keep their own copy until they reopen.
+ */
+
+static int create_segment( struct fins_shm_tp *shm ) {
+
+#if defined(_WIN32)
+
+	shm->mapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD) ( (uint64_t) shm->size >> 32 ), (DWORD) shm->size, shm->name );
+	if ( shm->mapping == NULL ) return FINS_RETVAL_SHM_INVALID;
+
+	shm->base = MapViewOfFile( shm->mapping, FILE_MAP_WRITE, 0, 0, shm->size );
+
+	if ( shm->base == NULL ) {
+
+		CloseHandle( shm->mapping );
+		return FINS_RETVAL_SHM_INVALID;
+	}
+
+	memset( shm->base, 0, shm->size );
+
+	return FINS_RETVAL_SUCCESS;
+
+#elif defined(__ANDROID__)
+
+	(void) shm;
+
+	return FINS_RETVAL_NOT_SUPPORTED;
+
+#else  /* defined(_WIN32) */
+
+	int fd;
+	int retval;
+	void *base;
+
+	shm_unlink( shm->name );
+
+	fd = shm_open( shm->name, O_RDWR | O_CREAT | O_EXCL, 0644 );
+	if ( fd < 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( ftruncate( fd, (off_t) shm->size ) != 0 ) {
+
+		retval = FINS_RETVAL_ERRNO_BASE + errno;
+		close( fd );
+		shm_unlink( shm->name );
+		return retval;
+	}
+
+	base = mmap( NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+	if ( base == MAP_FAILED ) {
+
+		retval = FINS_RETVAL_ERRNO_BASE + errno;
+		close( fd );
+		shm_unlink( shm->name );
+		return retval;
+	}
+
+	close( fd );
+
+	shm->base = base;
+
+	return FINS_RETVAL_SUCCESS;
+
+#endif  /* defined(_WIN32) */
+
+}  /* create_segment */
+
+/*
+ * static int open_segment( struct fins_shm_tp *shm );
+ *
+ * The function open_segment() maps an existing shared memory segment with the
+ * name stored in the handle read only.
+ */
+
+static int open_segment( struct fins_shm_tp *shm ) {
+
+#if defined(_WIN32)
+
+	MEMORY_BASIC_INFORMATION info;
+
+	shm->mapping = OpenFileMappingA( FILE_MAP_READ, FALSE, shm->name );
+	if ( shm->mapping == NULL ) return FINS_RETVAL_SHM_INVALID;
+
+	shm->base = MapViewOfFile( shm->mapping, FILE_MAP_READ, 0, 0, 0 );
+
+	if ( shm->base == NULL  ||  VirtualQuery( shm->base, & info, sizeof(info) ) == 0  ||  info.RegionSize < sizeof(struct shm_header_tp) ) {
+
+		if ( shm->base != NULL ) UnmapViewOfFile( shm->base );
+		CloseHandle( shm->mapping );
+		return FINS_RETVAL_SHM_INVALID;
+	}
+
+	shm->size = info.RegionSize;
+
+	return FINS_RETVAL_SUCCESS;
+
+#elif defined(__ANDROID__)
+
+	(void) shm;
+
+	return FINS_RETVAL_NOT_SUPPORTED;
+
+#else  /* defined(_WIN32) */
+
+	int fd;
+	int retval;
+	void *base;
+	struct stat st;
+
+	fd = shm_open( shm->name, O_RDONLY, 0 );
+	if ( fd < 0 ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fstat( fd, & st ) != 0  ||  (size_t) st.st_size < sizeof(struct shm_header_tp) ) {
+
+		close( fd );
+		return FINS_RETVAL_SHM_INVALID;
+	}
+
+	shm->size = (size_t) st.st_size;
+	base      = mmap( NULL, shm->size, PROT_READ, MAP_SHARED, fd, 0 );
+	retval    = ( base == MAP_FAILED ) ? FINS_RETVAL_ERRNO_BASE + errno : FINS_RETVAL_SUCCESS;
+
+	close( fd );
+
+	if ( retval != FINS_RETVAL_SUCCESS ) return retval;
+
+	shm->base = base;
+
+	return FINS_RETVAL_SUCCESS;
+
+#endif  /* defined(_WIN32) */
+
+}  /* open_segment */
+
+/*
+ * static void unmap_segment( struct fins_shm_tp *shm );
+ *
+ * The function unmap_segment() unmaps a shared memory segment and removes its
+ * name if it was created by this process.
+ */
+
+static void unmap_segment( struct fins_shm_tp *shm ) {
+
+#if defined(_WIN32)
+
+	UnmapViewOfFile( shm->base );
+	CloseHandle( shm->mapping );
+
+#elif defined(__ANDROID__)
+
+	(void) shm;
+
+#else  /* defined(_WIN32) */
+
+	munmap( shm->base, shm->size );
+
+	if ( shm->owner ) shm_unlink( shm->name );
+
+#endif  /* defined(_WIN32) */
+
+}  /* unmap_segment */
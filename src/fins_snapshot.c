@@ -0,0 +1,559 @@
+/*
+ * Library: libfins
+ * File:    src/fins_snapshot.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_snapshot.c contains routines to take incremental
+ * snapshots of PLC memory areas. A memory area is read in blocks of
+ * FINS_SNAPSHOT_BLOCK_WORDS words with a number of read commands in flight at
+ * the same time. Each block is stored in a local snapshot store as an object
+ * file named after the SHA-256 hash of its contents. A block which did not
+ * change since an earlier snapshot, or which is equal to another block, has
+ * the same hash and is therefore only stored once.
+ *
+ * A snapshot store is a directory with the subdirectories "objects" and
+ * "snapshots". For every snapshot a manifest is written in the "snapshots"
+ * directory. The manifest starts with a 40 byte header containing the text
+ * "FINSSNP", a version byte, the start address padded with zeros to 16 bytes,
+ * the number of words, the number of words per block and the wall clock time
+ * at which the snapshot was taken. The hashes of the blocks follow in order.
+ * All numbers are stored most significant byte first. Any snapshot can be
+ * reassembled to a complete memory image from its manifest and the objects.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#include <direct.h>
+#endif  /* defined(_WIN32) */
+
+#include "fins.h"
+
+#define SNAPSHOT_VERSION	0x01
+#define SNAPSHOT_HEADER		40
+#define SNAPSHOT_PATH_LEN	1024
+
+									/********************************************************/
+struct snapshot_tp {							/*							*/
+	const char *		store;					/* Directory of the snapshot store			*/
+	const char *		start;					/* Start address of the memory area			*/
+	struct fins_memaddr_tp	memaddr;				/* Address handle of the start address			*/
+	size_t			num_words;				/* Number of words in the snapshot			*/
+	size_t			num_blocks;				/* Number of blocks in the snapshot			*/
+	size_t			new_blocks;				/* Number of blocks not yet in the store		*/
+	unsigned char *		hash;					/* Hashes of all blocks					*/
+};									/*							*/
+									/********************************************************/
+
+static size_t			block_words( size_t num_words, size_t index );
+static int			build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int			handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int			make_directory( const char *path );
+static int			object_path( char *path, const char *store, const unsigned char *hash, bool directory );
+static int			read_manifest( const char *store, const char *name, unsigned char *header, unsigned char **hash );
+static int			replace_file( const char *path, const unsigned char *data1, size_t len1, const unsigned char *data2, size_t len2 );
+static int			snapshot_path( char *path, const char *store, const char *name );
+static bool			valid_name( const char *name );
+
+/*
+ * int finslib_snapshot_take( struct fins_sys_tp *sys, const char *store, const char *name, const char *start, size_t num_words, size_t depth, size_t *new_blocks );
+ *
+ * The function finslib_snapshot_take() reads num_words words from a PLC
+ * memory area beginning at the start address and stores them as a snapshot
+ * with the given name in a snapshot store. The store directory is created if
+ * it does not exist and an existing snapshot with the same name is replaced.
+ * At most depth read commands are in flight at the same time. Only blocks
+ * which are not yet present in the store are written. The number of these
+ * blocks is stored in new_blocks if that parameter is not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_snapshot_take( struct fins_sys_tp *sys, const char *store, const char *name, const char *start, size_t num_words, size_t depth, size_t *new_blocks ) {
+
+	int retval;
+	char path[SNAPSHOT_PATH_LEN];
+	unsigned char header[SNAPSHOT_HEADER];
+	struct snapshot_tp snapshot;
+	uint64_t now;
+	int a;
+
+	if ( new_blocks != NULL ) *new_blocks = 0;
+
+	if ( sys                  == NULL                    ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( store                == NULL                    ) return FINS_RETVAL_INVALID_PATH;
+	if ( start                == NULL                    ) return FINS_RETVAL_NO_READ_ADDRESS;
+	if ( strlen( start )      >= FINS_SNAPSHOT_START_LEN ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( ! valid_name( name )                            ) return FINS_RETVAL_INVALID_FILENAME;
+
+	if ( ( retval = XX_finslib_resolve_start( sys, start, 16, FI_RD, & snapshot.memaddr ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( ( retval = snapshot_path( path, store, name ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	snprintf( path, SNAPSHOT_PATH_LEN, "%s", store );
+	if ( ( retval = make_directory( path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	snprintf( path, SNAPSHOT_PATH_LEN, "%s/objects", store );
+	if ( ( retval = make_directory( path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	snprintf( path, SNAPSHOT_PATH_LEN, "%s/snapshots", store );
+	if ( ( retval = make_directory( path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	snapshot.store      = store;
+	snapshot.start      = start;
+	snapshot.num_words  = num_words;
+	snapshot.num_blocks = ( num_words + FINS_SNAPSHOT_BLOCK_WORDS - 1 ) / FINS_SNAPSHOT_BLOCK_WORDS;
+	snapshot.new_blocks = 0;
+	snapshot.hash       = NULL;
+
+	if ( snapshot.num_blocks > 0 ) {
+
+		snapshot.hash = malloc( snapshot.num_blocks * FINS_SHA256_LEN );
+		if ( snapshot.hash == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+	}
+
+	if ( ( retval = XX_finslib_pipeline( sys, snapshot.num_blocks, depth, build_read, handle_read, & snapshot ) ) != FINS_RETVAL_SUCCESS ) {
+
+		free( snapshot.hash );
+		return retval;
+	}
+
+	memset( header, 0, SNAPSHOT_HEADER );
+
+	now = (uint64_t) time( NULL );
+
+	memcpy( header, "FINSSNP", 7 );
+	header[7] = SNAPSHOT_VERSION;
+	memcpy( header+8, start, strlen( start ) );
+	XX_finslib_put_uint32( header+24, (uint32_t) num_words );
+	XX_finslib_put_uint32( header+28, FINS_SNAPSHOT_BLOCK_WORDS );
+	for (a=0; a<8; a++) header[39-a] = (unsigned char) ( now >> ( 8*a ) );
+
+	snapshot_path( path, store, name );
+
+	retval = replace_file( path, header, SNAPSHOT_HEADER, snapshot.hash, snapshot.num_blocks * FINS_SHA256_LEN );
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  new_blocks != NULL ) *new_blocks = snapshot.new_blocks;
+
+	free( snapshot.hash );
+
+	return retval;
+
+}  /* finslib_snapshot_take */
+
+/*
+ * int finslib_snapshot_info( const char *store, const char *name, struct fins_snapinfo_tp *info );
+ *
+ * The function finslib_snapshot_info() returns the start address, size and
+ * time of a snapshot in a snapshot store.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_snapshot_info( const char *store, const char *name, struct fins_snapinfo_tp *info ) {
+
+	int a;
+	int retval;
+	uint64_t when;
+	unsigned char *hash;
+	unsigned char header[SNAPSHOT_HEADER];
+
+	if ( info == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	if ( ( retval = read_manifest( store, name, header, & hash ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	free( hash );
+
+	when = 0;
+	for (a=32; a<40; a++) when = ( when << 8 ) + header[a];
+
+	memcpy( info->start, header+8, FINS_SNAPSHOT_START_LEN );
+	info->num_words  = XX_finslib_get_uint32( header+24 );
+	info->num_blocks = ( info->num_words + FINS_SNAPSHOT_BLOCK_WORDS - 1 ) / FINS_SNAPSHOT_BLOCK_WORDS;
+	info->time       = (time_t) when;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_snapshot_info */
+
+/*
+ * int finslib_snapshot_assemble( const char *store, const char *name, unsigned char *data, size_t max_words, size_t *num_words );
+ *
+ * The function finslib_snapshot_assemble() rebuilds the memory image of a
+ * snapshot from the objects in a snapshot store. The words are stored in the
+ * data buffer with the same layout as finslib_memory_area_read_word() uses.
+ * The buffer must have room for at least max_words words. The hash of every
+ * object is checked. The number of words in the snapshot is stored in
+ * num_words if that parameter is not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_snapshot_assemble( const char *store, const char *name, unsigned char *data, size_t max_words, size_t *num_words ) {
+
+	FILE *fp;
+	size_t a;
+	size_t words;
+	size_t num_blocks;
+	size_t length;
+	int retval;
+	char path[SNAPSHOT_PATH_LEN];
+	unsigned char *hash;
+	unsigned char check[FINS_SHA256_LEN];
+	unsigned char header[SNAPSHOT_HEADER];
+
+	if ( num_words != NULL ) *num_words = 0;
+
+	if ( ( retval = read_manifest( store, name, header, & hash ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	words      = XX_finslib_get_uint32( header+24 );
+	num_blocks = ( words + FINS_SNAPSHOT_BLOCK_WORDS - 1 ) / FINS_SNAPSHOT_BLOCK_WORDS;
+
+	if ( words > max_words           ) retval = FINS_RETVAL_BODY_TOO_LONG;
+	if ( words > 0  &&  data == NULL ) retval = FINS_RETVAL_NO_DATA_BLOCK;
+
+	for (a=0; a<num_blocks  &&  retval == FINS_RETVAL_SUCCESS; a++) {
+
+		length = 2 * block_words( words, a );
+
+		if ( ( retval = object_path( path, store, hash + a*FINS_SHA256_LEN, false ) ) != FINS_RETVAL_SUCCESS ) break;
+
+		fp = fopen( path, "rb" );
+
+		if ( fp == NULL ) {
+
+			retval = FINS_RETVAL_SNAPSHOT_INVALID;
+			break;
+		}
+
+		if ( fread( data + a*2*FINS_SNAPSHOT_BLOCK_WORDS, 1, length, fp ) != length  ||  fgetc( fp ) != EOF ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+
+		fclose( fp );
+
+		if ( retval != FINS_RETVAL_SUCCESS ) break;
+
+		finslib_sha256( data + a*2*FINS_SNAPSHOT_BLOCK_WORDS, length, check );
+
+		if ( memcmp( check, hash + a*FINS_SHA256_LEN, FINS_SHA256_LEN ) != 0 ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+	}
+
+	free( hash );
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  num_words != NULL ) *num_words = words;
+
+	return retval;
+
+}  /* finslib_snapshot_assemble */
+
+/*
+ * static size_t block_words( size_t num_words, size_t index );
+ *
+ * The function block_words() returns the number of words in a block of a
+ * snapshot. Only the last block can be shorter than the block size.
+ */
+
+static size_t block_words( size_t num_words, size_t index ) {
+
+	size_t offset;
+
+	offset = index * FINS_SNAPSHOT_BLOCK_WORDS;
+
+	if ( num_words - offset < FINS_SNAPSHOT_BLOCK_WORDS ) return num_words - offset;
+
+	return FINS_SNAPSHOT_BLOCK_WORDS;
+
+}  /* block_words */
+
+/*
+ * static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_read() builds the command which reads a block of a
+ * snapshot from the PLC.
+ */
+
+static int build_read( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	struct snapshot_tp *snapshot;
+
+	snapshot = context;
+
+	return XX_finslib_memory_area_read_word_command( sys, command, bodylen, & snapshot->memaddr, index * FINS_SNAPSHOT_BLOCK_WORDS, block_words( snapshot->num_words, index ) );
+
+}  /* build_read */
+
+/*
+ * static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_read() calculates the hash of a block read from the PLC
+ * and stores the block in the snapshot store if no object with that hash is
+ * present yet.
+ */
+
+static int handle_read( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	FILE *fp;
+	int retval;
+	size_t length;
+	unsigned char *hash;
+	char path[SNAPSHOT_PATH_LEN];
+	struct snapshot_tp *snapshot;
+
+	(void) sys;
+
+	snapshot = context;
+	length   = 2 * block_words( snapshot->num_words, index );
+	hash     = snapshot->hash + index * FINS_SHA256_LEN;
+
+	if ( bodylen != 2 + length ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	finslib_sha256( & response->body[2], length, hash );
+
+	if ( ( retval = object_path( path, snapshot->store, hash, true ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	fp = fopen( path, "rb" );
+
+	if ( fp != NULL ) {
+
+		fclose( fp );
+		return FINS_RETVAL_SUCCESS;
+	}
+
+	if ( ( retval = replace_file( path, & response->body[2], length, NULL, 0 ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	snapshot->new_blocks++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_read */
+
+/*
+ * static int read_manifest( const char *store, const char *name, unsigned char *header, unsigned char **hash );
+ *
+ * The function read_manifest() reads and checks the manifest of a snapshot.
+ * The list of block hashes is returned in an allocated buffer which the caller
+ * must free when the function returns success.
+ */
+
+static int read_manifest( const char *store, const char *name, unsigned char *header, unsigned char **hash ) {
+
+	FILE *fp;
+	size_t num_words;
+	size_t num_blocks;
+	int retval;
+	char path[SNAPSHOT_PATH_LEN];
+
+	*hash = NULL;
+
+	if ( store == NULL        ) return FINS_RETVAL_INVALID_PATH;
+	if ( ! valid_name( name ) ) return FINS_RETVAL_INVALID_FILENAME;
+
+	if ( ( retval = snapshot_path( path, store, name ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	fp = fopen( path, "rb" );
+	if ( fp == NULL ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fread( header, 1, SNAPSHOT_HEADER, fp ) != SNAPSHOT_HEADER ) {
+
+		fclose( fp );
+		return FINS_RETVAL_SNAPSHOT_INVALID;
+	}
+
+	num_words  = XX_finslib_get_uint32( header+24 );
+	num_blocks = ( num_words + FINS_SNAPSHOT_BLOCK_WORDS - 1 ) / FINS_SNAPSHOT_BLOCK_WORDS;
+
+	retval = FINS_RETVAL_SUCCESS;
+
+	if ( memcmp( header, "FINSSNP", 7 )       != 0                         ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+	if ( header[7]                            != SNAPSHOT_VERSION          ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+	if ( header[8+FINS_SNAPSHOT_START_LEN-1]  != 0                         ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+	if ( XX_finslib_get_uint32( header+28 )              != FINS_SNAPSHOT_BLOCK_WORDS ) retval = FINS_RETVAL_SNAPSHOT_INVALID;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) {
+
+		fclose( fp );
+		return retval;
+	}
+
+	*hash = malloc( num_blocks * FINS_SHA256_LEN + 1 );
+
+	if ( *hash == NULL ) {
+
+		fclose( fp );
+		return FINS_RETVAL_OUT_OF_MEMORY;
+	}
+
+	if ( fread( *hash, 1, num_blocks * FINS_SHA256_LEN, fp ) != num_blocks * FINS_SHA256_LEN  ||  fgetc( fp ) != EOF ) {
+
+		fclose( fp );
+		free( *hash );
+		*hash = NULL;
+		return FINS_RETVAL_SNAPSHOT_INVALID;
+	}
+
+	fclose( fp );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* read_manifest */
+
+/*
+ * static int replace_file( const char *path, const unsigned char *data1, size_t len1, const unsigned char *data2, size_t len2 );
+ *
+ * The function replace_file() writes two blocks of data to a temporary file
+ * and renames it to its final name when complete. A file with that name is
+ * therefore never seen partially written, also not after a crash.
+ */
+
+static int replace_file( const char *path, const unsigned char *data1, size_t len1, const unsigned char *data2, size_t len2 ) {
+
+	FILE *fp;
+	int retval;
+	char temp[SNAPSHOT_PATH_LEN+4];
+
+	snprintf( temp, sizeof(temp), "%s.tmp", path );
+
+	fp = fopen( temp, "wb" );
+	if ( fp == NULL ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	retval = FINS_RETVAL_SUCCESS;
+
+	if ( len1 > 0  &&  fwrite( data1, 1, len1, fp ) != len1 ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+	if ( len2 > 0  &&  fwrite( data2, 1, len2, fp ) != len2 ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( fclose( fp ) != 0  &&  retval == FINS_RETVAL_SUCCESS ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+#if defined(_WIN32)
+	if ( retval == FINS_RETVAL_SUCCESS ) remove( path );
+#endif  /* defined(_WIN32) */
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  rename( temp, path ) != 0 ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	if ( retval != FINS_RETVAL_SUCCESS ) remove( temp );
+
+	return retval;
+
+}  /* replace_file */
+
+/*
+ * static int make_directory( const char *path );
+ *
+ * The function make_directory() creates a directory if it does not exist yet.
+ */
+
+static int make_directory( const char *path ) {
+
+	int retval;
+
+#if defined(_WIN32)
+	retval = _mkdir( path );
+#else  /* defined(_WIN32) */
+	retval = mkdir( path, 0777 );
+#endif  /* defined(_WIN32) */
+
+	if ( retval != 0  &&  errno != EEXIST ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* make_directory */
+
+/*
+ * static int object_path( char *path, const char *store, const unsigned char *hash, bool directory );
+ *
+ * The function object_path() returns the name of the object file with a given
+ * hash. The objects are spread over 256 subdirectories named after the first
+ * byte of the hash. If directory is true, the subdirectory is created when it
+ * does not exist.
+ */
+
+static int object_path( char *path, const char *store, const unsigned char *hash, bool directory ) {
+
+	int a;
+	int len;
+	int retval;
+
+	len = snprintf( path, SNAPSHOT_PATH_LEN, "%s/objects/%02x", store, hash[0] );
+	if ( len < 0  ||  len + 2*FINS_SHA256_LEN >= SNAPSHOT_PATH_LEN ) return FINS_RETVAL_INVALID_PATH;
+
+	if ( directory  &&  ( retval = make_directory( path ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	path[len++] = '/';
+
+	for (a=1; a<FINS_SHA256_LEN; a++) len += snprintf( path+len, 3, "%02x", hash[a] );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* object_path */
+
+/*
+ * static int snapshot_path( char *path, const char *store, const char *name );
+ *
+ * The function snapshot_path() returns the name of the manifest file of a
+ * snapshot.
+ */
+
+static int snapshot_path( char *path, const char *store, const char *name ) {
+
+	int len;
+
+	len = snprintf( path, SNAPSHOT_PATH_LEN, "%s/snapshots/%s.snap", store, name );
+	if ( len < 0  ||  len >= SNAPSHOT_PATH_LEN ) return FINS_RETVAL_INVALID_PATH;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* snapshot_path */
+
+/*
+ * static bool valid_name( const char *name );
+ *
+ * The function valid_name() checks if a snapshot name can safely be used as
+ * part of a file name. Only letters, digits and the characters '-', '_' and
+ * '.' are allowed and the name may not start with a dot.
+ */
+
+static bool valid_name( const char *name ) {
+
+	const char *ptr;
+
+	if ( name == NULL  ||  name[0] == 0  ||  name[0] == '.' ) return false;
+
+	for (ptr=name; *ptr; ptr++) {
+
+		if ( *ptr >= 'a'  &&  *ptr <= 'z' ) continue;
+		if ( *ptr >= 'A'  &&  *ptr <= 'Z' ) continue;
+		if ( *ptr >= '0'  &&  *ptr <= '9' ) continue;
+		if ( *ptr == '-'  ||  *ptr == '_'  ||  *ptr == '.' ) continue;
+
+		return false;
+	}
+
+	return true;
+
+}  /* valid_name */
@@ -0,0 +1,363 @@
+/*
+ * Library: libfins
+ * File:    src/fins_stats.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_stats.c contains routines to collect performance
+ * statistics of a FINS connection. Counters are kept for the frames and bytes
+ * transferred and for the errors encountered. For every command code the
+ * round trip times are stored in a histogram with logarithmic buckets.
+ *
+ * Statistics are only updated by the thread which uses the connection. Other
+ * threads can take a consistent snapshot at any moment without locking. A
+ * sequence counter which is odd while an update is in progress is used to
+ * detect and retry snapshots which overlapped with an update.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define SUB_BUCKET_BITS		3
+#define SUB_BUCKETS		(1 << SUB_BUCKET_BITS)
+
+									/********************************************************/
+struct fins_statsdata_tp {						/*							*/
+	volatile uint32_t	sequence;				/* Odd while the statistics are being updated		*/
+	struct fins_stats_tp	stats;					/* The statistics					*/
+};									/*							*/
+									/********************************************************/
+
+static size_t				rtt_bucket( uint64_t usec );
+static struct fins_cmdstats_tp *	search_command( struct fins_stats_tp *stats, uint8_t mrc, uint8_t src );
+
+/*
+ * int finslib_stats_enable( struct fins_sys_tp *sys );
+ *
+ * The function finslib_stats_enable() starts the collection of performance
+ * statistics on a connection. Calling the function on a connection which
+ * already collects statistics has no effect.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_stats_enable( struct fins_sys_tp *sys ) {
+
+	if ( sys        == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( sys->stats != NULL ) return FINS_RETVAL_SUCCESS;
+
+	sys->stats = calloc( 1, sizeof(struct fins_statsdata_tp) );
+	if ( sys->stats == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_stats_enable */
+
+/*
+ * void finslib_stats_disable( struct fins_sys_tp *sys );
+ *
+ * The function finslib_stats_disable() stops the collection of performance
+ * statistics on a connection and releases the associated memory. It must be
+ * called from the thread which uses the connection.
+ */
+
+void finslib_stats_disable( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->stats == NULL ) return;
+
+	free( sys->stats );
+	sys->stats = NULL;
+
+}  /* finslib_stats_disable */
+
+/*
+ * void finslib_stats_reset( struct fins_sys_tp *sys );
+ *
+ * The function finslib_stats_reset() clears all statistics of a connection.
+ * It must be called from the thread which uses the connection.
+ */
+
+void finslib_stats_reset( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->stats == NULL ) return;
+
+	sys->stats->sequence++;
+	FINS_MEMORY_BARRIER();
+
+	memset( & sys->stats->stats, 0, sizeof(struct fins_stats_tp) );
+
+	FINS_MEMORY_BARRIER();
+	sys->stats->sequence++;
+
+}  /* finslib_stats_reset */
+
+/*
+ * int finslib_stats_snapshot( struct fins_sys_tp *sys, struct fins_stats_tp *stats );
+ *
+ * The function finslib_stats_snapshot() copies a consistent set of the
+ * statistics of a connection to a structure provided by the caller. It may be
+ * called from any thread while the connection is in use.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_stats_snapshot( struct fins_sys_tp *sys, struct fins_stats_tp *stats ) {
+
+	uint32_t before;
+	uint32_t after;
+
+	if ( sys        == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( stats      == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( sys->stats == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	do {
+		before = sys->stats->sequence;
+		FINS_MEMORY_BARRIER();
+
+		if ( before & 1 ) continue;
+
+		memcpy( stats, (const void *) & sys->stats->stats, sizeof(struct fins_stats_tp) );
+
+		FINS_MEMORY_BARRIER();
+		after = sys->stats->sequence;
+
+		if ( before == after ) break;
+
+	} while ( true );
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_stats_snapshot */
+
+/*
+ * uint64_t finslib_stats_rtt_percentile( const struct fins_cmdstats_tp *cmdstats, double percentile );
+ *
+ * The function finslib_stats_rtt_percentile() returns an estimate in
+ * microseconds of the round trip time below which the given percentage of the
+ * commands completed. The estimate is the upper bound of the histogram bucket
+ * in which the percentile falls, limited to the longest time measured. It is
+ * at most 12.5% too high.
+ */
+
+uint64_t finslib_stats_rtt_percentile( const struct fins_cmdstats_tp *cmdstats, double percentile ) {
+
+	size_t a;
+	uint64_t seen;
+	uint64_t limit;
+	uint64_t bound;
+
+	if ( cmdstats == NULL  ||  cmdstats->rtt_count == 0 ) return 0;
+
+	if ( percentile <   0.0 ) percentile =   0.0;
+	if ( percentile > 100.0 ) percentile = 100.0;
+
+	limit = (uint64_t) ( percentile * (double) cmdstats->rtt_count / 100.0 + 0.5 );
+	if ( limit < 1 ) limit = 1;
+
+	seen = 0;
+
+	for (a=0; a<FINS_STATS_RTT_BUCKETS; a++) {
+
+		seen += cmdstats->rtt_bucket[a];
+
+		if ( seen >= limit ) {
+
+			if ( a+1 >= FINS_STATS_RTT_BUCKETS ) return cmdstats->rtt_max_usec;
+
+			bound = finslib_stats_bucket_usec( a+1 ) - 1;
+
+			return ( bound < cmdstats->rtt_max_usec ) ? bound : cmdstats->rtt_max_usec;
+		}
+	}
+
+	return cmdstats->rtt_max_usec;
+
+}  /* finslib_stats_rtt_percentile */
+
+/*
+ * uint64_t finslib_stats_bucket_usec( size_t bucket );
+ *
+ * The function finslib_stats_bucket_usec() returns the lowest round trip time
+ * in microseconds which is counted in a histogram bucket. The first buckets
+ * each contain one microsecond. Every following power of two is divided in
+ * eight buckets of equal size.
+ */
+
+uint64_t finslib_stats_bucket_usec( size_t bucket ) {
+
+	size_t exponent;
+
+	if ( bucket < 2*SUB_BUCKETS ) return bucket;
+
+	exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+
+	return ( (uint64_t) ( SUB_BUCKETS + bucket % SUB_BUCKETS ) ) << ( exponent - SUB_BUCKET_BITS );
+
+}  /* finslib_stats_bucket_usec */
+
+/*
+ * void XX_finslib_stats_command( struct fins_sys_tp *sys, const unsigned char *header, size_t sent_len, size_t recv_len, int64_t rtt_nsec, int retval, bool from_cache );
+ *
+ * The function XX_finslib_stats_command() adds the result of one command to
+ * the statistics of a connection. A sent_len of 0 indicates that the command
+ * was not sent, and a recv_len of 0 that no response was received.
+ */
+
+void XX_finslib_stats_command( struct fins_sys_tp *sys, const unsigned char *header, size_t sent_len, size_t recv_len, int64_t rtt_nsec, int retval, bool from_cache ) {
+
+	uint64_t usec;
+	struct fins_stats_tp *stats;
+	struct fins_cmdstats_tp *cmdstats;
+
+	if ( sys == NULL  ||  sys->stats == NULL  ||  header == NULL ) return;
+
+	stats = & sys->stats->stats;
+
+	sys->stats->sequence++;
+	FINS_MEMORY_BARRIER();
+
+	stats->commands++;
+
+	cmdstats = search_command( stats, header[FINS_MRC], header[FINS_SRC] );
+
+	if ( cmdstats != NULL ) cmdstats->count++;
+
+	if ( from_cache ) stats->cache_hits++;
+
+	else {
+		if ( sent_len > 0 ) {
+
+			stats->frames_sent++;
+			stats->bytes_sent += sent_len;
+		}
+
+		if ( recv_len > 0 ) {
+
+			stats->frames_received++;
+			stats->bytes_received += recv_len;
+		}
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			if      ( sent_len == 0                   ) stats->send_errors++;
+			else if ( recv_len == 0                   ) stats->recv_errors++;
+			else if ( retval == FINS_RETVAL_SYNC_ERROR ) stats->sync_errors++;
+			else                                        stats->end_code_errors++;
+
+			if ( cmdstats != NULL ) cmdstats->errors++;
+		}
+
+		if ( cmdstats != NULL  &&  recv_len > 0  &&  rtt_nsec >= 0 ) {
+
+			usec = (uint64_t) rtt_nsec / 1000;
+
+			cmdstats->rtt_count++;
+			cmdstats->rtt_sum_usec += usec;
+			cmdstats->rtt_bucket[ rtt_bucket( usec ) ]++;
+
+			if ( usec > cmdstats->rtt_max_usec ) cmdstats->rtt_max_usec = usec;
+		}
+	}
+
+	FINS_MEMORY_BARRIER();
+	sys->stats->sequence++;
+
+}  /* XX_finslib_stats_command */
+
+/*
+ * void XX_finslib_stats_reconnect( struct fins_sys_tp *sys );
+ *
+ * The function XX_finslib_stats_reconnect() counts a successful reconnection
+ * of an existing connection.
+ */
+
+void XX_finslib_stats_reconnect( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->stats == NULL ) return;
+
+	sys->stats->sequence++;
+	FINS_MEMORY_BARRIER();
+
+	sys->stats->stats.reconnects++;
+
+	FINS_MEMORY_BARRIER();
+	sys->stats->sequence++;
+
+}  /* XX_finslib_stats_reconnect */
+
+/*
+ * static size_t rtt_bucket( uint64_t usec );
+ *
+ * The function rtt_bucket() returns the histogram bucket in which a round trip
+ * time must be counted. Times too large for the histogram are counted in the
+ * last bucket.
+ */
+
+static size_t rtt_bucket( uint64_t usec ) {
+
+	size_t exponent;
+	size_t bucket;
+
+	if ( usec < 2*SUB_BUCKETS ) return (size_t) usec;
+
+	exponent = 0;
+	while ( ( usec >> exponent ) >= 2*SUB_BUCKETS ) exponent++;
+
+	bucket = ( exponent + 1 ) * SUB_BUCKETS + (size_t) ( ( usec >> exponent ) - SUB_BUCKETS );
+
+	if ( bucket >= FINS_STATS_RTT_BUCKETS ) bucket = FINS_STATS_RTT_BUCKETS - 1;
+
+	return bucket;
+
+}  /* rtt_bucket */
+
+/*
+ * static struct fins_cmdstats_tp *search_command( struct fins_stats_tp *stats, uint8_t mrc, uint8_t src );
+ *
+ * The function search_command() returns the statistics slot of a command
+ * code. A new slot is assigned the first time a command code is seen. If all
+ * slots are in use, NULL is returned.
+ */
+
+static struct fins_cmdstats_tp *search_command( struct fins_stats_tp *stats, uint8_t mrc, uint8_t src ) {
+
+	size_t a;
+
+	for (a=0; a<stats->num_commands; a++) {
+
+		if ( stats->command[a].mrc == mrc  &&  stats->command[a].src == src ) return & stats->command[a];
+	}
+
+	if ( stats->num_commands >= FINS_STATS_MAX_COMMANDS ) return NULL;
+
+	stats->command[stats->num_commands].mrc = mrc;
+	stats->command[stats->num_commands].src = src;
+
+	return & stats->command[ stats->num_commands++ ];
+
+}  /* search_command */
@@ -0,0 +1,442 @@
+/*
+ * Library: libfins
+ * File:    src/fins_subscribe.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_subscribe.c contains a subscription layer on top
+ * of polled data items. The application polls its items in any way it likes,
+ * for example with finslib_multiple_memory_area_read() or a tag scheduler,
+ * and then lets the subscription layer decide which of the new values must be
+ * passed on. A callback is only called when the filter of a subscription
+ * passes. Filters support absolute and relative deadbands for numbers, edge
+ * detection for bits and minimum and maximum intervals between notifications.
+ *
+ * The state of all subscriptions is kept in separate arrays per field instead
+ * of an array of structures. The filters are then evaluated in one tight loop
+ * without function calls, which the compiler can turn into vector
+ * instructions. Only the conversion of the items to numbers and the callbacks
+ * are done per subscription.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define SUBSCRIBE_MIN_SUBS	16
+
+									/********************************************************/
+struct fins_subscribe_tp {						/*							*/
+	size_t				num_subs;			/* Number of subscriptions				*/
+	size_t				max_subs;			/* Number of subscriptions allocated			*/
+	const struct fins_multidata_tp **item;				/* Polled item of each subscription			*/
+	fins_notify_callback_tp *	callback;			/* Function to call when the filter passes		*/
+	void **				context;			/* Context passed to the callback			*/
+	double *			current;			/* Value of the item at this evaluation			*/
+	double *			reference;			/* Value the change is measured against			*/
+	double *			abs_band;			/* Absolute deadband					*/
+	double *			rel_band;			/* Deadband as a fraction of the reference value	*/
+	double *			rise_ok;			/* 1.0 if an increase may pass the filter		*/
+	double *			fall_ok;			/* 1.0 if a decrease may pass the filter		*/
+	int64_t *			last_time;			/* Monotonic msec time of the last notification		*/
+	int64_t *			min_interval;			/* Minimum msec between two notifications		*/
+	int64_t *			max_interval;			/* Maximum msec between two notifications, or 0		*/
+	unsigned char *			follow;				/* Reference follows edges which are not notified	*/
+	unsigned char *			fresh;				/* No notification has been sent yet			*/
+	unsigned char *			pass;				/* Result of the filter					*/
+};									/*							*/
+									/********************************************************/
+
+static bool			grow( struct fins_subscribe_tp *subscribe );
+static double			item_value( const struct fins_multidata_tp *item );
+
+/*
+ * struct fins_subscribe_tp *finslib_subscribe_create( int *error_val );
+ *
+ * The function finslib_subscribe_create() creates an empty set of
+ * subscriptions.
+ *
+ * The function returns a pointer to the set, or NULL if no memory could be
+ * allocated. In that case an error code is returned in error_val.
+ */
+
+struct fins_subscribe_tp *finslib_subscribe_create( int *error_val ) {
+
+	struct fins_subscribe_tp *subscribe;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	subscribe = calloc( 1, sizeof(struct fins_subscribe_tp) );
+
+	if ( subscribe == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	return subscribe;
+
+}  /* finslib_subscribe_create */
+
+/*
+ * void finslib_subscribe_destroy( struct fins_subscribe_tp *subscribe );
+ *
+ * The function finslib_subscribe_destroy() releases a set of subscriptions.
+ * The items are owned by the caller and left untouched.
+ */
+
+void finslib_subscribe_destroy( struct fins_subscribe_tp *subscribe ) {
+
+	if ( subscribe == NULL ) return;
+
+	free( subscribe->item          );
+	free( subscribe->callback      );
+	free( subscribe->context       );
+	free( subscribe->current       );
+	free( subscribe->reference     );
+	free( subscribe->abs_band      );
+	free( subscribe->rel_band      );
+	free( subscribe->rise_ok       );
+	free( subscribe->fall_ok       );
+	free( subscribe->last_time     );
+	free( subscribe->min_interval  );
+	free( subscribe->max_interval  );
+	free( subscribe->follow        );
+	free( subscribe->fresh         );
+	free( subscribe->pass          );
+	free( subscribe                );
+
+}  /* finslib_subscribe_destroy */
+
+/*
+ * int finslib_subscribe_add( struct fins_subscribe_tp *subscribe, const struct fins_multidata_tp *item, const struct fins_filter_tp *filter, fins_notify_callback_tp callback, void *context );
+ *
+ * The function finslib_subscribe_add() adds a subscription on a polled item.
+ * The item must stay valid as long as the subscription set is used. Without a
+ * filter every change of the value is passed on. The first evaluation after
+ * the subscription has been added always notifies the current value.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_subscribe_add( struct fins_subscribe_tp *subscribe, const struct fins_multidata_tp *item, const struct fins_filter_tp *filter, fins_notify_callback_tp callback, void *context ) {
+
+	size_t a;
+	bool is_bit;
+
+	if ( subscribe == NULL  ||  item == NULL                                       ) return FINS_RETVAL_NO_DATA_BLOCK;
+	if ( callback  == NULL                                                         ) return FINS_RETVAL_NO_COMMAND;
+	if ( item->type <= FINS_DATA_TYPE_NONE  ||  item->type > FINS_DATA_TYPE_LAST ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	if ( filter != NULL ) {
+
+		if ( filter->deadband_abs      < 0.0  ||  filter->deadband_pct      < 0.0 ) return FINS_RETVAL_INVALID_PERIOD;
+		if ( filter->min_interval_msec < 0    ||  filter->max_interval_msec < 0   ) return FINS_RETVAL_INVALID_PERIOD;
+	}
+
+	if ( subscribe->num_subs >= subscribe->max_subs  &&  ! grow( subscribe ) ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	a      = subscribe->num_subs;
+	is_bit = ( item->type == FINS_DATA_TYPE_BIT  ||  item->type == FINS_DATA_TYPE_BIT_FORCED );
+
+	subscribe->item[a]         = item;
+	subscribe->callback[a]     = callback;
+	subscribe->context[a]      = context;
+	subscribe->current[a]      = 0.0;
+	subscribe->reference[a]    = 0.0;
+	subscribe->abs_band[a]     = ( filter != NULL  &&  ! is_bit ) ? filter->deadband_abs         : 0.0;
+	subscribe->rel_band[a]     = ( filter != NULL  &&  ! is_bit ) ? filter->deadband_pct / 100.0 : 0.0;
+	subscribe->rise_ok[a]      = ( filter != NULL  &&  filter->edge == FINS_EDGE_FALLING ) ? 0.0 : 1.0;
+	subscribe->fall_ok[a]      = ( filter != NULL  &&  filter->edge == FINS_EDGE_RISING  ) ? 0.0 : 1.0;
+	subscribe->last_time[a]    = 0;
+	subscribe->min_interval[a] = ( filter != NULL ) ? filter->min_interval_msec : 0;
+	subscribe->max_interval[a] = ( filter != NULL ) ? filter->max_interval_msec : 0;
+	subscribe->follow[a]       = is_bit;
+	subscribe->fresh[a]        = true;
+	subscribe->pass[a]         = false;
+
+	subscribe->num_subs++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_subscribe_add */
+
+/*
+ * int finslib_subscribe_evaluate( struct fins_subscribe_tp *subscribe, size_t *num_notified );
+ *
+ * The function finslib_subscribe_evaluate() checks the current values of all
+ * subscribed items against their filters and calls the callback of every
+ * subscription which passes. It should be called after each poll of the
+ * items. The number of callbacks made is returned in num_notified if that
+ * pointer is not NULL.
+ *
+ * A number passes when it differs from the last notified value by more than
+ * the absolute deadband and by more than the relative deadband, taken as a
+ * percentage of the last notified value. A bit passes on the edges selected
+ * in the filter. A change which passes within the minimum interval after the
+ * previous notification is held back until the interval has expired. When the
+ * maximum interval expires without a notification, the current value is
+ * notified anyway.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_subscribe_evaluate( struct fins_subscribe_tp *subscribe, size_t *num_notified ) {
+
+	size_t a;
+	size_t num_subs;
+	size_t count;
+	int64_t now;
+	int64_t elapsed;
+	double reference;
+	double abs_band;
+	double rise_ok;
+	double fall_ok;
+	double diff;
+	double mag;
+	double base;
+	double limit;
+	double direction;
+	int changed;
+	int expired;
+	double *current;
+	const double *refs;
+	const double *abs_bands;
+	const double *rel_bands;
+	const double *rise;
+	const double *fall;
+	const int64_t *last_time;
+	const int64_t *min_interval;
+	const int64_t *max_interval;
+	const unsigned char *fresh;
+	unsigned char *pass;
+
+	if ( num_notified != NULL ) *num_notified = 0;
+
+	if ( subscribe == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	num_subs     = subscribe->num_subs;
+	current      = subscribe->current;
+	refs         = subscribe->reference;
+	abs_bands    = subscribe->abs_band;
+	rel_bands    = subscribe->rel_band;
+	rise         = subscribe->rise_ok;
+	fall         = subscribe->fall_ok;
+	last_time    = subscribe->last_time;
+	min_interval = subscribe->min_interval;
+	max_interval = subscribe->max_interval;
+	fresh        = subscribe->fresh;
+	pass         = subscribe->pass;
+	now          = finslib_monotonic_msec_timer();
+
+	for (a=0; a<num_subs; a++) current[a] = item_value( subscribe->item[a] );
+
+	/*
+	 * This loop only uses the arrays of the subscription set, without
+	 * function calls or branches, so that it can be vectorized.
+	 */
+
+	for (a=0; a<num_subs; a++) {
+
+		reference = refs[a];
+		abs_band  = abs_bands[a];
+		rise_ok   = rise[a];
+		fall_ok   = fall[a];
+		diff      = current[a] - reference;
+		mag       = ( diff      < 0.0 ) ? -diff      : diff;
+		base      = ( reference < 0.0 ) ? -reference : reference;
+		limit     = rel_bands[a] * base;
+		limit     = ( abs_band  > limit ) ? abs_band : limit;
+		direction = ( diff      > 0.0 ) ? rise_ok    : fall_ok;
+		elapsed   = now - last_time[a];
+
+		changed   = ( mag > limit ) & ( direction > 0.0 ) & ( elapsed >= min_interval[a] );
+		expired   = ( max_interval[a] > 0 ) & ( elapsed >= max_interval[a] );
+
+		pass[a]   = (unsigned char) ( changed | expired | fresh[a] );
+	}
+
+	count = 0;
+
+	for (a=0; a<num_subs; a++) {
+
+		if ( subscribe->pass[a] ) {
+
+			subscribe->reference[a] = subscribe->current[a];
+			subscribe->last_time[a] = now;
+			subscribe->fresh[a]     = false;
+
+			subscribe->callback[a]( subscribe->item[a], subscribe->context[a] );
+			count++;
+		}
+
+		/*
+		 * A bit edge in the direction which is not notified moves the
+		 * reference, so that the next edge is compared with the new
+		 * state. A wanted edge which is held back by the minimum
+		 * interval leaves the reference alone and passes later.
+		 */
+
+		else if ( subscribe->follow[a] ) {
+
+			direction = ( subscribe->current[a] > subscribe->reference[a] ) ? subscribe->rise_ok[a] : subscribe->fall_ok[a];
+
+			if ( direction <= 0.0 ) subscribe->reference[a] = subscribe->current[a];
+		}
+	}
+
+	if ( num_notified != NULL ) *num_notified = count;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* finslib_subscribe_evaluate */
+
+/*
+ * static double item_value( const struct fins_multidata_tp *item );
+ *
+ * The function item_value() returns the value of a polled item as a number.
+ * A bit is 0 or 1.
+ */
+
+static double item_value( const struct fins_multidata_tp *item ) {
+
+	switch ( item->type ) {
+
+		case FINS_DATA_TYPE_INT16       :
+		case FINS_DATA_TYPE_SBCD16_0    :
+		case FINS_DATA_TYPE_SBCD16_1    :
+		case FINS_DATA_TYPE_SBCD16_2    :
+		case FINS_DATA_TYPE_SBCD16_3    : return (double) item->int16;
+
+		case FINS_DATA_TYPE_INT32       :
+		case FINS_DATA_TYPE_SBCD32_0    :
+		case FINS_DATA_TYPE_SBCD32_1    :
+		case FINS_DATA_TYPE_SBCD32_2    :
+		case FINS_DATA_TYPE_SBCD32_3    : return (double) item->int32;
+
+		case FINS_DATA_TYPE_UINT16      :
+		case FINS_DATA_TYPE_BCD16       : return (double) item->uint16;
+
+		case FINS_DATA_TYPE_UINT32      :
+		case FINS_DATA_TYPE_BCD32       : return (double) item->uint32;
+
+		case FINS_DATA_TYPE_FLOAT       : return (double) item->sfloat;
+		case FINS_DATA_TYPE_DOUBLE      : return          item->dfloat;
+
+		case FINS_DATA_TYPE_BIT         :
+		case FINS_DATA_TYPE_BIT_FORCED  : return ( item->bit ) ? 1.0 : 0.0;
+
+		case FINS_DATA_TYPE_WORD_FORCED : return (double) item->word;
+	}
+
+	return 0.0;
+
+}  /* item_value */
+
+/*
+ * static bool grow( struct fins_subscribe_tp *subscribe );
+ *
+ * The function grow() doubles the number of subscriptions for which room is
+ * allocated. The arrays which could be enlarged stay valid if one of the
+ * allocations fails, because the number of allocated subscriptions is only
+ * updated at the end.
+ *
+ * The function returns true if the arrays have been enlarged.
+ */
+
+static bool grow( struct fins_subscribe_tp *subscribe ) {
+
+	size_t n;
+	void *ptr;
+
+	n = ( subscribe->max_subs == 0 ) ? SUBSCRIBE_MIN_SUBS : 2 * subscribe->max_subs;
+
+	ptr = realloc( subscribe->item, n * sizeof(*subscribe->item) );
+	if ( ptr == NULL ) return false;
+	subscribe->item = ptr;
+
+	ptr = realloc( subscribe->callback, n * sizeof(*subscribe->callback) );
+	if ( ptr == NULL ) return false;
+	subscribe->callback = ptr;
+
+	ptr = realloc( subscribe->context, n * sizeof(*subscribe->context) );
+	if ( ptr == NULL ) return false;
+	subscribe->context = ptr;
+
+	ptr = realloc( subscribe->current, n * sizeof(*subscribe->current) );
+	if ( ptr == NULL ) return false;
+	subscribe->current = ptr;
+
+	ptr = realloc( subscribe->reference, n * sizeof(*subscribe->reference) );
+	if ( ptr == NULL ) return false;
+	subscribe->reference = ptr;
+
+	ptr = realloc( subscribe->abs_band, n * sizeof(*subscribe->abs_band) );
+	if ( ptr == NULL ) return false;
+	subscribe->abs_band = ptr;
+
+	ptr = realloc( subscribe->rel_band, n * sizeof(*subscribe->rel_band) );
+	if ( ptr == NULL ) return false;
+	subscribe->rel_band = ptr;
+
+	ptr = realloc( subscribe->rise_ok, n * sizeof(*subscribe->rise_ok) );
+	if ( ptr == NULL ) return false;
+	subscribe->rise_ok = ptr;
+
+	ptr = realloc( subscribe->fall_ok, n * sizeof(*subscribe->fall_ok) );
+	if ( ptr == NULL ) return false;
+	subscribe->fall_ok = ptr;
+
+	ptr = realloc( subscribe->last_time, n * sizeof(*subscribe->last_time) );
+	if ( ptr == NULL ) return false;
+	subscribe->last_time = ptr;
+
+	ptr = realloc( subscribe->min_interval, n * sizeof(*subscribe->min_interval) );
+	if ( ptr == NULL ) return false;
+	subscribe->min_interval = ptr;
+
+	ptr = realloc( subscribe->max_interval, n * sizeof(*subscribe->max_interval) );
+	if ( ptr == NULL ) return false;
+	subscribe->max_interval = ptr;
+
+	ptr = realloc( subscribe->follow, n * sizeof(*subscribe->follow) );
+	if ( ptr == NULL ) return false;
+	subscribe->follow = ptr;
+
+	ptr = realloc( subscribe->fresh, n * sizeof(*subscribe->fresh) );
+	if ( ptr == NULL ) return false;
+	subscribe->fresh = ptr;
+
+	ptr = realloc( subscribe->pass, n * sizeof(*subscribe->pass) );
+	if ( ptr == NULL ) return false;
+	subscribe->pass = ptr;
+
+	subscribe->max_subs = n;
+
+	return true;
+
+}  /* grow */
@@ -0,0 +1,678 @@
+/*
+ * Library: libfins
+ * File:    src/fins_tagdb.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_tagdb.c contains a database of symbolic tags. Each
+ * tag couples a name to an address and a data type in a remote PLC. The
+ * address is decoded and the memory areas to read and write the tag are
+ * searched only once when the tag is added. Functions like finslib_tag_read()
+ * and finslib_tag_write() can then use the tags without any string handling.
+ *
+ * Tags are stored in blocks which are never moved, so that pointers to tags
+ * stay valid while new tags are added. The names are found through an open
+ * addressing hash table. Each slot in the table contains the full hash value
+ * of the name next to the index of the tag, so that a lookup only compares a
+ * name when the hash values match and growing the table needs no names.
+ *
+ * Symbol tables can be imported from the tab or comma separated text which
+ * CX-Programmer produces when a symbol table is copied or exported.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#define TAGDB_BLOCK_TAGS	4096
+#define TAGDB_MIN_SLOTS		1024
+#define TAGDB_LINE_LEN		1024
+#define TAGDB_MAX_FIELDS	8
+
+									/********************************************************/
+struct tagdb_slot_tp {							/*							*/
+	uint32_t			hash;				/* Hash value of the name of the tag			*/
+	uint32_t			index;				/* Index of the tag plus one, or 0 if the slot is empty	*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct fins_tagdb_tp {							/*							*/
+	int				plc_mode;			/* CS/CJ or CV mode communication			*/
+	size_t				num_tags;			/* Number of tags in the database			*/
+	size_t				num_blocks;			/* Number of blocks with tags allocated			*/
+	size_t				max_blocks;			/* Number of block pointers allocated			*/
+	struct fins_tag_tp **		block;				/* Blocks with TAGDB_BLOCK_TAGS tags each		*/
+	size_t				num_slots;			/* Number of hash slots, always a power of two		*/
+	struct tagdb_slot_tp *		slot;				/* Hash slots						*/
+};									/*							*/
+									/********************************************************/
+
+static bool			cx_address( const char *str, char *address );
+static int			cx_type( const char *str );
+static bool			grow_slots( struct fins_tagdb_tp *tagdb );
+static uint32_t			hash_name( const char *name );
+static int			insert_tag( struct fins_tagdb_tp *tagdb, const struct fins_tag_tp *tag );
+static size_t			parse_line( char *line, char delimiter, char **field );
+static int			resolve_tag( int plc_mode, const char *name, const char *address, int type, struct fins_tag_tp *tag );
+
+/*
+ * struct fins_tagdb_tp *finslib_tagdb_create( int plc_mode, int *error_val );
+ *
+ * The function finslib_tagdb_create() creates an empty tag database for PLCs
+ * which communicate in the FINS mode plc_mode. The mode is needed to resolve
+ * the memory areas of the tags before a connection with a PLC exists.
+ *
+ * The function returns a pointer to the database, or NULL if an error
+ * occured. In that case an error code is returned in error_val.
+ */
+
+struct fins_tagdb_tp *finslib_tagdb_create( int plc_mode, int *error_val ) {
+
+	struct fins_tagdb_tp *tagdb;
+
+	if ( error_val != NULL ) *error_val = FINS_RETVAL_SUCCESS;
+
+	if ( plc_mode != FINS_MODE_CS  &&  plc_mode != FINS_MODE_CV ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_NOT_SUPPORTED;
+		return NULL;
+	}
+
+	tagdb = calloc( 1, sizeof(struct fins_tagdb_tp) );
+
+	if ( tagdb == NULL ) {
+
+		if ( error_val != NULL ) *error_val = FINS_RETVAL_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	tagdb->plc_mode = plc_mode;
+
+	return tagdb;
+
+}  /* finslib_tagdb_create */
+
+/*
+ * void finslib_tagdb_destroy( struct fins_tagdb_tp *tagdb );
+ *
+ * The function finslib_tagdb_destroy() releases a tag database. Pointers to
+ * tags in the database are no longer valid afterwards.
+ */
+
+void finslib_tagdb_destroy( struct fins_tagdb_tp *tagdb ) {
+
+	size_t a;
+
+	if ( tagdb == NULL ) return;
+
+	for (a=0; a<tagdb->num_blocks; a++) free( tagdb->block[a] );
+
+	free( tagdb->block );
+	free( tagdb->slot  );
+	free( tagdb        );
+
+}  /* finslib_tagdb_destroy */
+
+/*
+ * int finslib_tagdb_add( struct fins_tagdb_tp *tagdb, const char *name, const char *address, int type );
+ *
+ * The function finslib_tagdb_add() adds a tag with a name, an address string
+ * and a data type FINS_DATA_TYPE_... to a tag database. The address is
+ * decoded and the memory areas to access it are searched immediately. Tag
+ * names are case sensitive and must be unique in the database.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_tagdb_add( struct fins_tagdb_tp *tagdb, const char *name, const char *address, int type ) {
+
+	struct fins_tag_tp tag;
+	int retval;
+
+	if ( tagdb   == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( address == NULL ) return FINS_RETVAL_NO_READ_ADDRESS;
+
+	if ( ( retval = resolve_tag( tagdb->plc_mode, name, address, type, & tag ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	return insert_tag( tagdb, & tag );
+
+}  /* finslib_tagdb_add */
+
+/*
+ * const struct fins_tag_tp *finslib_tagdb_find( const struct fins_tagdb_tp *tagdb, const char *name );
+ *
+ * The function finslib_tagdb_find() looks up a tag by name. The returned
+ * pointer stays valid until the database is destroyed and can be kept by the
+ * application to access the tag without further lookups.
+ *
+ * The function returns a pointer to the tag, or NULL if no tag with the name
+ * exists.
+ */
+
+const struct fins_tag_tp *finslib_tagdb_find( const struct fins_tagdb_tp *tagdb, const char *name ) {
+
+	uint32_t hash;
+	size_t a;
+	size_t index;
+	size_t mask;
+	const struct fins_tag_tp *tag;
+
+	if ( tagdb == NULL  ||  name == NULL  ||  tagdb->num_slots == 0 ) return NULL;
+
+	hash = hash_name( name );
+	mask = tagdb->num_slots - 1;
+	a    = hash & mask;
+
+	while ( tagdb->slot[a].index != 0 ) {
+
+		if ( tagdb->slot[a].hash == hash ) {
+
+			index = tagdb->slot[a].index - 1;
+			tag   = & tagdb->block[index / TAGDB_BLOCK_TAGS][index % TAGDB_BLOCK_TAGS];
+
+			if ( strcmp( tag->name, name ) == 0 ) return tag;
+		}
+
+		a = ( a + 1 ) & mask;
+	}
+
+	return NULL;
+
+}  /* finslib_tagdb_find */
+
+/*
+ * int finslib_tagdb_import( struct fins_tagdb_tp *tagdb, const char *filename, size_t *num_tags, size_t *num_skipped );
+ *
+ * The function finslib_tagdb_import() adds the symbols in a symbol table text
+ * file exported from CX-Programmer to a tag database. The fields on a line
+ * are separated by tabs, commas or semicolons and may be quoted. The first
+ * three fields contain the name, the data type and the address of the
+ * symbol. The data type and address fields may also be swapped. Addresses in
+ * the CX-Programmer notation like 0.00, D100, T10 and W3.05 are converted to
+ * the notation used by the library.
+ *
+ * Lines with a data type that has no FINS counterpart, like arrays and
+ * strings, with an invalid address or with a name which is already in the
+ * database are skipped. A header line and lines starting with a # are
+ * ignored. The number of added and skipped tags are returned in num_tags and
+ * num_skipped when these are not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_tagdb_import( struct fins_tagdb_tp *tagdb, const char *filename, size_t *num_tags, size_t *num_skipped ) {
+
+	FILE *fp;
+	char line[TAGDB_LINE_LEN];
+	char address[12];
+	char *field[TAGDB_MAX_FIELDS];
+	char *ptr;
+	char delimiter;
+	size_t num_fields;
+	size_t num_comma;
+	size_t num_semicolon;
+	size_t added;
+	size_t skipped;
+	bool first;
+	int type;
+	int ch;
+	int retval;
+	struct fins_tag_tp tag;
+
+	if ( num_tags    != NULL ) *num_tags    = 0;
+	if ( num_skipped != NULL ) *num_skipped = 0;
+
+	if ( tagdb    == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( filename == NULL ) return FINS_RETVAL_INVALID_FILENAME;
+
+	fp = fopen( filename, "rb" );
+	if ( fp == NULL ) return FINS_RETVAL_ERRNO_BASE + errno;
+
+	delimiter = 0;
+	added     = 0;
+	skipped   = 0;
+	first     = true;
+	retval    = FINS_RETVAL_SUCCESS;
+
+	while ( fgets( line, TAGDB_LINE_LEN, fp ) != NULL ) {
+
+		ptr = strchr( line, '\n' );
+
+		if ( ptr == NULL  &&  ! feof( fp ) ) {
+
+			do { ch = fgetc( fp ); } while ( ch != '\n'  &&  ch != EOF );
+			skipped++;
+			continue;
+		}
+
+		if ( ptr != NULL ) *ptr = 0;
+		ptr = strchr( line, '\r' );
+		if ( ptr != NULL ) *ptr = 0;
+
+		ptr = line;
+		if ( (unsigned char) ptr[0] == 0xEF  &&  (unsigned char) ptr[1] == 0xBB  &&  (unsigned char) ptr[2] == 0xBF ) ptr += 3;
+
+		while ( *ptr == ' ' ) ptr++;
+		if ( *ptr == 0  ||  *ptr == '#' ) continue;
+
+		if ( delimiter == 0 ) {
+
+			num_comma     = 0;
+			num_semicolon = 0;
+
+			for (num_fields=0; ptr[num_fields]; num_fields++) {
+
+				if ( ptr[num_fields] == ','  ) num_comma++;
+				if ( ptr[num_fields] == ';'  ) num_semicolon++;
+			}
+
+			if      ( strchr( ptr, '\t' ) != NULL  ) delimiter = '\t';
+			else if ( num_semicolon > num_comma    ) delimiter = ';';
+			else                                     delimiter = ',';
+		}
+
+		num_fields = parse_line( ptr, delimiter, field );
+
+		type = FINS_DATA_TYPE_NONE;
+
+		if ( num_fields >= 3 ) {
+
+			type = cx_type( field[1] );
+
+			if ( type != FINS_DATA_TYPE_NONE ) ptr = field[2];
+			else {
+				type = cx_type( field[2] );
+				ptr  = field[1];
+			}
+		}
+
+		if ( type == FINS_DATA_TYPE_NONE ) {
+
+			if ( ! first ) skipped++;
+			first = false;
+			continue;
+		}
+
+		first = false;
+
+		if ( cx_address( ptr, address )                                                   ||
+		     resolve_tag( tagdb->plc_mode, field[0], address, type, & tag ) != FINS_RETVAL_SUCCESS ) {
+
+			skipped++;
+			continue;
+		}
+
+		retval = insert_tag( tagdb, & tag );
+
+		if      ( retval == FINS_RETVAL_SUCCESS     ) added++;
+		else if ( retval == FINS_RETVAL_INVALID_TAG ) skipped++;
+		else break;
+
+		retval = FINS_RETVAL_SUCCESS;
+	}
+
+	if ( retval == FINS_RETVAL_SUCCESS  &&  ferror( fp ) ) retval = FINS_RETVAL_ERRNO_BASE + errno;
+
+	fclose( fp );
+
+	if ( num_tags    != NULL ) *num_tags    = added;
+	if ( num_skipped != NULL ) *num_skipped = skipped;
+
+	return retval;
+
+}  /* finslib_tagdb_import */
+
+/*
+ * static int resolve_tag( int plc_mode, const char *name, const char *address, int type, struct fins_tag_tp *tag );
+ *
+ * The function resolve_tag() fills a tag structure with a name, an address
+ * and a data type. The address is decoded and the memory areas to read and
+ * write values of the data type at that address are searched. Forced data
+ * types can only be read. Values of more than one word must fit completely
+ * in the memory area.
+ */
+
+static int resolve_tag( int plc_mode, const char *name, const char *address, int type, struct fins_tag_tp *tag ) {
+
+	int bits;
+	bool force;
+	uint32_t num_words;
+
+	if ( name == NULL  ||  name[0] == 0                       ) return FINS_RETVAL_INVALID_TAG;
+	if ( strlen( name    ) >= FINS_TAG_NAME_LEN               ) return FINS_RETVAL_INVALID_TAG;
+	if ( strlen( address ) >= sizeof(tag->address)            ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+	if ( type < FINS_DATA_TYPE_INT16                          ) return FINS_RETVAL_INVALID_TAG;
+	if ( type > FINS_DATA_TYPE_LAST                           ) return FINS_RETVAL_INVALID_TAG;
+	if ( XX_finslib_decode_address( address, & tag->decoded ) ) return FINS_RETVAL_INVALID_READ_ADDRESS;
+
+	bits      = 16;
+	force     = false;
+	num_words = 1;
+
+	switch ( type ) {
+
+		case FINS_DATA_TYPE_BIT         : bits = 1;                 break;
+		case FINS_DATA_TYPE_BIT_FORCED  : bits = 1;  force = true;  break;
+		case FINS_DATA_TYPE_WORD_FORCED :            force = true;  break;
+		case FINS_DATA_TYPE_INT32       :
+		case FINS_DATA_TYPE_UINT32      :
+		case FINS_DATA_TYPE_BCD32       :
+		case FINS_DATA_TYPE_SBCD32_0    :
+		case FINS_DATA_TYPE_SBCD32_1    :
+		case FINS_DATA_TYPE_SBCD32_2    :
+		case FINS_DATA_TYPE_SBCD32_3    :
+		case FINS_DATA_TYPE_FLOAT       : num_words = 2;            break;
+		case FINS_DATA_TYPE_DOUBLE      : num_words = 4;            break;
+	}
+
+	tag->read_area  = XX_finslib_search_area_mode( plc_mode, & tag->decoded, bits, FI_MRD, force );
+	tag->write_area = ( force ) ? NULL : XX_finslib_search_area_mode( plc_mode, & tag->decoded, bits, FI_WR, false );
+
+	if ( tag->read_area == NULL                                                     ) return FINS_RETVAL_INVALID_READ_AREA;
+	if ( tag->decoded.main_address + num_words - 1 > tag->read_area->high_id        ) return FINS_RETVAL_INVALID_READ_AREA;
+
+	strcpy( tag->name,    name    );
+	strcpy( tag->address, address );
+	tag->type = type;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* resolve_tag */
+
+/*
+ * static int insert_tag( struct fins_tagdb_tp *tagdb, const struct fins_tag_tp *tag );
+ *
+ * The function insert_tag() copies a resolved tag to the database and adds
+ * its name to the hash table. A new block of tags is allocated when the last
+ * one is full.
+ */
+
+static int insert_tag( struct fins_tagdb_tp *tagdb, const struct fins_tag_tp *tag ) {
+
+	uint32_t hash;
+	size_t a;
+	size_t index;
+	size_t mask;
+	struct fins_tag_tp **block;
+
+	if ( tagdb->num_tags >= UINT32_MAX - 1                                ) return FINS_RETVAL_OUT_OF_MEMORY;
+	if ( 2 * ( tagdb->num_tags + 1 ) > tagdb->num_slots  &&  grow_slots( tagdb ) ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	hash = hash_name( tag->name );
+	mask = tagdb->num_slots - 1;
+	a    = hash & mask;
+
+	while ( tagdb->slot[a].index != 0 ) {
+
+		if ( tagdb->slot[a].hash == hash ) {
+
+			index = tagdb->slot[a].index - 1;
+			if ( strcmp( tagdb->block[index / TAGDB_BLOCK_TAGS][index % TAGDB_BLOCK_TAGS].name, tag->name ) == 0 ) return FINS_RETVAL_INVALID_TAG;
+		}
+
+		a = ( a + 1 ) & mask;
+	}
+
+	index = tagdb->num_tags;
+
+	if ( index / TAGDB_BLOCK_TAGS >= tagdb->num_blocks ) {
+
+		if ( tagdb->num_blocks >= tagdb->max_blocks ) {
+
+			block = realloc( tagdb->block, ( tagdb->max_blocks + 16 ) * sizeof(struct fins_tag_tp *) );
+			if ( block == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+			tagdb->block       = block;
+			tagdb->max_blocks += 16;
+		}
+
+		tagdb->block[tagdb->num_blocks] = malloc( TAGDB_BLOCK_TAGS * sizeof(struct fins_tag_tp) );
+		if ( tagdb->block[tagdb->num_blocks] == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+		tagdb->num_blocks++;
+	}
+
+	tagdb->block[index / TAGDB_BLOCK_TAGS][index % TAGDB_BLOCK_TAGS] = *tag;
+
+	tagdb->slot[a].hash  = hash;
+	tagdb->slot[a].index = (uint32_t) ( index + 1 );
+	tagdb->num_tags++;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* insert_tag */
+
+/*
+ * static bool grow_slots( struct fins_tagdb_tp *tagdb );
+ *
+ * The function grow_slots() doubles the size of the hash table. The slots are
+ * moved with the stored hash values, so no names have to be hashed again.
+ * The function returns true if no memory could be allocated.
+ */
+
+static bool grow_slots( struct fins_tagdb_tp *tagdb ) {
+
+	size_t a;
+	size_t b;
+	size_t mask;
+	size_t num_slots;
+	struct tagdb_slot_tp *slot;
+
+	num_slots = ( tagdb->num_slots == 0 ) ? TAGDB_MIN_SLOTS : 2 * tagdb->num_slots;
+
+	slot = calloc( num_slots, sizeof(struct tagdb_slot_tp) );
+	if ( slot == NULL ) return true;
+
+	mask = num_slots - 1;
+
+	for (a=0; a<tagdb->num_slots; a++) {
+
+		if ( tagdb->slot[a].index == 0 ) continue;
+
+		b = tagdb->slot[a].hash & mask;
+		while ( slot[b].index != 0 ) b = ( b + 1 ) & mask;
+
+		slot[b] = tagdb->slot[a];
+	}
+
+	free( tagdb->slot );
+
+	tagdb->slot      = slot;
+	tagdb->num_slots = num_slots;
+
+	return false;
+
+}  /* grow_slots */
+
+/*
+ * static uint32_t hash_name( const char *name );
+ *
+ * The function hash_name() returns the 32 bit FNV-1a hash of a tag name.
+ */
+
+static uint32_t hash_name( const char *name ) {
+
+	uint32_t hash;
+
+	hash = 2166136261u;
+
+	while ( *name ) {
+
+		hash ^= (unsigned char) *name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+
+}  /* hash_name */
+
+/*
+ * static size_t parse_line( char *line, char delimiter, char **field );
+ *
+ * The function parse_line() splits a line in place in at most
+ * TAGDB_MAX_FIELDS fields. Spaces around a field are removed and a field
+ * between double quotes may contain the delimiter. Two double quotes in a
+ * quoted field are converted to one. The function returns the number of
+ * fields found.
+ */
+
+static size_t parse_line( char *line, char delimiter, char **field ) {
+
+	size_t num_fields;
+	char *src;
+	char *dst;
+	char *end;
+
+	num_fields = 0;
+	src        = line;
+
+	while ( num_fields < TAGDB_MAX_FIELDS ) {
+
+		while ( *src == ' ' ) src++;
+
+		dst                 = src;
+		field[num_fields++] = dst;
+
+		if ( *src == '"' ) {
+
+			src++;
+
+			while ( *src ) {
+
+				if ( src[0] == '"'  &&  src[1] == '"' ) { *dst++ = '"'; src += 2; continue; }
+				if ( src[0] == '"'                    ) { src++; break; }
+
+				*dst++ = *src++;
+			}
+
+			while ( *src  &&  *src != delimiter ) src++;
+		}
+
+		else {
+			while ( *src  &&  *src != delimiter ) *dst++ = *src++;
+		}
+
+		end = dst;
+		while ( end > field[num_fields-1]  &&  end[-1] == ' ' ) end--;
+
+		if ( *src == 0 ) { *end = 0; break; }
+
+		src++;
+		*end = 0;
+	}
+
+	return num_fields;
+
+}  /* parse_line */
+
+/*
+ * static int cx_type( const char *str );
+ *
+ * The function cx_type() converts the name of a CX-Programmer data type to
+ * the matching FINS_DATA_TYPE_... value. The value FINS_DATA_TYPE_NONE is
+ * returned for types without a FINS counterpart.
+ */
+
+static int cx_type( const char *str ) {
+
+	static const struct {
+		const char *	name;
+		int		type;
+	} cx_types[] = {
+		{ "BOOL",      FINS_DATA_TYPE_BIT    },
+		{ "INT",       FINS_DATA_TYPE_INT16  },
+		{ "UINT",      FINS_DATA_TYPE_UINT16 },
+		{ "WORD",      FINS_DATA_TYPE_UINT16 },
+		{ "CHANNEL",   FINS_DATA_TYPE_UINT16 },
+		{ "DINT",      FINS_DATA_TYPE_INT32  },
+		{ "UDINT",     FINS_DATA_TYPE_UINT32 },
+		{ "DWORD",     FINS_DATA_TYPE_UINT32 },
+		{ "UINT_BCD",  FINS_DATA_TYPE_BCD16  },
+		{ "UDINT_BCD", FINS_DATA_TYPE_BCD32  },
+		{ "REAL",      FINS_DATA_TYPE_FLOAT  },
+		{ "LREAL",     FINS_DATA_TYPE_DOUBLE },
+		{ NULL,        FINS_DATA_TYPE_NONE   }
+	};
+
+	char upper[12];
+	size_t a;
+
+	for (a=0; str[a]  &&  a < sizeof(upper)-1; a++) upper[a] = (char) toupper( (unsigned char) str[a] );
+	if ( str[a] ) return FINS_DATA_TYPE_NONE;
+	upper[a] = 0;
+
+	for (a=0; cx_types[a].name != NULL; a++) if ( strcmp( cx_types[a].name, upper ) == 0 ) return cx_types[a].type;
+
+	return FINS_DATA_TYPE_NONE;
+
+}  /* cx_type */
+
+/*
+ * static bool cx_address( const char *str, char *address );
+ *
+ * The function cx_address() converts an address in CX-Programmer notation to
+ * the notation of the library in a buffer of 12 characters. A CIO address
+ * has no area name in CX-Programmer and the DM, timer and counter areas are
+ * abbreviated to D, T and C. The function returns true if the converted
+ * address does not fit in the buffer.
+ */
+
+static bool cx_address( const char *str, char *address ) {
+
+	const char *prefix;
+	size_t len;
+	int area;
+
+	while ( *str == ' ' ) str++;
+
+	prefix = "";
+	area   = toupper( (unsigned char) str[0] );
+
+	if ( isdigit( (unsigned char) str[0] ) ) prefix = "CIO";
+
+	else if ( isdigit( (unsigned char) str[1] ) ) {
+
+		if ( area == 'D' ) prefix = "DM";
+		if ( area == 'T' ) prefix = "TIM";
+		if ( area == 'C' ) prefix = "CNT";
+
+		if ( prefix[0] ) str++;
+	}
+
+	len = strlen( prefix );
+	if ( len + strlen( str ) >= 12 ) return true;
+
+	strcpy( address,       prefix );
+	strcpy( address + len, str    );
+
+	return false;
+
+}  /* cx_address */
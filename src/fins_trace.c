@@ -0,0 +1,233 @@
+/*
+ * Library: libfins
+ * File:    src/fins_trace.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_trace.c contains optional tracing of the phases of
+ * FINS commands. Trace events are generated when a command is built, when
+ * sending starts and ends, when the first part of the response arrives, when
+ * the complete response has been received and when the response has been
+ * checked. Every event carries a nanosecond timestamp, which makes it possible
+ * to see where the time of a slow command was spent.
+ *
+ * The trace points are only compiled in when the library is built with the
+ * preprocessor symbol FINS_ENABLE_TRACE defined. Events can be passed to a
+ * callback function and stored in a ring buffer which another thread can read
+ * without locking.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+									/********************************************************/
+struct fins_tracedata_tp {						/*							*/
+	fins_trace_callback_tp	callback;				/* Function called for every event or NULL		*/
+	void *			context;				/* Parameter passed to the callback function		*/
+	size_t			ring_size;				/* Number of events in the ring, a power of two		*/
+	struct fins_trace_tp *	ring;					/* Ring buffer with events or NULL			*/
+	volatile size_t		head;					/* Number of events written, owned by the connection	*/
+	volatile size_t		tail;					/* Number of events read, owned by the reader		*/
+	volatile uint64_t	dropped;				/* Events lost because the ring was full		*/
+};									/*							*/
+									/********************************************************/
+
+/*
+ * int finslib_trace_enable( struct fins_sys_tp *sys, fins_trace_callback_tp callback, void *context, size_t ring_size );
+ *
+ * The function finslib_trace_enable() starts tracing the commands on a
+ * connection. Every event is passed to the callback function if it is not
+ * NULL. If ring_size is not zero, events are also stored in a ring buffer
+ * which can hold at least ring_size events and can be read with the function
+ * finslib_trace_read(). If the library was compiled without trace support the
+ * function returns FINS_RETVAL_NOT_SUPPORTED.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_trace_enable( struct fins_sys_tp *sys, fins_trace_callback_tp callback, void *context, size_t ring_size ) {
+
+#if defined(FINS_ENABLE_TRACE)
+
+	size_t size;
+	struct fins_tracedata_tp *trace;
+
+	if ( sys == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	trace = calloc( 1, sizeof(struct fins_tracedata_tp) );
+	if ( trace == NULL ) return FINS_RETVAL_OUT_OF_MEMORY;
+
+	if ( ring_size > 0 ) {
+
+		size = 1;
+		while ( size < ring_size ) size <<= 1;
+
+		trace->ring = calloc( size, sizeof(struct fins_trace_tp) );
+
+		if ( trace->ring == NULL ) {
+
+			free( trace );
+			return FINS_RETVAL_OUT_OF_MEMORY;
+		}
+
+		trace->ring_size = size;
+	}
+
+	trace->callback = callback;
+	trace->context  = context;
+
+	finslib_trace_disable( sys );
+
+	sys->trace = trace;
+
+	return FINS_RETVAL_SUCCESS;
+
+#else  /* defined(FINS_ENABLE_TRACE) */
+
+	(void) callback;
+	(void) context;
+	(void) ring_size;
+
+	if ( sys == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+
+	return FINS_RETVAL_NOT_SUPPORTED;
+
+#endif  /* defined(FINS_ENABLE_TRACE) */
+
+}  /* finslib_trace_enable */
+
+/*
+ * void finslib_trace_disable( struct fins_sys_tp *sys );
+ *
+ * The function finslib_trace_disable() stops tracing on a connection and
+ * releases the associated memory. No other thread may be reading the ring
+ * buffer while this function is called.
+ */
+
+void finslib_trace_disable( struct fins_sys_tp *sys ) {
+
+	if ( sys == NULL  ||  sys->trace == NULL ) return;
+
+	free( sys->trace->ring );
+	free( sys->trace );
+
+	sys->trace = NULL;
+
+}  /* finslib_trace_disable */
+
+/*
+ * size_t finslib_trace_read( struct fins_sys_tp *sys, struct fins_trace_tp *events, size_t max_events, uint64_t *dropped );
+ *
+ * The function finslib_trace_read() moves at most max_events events from the
+ * ring buffer of a connection to the events array and returns the number of
+ * events moved. The function may be called from another thread than the one
+ * using the connection, but only one thread may read the ring buffer. If the
+ * dropped parameter is not NULL, the number of events lost because the ring
+ * buffer was full is stored there.
+ */
+
+size_t finslib_trace_read( struct fins_sys_tp *sys, struct fins_trace_tp *events, size_t max_events, uint64_t *dropped ) {
+
+	size_t num;
+	size_t head;
+	size_t tail;
+	struct fins_tracedata_tp *trace;
+
+	if ( sys == NULL  ||  sys->trace == NULL  ||  events == NULL ) return 0;
+
+	trace = sys->trace;
+
+	if ( dropped != NULL ) *dropped = trace->dropped;
+
+	if ( trace->ring == NULL ) return 0;
+
+	head = trace->head;
+	FINS_MEMORY_BARRIER();
+	tail = trace->tail;
+
+	num = 0;
+
+	while ( tail != head  &&  num < max_events ) {
+
+		events[num++] = trace->ring[ tail & ( trace->ring_size - 1 ) ];
+		tail++;
+	}
+
+	FINS_MEMORY_BARRIER();
+	trace->tail = tail;
+
+	return num;
+
+}  /* finslib_trace_read */
+
+/*
+ * void XX_finslib_trace( struct fins_sys_tp *sys, uint8_t event, const unsigned char *header, int retval );
+ *
+ * The function XX_finslib_trace() records one trace event. The Service ID and
+ * command code are taken from the header. If no header is available, they
+ * are recorded as zero. The header of the last command sent is not used
+ * instead, because it is wrong when more than one command is in flight.
+ *
+ * The function is normally called through the macro XX_FINS_TRACE() which is
+ * empty if tracing is not compiled in.
+ */
+
+void XX_finslib_trace( struct fins_sys_tp *sys, uint8_t event, const unsigned char *header, int retval ) {
+
+	size_t head;
+	struct fins_trace_tp ev;
+	struct fins_tracedata_tp *trace;
+
+	if ( sys == NULL  ||  sys->trace == NULL ) return;
+
+	trace = sys->trace;
+
+	ev.nsec   = finslib_monotonic_nsec_timer();
+	ev.event  = event;
+	ev.sid    = ( header != NULL ) ? header[FINS_SID] : 0;
+	ev.mrc    = ( header != NULL ) ? header[FINS_MRC] : 0;
+	ev.src    = ( header != NULL ) ? header[FINS_SRC] : 0;
+	ev.retval = retval;
+
+	if ( trace->ring != NULL ) {
+
+		head = trace->head;
+
+		if ( head - trace->tail >= trace->ring_size ) trace->dropped++;
+
+		else {
+			trace->ring[ head & ( trace->ring_size - 1 ) ] = ev;
+
+			FINS_MEMORY_BARRIER();
+			trace->head = head + 1;
+		}
+	}
+
+	if ( trace->callback != NULL ) trace->callback( sys, & ev, trace->context );
+
+}  /* XX_finslib_trace */
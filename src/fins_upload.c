@@ -0,0 +1,323 @@
+/*
+ * Library: libfins
+ * File:    src/fins_upload.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_upload.c contains routines to upload complete files
+ * to the memory card or EM file memory of a remote PLC. The first block of
+ * data creates or overwrites the file. The remaining blocks are written at
+ * their own file position with a number of 22 03 file write commands in
+ * flight at the same time. The result
+ * can optionally be verified by checking the size in the directory entry or
+ * by reading the file back and comparing the CRC-32 checksum.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#else  /* defined(_WIN32) */
+#include <unistd.h>
+#endif  /* defined(_WIN32) */
+
+#include "fins.h"
+
+									/********************************************************/
+struct upload_tp {							/*							*/
+	uint16_t		disk;					/* Disk on which the file is located			*/
+	const char *		path;					/* Directory in which the file is located		*/
+	const char *		filename;				/* Name of the file					*/
+	const unsigned char *	data;					/* Data to upload or NULL when reading from fd		*/
+	size_t			data_len;				/* Number of bytes in data				*/
+	int			fd;					/* File descriptor to read the data from		*/
+	size_t			position;				/* Number of bytes taken from the source		*/
+	size_t			num_bytes;				/* Number of bytes confirmed written by the PLC		*/
+	uint32_t		crc;					/* CRC-32 of the bytes taken from the source		*/
+	size_t			block_len[FINS_PIPELINE_MAX_DEPTH];	/* Length of the blocks in flight			*/
+	unsigned char		buffer[FINS_MAX_FILE_WRITE_BYTES];	/* Buffer for data read from the file descriptor	*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct verify_tp {							/*							*/
+	size_t			num_bytes;				/* Number of bytes read back				*/
+	uint32_t		crc;					/* CRC-32 of the bytes read back			*/
+};									/*							*/
+									/********************************************************/
+
+static int	build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+static int	crc_sink( const unsigned char *data, size_t num_bytes, void *context );
+static int	handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+static int	next_block( struct upload_tp *upload, const unsigned char **block, size_t *block_len );
+static int	upload( struct fins_sys_tp *sys, struct upload_tp *upload, size_t depth, int verify );
+
+/*
+ * int finslib_file_upload( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t num_bytes, size_t depth, int verify );
+ *
+ * The function finslib_file_upload() writes a block of memory, for example a
+ * memory mapped file, as a complete file to a disk of a remote PLC. An
+ * existing file with the same name is overwritten. At most depth write
+ * commands are in flight at the same time. The verify parameter selects how
+ * the result is checked afterwards and is one of the FINS_VERIFY_... values.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_upload( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, const unsigned char *data, size_t num_bytes, size_t depth, int verify ) {
+
+	struct upload_tp state;
+
+	if ( sys == NULL                     ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( num_bytes > 0  &&  data == NULL ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	memset( & state, 0, sizeof(state) );
+
+	state.disk     = disk;
+	state.path     = path;
+	state.filename = filename;
+	state.data     = ( data != NULL ) ? data : (const unsigned char *) "";
+	state.data_len = num_bytes;
+	state.fd       = -1;
+
+	return upload( sys, & state, depth, verify );
+
+}  /* finslib_file_upload */
+
+/*
+ * int finslib_file_upload_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, int fd, size_t depth, int verify, size_t *num_bytes );
+ *
+ * The function finslib_file_upload_fd() reads data from a file descriptor
+ * until the end of file is reached and writes it as a complete file to a disk
+ * of a remote PLC like finslib_file_upload(). The file descriptor may also be
+ * a pipe. The number of bytes confirmed written by the PLC is stored in
+ * num_bytes if that parameter is not NULL.
+ *
+ * The function returns a success or error code from the list FINS_RETVAL_...
+ */
+
+int finslib_file_upload_fd( struct fins_sys_tp *sys, uint16_t disk, const char *path, const char *filename, int fd, size_t depth, int verify, size_t *num_bytes ) {
+
+	int retval;
+	struct upload_tp state;
+
+	if ( num_bytes != NULL ) *num_bytes = 0;
+
+	if ( sys == NULL ) return FINS_RETVAL_NOT_INITIALIZED;
+	if ( fd  <  0    ) return FINS_RETVAL_NO_DATA_BLOCK;
+
+	memset( & state, 0, sizeof(state) );
+
+	state.disk     = disk;
+	state.path     = path;
+	state.filename = filename;
+	state.data     = NULL;
+	state.fd       = fd;
+
+	retval = upload( sys, & state, depth, verify );
+
+	if ( num_bytes != NULL ) *num_bytes = state.num_bytes;
+
+	return retval;
+
+}  /* finslib_file_upload_fd */
+
+/*
+ * static int upload( struct fins_sys_tp *sys, struct upload_tp *upload, size_t depth, int verify );
+ *
+ * The function upload() performs an upload from a memory block or a file
+ * descriptor. The first block is written on its own to create the file. The
+ * other blocks are written at their file position with the write commands
+ * pipelined.
+ */
+
+static int upload( struct fins_sys_tp *sys, struct upload_tp *state, size_t depth, int verify ) {
+
+	int retval;
+	size_t block_len;
+	const unsigned char *block;
+	struct fins_fileinfo_tp fileinfo;
+	struct verify_tp readback;
+
+	if ( verify != FINS_VERIFY_NONE  &&  verify != FINS_VERIFY_SIZE  &&  verify != FINS_VERIFY_READ_BACK ) return FINS_RETVAL_INVALID_VERIFY_MODE;
+
+	if ( ( retval = next_block( state, & block, & block_len ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( ( retval = finslib_file_write( sys, state->disk, state->path, state->filename, block, 0, block_len, FINS_WRITE_MODE_NEW_OVERWRITE ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	state->num_bytes = block_len;
+
+	if ( block_len == FINS_MAX_FILE_WRITE_BYTES ) {
+
+		if ( ( retval = XX_finslib_pipeline( sys, (size_t) -1, depth, build_write, handle_write, state ) ) != FINS_RETVAL_SUCCESS ) return retval;
+	}
+
+	if ( state->num_bytes != state->position ) return FINS_RETVAL_FILE_SIZE_MISMATCH;
+
+	if ( verify == FINS_VERIFY_SIZE ) {
+
+		if ( ( retval = finslib_file_info( sys, state->disk, state->path, state->filename, & fileinfo ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+		if ( fileinfo.size != state->num_bytes ) return FINS_RETVAL_FILE_SIZE_MISMATCH;
+	}
+
+	else if ( verify == FINS_VERIFY_READ_BACK ) {
+
+		readback.num_bytes = 0;
+		readback.crc       = 0;
+
+		if ( ( retval = finslib_file_download( sys, state->disk, state->path, state->filename, 0, crc_sink, & readback, depth, NULL ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+		if ( readback.num_bytes != state->num_bytes  ||  readback.crc != state->crc ) return FINS_RETVAL_VERIFY_FAILED;
+	}
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* upload */
+
+/*
+ * static int next_block( struct upload_tp *upload, const unsigned char **block, size_t *block_len );
+ *
+ * The function next_block() takes the next block of at most the maximum file
+ * write size from the source of an upload. A file descriptor is read until
+ * the block is full or the end of file is reached, so that only the last
+ * block is shorter than the maximum. A block length of 0 indicates that all
+ * data has been taken.
+ */
+
+static int next_block( struct upload_tp *state, const unsigned char **block, size_t *block_len ) {
+
+	int num_read;
+
+	if ( state->data != NULL ) {
+
+		*block     = state->data + state->position;
+		*block_len = state->data_len - state->position;
+
+		if ( *block_len > FINS_MAX_FILE_WRITE_BYTES ) *block_len = FINS_MAX_FILE_WRITE_BYTES;
+	}
+
+	else {
+		*block     = state->buffer;
+		*block_len = 0;
+
+		while ( *block_len < FINS_MAX_FILE_WRITE_BYTES ) {
+
+#if defined(_WIN32)
+			num_read = _read( state->fd, state->buffer + *block_len, (unsigned int) ( FINS_MAX_FILE_WRITE_BYTES - *block_len ) );
+#else  /* defined(_WIN32) */
+			num_read = (int) read( state->fd, state->buffer + *block_len, FINS_MAX_FILE_WRITE_BYTES - *block_len );
+#endif  /* defined(_WIN32) */
+
+			if ( num_read <  0  &&  errno == EINTR ) continue;
+			if ( num_read <  0                     ) return FINS_RETVAL_ERRNO_BASE + errno;
+			if ( num_read == 0                     ) break;
+
+			*block_len += (size_t) num_read;
+		}
+	}
+
+	state->crc       = finslib_crc32( state->crc, *block, *block_len );
+	state->position += *block_len;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* next_block */
+
+/*
+ * static int build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context );
+ *
+ * The function build_write() builds the command which writes the next block
+ * of an upload to the file. The block is written in overwrite mode at its
+ * explicit position and not appended. With several commands in flight the
+ * PLC may otherwise store blocks in the wrong place when a command is lost or
+ * handled out of order. When all data has been taken from the source the
+ * value FINS_RETVAL_SUCCESS_LAST_DATA is returned to end the pipeline.
+ */
+
+static int build_write( struct fins_sys_tp *sys, size_t index, struct fins_command_tp *command, size_t *bodylen, void *context ) {
+
+	int retval;
+	size_t block_len;
+	size_t file_position;
+	const unsigned char *block;
+	struct upload_tp *state;
+
+	state         = context;
+	file_position = state->position;
+
+	if ( ( retval = next_block( state, & block, & block_len ) ) != FINS_RETVAL_SUCCESS ) return retval;
+
+	if ( block_len == 0 ) return FINS_RETVAL_SUCCESS_LAST_DATA;
+
+	state->block_len[ index % FINS_PIPELINE_MAX_DEPTH ] = block_len;
+
+	return XX_finslib_file_write_command( sys, command, bodylen, state->disk, state->path, state->filename, block, file_position, block_len, FINS_WRITE_MODE_OVERWRITE );
+
+}  /* build_write */
+
+/*
+ * static int handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context );
+ *
+ * The function handle_write() counts the bytes of a block which the PLC
+ * confirmed as written.
+ */
+
+static int handle_write( struct fins_sys_tp *sys, size_t index, const struct fins_command_tp *response, size_t bodylen, void *context ) {
+
+	struct upload_tp *state;
+
+	(void) sys;
+	(void) response;
+
+	if ( bodylen != 2 ) return FINS_RETVAL_BODY_TOO_SHORT;
+
+	state             = context;
+	state->num_bytes += state->block_len[ index % FINS_PIPELINE_MAX_DEPTH ];
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* handle_write */
+
+/*
+ * static int crc_sink( const unsigned char *data, size_t num_bytes, void *context );
+ *
+ * The function crc_sink() calculates the CRC-32 of data read back from the PLC
+ * for verification.
+ */
+
+static int crc_sink( const unsigned char *data, size_t num_bytes, void *context ) {
+
+	struct verify_tp *readback;
+
+	readback             = context;
+	readback->crc        = finslib_crc32( readback->crc, data, num_bytes );
+	readback->num_bytes += num_bytes;
+
+	return FINS_RETVAL_SUCCESS;
+
+}  /* crc_sink */
@@ -0,0 +1,1222 @@
+/*
+ * Library: libfins
+ * File:    src/fins_uring.c
+ * Author:  Lammert Bies
+ *
+ * This file is licensed under the MIT License as stated below
+ *
+ * Copyright (c) 2016-2023 Lammert Bies
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description
+ * -----------
+ * The source file src/fins_uring.c contains an I/O backend based on the Linux
+ * io_uring interface. It is used when the same commands are sent to many PLCs
+ * at the same time. With the blocking socket calls every frame costs at least
+ * one system call for sending and one for receiving. The backend queues the
+ * sends and receives of all connections in a ring shared with the kernel and
+ * passes them in batches, so that the number of system calls and context
+ * switches no longer grows with the number of connections.
+ *
+ * Every thread which uses the backend gets its own ring. It is created at the
+ * first batch and kept until the thread ends, because closing a ring makes
+ * the kernel interrupt the next blocking system call of the thread. During a
+ * batch the sockets of the connections are placed in the table of fixed files
+ * of the ring. Every socket gets one multishot receive request which stays
+ * active until all responses have arrived. The kernel stores the received
+ * datagrams in buffers from a buffer ring which is registered with the ring
+ * as well, and the buffers are handed back to the kernel as soon as the
+ * response has been processed. Completions are only processed while the
+ * thread waits for them, so that the ring never interrupts the thread when it
+ * is doing something else.
+ *
+ * The backend is only compiled when the preprocessor symbol
+ * FINS_ENABLE_IO_URING is defined on a Linux system. It needs kernel 6.1 or
+ * newer and only handles batches in which all connections use UDP. In all
+ * other cases XX_finslib_uring_pipeline() returns false and the caller falls
+ * back to the blocking socket calls.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fins.h"
+
+#if defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__)
+
+#include <pthread.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define URING_RECV_TIMEOUT	10000					/* Equal to the socket receive timeout in fins_io.c	*/
+#define URING_CANCEL_TIMEOUT	100
+#define URING_SQ_ENTRIES	256
+#define URING_CQ_ENTRIES	4096
+#define URING_MIN_FILES		64
+#define URING_MIN_BUFFERS	64
+#define URING_MAX_BUFFERS	4096
+#define URING_BUF_GROUP		0
+#define URING_BUF_LEN		(FINS_HEADER_LEN+FINS_BODY_LEN)
+#define URING_RECV_FLAG		((uint64_t) 1 << 63)
+#define URING_CANCEL_FLAG	((uint64_t) 1 << 62)
+#define URING_GEN_SHIFT		40
+#define URING_GEN_MASK		0x3FFFFF
+#define URING_INDEX_MASK	( ( (uint64_t) 1 << URING_GEN_SHIFT ) - 1 )
+
+									/********************************************************/
+struct uring_tp {							/*							*/
+	int			fd;					/* File descriptor of the ring				*/
+	uint32_t		generation;				/* Number of the current batch				*/
+	size_t			num_files;				/* Size of the table of fixed files			*/
+	unsigned		sq_entries;				/* Number of entries in the submission queue		*/
+	unsigned		sq_tail;				/* Local copy of the submission queue tail		*/
+	unsigned *		sq_khead;				/* Submission queue head maintained by the kernel	*/
+	unsigned *		sq_ktail;				/* Submission queue tail shared with the kernel		*/
+	unsigned *		sq_kmask;				/* Mask to convert a position to an index		*/
+	unsigned *		sq_karray;				/* Array with the indices of the queued entries		*/
+	unsigned *		cq_khead;				/* Completion queue head shared with the kernel		*/
+	unsigned *		cq_ktail;				/* Completion queue tail maintained by the kernel	*/
+	unsigned *		cq_kmask;				/* Mask to convert a position to an index		*/
+	struct io_uring_sqe *	sqes;					/* Submission queue entries				*/
+	struct io_uring_cqe *	cqes;					/* Completion queue entries				*/
+	void *			sq_ring;				/* Mapped submission queue ring				*/
+	size_t			sq_ring_len;				/* Size of the mapped submission queue ring		*/
+	void *			cq_ring;				/* Mapped completion queue ring				*/
+	size_t			cq_ring_len;				/* Size of the mapped completion queue ring		*/
+	size_t			sqes_len;				/* Size of the mapped submission queue entries		*/
+	struct io_uring_buf_ring *buf_ring;				/* Ring with receive buffers for the kernel		*/
+	size_t			buf_ring_len;				/* Size of the mapped buffer ring			*/
+	unsigned		buf_entries;				/* Number of receive buffers				*/
+	uint16_t		buf_tail;				/* Local copy of the buffer ring tail			*/
+	unsigned char *		buf;					/* Memory of the receive buffers			*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct uring_slot_tp {							/*							*/
+	bool			done;					/* The command has been completed			*/
+	size_t			sent_len;				/* Number of bytes sent for the command			*/
+	int64_t			start_time;				/* Time at which the command was queued			*/
+	struct iovec		iov;					/* I/O vector pointing to the frame			*/
+	struct msghdr		msg;					/* Message header for the send request			*/
+	struct fins_command_tp	frame;					/* The command which is sent				*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct uring_conn_tp {							/*							*/
+	size_t			num_sent;				/* Number of commands queued for the connection		*/
+	size_t			outstanding;				/* Number of commands waiting for completion		*/
+	bool			armed;					/* A multishot receive request is active		*/
+	bool			stopped;				/* The handle function asked to ignore the rest		*/
+	struct sockaddr_in	addr;					/* Address of the PLC					*/
+};									/*							*/
+									/********************************************************/
+
+									/********************************************************/
+struct uring_batch_tp {							/*							*/
+	struct fins_sys_tp **	sys;					/* The connections in the batch				*/
+	size_t			num_sys;				/* Number of connections				*/
+	size_t			num_command;				/* Number of commands per connection			*/
+	fins_pipeline_handle_tp	handle;					/* Function to handle a response			*/
+	void **			context;				/* Context of each connection				*/
+	int *			retval;					/* Return code of each connection			*/
+	size_t			outstanding;				/* Commands waiting for completion in all connections	*/
+	struct uring_conn_tp *	conn;					/* State of the connections				*/
+	struct uring_slot_tp *	slot;					/* State of the commands				*/
+};									/*							*/
+									/********************************************************/
+
+static bool			arm_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index );
+static bool			attach_files( struct uring_tp *ring, const struct uring_batch_tp *batch, bool attach );
+static void			cancel_recv( struct uring_tp *ring, struct uring_batch_tp *batch );
+static void			close_ring( struct uring_tp *ring );
+static void			create_ring_key( void );
+static void			fail_conn( struct uring_batch_tp *batch, size_t index, int error_code );
+static void			finish_conn( struct uring_batch_tp *batch, size_t index, int retval );
+static struct uring_tp *	get_ring( size_t num_files, size_t num_buffers );
+static struct io_uring_sqe *	get_sqe( struct uring_tp *ring );
+static bool			open_ring( struct uring_tp *ring );
+static void			process_cqe( struct uring_tp *ring, struct uring_batch_tp *batch, const struct io_uring_cqe *cqe );
+static void			process_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, const struct io_uring_cqe *cqe );
+static void			process_send( struct uring_batch_tp *batch, size_t index, int res );
+static void			queue_commands( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, fins_pipeline_build_tp build );
+static size_t			reap( struct uring_tp *ring, struct uring_batch_tp *batch );
+static void			recycle_buffer( struct uring_tp *ring, unsigned bid );
+static void			release_ring( void *ptr );
+static bool			size_buffers( struct uring_tp *ring, size_t num_buffers );
+static bool			size_files( struct uring_tp *ring, size_t num_files );
+static int			submit( struct uring_tp *ring );
+static uint64_t			user_data( const struct uring_tp *ring, uint64_t flags, size_t index );
+static int			wait_cqe( struct uring_tp *ring, int64_t timeout_msec );
+
+static __thread struct uring_tp *	thread_ring         = NULL;
+static __thread bool			thread_unsupported  = false;
+static pthread_once_t			ring_key_once       = PTHREAD_ONCE_INIT;
+static pthread_key_t			ring_key;
+static bool				ring_key_valid      = false;
+
+#endif  /* defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__) */
+
+/*
+ * bool XX_finslib_uring_pipeline( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval );
+ *
+ * The function XX_finslib_uring_pipeline() executes a multi connection
+ * pipeline with the io_uring backend. The parameters are the same as for
+ * XX_finslib_pipeline_multi() which has already stored an error code in
+ * retval for the connections which cannot be used. Only the connections with
+ * FINS_RETVAL_SUCCESS in retval take part in the batch.
+ *
+ * The function returns true if the batch has been executed, in which case the
+ * results are available in retval. It returns false without any I/O if the
+ * backend is not compiled in, not supported by the kernel or not suitable for
+ * the connections in the batch.
+ */
+
+bool XX_finslib_uring_pipeline( struct fins_sys_tp **sys, size_t num_sys, size_t num_command, fins_pipeline_build_tp build, fins_pipeline_handle_tp handle, void **context, int *retval ) {
+
+#if defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__)
+
+	size_t a;
+	size_t num_active;
+	int64_t deadline;
+	int64_t now;
+	int result;
+	struct uring_tp *ring;
+	struct uring_batch_tp batch;
+
+	if ( sys == NULL  ||  build == NULL  ||  handle == NULL  ||  context == NULL  ||  retval == NULL ) return false;
+	if ( num_sys == 0  ||  num_command == 0  ||  num_command > FINS_PIPELINE_MAX_DEPTH              ) return false;
+
+	num_active = 0;
+
+	for (a=0; a<num_sys; a++) {
+
+		if ( retval[a]         != FINS_RETVAL_SUCCESS ) continue;
+		if ( sys[a]->comm_type != FINS_COMM_TYPE_UDP  ) return false;
+
+		num_active++;
+	}
+
+	if ( num_active == 0 ) return false;
+
+	memset( & batch, 0, sizeof(batch) );
+
+	batch.sys         = sys;
+	batch.num_sys     = num_sys;
+	batch.num_command = num_command;
+	batch.handle      = handle;
+	batch.context     = context;
+	batch.retval      = retval;
+	batch.conn        = calloc( num_sys,               sizeof(struct uring_conn_tp) );
+	batch.slot        = calloc( num_sys * num_command, sizeof(struct uring_slot_tp) );
+
+	if ( batch.conn == NULL  ||  batch.slot == NULL ) {
+
+		free( batch.conn );
+		free( batch.slot );
+
+		return false;
+	}
+
+	for (a=0; a<num_sys; a++) {
+
+		if ( retval[a] != FINS_RETVAL_SUCCESS ) continue;
+
+		batch.conn[a].addr.sin_family = AF_INET;
+		batch.conn[a].addr.sin_port   = htons( sys[a]->port );
+
+		if ( finslib_inet_pton( AF_INET, sys[a]->address, & batch.conn[a].addr.sin_addr.s_addr ) <= 0 ) {
+
+			/*
+			 * The blocking path knows how to report an invalid
+			 * address and closes the connection in that case.
+			 */
+
+			free( batch.conn );
+			free( batch.slot );
+
+			return false;
+		}
+	}
+
+	ring = get_ring( num_sys, num_sys * num_command );
+
+	if ( ring == NULL  ||  ! attach_files( ring, & batch, true ) ) {
+
+		free( batch.conn );
+		free( batch.slot );
+
+		return false;
+	}
+
+	ring->generation = ( ring->generation + 1 ) & URING_GEN_MASK;
+
+	for (a=0; a<num_sys; a++) {
+
+		if ( retval[a] != FINS_RETVAL_SUCCESS ) continue;
+
+		if ( ! arm_recv( ring, & batch, a ) ) {
+
+			retval[a] = FINS_RETVAL_ERRNO_BASE + EBUSY;
+			continue;
+		}
+
+		queue_commands( ring, & batch, a, build );
+	}
+
+	deadline = finslib_monotonic_msec_timer() + URING_RECV_TIMEOUT;
+
+	while ( batch.outstanding > 0 ) {
+
+		if ( ( result = submit( ring ) ) < 0  &&  result != -EAGAIN  &&  result != -EBUSY  &&  result != -EINTR ) {
+
+			for (a=0; a<num_sys; a++) fail_conn( & batch, a, FINS_RETVAL_ERRNO_BASE - result );
+			break;
+		}
+
+		if ( reap( ring, & batch ) > 0 ) continue;
+
+		now = finslib_monotonic_msec_timer();
+
+		if ( now >= deadline ) {
+
+			/*
+			 * The PLCs which did not answer in time get the same
+			 * error as a receive timeout on a blocking socket.
+			 */
+
+			for (a=0; a<num_sys; a++) fail_conn( & batch, a, FINS_RETVAL_ERRNO_BASE + EAGAIN );
+			break;
+		}
+
+		wait_cqe( ring, deadline - now );
+	}
+
+	cancel_recv( ring, & batch );
+	attach_files( ring, & batch, false );
+
+	free( batch.conn );
+	free( batch.slot );
+
+	return true;
+
+#else  /* defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__) */
+
+	(void) sys;
+	(void) num_sys;
+	(void) num_command;
+	(void) build;
+	(void) handle;
+	(void) context;
+	(void) retval;
+
+	return false;
+
+#endif  /* defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__) */
+
+}  /* XX_finslib_uring_pipeline */
+
+#if defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__)
+
+/*
+ * static struct uring_tp *get_ring( size_t num_files, size_t num_buffers );
+ *
+ * The function get_ring() returns the ring of the calling thread with room
+ * for at least num_files fixed files and, up to a maximum, num_buffers
+ * receive buffers. The ring is created at the first call in a thread and
+ * released automatically when the thread ends. If the running kernel does not
+ * support the features needed, this is remembered so that later batches in
+ * the same thread do not try again.
+ *
+ * The function returns a pointer to the ring or NULL if it is not available.
+ */
+
+static struct uring_tp *get_ring( size_t num_files, size_t num_buffers ) {
+
+	struct uring_tp *ring;
+
+	if ( thread_unsupported ) return NULL;
+
+	if ( thread_ring == NULL ) {
+
+		pthread_once( & ring_key_once, create_ring_key );
+		if ( ! ring_key_valid ) return NULL;
+
+		ring = calloc( 1, sizeof(struct uring_tp) );
+		if ( ring == NULL ) return NULL;
+
+		if ( ! open_ring( ring ) ) {
+
+			free( ring );
+			thread_unsupported = true;
+
+			return NULL;
+		}
+
+		if ( pthread_setspecific( ring_key, ring ) != 0 ) {
+
+			release_ring( ring );
+			return NULL;
+		}
+
+		thread_ring = ring;
+	}
+
+	if ( ! size_files(   thread_ring, num_files   ) ) return NULL;
+	if ( ! size_buffers( thread_ring, num_buffers ) ) return NULL;
+
+	return thread_ring;
+
+}  /* get_ring */
+
+/*
+ * static void create_ring_key( void );
+ *
+ * The function create_ring_key() creates the key with which the ring of a
+ * thread is released when the thread ends. It is called only once.
+ */
+
+static void create_ring_key( void ) {
+
+	ring_key_valid = ( pthread_key_create( & ring_key, release_ring ) == 0 );
+
+}  /* create_ring_key */
+
+/*
+ * static void release_ring( void *ptr );
+ *
+ * The function release_ring() closes the ring of a thread which ends and
+ * releases the memory associated with it.
+ */
+
+static void release_ring( void *ptr ) {
+
+	close_ring( ptr );
+	free( ptr );
+
+}  /* release_ring */
+
+/*
+ * static bool open_ring( struct uring_tp *ring );
+ *
+ * The function open_ring() creates a ring. Completions are only processed
+ * when the thread waits for them, so that the kernel never has to interrupt
+ * the thread to deliver them. Features which are missing in the running
+ * kernel make the function fail, so that the caller can fall back to the
+ * blocking socket calls.
+ *
+ * The function returns true if the ring is ready for use.
+ */
+
+static bool open_ring( struct uring_tp *ring ) {
+
+	struct io_uring_params params;
+
+	memset( ring,     0, sizeof(struct uring_tp) );
+	memset( & params, 0, sizeof(params)          );
+
+	params.flags      = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_CQSIZE;
+	params.cq_entries = URING_CQ_ENTRIES;
+
+	ring->fd = (int) syscall( __NR_io_uring_setup, URING_SQ_ENTRIES, & params );
+	if ( ring->fd < 0 ) return false;
+
+	if ( ! ( params.features & IORING_FEAT_EXT_ARG ) ) {
+
+		close_ring( ring );
+		return false;
+	}
+
+	ring->sq_entries  = params.sq_entries;
+	ring->sq_ring_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_ring_len = params.cq_off.cqes  + params.cq_entries * sizeof(struct io_uring_cqe);
+	ring->sqes_len    = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	if ( params.features & IORING_FEAT_SINGLE_MMAP ) {
+
+		if ( ring->cq_ring_len > ring->sq_ring_len ) ring->sq_ring_len = ring->cq_ring_len;
+		ring->cq_ring_len = ring->sq_ring_len;
+	}
+
+	ring->sq_ring = mmap( NULL, ring->sq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING );
+
+	if ( ring->sq_ring == MAP_FAILED ) {
+
+		ring->sq_ring = NULL;
+		close_ring( ring );
+		return false;
+	}
+
+	if ( params.features & IORING_FEAT_SINGLE_MMAP ) ring->cq_ring = ring->sq_ring;
+	else {
+		ring->cq_ring = mmap( NULL, ring->cq_ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING );
+
+		if ( ring->cq_ring == MAP_FAILED ) {
+
+			ring->cq_ring = NULL;
+			close_ring( ring );
+			return false;
+		}
+	}
+
+	ring->sqes = mmap( NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES );
+
+	if ( ring->sqes == MAP_FAILED ) {
+
+		ring->sqes = NULL;
+		close_ring( ring );
+		return false;
+	}
+
+	ring->sq_khead  = (unsigned *) ( (unsigned char *) ring->sq_ring + params.sq_off.head         );
+	ring->sq_ktail  = (unsigned *) ( (unsigned char *) ring->sq_ring + params.sq_off.tail         );
+	ring->sq_kmask  = (unsigned *) ( (unsigned char *) ring->sq_ring + params.sq_off.ring_mask    );
+	ring->sq_karray = (unsigned *) ( (unsigned char *) ring->sq_ring + params.sq_off.array        );
+	ring->cq_khead  = (unsigned *) ( (unsigned char *) ring->cq_ring + params.cq_off.head         );
+	ring->cq_ktail  = (unsigned *) ( (unsigned char *) ring->cq_ring + params.cq_off.tail         );
+	ring->cq_kmask  = (unsigned *) ( (unsigned char *) ring->cq_ring + params.cq_off.ring_mask    );
+	ring->cqes      = (struct io_uring_cqe *) ( (unsigned char *) ring->cq_ring + params.cq_off.cqes );
+	ring->sq_tail   = *ring->sq_ktail;
+
+	return true;
+
+}  /* open_ring */
+
+/*
+ * static bool size_files( struct uring_tp *ring, size_t num_files );
+ *
+ * The function size_files() makes sure that the table of fixed files of the
+ * ring has room for at least num_files sockets. The table is created empty
+ * and only filled for the duration of a batch.
+ *
+ * The function returns true if the table is large enough.
+ */
+
+static bool size_files( struct uring_tp *ring, size_t num_files ) {
+
+	size_t size;
+	struct io_uring_rsrc_register reg;
+
+	if ( num_files <= ring->num_files ) return true;
+
+	size = URING_MIN_FILES;
+	while ( size < num_files ) size <<= 1;
+
+	if ( ring->num_files > 0 ) {
+
+		syscall( __NR_io_uring_register, ring->fd, IORING_UNREGISTER_FILES, NULL, 0 );
+		ring->num_files = 0;
+	}
+
+	memset( & reg, 0, sizeof(reg) );
+
+	reg.nr    = (uint32_t) size;
+	reg.flags = IORING_RSRC_REGISTER_SPARSE;
+
+	if ( syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_FILES2, & reg, sizeof(reg) ) < 0 ) return false;
+
+	ring->num_files = size;
+
+	return true;
+
+}  /* size_files */
+
+/*
+ * static bool size_buffers( struct uring_tp *ring, size_t num_buffers );
+ *
+ * The function size_buffers() makes sure that the buffer ring has at least
+ * num_buffers receive buffers, limited to URING_MAX_BUFFERS. A batch which
+ * expects more responses still works, because receive requests which run out
+ * of buffers are armed again after buffers have been recycled.
+ *
+ * The function returns true if the buffer ring is ready for use.
+ */
+
+static bool size_buffers( struct uring_tp *ring, size_t num_buffers ) {
+
+	unsigned a;
+	unsigned entries;
+	struct io_uring_buf_reg reg;
+
+	entries = URING_MIN_BUFFERS;
+	while ( entries < num_buffers  &&  entries < URING_MAX_BUFFERS ) entries <<= 1;
+
+	if ( entries <= ring->buf_entries ) return true;
+
+	memset( & reg, 0, sizeof(reg) );
+
+	if ( ring->buf_ring != NULL ) {
+
+		reg.bgid = URING_BUF_GROUP;
+
+		syscall( __NR_io_uring_register, ring->fd, IORING_UNREGISTER_PBUF_RING, & reg, 1 );
+		munmap( ring->buf_ring, ring->buf_ring_len );
+		free( ring->buf );
+
+		ring->buf_ring    = NULL;
+		ring->buf         = NULL;
+		ring->buf_entries = 0;
+	}
+
+	ring->buf_ring_len = entries * sizeof(struct io_uring_buf);
+	ring->buf_ring     = mmap( NULL, ring->buf_ring_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+	if ( ring->buf_ring == MAP_FAILED ) {
+
+		ring->buf_ring = NULL;
+		return false;
+	}
+
+	ring->buf = malloc( (size_t) entries * URING_BUF_LEN );
+
+	if ( ring->buf == NULL ) {
+
+		munmap( ring->buf_ring, ring->buf_ring_len );
+		ring->buf_ring = NULL;
+
+		return false;
+	}
+
+	reg.ring_addr    = (uint64_t) (uintptr_t) ring->buf_ring;
+	reg.ring_entries = entries;
+	reg.bgid         = URING_BUF_GROUP;
+
+	if ( syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, & reg, 1 ) < 0 ) {
+
+		munmap( ring->buf_ring, ring->buf_ring_len );
+		free( ring->buf );
+
+		ring->buf_ring = NULL;
+		ring->buf      = NULL;
+
+		return false;
+	}
+
+	ring->buf_entries = entries;
+	ring->buf_tail    = 0;
+
+	for (a=0; a<entries; a++) recycle_buffer( ring, a );
+
+	return true;
+
+}  /* size_buffers */
+
+/*
+ * static bool attach_files( struct uring_tp *ring, const struct uring_batch_tp *batch, bool attach );
+ *
+ * The function attach_files() places the sockets of the connections in a
+ * batch in the table of fixed files, or removes them again after the batch.
+ * The index of a fixed file is always the index of the connection. Removing
+ * the sockets is necessary because the ring keeps a socket open as long as it
+ * is in the table.
+ *
+ * The function returns true if the table has been updated.
+ */
+
+static bool attach_files( struct uring_tp *ring, const struct uring_batch_tp *batch, bool attach ) {
+
+	size_t a;
+	int *fds;
+	long result;
+	struct io_uring_files_update update;
+
+	fds = malloc( batch->num_sys * sizeof(int) );
+	if ( fds == NULL ) return false;
+
+	for (a=0; a<batch->num_sys; a++) fds[a] = ( attach  &&  batch->retval[a] == FINS_RETVAL_SUCCESS ) ? batch->sys[a]->sockfd : -1;
+
+	memset( & update, 0, sizeof(update) );
+
+	update.offset = 0;
+	update.fds    = (uint64_t) (uintptr_t) fds;
+
+	result = syscall( __NR_io_uring_register, ring->fd, IORING_REGISTER_FILES_UPDATE, & update, (unsigned) batch->num_sys );
+
+	free( fds );
+
+	return ( result == (long) batch->num_sys );
+
+}  /* attach_files */
+
+/*
+ * static uint64_t user_data( const struct uring_tp *ring, uint64_t flags, size_t index );
+ *
+ * The function user_data() composes the value which identifies a request in
+ * its completion. Besides the type flags and the index of the connection or
+ * command, the number of the batch is included. Completions of requests from
+ * an earlier batch which arrive late can be recognized and ignored that way.
+ */
+
+static uint64_t user_data( const struct uring_tp *ring, uint64_t flags, size_t index ) {
+
+	return flags | ( (uint64_t) ring->generation << URING_GEN_SHIFT ) | ( (uint64_t) index & URING_INDEX_MASK );
+
+}  /* user_data */
+
+/*
+ * static void close_ring( struct uring_tp *ring );
+ *
+ * The function close_ring() closes a ring and releases the memory associated
+ * with it. Requests which are still active are cancelled by the kernel. This
+ * is only done when the thread which owns the ring ends.
+ */
+
+static void close_ring( struct uring_tp *ring ) {
+
+	if ( ring->fd >= 0 ) close( ring->fd );
+
+	if ( ring->sqes     != NULL                                        ) munmap( ring->sqes,     ring->sqes_len     );
+	if ( ring->cq_ring  != NULL  &&  ring->cq_ring != ring->sq_ring    ) munmap( ring->cq_ring,  ring->cq_ring_len  );
+	if ( ring->sq_ring  != NULL                                        ) munmap( ring->sq_ring,  ring->sq_ring_len  );
+	if ( ring->buf_ring != NULL                                        ) munmap( ring->buf_ring, ring->buf_ring_len );
+
+	free( ring->buf );
+
+	memset( ring, 0, sizeof(struct uring_tp) );
+
+	ring->fd = -1;
+
+}  /* close_ring */
+
+/*
+ * static struct io_uring_sqe *get_sqe( struct uring_tp *ring );
+ *
+ * The function get_sqe() returns a cleared entry in the submission queue. If
+ * the queue is full, the queued entries are submitted first. The entry is
+ * visible to the kernel immediately, but the kernel only looks at it at the
+ * next submit.
+ *
+ * The function returns a pointer to the entry or NULL if the queue is full.
+ */
+
+static struct io_uring_sqe *get_sqe( struct uring_tp *ring ) {
+
+	unsigned index;
+	struct io_uring_sqe *sqe;
+
+	if ( ring->sq_tail - __atomic_load_n( ring->sq_khead, __ATOMIC_ACQUIRE ) >= ring->sq_entries ) {
+
+		submit( ring );
+
+		if ( ring->sq_tail - __atomic_load_n( ring->sq_khead, __ATOMIC_ACQUIRE ) >= ring->sq_entries ) return NULL;
+	}
+
+	index = ring->sq_tail & *ring->sq_kmask;
+	sqe   = & ring->sqes[index];
+
+	memset( sqe, 0, sizeof(struct io_uring_sqe) );
+
+	ring->sq_karray[index] = index;
+	ring->sq_tail++;
+
+	__atomic_store_n( ring->sq_ktail, ring->sq_tail, __ATOMIC_RELEASE );
+
+	return sqe;
+
+}  /* get_sqe */
+
+/*
+ * static int submit( struct uring_tp *ring );
+ *
+ * The function submit() passes all queued entries to the kernel without
+ * waiting for completions.
+ *
+ * The function returns 0 on success or a negative errno value.
+ */
+
+static int submit( struct uring_tp *ring ) {
+
+	unsigned pending;
+	long result;
+
+	while ( ( pending = ring->sq_tail - __atomic_load_n( ring->sq_khead, __ATOMIC_ACQUIRE ) ) > 0 ) {
+
+		result = syscall( __NR_io_uring_enter, ring->fd, pending, 0, 0, NULL, 0 );
+
+		if ( result <  0 ) return -errno;
+		if ( result == 0 ) return -EBUSY;
+	}
+
+	return 0;
+
+}  /* submit */
+
+/*
+ * static int wait_cqe( struct uring_tp *ring, int64_t timeout_msec );
+ *
+ * The function wait_cqe() waits at most timeout_msec milliseconds until at
+ * least one completion is available.
+ *
+ * The function returns 0 on success or a negative errno value.
+ */
+
+static int wait_cqe( struct uring_tp *ring, int64_t timeout_msec ) {
+
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+
+	memset( & arg, 0, sizeof(arg) );
+
+	ts.tv_sec  = timeout_msec / 1000;
+	ts.tv_nsec = ( timeout_msec % 1000 ) * 1000000;
+	arg.ts     = (uint64_t) (uintptr_t) & ts;
+
+	if ( syscall( __NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, & arg, sizeof(arg) ) < 0 ) return -errno;
+
+	return 0;
+
+}  /* wait_cqe */
+
+/*
+ * static size_t reap( struct uring_tp *ring, struct uring_batch_tp *batch );
+ *
+ * The function reap() processes all completions which are available in the
+ * completion queue.
+ *
+ * The function returns the number of completions processed.
+ */
+
+static size_t reap( struct uring_tp *ring, struct uring_batch_tp *batch ) {
+
+	unsigned head;
+	size_t count;
+	struct io_uring_cqe cqe;
+
+	count = 0;
+	head  = *ring->cq_khead;
+
+	while ( head != __atomic_load_n( ring->cq_ktail, __ATOMIC_ACQUIRE ) ) {
+
+		cqe = ring->cqes[ head & *ring->cq_kmask ];
+		head++;
+
+		__atomic_store_n( ring->cq_khead, head, __ATOMIC_RELEASE );
+
+		process_cqe( ring, batch, & cqe );
+		count++;
+	}
+
+	return count;
+
+}  /* reap */
+
+/*
+ * static void recycle_buffer( struct uring_tp *ring, unsigned bid );
+ *
+ * The function recycle_buffer() hands receive buffer bid back to the kernel.
+ */
+
+static void recycle_buffer( struct uring_tp *ring, unsigned bid ) {
+
+	struct io_uring_buf *buf;
+
+	buf       = & ring->buf_ring->bufs[ ring->buf_tail & ( ring->buf_entries - 1 ) ];
+	buf->addr = (uint64_t) (uintptr_t) ( ring->buf + (size_t) bid * URING_BUF_LEN );
+	buf->len  = URING_BUF_LEN;
+	buf->bid  = (uint16_t) bid;
+
+	ring->buf_tail++;
+
+	__atomic_store_n( & ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE );
+
+}  /* recycle_buffer */
+
+/*
+ * static bool arm_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index );
+ *
+ * The function arm_recv() queues a multishot receive request for connection
+ * index. The request delivers every datagram arriving on the socket until it
+ * is cancelled or runs out of buffers.
+ *
+ * The function returns true if the request has been queued.
+ */
+
+static bool arm_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index ) {
+
+	struct io_uring_sqe *sqe;
+
+	sqe = get_sqe( ring );
+	if ( sqe == NULL ) return false;
+
+	sqe->opcode    = IORING_OP_RECV;
+	sqe->fd        = (int32_t) index;
+	sqe->flags     = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+	sqe->ioprio    = IORING_RECV_MULTISHOT;
+	sqe->buf_group = URING_BUF_GROUP;
+	sqe->user_data = user_data( ring, URING_RECV_FLAG, index );
+
+	batch->conn[index].armed = true;
+
+	return true;
+
+}  /* arm_recv */
+
+/*
+ * static void queue_commands( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, fins_pipeline_build_tp build );
+ *
+ * The function queue_commands() builds the commands for connection index and
+ * queues a send request for each of them. An error while building stops the
+ * connection, but the commands already queued are still completed.
+ */
+
+static void queue_commands( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, fins_pipeline_build_tp build ) {
+
+	size_t a;
+	size_t bodylen;
+	int retval;
+	struct fins_sys_tp *sys;
+	struct uring_conn_tp *conn;
+	struct uring_slot_tp *slot;
+	struct io_uring_sqe *sqe;
+
+	sys  = batch->sys[index];
+	conn = & batch->conn[index];
+
+	for (a=0; a<batch->num_command; a++) {
+
+		slot   = & batch->slot[ index * batch->num_command + a ];
+		retval = build( sys, a, & slot->frame, & bodylen, batch->context[index] );
+
+		if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) return;
+
+		if ( retval == FINS_RETVAL_SUCCESS  &&  bodylen > FINS_BODY_LEN ) retval = FINS_RETVAL_BODY_TOO_LONG;
+
+		if ( retval != FINS_RETVAL_SUCCESS ) {
+
+			batch->retval[index] = retval;
+			return;
+		}
+
+		if ( sys->cache    != NULL ) XX_finslib_cache_invalidate(    sys, & slot->frame, bodylen );
+		if ( sys->dircache != NULL ) XX_finslib_dircache_invalidate( sys, & slot->frame, bodylen );
+
+		if ( ( sqe = get_sqe( ring ) ) == NULL ) {
+
+			batch->retval[index] = FINS_RETVAL_ERRNO_BASE + EBUSY;
+			return;
+		}
+
+		XX_FINS_TRACE( sys, FINS_TRACE_SEND_START, slot->frame.header, FINS_RETVAL_SUCCESS );
+
+		slot->sent_len        = FINS_HEADER_LEN + bodylen;
+		slot->start_time      = ( sys->stats != NULL ) ? finslib_monotonic_nsec_timer() : 0;
+		slot->iov.iov_base    = & slot->frame;
+		slot->iov.iov_len     = slot->sent_len;
+		slot->msg.msg_name    = & conn->addr;
+		slot->msg.msg_namelen = sizeof(conn->addr);
+		slot->msg.msg_iov     = & slot->iov;
+		slot->msg.msg_iovlen  = 1;
+
+		sqe->opcode    = IORING_OP_SENDMSG;
+		sqe->fd        = (int32_t) index;
+		sqe->flags     = IOSQE_FIXED_FILE;
+		sqe->addr      = (uint64_t) (uintptr_t) & slot->msg;
+		sqe->len       = 1;
+		sqe->user_data = user_data( ring, 0, index * batch->num_command + a );
+
+		conn->num_sent++;
+		conn->outstanding++;
+		batch->outstanding++;
+	}
+
+}  /* queue_commands */
+
+/*
+ * static void process_cqe( struct uring_tp *ring, struct uring_batch_tp *batch, const struct io_uring_cqe *cqe );
+ *
+ * The function process_cqe() dispatches a completion to the routine which
+ * handles the type of request it belongs to. Completions which belong to an
+ * earlier batch are ignored, but a receive buffer they carry is recycled.
+ */
+
+static void process_cqe( struct uring_tp *ring, struct uring_batch_tp *batch, const struct io_uring_cqe *cqe ) {
+
+	size_t index;
+
+	if ( ( ( cqe->user_data >> URING_GEN_SHIFT ) & URING_GEN_MASK ) != ring->generation ) {
+
+		if ( cqe->flags & IORING_CQE_F_BUFFER ) recycle_buffer( ring, cqe->flags >> IORING_CQE_BUFFER_SHIFT );
+		return;
+	}
+
+	if ( cqe->user_data & URING_CANCEL_FLAG ) return;
+
+	index = (size_t) ( cqe->user_data & URING_INDEX_MASK );
+
+	if ( cqe->user_data & URING_RECV_FLAG ) {
+
+		if ( index < batch->num_sys ) process_recv( ring, batch, index, cqe );
+		return;
+	}
+
+	if ( index < batch->num_sys * batch->num_command ) process_send( batch, index, cqe->res );
+
+}  /* process_cqe */
+
+/*
+ * static void process_send( struct uring_batch_tp *batch, size_t index, int res );
+ *
+ * The function process_send() finishes a send request for command slot index
+ * with the result res as reported by the kernel.
+ */
+
+static void process_send( struct uring_batch_tp *batch, size_t index, int res ) {
+
+	size_t conn_index;
+	int retval;
+	struct fins_sys_tp *sys;
+	struct uring_slot_tp *slot;
+
+	conn_index = index / batch->num_command;
+	sys        = batch->sys[conn_index];
+	slot       = & batch->slot[index];
+
+	if      ( res          <  0              ) retval = FINS_RETVAL_ERRNO_BASE - res;
+	else if ( (size_t) res != slot->sent_len ) retval = FINS_RETVAL_COMMAND_SEND_ERROR;
+	else                                       retval = FINS_RETVAL_SUCCESS;
+
+	retval = XX_finslib_send_complete( sys, & slot->frame, slot->sent_len - FINS_HEADER_LEN, retval );
+
+	if ( retval == FINS_RETVAL_SUCCESS  ||  slot->done ) return;
+
+	if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->frame.header, 0, 0, 0, retval, false );
+
+	if ( batch->retval[conn_index] == FINS_RETVAL_SUCCESS ) batch->retval[conn_index] = retval;
+
+	slot->done = true;
+	batch->conn[conn_index].outstanding--;
+	batch->outstanding--;
+
+}  /* process_send */
+
+/*
+ * static void process_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, const struct io_uring_cqe *cqe );
+ *
+ * The function process_recv() handles a datagram received on connection
+ * index. The response is matched with its command through the Service ID,
+ * checked and passed to the handle function. The multishot receive request
+ * is armed again if the kernel ended it while responses are still expected.
+ */
+
+static void process_recv( struct uring_tp *ring, struct uring_batch_tp *batch, size_t index, const struct io_uring_cqe *cqe ) {
+
+	size_t a;
+	size_t bodylen;
+	unsigned bid;
+	int retval;
+	struct fins_sys_tp *sys;
+	struct uring_conn_tp *conn;
+	struct uring_slot_tp *slot;
+	struct fins_command_tp response;
+
+	sys  = batch->sys[index];
+	conn = & batch->conn[index];
+
+	if ( ! ( cqe->flags & IORING_CQE_F_MORE ) ) conn->armed = false;
+
+	if ( cqe->res < 0 ) {
+
+		/*
+		 * Running out of buffers ends the multishot request without
+		 * losing data. The datagram stays in the socket until the
+		 * request is armed again.
+		 */
+
+		if ( cqe->res != -ENOBUFS  &&  cqe->res != -ECANCELED ) fail_conn( batch, index, FINS_RETVAL_ERRNO_BASE - cqe->res );
+	}
+
+	else if ( cqe->flags & IORING_CQE_F_BUFFER ) {
+
+		bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+		memcpy( & response, ring->buf + (size_t) bid * URING_BUF_LEN, ( (size_t) cqe->res < sizeof(response) ) ? (size_t) cqe->res : sizeof(response) );
+		recycle_buffer( ring, bid );
+
+		if ( conn->outstanding > 0 ) {
+
+			retval = XX_finslib_recv_complete( sys, NULL, & response, cqe->res, FINS_RETVAL_SUCCESS, & bodylen );
+
+			if ( retval != FINS_RETVAL_SUCCESS ) finish_conn( batch, index, retval );
+
+			else {
+				for (a=0; a<conn->num_sent; a++) {
+
+					slot = & batch->slot[ index * batch->num_command + a ];
+
+					if ( ! slot->done  &&  slot->frame.header[FINS_SID] == response.header[FINS_SID] ) break;
+				}
+
+				/*
+				 * As in the pipeline, a response with an
+				 * unknown Service ID is a late response to an
+				 * earlier command and is ignored.
+				 */
+
+				if ( a < conn->num_sent ) {
+
+					slot->done = true;
+					conn->outstanding--;
+					batch->outstanding--;
+
+					retval = XX_finslib_check_response( sys, slot->frame.header, & response, bodylen );
+
+					if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->frame.header, slot->sent_len, FINS_HEADER_LEN + bodylen, finslib_monotonic_nsec_timer() - slot->start_time, retval, false );
+
+					if ( retval == FINS_RETVAL_SUCCESS  &&  ! conn->stopped ) retval = batch->handle( sys, a, & response, bodylen, batch->context[index] );
+
+					if ( retval == FINS_RETVAL_SUCCESS_LAST_DATA ) {
+
+						conn->stopped = true;
+						retval        = FINS_RETVAL_SUCCESS;
+					}
+
+					if ( retval != FINS_RETVAL_SUCCESS  &&  batch->retval[index] == FINS_RETVAL_SUCCESS ) batch->retval[index] = retval;
+				}
+			}
+		}
+	}
+
+	if ( ! conn->armed  &&  conn->outstanding > 0 ) {
+
+		if ( ! arm_recv( ring, batch, index ) ) fail_conn( batch, index, FINS_RETVAL_ERRNO_BASE + EBUSY );
+	}
+
+}  /* process_recv */
+
+/*
+ * static void fail_conn( struct uring_batch_tp *batch, size_t index, int error_code );
+ *
+ * The function fail_conn() ends all commands of connection index which are
+ * still waiting for a response with error_code. The error is counted on the
+ * connection once, in the same way as a failing receive on a blocking socket.
+ */
+
+static void fail_conn( struct uring_batch_tp *batch, size_t index, int error_code ) {
+
+	size_t a;
+	size_t bodylen;
+	struct uring_slot_tp *slot;
+
+	if ( batch->conn[index].outstanding == 0 ) return;
+
+	slot = & batch->slot[ index * batch->num_command ];
+
+	for (a=0; a<batch->conn[index].num_sent; a++) {
+
+		if ( ! slot[a].done ) { slot = & slot[a]; break; }
+	}
+
+	finish_conn( batch, index, XX_finslib_recv_complete( batch->sys[index], slot->frame.header, & slot->frame, -1, error_code, & bodylen ) );
+
+}  /* fail_conn */
+
+/*
+ * static void finish_conn( struct uring_batch_tp *batch, size_t index, int retval );
+ *
+ * The function finish_conn() ends all commands of connection index which are
+ * still waiting for a response with the error retval which has already been
+ * counted on the connection.
+ */
+
+static void finish_conn( struct uring_batch_tp *batch, size_t index, int retval ) {
+
+	size_t a;
+	struct fins_sys_tp *sys;
+	struct uring_conn_tp *conn;
+	struct uring_slot_tp *slot;
+
+	sys  = batch->sys[index];
+	conn = & batch->conn[index];
+
+	for (a=0; a<conn->num_sent; a++) {
+
+		slot = & batch->slot[ index * batch->num_command + a ];
+
+		if ( slot->done ) continue;
+
+		if ( sys->stats != NULL ) XX_finslib_stats_command( sys, slot->frame.header, slot->sent_len, 0, 0, retval, false );
+
+		slot->done = true;
+		conn->outstanding--;
+		batch->outstanding--;
+	}
+
+	if ( batch->retval[index] == FINS_RETVAL_SUCCESS ) batch->retval[index] = retval;
+
+}  /* finish_conn */
+
+/*
+ * static void cancel_recv( struct uring_tp *ring, struct uring_batch_tp *batch );
+ *
+ * The function cancel_recv() cancels the multishot receive requests which are
+ * still active and waits briefly until the kernel has confirmed that. This
+ * guarantees that no datagram which arrives after the batch is consumed by a
+ * request which nobody looks at anymore. Such a datagram then stays in the
+ * socket and is seen as a late response by the next command.
+ */
+
+static void cancel_recv( struct uring_tp *ring, struct uring_batch_tp *batch ) {
+
+	size_t a;
+	bool armed;
+	int64_t deadline;
+	int64_t now;
+	struct io_uring_sqe *sqe;
+
+	for (a=0; a<batch->num_sys; a++) {
+
+		if ( ! batch->conn[a].armed ) continue;
+
+		if ( ( sqe = get_sqe( ring ) ) == NULL ) return;
+
+		sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+		sqe->fd        = -1;
+		sqe->addr      = user_data( ring, URING_RECV_FLAG,   a );
+		sqe->user_data = user_data( ring, URING_CANCEL_FLAG, a );
+	}
+
+	submit( ring );
+
+	deadline = finslib_monotonic_msec_timer() + URING_CANCEL_TIMEOUT;
+
+	do {
+		reap( ring, batch );
+
+		armed = false;
+		for (a=0; a<batch->num_sys; a++) if ( batch->conn[a].armed ) armed = true;
+
+		if ( ! armed ) break;
+
+		now = finslib_monotonic_msec_timer();
+		if ( now >= deadline ) break;
+
+		wait_cqe( ring, deadline - now );
+
+	} while ( true );
+
+}  /* cancel_recv */
+
+#endif  /* defined(FINS_ENABLE_IO_URING)  &&  defined(__linux__) */
@@ -511,6 +511,92 @@ time_t finslib_monotonic_sec_timer( void ) {
 
 }  /* finslib_monotonic_sec_timer */
 
+/*
+ * int64_t finslib_monotonic_msec_timer( void );
+ *
+ * The function finslib_monotonic_msec_timer() returns the value of a
+ * milliseconds timer which is guaranteed to be monotonic, but has no
+ * connection with the wall clock.
+ */
+
+int64_t finslib_monotonic_msec_timer( void ) {
+
+#if defined(_WIN32)
+
+#if (WINVER < _WIN32_WINNT_VISTA)
+
+	LARGE_INTEGER performance_counter;
+	LARGE_INTEGER performance_frequency;
+	int64_t counter_value;
+	int64_t frequency_value;
+
+	QueryPerformanceCounter(   & performance_counter   );
+	QueryPerformanceFrequency( & performance_frequency );
+
+	counter_value   = performance_counter.QuadPart;
+	frequency_value = performance_frequency.QuadPart;
+
+	if ( frequency_value <= 0 ) return counter_value;
+
+	return (counter_value/frequency_value) * 1000 + ((counter_value%frequency_value) * 1000) / frequency_value;
+
+#else  /* (WINVER < _WIN32_WINNT_VISTA) */
+
+	return (int64_t) GetTickCount64();
+
+#endif  /* (WINVER < _WIN32_WINNT_VISTA) */
+
+#else  /* defined(_WIN32) */
+
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, & ts );
+	return ((int64_t) ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+
+#endif  /* defined(_WIN32) */
+
+}  /* finslib_monotonic_msec_timer */
+
+/*
+ * int64_t finslib_monotonic_nsec_timer( void );
+ *
+ * The function finslib_monotonic_nsec_timer() returns the value of a
+ * nanoseconds timer which is guaranteed to be monotonic, but has no
+ * connection with the wall clock. The real resolution depends on the
+ * operating system and hardware. It is intended to measure short intervals
+ * like the round trip time of a FINS command.
+ */
+
+int64_t finslib_monotonic_nsec_timer( void ) {
+
+#if defined(_WIN32)
+
+	LARGE_INTEGER performance_counter;
+	LARGE_INTEGER performance_frequency;
+	int64_t counter_value;
+	int64_t frequency_value;
+
+	QueryPerformanceCounter(   & performance_counter   );
+	QueryPerformanceFrequency( & performance_frequency );
+
+	counter_value   = performance_counter.QuadPart;
+	frequency_value = performance_frequency.QuadPart;
+
+	if ( frequency_value <= 0 ) return counter_value;
+
+	return (counter_value/frequency_value) * 1000000000 + ((counter_value%frequency_value) * 1000000000) / frequency_value;
+
+#else  /* defined(_WIN32) */
+
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, & ts );
+	return ((int64_t) ts.tv_sec) * 1000000000 + ts.tv_nsec;
+
+#endif  /* defined(_WIN32) */
+
+}  /* finslib_monotonic_nsec_timer */
+
 /*
  * void finslib_milli_second_sleep( int msec );
  *
@@ -759,3 +845,68 @@ const char *finslib_inet_ntop( int af, const void *src, char *dst, socklen_t siz
 #endif  /* defined(_WIN32)  &&  (WINVER < _WIN32_WINNT_VISTA) */
 
 }  /* finslib_inet_ntop */
+
+
+
+/*
+ * void XX_finslib_put_uint32( unsigned char *buf, uint32_t value );
+ *
+ * The function XX_finslib_put_uint32() stores a 32 bit value in a buffer with
+ * the most significant byte first. This is the byte order of all numbers in
+ * the files written by the library.
+ */
+
+void XX_finslib_put_uint32( unsigned char *buf, uint32_t value ) {
+
+	buf[0] = (value >> 24) & 0xff;
+	buf[1] = (value >> 16) & 0xff;
+	buf[2] = (value >>  8) & 0xff;
+	buf[3] = (value      ) & 0xff;
+
+}  /* XX_finslib_put_uint32 */
+
+
+
+/*
+ * void XX_finslib_put_uint64( unsigned char *buf, uint64_t value );
+ *
+ * The function XX_finslib_put_uint64() stores a 64 bit value in a buffer with
+ * the most significant byte first.
+ */
+
+void XX_finslib_put_uint64( unsigned char *buf, uint64_t value ) {
+
+	XX_finslib_put_uint32( buf,   (uint32_t) ( value >> 32 ) );
+	XX_finslib_put_uint32( buf+4, (uint32_t) ( value       ) );
+
+}  /* XX_finslib_put_uint64 */
+
+
+
+/*
+ * uint32_t XX_finslib_get_uint32( const unsigned char *buf );
+ *
+ * The function XX_finslib_get_uint32() reads a 32 bit value from a buffer in
+ * which it is stored with the most significant byte first.
+ */
+
+uint32_t XX_finslib_get_uint32( const unsigned char *buf ) {
+
+	return ( (uint32_t) buf[0] << 24 ) | ( (uint32_t) buf[1] << 16 ) | ( (uint32_t) buf[2] << 8 ) | (uint32_t) buf[3];
+
+}  /* XX_finslib_get_uint32 */
+
+
+
+/*
+ * uint64_t XX_finslib_get_uint64( const unsigned char *buf );
+ *
+ * The function XX_finslib_get_uint64() reads a 64 bit value from a buffer in
+ * which it is stored with the most significant byte first.
+ */
+
+uint64_t XX_finslib_get_uint64( const unsigned char *buf ) {
+
+	return ( (uint64_t) XX_finslib_get_uint32( buf ) << 32 ) | XX_finslib_get_uint32( buf+4 );
+
+}  /* XX_finslib_get_uint64 */